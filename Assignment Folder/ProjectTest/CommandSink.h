@@ -0,0 +1,33 @@
+//***************************************************************************************
+// CommandSink.h
+//
+// Target of draw recording.  The record scheduler issues its state changes and draws
+// through this interface so the partitioning and redundant state filtering do not
+// depend on D3D12 and can be driven by a mock that just logs the calls.
+//***************************************************************************************
+
+#pragma once
+
+#include <cstdint>
+
+class CommandSink
+{
+public:
+	virtual ~CommandSink() {}
+
+	// Layer PSO, geometry sort id and D3D_PRIMITIVE_TOPOLOGY of the following draws.
+	virtual void SetPipeline(std::uint32_t pso) = 0;
+	virtual void SetGeometry(std::uint32_t geometry) = 0;
+	virtual void SetTopology(std::uint32_t topology) = 0;
+
+	// Index of the material in the material buffer, which also names its texture.
+	virtual void SetMaterial(std::uint32_t matIndex) = 0;
+
+	// ObjectCB element of a non-instanced draw, or the first InstanceIndices slot of
+	// an instanced one.
+	virtual void SetObject(std::uint32_t objCBIndex) = 0;
+	virtual void SetInstanceBase(std::uint32_t instanceBase) = 0;
+
+	virtual void DrawIndexed(std::uint32_t indexCount, std::uint32_t instanceCount,
+		std::uint32_t startIndex, std::int32_t baseVertex) = 0;
+};
@@ -0,0 +1,51 @@
+//***************************************************************************************
+// D3D12CommandSink.cpp
+//***************************************************************************************
+
+#include "D3D12CommandSink.h"
+
+D3D12CommandSink::D3D12CommandSink(ID3D12GraphicsCommandList* cmdList, const Bindings& bindings)
+	: mCmdList(cmdList), mBindings(bindings)
+{
+}
+
+void D3D12CommandSink::SetPipeline(std::uint32_t pso)
+{
+	mCmdList->SetPipelineState(mBindings.Psos[pso]);
+}
+
+void D3D12CommandSink::SetGeometry(std::uint32_t geometry)
+{
+	MeshGeometry* geo = (*mBindings.Geometries)[geometry];
+	D3D12_VERTEX_BUFFER_VIEW vbv = geo == mBindings.DynamicGeometry ?
+		mBindings.DynamicVertexBuffer : geo->VertexBufferView();
+	D3D12_INDEX_BUFFER_VIEW ibv = geo->IndexBufferView();
+	mCmdList->IASetVertexBuffers(0, 1, &vbv);
+	mCmdList->IASetIndexBuffer(&ibv);
+}
+
+void D3D12CommandSink::SetTopology(std::uint32_t topology)
+{
+	mCmdList->IASetPrimitiveTopology((D3D12_PRIMITIVE_TOPOLOGY)topology);
+}
+
+void D3D12CommandSink::SetMaterial(std::uint32_t matIndex)
+{
+	mCmdList->SetGraphicsRoot32BitConstant(6, matIndex, 1);
+}
+
+void D3D12CommandSink::SetObject(std::uint32_t objCBIndex)
+{
+	mCmdList->SetGraphicsRootConstantBufferView(1, mBindings.ObjectCB + (UINT64)objCBIndex*mBindings.ObjCBByteSize);
+}
+
+void D3D12CommandSink::SetInstanceBase(std::uint32_t instanceBase)
+{
+	mCmdList->SetGraphicsRoot32BitConstant(6, instanceBase, 0);
+}
+
+void D3D12CommandSink::DrawIndexed(std::uint32_t indexCount, std::uint32_t instanceCount,
+	std::uint32_t startIndex, std::int32_t baseVertex)
+{
+	mCmdList->DrawIndexedInstanced(indexCount, instanceCount, startIndex, baseVertex, 0);
+}
@@ -0,0 +1,47 @@
+//***************************************************************************************
+// D3D12CommandSink.h
+//
+// CommandSink that records into a D3D12 graphics command list.  The ids used by the
+// draw packets are resolved through the tables in Bindings, which the app fills once
+// per frame; the root parameter slots match the TreeBillboards root signature.
+//***************************************************************************************
+
+#pragma once
+
+#include "../../Common/d3dUtil.h"
+#include "CommandSink.h"
+#include <vector>
+
+class D3D12CommandSink : public CommandSink
+{
+public:
+	struct Bindings
+	{
+		// PSO of each layer and geometry of each geometry sort id.
+		ID3D12PipelineState* const* Psos = nullptr;
+		const std::vector<MeshGeometry*>* Geometries = nullptr;
+
+		D3D12_GPU_VIRTUAL_ADDRESS ObjectCB = 0;
+		UINT ObjCBByteSize = 0;
+
+		// Geometry whose vertices are rewritten every frame, drawn from the vertex
+		// buffer of the frame being recorded instead of its own.
+		const MeshGeometry* DynamicGeometry = nullptr;
+		D3D12_VERTEX_BUFFER_VIEW DynamicVertexBuffer = {};
+	};
+
+	D3D12CommandSink(ID3D12GraphicsCommandList* cmdList, const Bindings& bindings);
+
+	void SetPipeline(std::uint32_t pso) override;
+	void SetGeometry(std::uint32_t geometry) override;
+	void SetTopology(std::uint32_t topology) override;
+	void SetMaterial(std::uint32_t matIndex) override;
+	void SetObject(std::uint32_t objCBIndex) override;
+	void SetInstanceBase(std::uint32_t instanceBase) override;
+	void DrawIndexed(std::uint32_t indexCount, std::uint32_t instanceCount,
+		std::uint32_t startIndex, std::int32_t baseVertex) override;
+
+private:
+	ID3D12GraphicsCommandList* mCmdList = nullptr;
+	const Bindings& mBindings;
+};
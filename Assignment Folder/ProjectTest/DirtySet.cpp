@@ -0,0 +1,76 @@
+//***************************************************************************************
+// DirtySet.cpp
+//***************************************************************************************
+
+#include "DirtySet.h"
+#include <algorithm>
+#include <cassert>
+
+DirtySet::DirtySet(int frameResourceCount)
+	: mFrames(frameResourceCount)
+{
+}
+
+void DirtySet::Resize(std::uint32_t elementCount)
+{
+	const std::uint32_t oldCount = mElementCount;
+	mElementCount = elementCount;
+
+	for(auto& frame : mFrames)
+	{
+		frame.Stamps.resize(elementCount, 0);
+
+		if(elementCount < oldCount)
+		{
+			auto removed = std::remove_if(frame.Pending.begin(), frame.Pending.end(),
+				[elementCount](std::uint32_t index) { return index >= elementCount; });
+			frame.Pending.erase(removed, frame.Pending.end());
+		}
+	}
+
+	for(std::uint32_t i = oldCount; i < elementCount; ++i)
+		MarkDirty(i);
+}
+
+std::uint32_t DirtySet::Size()const
+{
+	return mElementCount;
+}
+
+void DirtySet::MarkDirty(std::uint32_t index)
+{
+	assert(index < mElementCount);
+
+	for(auto& frame : mFrames)
+	{
+		if(frame.Stamps[index] != frame.Generation)
+		{
+			frame.Stamps[index] = frame.Generation;
+			frame.Pending.push_back(index);
+		}
+	}
+}
+
+void DirtySet::MarkAllDirty()
+{
+	for(std::uint32_t i = 0; i < mElementCount; ++i)
+		MarkDirty(i);
+}
+
+const std::vector<std::uint32_t>& DirtySet::Pending(int frameIndex)const
+{
+	return mFrames[frameIndex].Pending;
+}
+
+void DirtySet::ClearPending(int frameIndex)
+{
+	FrameList& frame = mFrames[frameIndex];
+	frame.Pending.clear();
+
+	// On wrap-around reset the stamps so an old stamp can never match again.
+	if(++frame.Generation == 0)
+	{
+		std::fill(frame.Stamps.begin(), frame.Stamps.end(), 0);
+		frame.Generation = 1;
+	}
+}
@@ -0,0 +1,51 @@
+//***************************************************************************************
+// DirtySet.h
+//
+// Tracks which elements (render items, materials) changed and still need to be
+// uploaded into each FrameResource.  Instead of scanning every element for a dirty
+// counter each frame, MarkDirty appends the index to a dense pending list per frame
+// resource, so the per-frame cost is proportional to what actually changed.
+//***************************************************************************************
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+class DirtySet
+{
+public:
+	explicit DirtySet(int frameResourceCount);
+	DirtySet(const DirtySet& rhs) = delete;
+	DirtySet& operator=(const DirtySet& rhs) = delete;
+	~DirtySet() = default;
+
+	// Grows (or shrinks) the number of tracked elements.  New elements start dirty.
+	void Resize(std::uint32_t elementCount);
+	std::uint32_t Size()const;
+
+	// Queues the element for upload into every frame resource.  Marking an element
+	// again before a frame resource consumed it does not queue a duplicate.
+	void MarkDirty(std::uint32_t index);
+	void MarkAllDirty();
+
+	// Elements the given frame resource still has to upload.
+	const std::vector<std::uint32_t>& Pending(int frameIndex)const;
+
+	// Call after the frame resource uploaded everything returned by Pending().
+	void ClearPending(int frameIndex);
+
+private:
+	struct FrameList
+	{
+		std::vector<std::uint32_t> Pending;
+
+		// Stamps[i] == Generation means element i is already in Pending.  Bumping the
+		// generation on clear invalidates all stamps without touching them.
+		std::vector<std::uint32_t> Stamps;
+		std::uint32_t Generation = 1;
+	};
+
+	std::vector<FrameList> mFrames;
+	std::uint32_t mElementCount = 0;
+};
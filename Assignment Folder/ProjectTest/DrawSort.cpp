@@ -0,0 +1,124 @@
+//***************************************************************************************
+// DrawSort.cpp
+//***************************************************************************************
+
+#include "DrawSort.h"
+#include <cstring>
+#include <utility>
+
+namespace
+{
+	std::uint64_t Field(std::uint32_t value, int bits)
+	{
+		return (std::uint64_t)value & ((1ull << bits) - 1ull);
+	}
+}
+
+std::uint64_t DrawSort::QuantizeDepth(float depth01, int bits)
+{
+	if(!(depth01 > 0.0f))
+		depth01 = 0.0f;
+	if(depth01 > 1.0f)
+		depth01 = 1.0f;
+
+	const std::uint64_t maxValue = (1ull << bits) - 1ull;
+	return (std::uint64_t)(depth01 * (double)maxValue);
+}
+
+std::uint64_t DrawSort::MakeFrontToBackKey(std::uint32_t layer, std::uint32_t pso,
+	std::uint32_t geometry, std::uint32_t submesh, std::uint32_t material, float depth01)
+{
+	const int depthBits = 64 - LayerBits - PsoBits - GeometryBits - SubmeshBits - MaterialBits;
+
+	std::uint64_t key = Field(layer, LayerBits);
+	key = (key << PsoBits) | Field(pso, PsoBits);
+	key = (key << GeometryBits) | Field(geometry, GeometryBits);
+	key = (key << SubmeshBits) | Field(submesh, SubmeshBits);
+	key = (key << MaterialBits) | Field(material, MaterialBits);
+	key = (key << depthBits) | QuantizeDepth(depth01, depthBits);
+
+	return key;
+}
+
+std::uint64_t DrawSort::MakeBackToFrontKey(std::uint32_t layer, std::uint32_t pso,
+	std::uint32_t geometry, std::uint32_t submesh, std::uint32_t material, float depth01)
+{
+	const int depthBits = 24;
+	const int padBits = 64 - LayerBits - depthBits - PsoBits - GeometryBits - SubmeshBits - MaterialBits;
+
+	// Invert the depth so the farthest item gets the smallest key.
+	const std::uint64_t maxDepth = (1ull << depthBits) - 1ull;
+	const std::uint64_t invDepth = maxDepth - QuantizeDepth(depth01, depthBits);
+
+	std::uint64_t key = Field(layer, LayerBits);
+	key = (key << depthBits) | invDepth;
+	key = (key << PsoBits) | Field(pso, PsoBits);
+	key = (key << GeometryBits) | Field(geometry, GeometryBits);
+	key = (key << SubmeshBits) | Field(submesh, SubmeshBits);
+	key = (key << MaterialBits) | Field(material, MaterialBits);
+	key = key << padBits;
+
+	return key;
+}
+
+float DrawSort::NormalizeDepth(float viewZ, float nearZ, float farZ)
+{
+	return (viewZ - nearZ) / (farZ - nearZ);
+}
+
+void DrawSort::RadixSort(std::vector<DrawSortItem>& items, std::vector<DrawSortItem>& scratch)
+{
+	const size_t count = items.size();
+	if(count < 2)
+		return;
+
+	scratch.resize(count);
+
+	// Build the histograms for all eight digits in a single pass over the keys.
+	std::uint32_t histograms[8][256];
+	std::memset(histograms, 0, sizeof(histograms));
+
+	for(size_t i = 0; i < count; ++i)
+	{
+		std::uint64_t key = items[i].Key;
+		for(int pass = 0; pass < 8; ++pass)
+		{
+			++histograms[pass][key & 0xff];
+			key >>= 8;
+		}
+	}
+
+	DrawSortItem* src = items.data();
+	DrawSortItem* dst = scratch.data();
+
+	for(int pass = 0; pass < 8; ++pass)
+	{
+		std::uint32_t* histogram = histograms[pass];
+
+		// Every key shares this digit, so the pass would not move anything.
+		const std::uint32_t firstDigit = (std::uint32_t)((src[0].Key >> (pass * 8)) & 0xff);
+		if(histogram[firstDigit] == count)
+			continue;
+
+		// Exclusive prefix sum gives the first output slot of each digit.
+		std::uint32_t offset = 0;
+		for(int digit = 0; digit < 256; ++digit)
+		{
+			std::uint32_t digitCount = histogram[digit];
+			histogram[digit] = offset;
+			offset += digitCount;
+		}
+
+		for(size_t i = 0; i < count; ++i)
+		{
+			const std::uint32_t digit = (std::uint32_t)((src[i].Key >> (pass * 8)) & 0xff);
+			dst[histogram[digit]++] = src[i];
+		}
+
+		std::swap(src, dst);
+	}
+
+	// An odd number of executed passes leaves the result in the scratch buffer.
+	if(src != items.data())
+		items.swap(scratch);
+}
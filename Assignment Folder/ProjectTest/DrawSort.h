@@ -0,0 +1,79 @@
+//***************************************************************************************
+// DrawSort.h
+//
+// 64-bit draw sort keys and a radix sort used to order the visible render items so
+// that command recording can skip redundant pipeline, input assembler and root bindings.
+//***************************************************************************************
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// One entry of the per-frame draw list.  Index refers back to the render item.
+struct DrawSortItem
+{
+	std::uint64_t Key = 0;
+	std::uint32_t Index = 0;
+};
+
+// Per-frame counters so we can verify how much state setting the sort saves.
+struct DrawStats
+{
+	std::uint32_t DrawCalls = 0;
+	std::uint32_t Instances = 0;
+	std::uint32_t BindsIssued = 0;
+	std::uint32_t BindsSkipped = 0;
+
+	void Reset()
+	{
+		DrawCalls = 0;
+		Instances = 0;
+		BindsIssued = 0;
+		BindsSkipped = 0;
+	}
+
+	void Add(const DrawStats& rhs)
+	{
+		DrawCalls += rhs.DrawCalls;
+		Instances += rhs.Instances;
+		BindsIssued += rhs.BindsIssued;
+		BindsSkipped += rhs.BindsSkipped;
+	}
+};
+
+class DrawSort
+{
+public:
+	// Key layout, most significant bits first.
+	//
+	//   Front-to-back: layer:4 | pso:6 | geometry:8 | submesh:8 | material:10 | depth:28
+	//   Back-to-front: layer:4 | ~depth:24 | pso:6 | geometry:8 | submesh:8 | material:10 | 0:4
+	//
+	// The layer is always on top so layers draw in a fixed order.  Opaque style layers
+	// are then grouped by state and drawn roughly front-to-back inside each group, while
+	// blended layers are ordered strictly back-to-front and only grouped by state when
+	// two items are at the same depth.
+	static const int LayerBits = 4;
+	static const int PsoBits = 6;
+	static const int GeometryBits = 8;
+	static const int SubmeshBits = 8;
+	static const int MaterialBits = 10;
+
+	static std::uint64_t MakeFrontToBackKey(std::uint32_t layer, std::uint32_t pso,
+		std::uint32_t geometry, std::uint32_t submesh, std::uint32_t material, float depth01);
+
+	static std::uint64_t MakeBackToFrontKey(std::uint32_t layer, std::uint32_t pso,
+		std::uint32_t geometry, std::uint32_t submesh, std::uint32_t material, float depth01);
+
+	// Maps a view space depth to [0, 1] between the near and far planes.
+	static float NormalizeDepth(float viewZ, float nearZ, float farZ);
+
+	// Stable LSD radix sort on the 64-bit keys, 8 bits per pass.  Passes where every
+	// key has the same digit are skipped.  The scratch vector is reused between frames
+	// so the sort does not allocate once the draw list has reached its peak size.
+	static void RadixSort(std::vector<DrawSortItem>& items, std::vector<DrawSortItem>& scratch);
+
+private:
+	static std::uint64_t QuantizeDepth(float depth01, int bits);
+};
@@ -0,0 +1,292 @@
+//***************************************************************************************
+// FrameBench.cpp
+//***************************************************************************************
+
+#include "FrameBench.h"
+#include "NullCommandSink.h"
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <ppl.h>
+
+using namespace DirectX;
+
+// The app's simulation step.
+static const double gBenchStep = 1.0 / 60.0;
+
+FrameBench::FrameBench()
+	: mFrameScene(FrameResourceCount)
+{
+}
+
+bool FrameBench::Initialize(const std::string& sceneFilename, std::string& error)
+{
+	SceneDesc desc;
+	std::vector<std::uint8_t> cooked;
+	if(!SceneFormat::LoadText(sceneFilename, desc, error) ||
+		!SceneFormat::Cook(desc, cooked, error) ||
+		!mScene.Load(std::move(cooked), error))
+		return false;
+
+	BuildGeometries();
+	BuildMaterials();
+	if(!mFrameScene.Build(mScene.View(), mGeometries, mMaterialList, error))
+	{
+		error = sceneFilename + ", " + error;
+		return false;
+	}
+	BuildTargets();
+
+	mFrameScene.SetRenderTargetSize(1920, 1080);
+	mFrameScene.GetCamera().SetLens(0.25f * MathHelper::Pi, 16.0f / 9.0f, 1.0f, 1000.0f);
+
+	// The app's clocks, stepped like an input replay, which also seeds the waves.
+	mTimer.SetFixedStep(gBenchStep);
+	mTimer.SetSimStep(gBenchStep, 4);
+	mTimer.Reset();
+	std::srand(1);
+
+	// The app's update graph without the frame resource fence or texture streaming.
+	mFrameScene.BuildFrameGraph(mFrameGraph, mTimer, nullptr, nullptr);
+
+	for(unsigned job = 0; job < mFrameGraph.JobCount(); ++job)
+		mStageNames.push_back(mFrameGraph.GetJobName(job));
+	mStageNames.push_back("record");
+	mStageNames.push_back("crowd_fill");
+	mStageNames.push_back("crowd_fill_single");
+	mStageNames.push_back("frame");
+
+	BuildCrowd();
+
+	return true;
+}
+
+void FrameBench::BuildGeometries()
+{
+	// Only the names and draw arguments matter; nothing is drawn.
+	auto addGeometry = [this](const std::string& name)
+	{
+		auto geo = std::make_unique<MeshGeometry>();
+		geo->Name = name;
+
+		MeshGeometry* result = geo.get();
+		mGeometries[name] = std::move(geo);
+		return result;
+	};
+
+	SubmeshGeometry submesh;
+	submesh.IndexCount = 3 * mFrameScene.GetWaves().TriangleCount();
+	addGeometry("waterGeo")->DrawArgs["grid"] = submesh;
+
+	submesh.IndexCount = 3 * 2 * 49 * 49;
+	addGeometry("landGeo")->DrawArgs["grid"] = submesh;
+
+	submesh.IndexCount = 16;
+	addGeometry("treeSpritesGeo")->DrawArgs["points"] = submesh;
+
+	// A box sized submesh per scene mesh, one after the other.
+	MeshGeometry* shapeGeo = addGeometry("shapeGeo");
+	const CookedSceneView& scene = mScene.View();
+	for(std::uint32_t i = 0; i < mScene.MeshCount(); ++i)
+	{
+		submesh.IndexCount = 36;
+		submesh.StartIndexLocation = 36 * i;
+		shapeGeo->DrawArgs[scene.GetString(scene.Meshes[i].Name)] = submesh;
+	}
+}
+
+void FrameBench::BuildMaterials()
+{
+	// The app's materials, with texture indices standing in for the SRV slots.
+	const CookedSceneView& scene = mScene.View();
+	for(std::uint32_t i = 0; i < mScene.MaterialCount(); ++i)
+	{
+		const CookedMaterial& src = scene.Materials[i];
+
+		auto mat = std::make_unique<Material>();
+		mat->Name = scene.GetString(src.Name);
+		mat->MatCBIndex = (int)i;
+		mat->DiffuseSrvHeapIndex = (int)src.TextureIndex;
+		mat->DiffuseAlbedo = XMFLOAT4(src.DiffuseAlbedo);
+		mat->FresnelR0 = XMFLOAT3(src.FresnelR0);
+		mat->Roughness = src.Roughness;
+
+		mMaterialList.push_back(mat.get());
+		mMaterials.push_back(std::move(mat));
+	}
+}
+
+void FrameBench::BuildTargets()
+{
+	const std::size_t objectCount = mFrameScene.GetRenderItems().size();
+	const UINT objCBByteSize = d3dUtil::CalcConstantBufferByteSize(sizeof(ObjectConstants));
+
+	for(Targets& targets : mTargets)
+	{
+		targets.ObjectCB.resize(objectCount * objCBByteSize);
+		targets.ObjectData.resize(objectCount);
+		targets.Materials.resize(mMaterialList.size());
+		targets.WaveVertices.resize(mFrameScene.GetWaves().VertexCount());
+		targets.InstanceIndices.resize(objectCount);
+	}
+}
+
+void FrameBench::Run(std::uint32_t frameCount)
+{
+	mStageTimes.assign(mStageNames.size(), FrameStats(frameCount, 1.0e9f));
+	mStageTotals.assign(mStageNames.size(), 0.0);
+
+	const UINT objCBByteSize = d3dUtil::CalcConstantBufferByteSize(sizeof(ObjectConstants));
+	const std::uint32_t recordStage = mFrameGraph.JobCount();
+
+	for(std::uint32_t frame = 0; frame < frameCount; ++frame)
+	{
+		mFrameIndex = (mFrameIndex + 1) % FrameResourceCount;
+		Targets& targets = mTargets[mFrameIndex];
+
+		FrameTargets frameTargets;
+		frameTargets.ObjectCB = targets.ObjectCB.data();
+		frameTargets.ObjectCBStride = objCBByteSize;
+		frameTargets.ObjectData = reinterpret_cast<std::uint8_t*>(targets.ObjectData.data());
+		frameTargets.ObjectDataStride = sizeof(ObjectConstants);
+		frameTargets.Materials = targets.Materials.data();
+		frameTargets.Pass = &targets.Pass;
+		frameTargets.WaveVertices = targets.WaveVertices.data();
+		frameTargets.InstanceIndices = targets.InstanceIndices.data();
+		mFrameScene.SetFrame(mFrameIndex, frameTargets);
+
+		mTimer.Tick();
+		mFrameScene.SetInput(MakeInput(frame));
+		SwayGroups();
+
+		mFrameGraph.Run();
+
+		for(unsigned job = 0; job < mFrameGraph.JobCount(); ++job)
+		{
+			const float ms = mFrameGraph.GetJobEnd(job) - mFrameGraph.GetJobStart(job);
+			mStageTimes[job].AddFrame(ms, ms);
+			mStageTotals[job] += ms;
+		}
+
+		// The app records after the graph, on the draw thread.
+		const float recordMs = Record();
+		mStageTimes[recordStage].AddFrame(recordMs, recordMs);
+		mStageTotals[recordStage] += recordMs;
+
+		const float frameMs = mFrameGraph.GetWallMs() + recordMs;
+		mStageTimes.back().AddFrame(frameMs, frameMs);
+		mStageTotals.back() += frameMs;
+
+		FillCrowd(recordStage + 1);
+	}
+
+	mFramesRun = frameCount;
+}
+
+InputSample FrameBench::MakeInput(std::uint32_t frame)const
+{
+	// Walk forward while dragging the mouse right, which circles the castle.  The drag
+	// starts over every 10000 frames, before the mouse position runs out of range.
+	const std::uint32_t dragFrame = frame % 10000;
+
+	InputSample input;
+	input.Time = mTimer.TotalTime();
+	input.Keys = (std::uint16_t)(1 << FrameScene::KeyWalkForward);
+	input.Buttons = dragFrame == 0 ? 0 : InputSample::LeftButton;
+	input.MouseX = (std::int16_t)(2 * dragFrame);
+	return input;
+}
+
+void FrameBench::SwayGroups()
+{
+	// Sway every group a little so the scene graph and the constant fills have work
+	// every frame; in the app the scene is static unless it is reloaded.
+	const CookedSceneView& scene = mScene.View();
+	const float time = mTimer.TotalTime();
+	for(std::uint32_t i = 0; i < mScene.GroupCount(); ++i)
+	{
+		XMFLOAT4X4 local;
+		XMStoreFloat4x4(&local, XMMatrixRotationY(0.02f * sinf(time + (float)i)));
+		mFrameScene.SetGroupLocal(scene.GetString(scene.Groups[i].Name), local);
+	}
+}
+
+float FrameBench::Record()
+{
+	const auto start = std::chrono::steady_clock::now();
+
+	mFrameScene.BuildDrawPackets(FrameScene::RecordWorkerCount, FrameScene::MinRecordChunkCost);
+
+	const auto& chunks = mFrameScene.GetRecordChunks();
+	mChunkDrawStats.assign(chunks.size(), DrawStats());
+	concurrency::parallel_for(0, (int)chunks.size(), [&](int c)
+	{
+		NullCommandSink sink;
+		mFrameScene.RecordChunk(c, sink, mChunkDrawStats[c]);
+	});
+
+	mDrawStats.Reset();
+	for(const auto& stats : mChunkDrawStats)
+		mDrawStats.Add(stats);
+
+	return std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void FrameBench::BuildCrowd()
+{
+	// A grid of unit objects; the values do not matter to the fill, only the count.
+	for(std::uint32_t i = 0; i < CrowdSize; ++i)
+	{
+		XMFLOAT4X4 world;
+		XMStoreFloat4x4(&world, XMMatrixTranslation((float)(i % 256), 0.0f, (float)(i / 256)));
+		mCrowd.Push(world, MathHelper::Identity4x4());
+	}
+
+	mCrowdData.resize(CrowdSize);
+}
+
+void FrameBench::FillCrowd(std::uint32_t stage)
+{
+	// Every object of the crowd moved, as with an animated crowd, so all of them are
+	// written: first with the batched fill UpdateObjectCBs uses when most objects are
+	// dirty, then one object at a time as it does for a few.
+	std::uint8_t* data = reinterpret_cast<std::uint8_t*>(mCrowdData.data());
+
+	auto start = std::chrono::steady_clock::now();
+	mCrowd.WriteConstantsRange(0, CrowdSize, data, sizeof(ObjectConstants));
+	const float batchMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+	start = std::chrono::steady_clock::now();
+	for(std::uint32_t i = 0; i < CrowdSize; ++i)
+		mCrowd.WriteConstants(i, data + i * sizeof(ObjectConstants));
+	const float singleMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+	mStageTimes[stage].AddFrame(batchMs, batchMs);
+	mStageTotals[stage] += batchMs;
+	mStageTimes[stage + 1].AddFrame(singleMs, singleMs);
+	mStageTotals[stage + 1] += singleMs;
+}
+
+bool FrameBench::WriteReport(const std::string& filename, std::string& error)const
+{
+	std::ofstream fout(filename, std::ios::trunc);
+	fout.setf(std::ios::fixed);
+	fout.precision(4);
+
+	fout << "stage,mean_ms,p50_ms,p95_ms,p99_ms,max_ms\n";
+	for(std::size_t i = 0; i < mStageNames.size() && i < mStageTimes.size(); ++i)
+	{
+		const FrameStats::Summary summary = mStageTimes[i].GetFrameTimes();
+		const double mean = mFramesRun > 0 ? mStageTotals[i] / mFramesRun : 0.0;
+
+		fout << mStageNames[i] << ',' << mean << ',' << summary.P50 << ',' << summary.P95 << ',' <<
+			summary.P99 << ',' << summary.Max << '\n';
+	}
+
+	if(!fout)
+	{
+		error = "cannot write " + filename;
+		return false;
+	}
+	return true;
+}
@@ -0,0 +1,105 @@
+//***************************************************************************************
+// FrameBench.h
+//
+// Headless benchmark of the CPU side of a TreeBillboards frame.  Drives the app's own
+// FrameScene (the update graph, draw packets and chunked recording) over the scene for
+// a fixed number of frames, with a fixed time step and a scripted input, writing the
+// constants to plain memory and recording into a NullCommandSink.  Needs neither a
+// window nor a GPU, so it can run on build machines and give comparable numbers for
+// every commit.
+//
+// Each frame also fills the object constants of a crowd of CrowdSize objects, once
+// with the batched fill and once an object at a time, to time the fill at the scale
+// it is meant for; the scene itself has only a few hundred objects.
+//***************************************************************************************
+
+#pragma once
+
+#include "../../Common/FrameStats.h"
+#include "../../Common/GameTimer.h"
+#include "FrameScene.h"
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class FrameBench
+{
+public:
+	FrameBench();
+	FrameBench(const FrameBench& rhs) = delete;
+	FrameBench& operator=(const FrameBench& rhs) = delete;
+
+	// Loads and cooks the text scene in memory and builds the frame scene over
+	// stand-ins for the app's geometry and materials.
+	bool Initialize(const std::string& sceneFilename, std::string& error);
+
+	// Runs frameCount frames and collects the stage timings.
+	void Run(std::uint32_t frameCount);
+
+	// Writes stage,mean_ms,p50_ms,p95_ms,p99_ms,max_ms rows for every stage, plus the
+	// whole frame.
+	bool WriteReport(const std::string& filename, std::string& error)const;
+
+private:
+	void BuildGeometries();
+	void BuildMaterials();
+	void BuildTargets();
+
+	// Scripted input and group motion of the given frame.
+	InputSample MakeInput(std::uint32_t frame)const;
+	void SwayGroups();
+
+	// Builds the draw packets and records them; returns the time taken in ms.
+	float Record();
+
+	// Times the batched and the single object crowd fill into report rows stage and
+	// stage + 1.
+	void BuildCrowd();
+	void FillCrowd(std::uint32_t stage);
+
+private:
+	// Frame resources in flight in the app, so the dirty sets behave the same.
+	static const int FrameResourceCount = 3;
+
+	static const std::uint32_t CrowdSize = 50000;
+
+	CookedScene mScene;
+	FrameScene mFrameScene;
+	GameTimer mTimer;
+
+	// Geometry without GPU buffers and the scene materials; the frame scene only
+	// reads their names, draw arguments and constants.
+	std::unordered_map<std::string, std::unique_ptr<MeshGeometry>> mGeometries;
+	std::vector<std::unique_ptr<Material>> mMaterials;
+	std::vector<Material*> mMaterialList;
+
+	// Stand-ins for the upload buffers of each frame resource.
+	struct Targets
+	{
+		std::vector<std::uint8_t> ObjectCB;
+		std::vector<ObjectConstants> ObjectData;
+		std::vector<MaterialData> Materials;
+		PassConstants Pass;
+		std::vector<Vertex> WaveVertices;
+		std::vector<std::uint32_t> InstanceIndices;
+	};
+	Targets mTargets[FrameResourceCount];
+	int mFrameIndex = 0;
+
+	DrawStats mDrawStats;
+	std::vector<DrawStats> mChunkDrawStats;
+
+	JobGraph mFrameGraph;
+
+	// Transforms of the crowd and the constants they are filled into.
+	ObjectTransforms mCrowd;
+	std::vector<ObjectConstants> mCrowdData;
+
+	// Per stage times, indexed by job id, then recording, the crowd fills and the
+	// whole frame.
+	std::vector<std::string> mStageNames;
+	std::vector<FrameStats> mStageTimes;
+	std::vector<double> mStageTotals;
+	std::uint32_t mFramesRun = 0;
+};
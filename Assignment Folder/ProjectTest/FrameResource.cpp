@@ -1,15 +1,31 @@
 #include "FrameResource.h"
 
-FrameResource::FrameResource(ID3D12Device* device, UINT passCount, UINT objectCount, UINT materialCount, UINT waveVertCount)
+FrameResource::FrameResource(ID3D12Device* device, UINT passCount, UINT objectCount, UINT materialCount, UINT waveVertCount, UINT workerCount)
 {
     ThrowIfFailed(device->CreateCommandAllocator(
         D3D12_COMMAND_LIST_TYPE_DIRECT,
 		IID_PPV_ARGS(CmdListAlloc.GetAddressOf())));
 
+    WorkerCmdListAllocs.resize(workerCount);
+    WorkerCmdLists.resize(workerCount);
+    for(UINT i = 0; i < workerCount; ++i)
+    {
+        ThrowIfFailed(device->CreateCommandAllocator(
+            D3D12_COMMAND_LIST_TYPE_DIRECT,
+            IID_PPV_ARGS(WorkerCmdListAllocs[i].GetAddressOf())));
+
+        ThrowIfFailed(device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT,
+            WorkerCmdListAllocs[i].Get(), nullptr,
+            IID_PPV_ARGS(WorkerCmdLists[i].GetAddressOf())));
+        ThrowIfFailed(WorkerCmdLists[i]->Close());
+    }
+
   //  FrameCB = std::make_unique<UploadBuffer<FrameConstants>>(device, 1, true);
     PassCB = std::make_unique<UploadBuffer<PassConstants>>(device, passCount, true);
-    MaterialCB = std::make_unique<UploadBuffer<MaterialConstants>>(device, materialCount, true);
     ObjectCB = std::make_unique<UploadBuffer<ObjectConstants>>(device, objectCount, true);
+    MaterialBuffer = std::make_unique<UploadBuffer<MaterialData>>(device, materialCount, false);
+    ObjectData = std::make_unique<UploadBuffer<ObjectConstants>>(device, objectCount, false);
+    InstanceIndices = std::make_unique<UploadBuffer<UINT>>(device, objectCount, false);
 
     WavesVB = std::make_unique<UploadBuffer<Vertex>>(device, waveVertCount, false);
 }
@@ -22,8 +38,10 @@ FrameResource::FrameResource(ID3D12Device* device, UINT passCount, UINT objectCo
 
 	//  FrameCB = std::make_unique<UploadBuffer<FrameConstants>>(device, 1, true);
 	PassCB = std::make_unique<UploadBuffer<PassConstants>>(device, passCount, true);
-	MaterialCB = std::make_unique<UploadBuffer<MaterialConstants>>(device, materialCount, true);
 	ObjectCB = std::make_unique<UploadBuffer<ObjectConstants>>(device, objectCount, true);
+	MaterialBuffer = std::make_unique<UploadBuffer<MaterialData>>(device, materialCount, false);
+	ObjectData = std::make_unique<UploadBuffer<ObjectConstants>>(device, objectCount, false);
+	InstanceIndices = std::make_unique<UploadBuffer<UINT>>(device, objectCount, false);
 
 }
 
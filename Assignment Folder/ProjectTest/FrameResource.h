@@ -10,6 +10,25 @@ struct ObjectConstants
 	DirectX::XMFLOAT4X4 TexTransform = MathHelper::Identity4x4();
 };
 
+// One material in the material structured buffer, at its MatCBIndex.  Unlike a
+// constant buffer element it needs no 256 byte alignment, only padding to 16 bytes.
+// DiffuseMapIndex picks the material's texture out of the unbounded SRV range.
+// Matches MaterialData in the shaders.
+struct MaterialData
+{
+	DirectX::XMFLOAT4 DiffuseAlbedo = { 1.0f, 1.0f, 1.0f, 1.0f };
+	DirectX::XMFLOAT3 FresnelR0 = { 0.01f, 0.01f, 0.01f };
+	float Roughness = 0.25f;
+	DirectX::XMFLOAT4X4 MatTransform = MathHelper::Identity4x4();
+
+	UINT DiffuseMapIndex = 0;
+	UINT MaterialPad0 = 0;
+	UINT MaterialPad1 = 0;
+	UINT MaterialPad2 = 0;
+};
+
+static_assert(sizeof(MaterialData) == 112, "MaterialData must match the shaders' layout");
+
 struct PassConstants
 {
     DirectX::XMFLOAT4X4 View = MathHelper::Identity4x4();
@@ -54,7 +73,7 @@ struct FrameResource
 {
 public:
     
-    FrameResource(ID3D12Device* device, UINT passCount, UINT objectCount, UINT materialCount, UINT waveVertCount);
+    FrameResource(ID3D12Device* device, UINT passCount, UINT objectCount, UINT materialCount, UINT waveVertCount, UINT workerCount = 0);
 	FrameResource(ID3D12Device* device, UINT passCount, UINT objectCount, UINT materialCount);
     FrameResource(const FrameResource& rhs) = delete;
     FrameResource& operator=(const FrameResource& rhs) = delete;
@@ -64,13 +83,25 @@ public:
     // So each frame needs their own allocator.
     Microsoft::WRL::ComPtr<ID3D12CommandAllocator> CmdListAlloc;
 
+    // Allocator and command list of each recording worker.  The lists are created
+    // closed and are reset against their allocator when a worker records a chunk.
+    std::vector<Microsoft::WRL::ComPtr<ID3D12CommandAllocator>> WorkerCmdListAllocs;
+    std::vector<Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList>> WorkerCmdLists;
+
     // We cannot update a cbuffer until the GPU is done processing the commands
     // that reference it.  So each frame needs their own cbuffers.
    // std::unique_ptr<UploadBuffer<FrameConstants>> FrameCB = nullptr;
     std::unique_ptr<UploadBuffer<PassConstants>> PassCB = nullptr;
-    std::unique_ptr<UploadBuffer<MaterialConstants>> MaterialCB = nullptr;
     std::unique_ptr<UploadBuffer<ObjectConstants>> ObjectCB = nullptr;
 
+    // Every material, tightly packed, read by material index.
+    std::unique_ptr<UploadBuffer<MaterialData>> MaterialBuffer = nullptr;
+
+    // Tightly packed per-object data read through SV_InstanceID by the instanced
+    // shaders, and the object index of every instance drawn this frame.
+    std::unique_ptr<UploadBuffer<ObjectConstants>> ObjectData = nullptr;
+    std::unique_ptr<UploadBuffer<UINT>> InstanceIndices = nullptr;
+
     // We cannot update a dynamic vertex buffer until the GPU is done processing
     // the commands that reference it.  So each frame needs their own.
     std::unique_ptr<UploadBuffer<Vertex>> WavesVB = nullptr;
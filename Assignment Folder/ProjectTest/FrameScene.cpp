@@ -0,0 +1,655 @@
+//***************************************************************************************
+// FrameScene.cpp
+//***************************************************************************************
+
+#include "FrameScene.h"
+#include "../../Common/Profiler.h"
+#include "FrameStages.h"
+#include <algorithm>
+#include <cassert>
+
+using namespace DirectX;
+
+// Order in which the layers are drawn.  This goes into the top bits of the sort key.
+static const UINT gLayerDrawOrder[(int)RenderLayer::Count] = { 0, 3, 1, 2 };
+
+// Layers drawn with the instanced Default.hlsl variant.  Consecutive items in these
+// layers that share geometry, submesh and material are merged into one draw.
+static bool IsInstancedLayer(RenderLayer layer)
+{
+	return layer != RenderLayer::AlphaTestedTreeSprites;
+}
+
+// Layer of the scene shapes drawn with the given scene material.
+static RenderLayer ShapeLayer(const CookedMaterial& mat)
+{
+	switch((SceneLayer)mat.Layer)
+	{
+	case SceneLayer::AlphaTested: return RenderLayer::AlphaTested;
+	case SceneLayer::Transparent: return RenderLayer::Transparent;
+	default: return RenderLayer::Opaque;
+	}
+}
+
+FrameScene::FrameScene(int frameResourceCount)
+	: mObjectDirty(frameResourceCount), mMaterialDirty(frameResourceCount)
+{
+	mWaves = std::make_unique<Waves>(128, 128, 1.0f, 0.03f, 4.0f, 0.2f);
+
+	mCamera.SetPosition(mSimCameraPos);
+}
+
+bool FrameScene::Build(const CookedSceneView& scene,
+	const std::unordered_map<std::string, std::unique_ptr<MeshGeometry>>& geometries,
+	const std::vector<Material*>& materials, std::string& error)
+{
+	auto findGeometry = [&](const char* name) -> MeshGeometry*
+	{
+		auto it = geometries.find(name);
+		if(it == geometries.end())
+			error = std::string("missing geometry '") + name + "'";
+		return it == geometries.end() ? nullptr : it->second.get();
+	};
+	auto findMaterial = [&](const char* name) -> Material*
+	{
+		for(Material* mat : materials)
+		{
+			if(mat->Name == name)
+				return mat;
+		}
+		error = std::string("missing material '") + name + "'";
+		return nullptr;
+	};
+
+	MeshGeometry* waterGeo = findGeometry("waterGeo");
+	MeshGeometry* landGeo = findGeometry("landGeo");
+	MeshGeometry* treeSpritesGeo = findGeometry("treeSpritesGeo");
+	mShapeGeo = findGeometry("shapeGeo");
+	Material* grass = findMaterial("grass");
+	Material* treeSprites = findMaterial("treeSprites");
+	mWaterMaterial = findMaterial("water");
+	if(waterGeo == nullptr || landGeo == nullptr || treeSpritesGeo == nullptr || mShapeGeo == nullptr ||
+		grass == nullptr || treeSprites == nullptr || mWaterMaterial == nullptr)
+		return false;
+
+	mMaterialList = materials;
+	mMaterialDirty.Resize((std::uint32_t)mMaterialList.size());
+
+	XMFLOAT4X4 world;
+	XMFLOAT4X4 texTransform;
+
+	auto wavesRitem = std::make_unique<RenderItem>();
+	XMStoreFloat4x4(&world, XMMatrixScaling(5.0f, 1.0f, 5.0f) *
+		XMMatrixTranslation(0.0f, -5.0f, 0.0f));
+	XMStoreFloat4x4(&texTransform, XMMatrixScaling(20.0f, 20.0f, 20.0f));
+	wavesRitem->ObjCBIndex = mTransforms.Push(world, texTransform);
+	wavesRitem->Mat = mWaterMaterial;
+	wavesRitem->PrimitiveType = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
+	wavesRitem->Layer = RenderLayer::Transparent;
+	SetDrawArgs(wavesRitem.get(), waterGeo, "grid");
+
+	mWavesRitem = wavesRitem.get();
+	AddRenderItem(std::move(wavesRitem));
+
+	auto gridRitem = std::make_unique<RenderItem>();
+	XMStoreFloat4x4(&texTransform, XMMatrixScaling(15.0f, 15.0f, 15.0f));
+	gridRitem->ObjCBIndex = mTransforms.Push(MathHelper::Identity4x4(), texTransform);
+	gridRitem->Mat = grass;
+	gridRitem->PrimitiveType = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
+	SetDrawArgs(gridRitem.get(), landGeo, "grid");
+	AddRenderItem(std::move(gridRitem));
+
+	auto wavesRitem2 = std::make_unique<RenderItem>();
+	XMStoreFloat4x4(&world, XMMatrixScaling(0.015f, 1.0f, 0.015f) *
+		XMMatrixTranslation(5.5f, 3.5f, -6.0f));
+	XMStoreFloat4x4(&texTransform, XMMatrixScaling(0.5f, 0.5f, 0.5f));
+	wavesRitem2->ObjCBIndex = mTransforms.Push(world, texTransform);
+	wavesRitem2->Mat = mWaterMaterial;
+	wavesRitem2->PrimitiveType = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
+	wavesRitem2->Layer = RenderLayer::Transparent;
+	SetDrawArgs(wavesRitem2.get(), waterGeo, "grid");
+
+	mWavesRitem = wavesRitem2.get();
+	AddRenderItem(std::move(wavesRitem2));
+
+	auto treeSpritesRitem = std::make_unique<RenderItem>();
+	treeSpritesRitem->ObjCBIndex = mTransforms.Push(MathHelper::Identity4x4(), MathHelper::Identity4x4());
+	treeSpritesRitem->Mat = treeSprites;
+	//step2
+	treeSpritesRitem->PrimitiveType = D3D_PRIMITIVE_TOPOLOGY_POINTLIST;
+	treeSpritesRitem->Layer = RenderLayer::AlphaTestedTreeSprites;
+	SetDrawArgs(treeSpritesRitem.get(), treeSpritesGeo, "points");
+	AddRenderItem(std::move(treeSpritesRitem));
+
+	// Scene groups become scene graph nodes.  Cooked groups are stored parent before
+	// child, so the parent's node already exists.
+	std::vector<int> groupNodes(scene.Header->GroupCount);
+	for(UINT i = 0; i < scene.Header->GroupCount; ++i)
+	{
+		const int parent = scene.Groups[i].Parent;
+		groupNodes[i] = (int)mSceneGraph.AddNode(parent < 0 ? SceneGraph::NoParent : groupNodes[parent],
+			MathHelper::Identity4x4());
+		mGroupNodes[scene.GetString(scene.Groups[i].Name)] = (UINT)groupNodes[i];
+	}
+
+	std::vector<RenderItem> meshArgs;
+	if(!ResolveSceneMeshes(scene, meshArgs, error))
+		return false;
+
+	for(UINT i = 0; i < scene.Header->ShapeCount; ++i)
+	{
+		const int group = scene.ShapeGroups[i];
+		BuildShape(group < 0 ? SceneGraph::NoParent : groupNodes[group],
+			meshArgs[scene.ShapeMeshes[i]], mMaterialList[scene.ShapeMaterials[i]],
+			ShapeLayer(scene.Materials[scene.ShapeMaterials[i]]),
+			scene.ShapeLocals[i], scene.ShapeTexTransforms[i]);
+	}
+
+	// Every item starts dirty so each frame resource uploads it once.
+	mObjectDirty.Resize((std::uint32_t)mAllRitems.size());
+
+	return true;
+}
+
+bool FrameScene::ResolveSceneMeshes(const CookedSceneView& scene, std::vector<RenderItem>& meshArgs, std::string& error)
+{
+	// Resolve each mesh of the scene once instead of once per shape.
+	meshArgs.assign(scene.Header->MeshCount, RenderItem());
+	for(UINT i = 0; i < scene.Header->MeshCount; ++i)
+	{
+		const char* meshName = scene.GetString(scene.Meshes[i].Name);
+		if(mShapeGeo->DrawArgs.find(meshName) == mShapeGeo->DrawArgs.end())
+		{
+			error = std::string("unknown mesh '") + meshName + "'";
+			return false;
+		}
+
+		meshArgs[i].PrimitiveType = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
+		SetDrawArgs(&meshArgs[i], mShapeGeo, meshName);
+	}
+
+	return true;
+}
+
+void FrameScene::ApplyShapeChanges(const CookedSceneView& newScene, const SceneDelta& delta,
+	const std::vector<RenderItem>& meshArgs)
+{
+	for(UINT i : delta.ChangedShapes)
+	{
+		RenderItem* ri = mShapeRitems[i];
+		const RenderItem& args = meshArgs[newScene.ShapeMeshes[i]];
+		ri->Geo = args.Geo;
+		ri->IndexCount = args.IndexCount;
+		ri->StartIndexLocation = args.StartIndexLocation;
+		ri->BaseVertexLocation = args.BaseVertexLocation;
+		ri->GeoSortId = args.GeoSortId;
+		ri->SubmeshSortId = args.SubmeshSortId;
+		ri->Mat = mMaterialList[newScene.ShapeMaterials[i]];
+
+		// The world matrix and bounds follow through UpdateSceneGraph.
+		const int group = newScene.ShapeGroups[i];
+		mSceneGraph.SetParent(mShapeNodes[i], group < 0 ? SceneGraph::NoParent :
+			(int)mGroupNodes[newScene.GetString(newScene.Groups[group].Name)]);
+		mSceneGraph.SetLocal(mShapeNodes[i], newScene.ShapeLocals[i]);
+
+		mTransforms.SetTexTransform(ri->ObjCBIndex, newScene.ShapeTexTransforms[i]);
+		mObjectDirty.MarkDirty(ri->ObjCBIndex);
+	}
+
+	// A shape that got a new material, or whose material changed layer, may have to
+	// move to another layer for its pipeline state and sort order.
+	for(UINT i = 0; i < newScene.Header->ShapeCount; ++i)
+	{
+		const RenderLayer layer = ShapeLayer(newScene.Materials[newScene.ShapeMaterials[i]]);
+		if(mShapeRitems[i]->Layer != layer)
+			SetRenderLayer(mShapeRitems[i], layer);
+	}
+}
+
+void FrameScene::SetGroupLocal(const std::string& group, const XMFLOAT4X4& local)
+{
+	mSceneGraph.SetLocal(mGroupNodes.at(group), local);
+}
+
+void FrameScene::BuildFrameGraph(JobGraph& graph, const GameTimer& gt,
+	std::function<void()> acquire, std::function<void()> stream)
+{
+	// input --------> collision -> camera -> cull
+	// scene -------/        \---------------> pass
+	//   \----------------------------------> objects, materials
+	// acquire ------------------------------> waves, objects, materials, pass
+	// camera, scene ------------------------> cull, stream
+	//
+	// The camera view is built after collision has clamped the simulated camera
+	// position, and everything writing the current frame resource waits on acquire.
+	const unsigned input = graph.AddJob("input", [this, &gt]() { ApplyInput(gt); });
+	const unsigned scene = graph.AddJob("scene", [this, &gt]()
+	{
+		AnimateMaterials(gt);
+		UpdateSceneGraph();
+	});
+	const unsigned acquired = graph.AddJob("acquire", [acquire]()
+	{
+		if(acquire)
+			acquire();
+	});
+
+	const unsigned collision = graph.AddJob("collision", [this]() { AABBCheck(); }, { input, scene });
+	const unsigned camera = graph.AddJob("camera", [this, &gt]() { BlendCamera(gt); }, { collision });
+
+	graph.AddJob("waves", [this, &gt]() { UpdateWaves(gt); }, { acquired });
+	graph.AddJob("objects", [this]() { UpdateObjectCBs(); }, { acquired, scene });
+	graph.AddJob("materials", [this]() { UpdateMaterialCBs(); }, { acquired, scene });
+	graph.AddJob("pass", [this, &gt]() { UpdateMainPassCB(gt); }, { acquired, camera });
+	graph.AddJob("cull", [this]() { BuildDrawList(); }, { camera, scene });
+	graph.AddJob("stream", [stream]()
+	{
+		if(stream)
+			stream();
+	}, { camera, scene });
+}
+
+void FrameScene::SetInput(const InputSample& input)
+{
+	mPrevInput = mInput;
+	mInput = input;
+}
+
+void FrameScene::SetFrame(int frameIndex, const FrameTargets& targets)
+{
+	mFrameIndex = frameIndex;
+	mTargets = targets;
+}
+
+void FrameScene::SetRenderTargetSize(UINT width, UINT height)
+{
+	mRenderTargetWidth = width;
+	mRenderTargetHeight = height;
+}
+
+void FrameScene::ApplyInput(const GameTimer& gt)
+{
+	//step3: we handle keyboard input to move the camera:
+
+	const float dt = gt.SimStep();
+	const std::uint16_t keys = mInput.Keys;
+
+	// Move from the last simulated position, not the blended one we rendered.
+	mCamera.SetPosition(mSimCameraPos);
+
+	// Toggle on the press only, so holding the key does not flip it every frame, and
+	// before this frame's steps, which all come after the press whatever the frame
+	// rate.
+	if (mInput.PressedSince(mPrevInput) & (1 << KeyToggleFly))
+		mCamera.SetCanFly(!mCamera.GetCanFly());
+
+	for(int step = 0; step < gt.SimSteps(); ++step)
+	{
+		mPrevSimCameraPos = mCamera.GetPosition3f();
+
+		if (keys & (1 << KeyWalkForward))
+			mCamera.Walk(10.0f * dt);
+
+		if (keys & (1 << KeyWalkBack))
+			mCamera.Walk(-10.0f * dt);
+
+		if (keys & (1 << KeyStrafeLeft))
+			mCamera.Strafe(-10.0f * dt);
+
+		if (keys & (1 << KeyStrafeRight))
+			mCamera.Strafe(10.0f * dt);
+	}
+
+	// Rotate by the mouse movement since the last frame while the left button stays
+	// down.  The frame the button goes down only sets the starting point.
+	if((mInput.Buttons & mPrevInput.Buttons & InputSample::LeftButton) != 0)
+	{
+		// Make each pixel correspond to a quarter of a degree.
+		float dx = XMConvertToRadians(0.25f*static_cast<float>(mInput.MouseX - mPrevInput.MouseX));
+		float dy = XMConvertToRadians(0.25f*static_cast<float>(mInput.MouseY - mPrevInput.MouseY));
+
+		mCamera.Pitch(dy);
+		mCamera.RotateY(dx);
+	}
+}
+
+void FrameScene::BlendCamera(const GameTimer& gt)
+{
+	// Collision has clamped the simulated position by now.
+	mSimCameraPos = mCamera.GetPosition3f();
+
+	XMFLOAT3 position;
+	XMStoreFloat3(&position, XMVectorLerp(XMLoadFloat3(&mPrevSimCameraPos), XMLoadFloat3(&mSimCameraPos), gt.SimAlpha()));
+
+	mCamera.SetPosition(position);
+	mCamera.UpdateViewMatrix();
+}
+
+void FrameScene::AnimateMaterials(const GameTimer& gt)
+{
+	// Scroll the water material texture coordinates.
+	const float simTime = gt.SimSteps() * gt.SimStep();
+	FrameStages::ScrollTexture(mWaterMaterial->MatTransform, 0.1f * simTime, 0.02f * simTime);
+
+	// Material has changed, so need to update cbuffer.
+	mMaterialDirty.MarkDirty(mWaterMaterial->MatCBIndex);
+}
+
+void FrameScene::UpdateSceneGraph()
+{
+	// Copy the recomputed world matrices and bounds of the changed nodes to their
+	// render items and queue the items for upload.
+	for(UINT node : mSceneGraph.Update())
+	{
+		const int objectIndex = mSceneGraph.GetObjectIndex(node);
+		if(objectIndex == SceneGraph::NoObject)
+			continue;
+
+		mTransforms.SetWorld(objectIndex, mSceneGraph.GetWorld(node));
+		RenderItem* ri = mAllRitems[objectIndex].get();
+		ri->HasBounds = mSceneGraph.HasBounds(node);
+		if(ri->HasBounds)
+			ri->mBoundingBox = mSceneGraph.GetWorldBounds(node);
+
+		mObjectDirty.MarkDirty(objectIndex);
+	}
+}
+
+void FrameScene::AABBCheck()
+{
+	PROFILE_SCOPE("AABBCheck");
+
+	const float extent = FrameStages::CameraExtent;
+	mCameraBoundingBox.Center = mCamera.GetPosition3f();
+	mCameraBoundingBox.Extents = XMFLOAT3(extent, extent, extent);
+
+	for (auto& e : mAllRitems)
+	{
+		if (mCameraBoundingBox.Intersects(e->mBoundingBox) && e->Mat->Name == "headge")
+			FrameStages::ClampCameraToBox(mCamera, mCameraBoundingBox, e->mBoundingBox);
+	}
+}
+
+void FrameScene::UpdateWaves(const GameTimer& gt)
+{
+	PROFILE_SCOPE("UpdateWaves");
+
+	// Update the wave simulation.  Every quarter second of simulated time, generate a
+	// random wave, so the disturbances pause and speed up with the time scale.
+	for(int step = 0; step < gt.SimSteps(); ++step)
+	{
+		mWaveSimTime += gt.SimStep();
+		if(mWaveSimTime >= mNextWaveDisturb)
+		{
+			mNextWaveDisturb += 0.25;
+
+			int i = MathHelper::Rand(4, mWaves->RowCount() - 5);
+			int j = MathHelper::Rand(4, mWaves->ColumnCount() - 5);
+
+			float r = MathHelper::RandF(0.2f, 0.5f);
+
+			mWaves->Disturb(i, j, r);
+		}
+
+		mWaves->Update(gt.SimStep());
+	}
+
+	// Update the wave vertex buffer with the new solution.  The app draws the waves
+	// from the frame resource's buffer; the geometry is left alone, since the previous
+	// frame may still be recording from it.
+	FrameStages::WriteWaveVertices(*mWaves, mTargets.WaveVertices);
+}
+
+void FrameScene::UpdateObjectCBs()
+{
+	PROFILE_SCOPE("UpdateObjectCBs");
+
+	// Only update the cbuffer data if the constants have changed.
+	// This is tracked per frame resource by the dirty set.
+	const auto& pending = mObjectDirty.Pending(mFrameIndex);
+
+	const bool batchFill = FrameStages::UseBatchFill(pending.size(), mTransforms.Size());
+
+	PROFILE_COUNTER("Dirty objects", pending.size());
+
+	if(batchFill)
+		mTransforms.WriteConstantsRange(0, mTransforms.Size(), mTargets.ObjectData, mTargets.ObjectDataStride);
+
+	for(UINT index : pending)
+	{
+		RenderItem* e = mAllRitems[index].get();
+
+		// Instanced items read their constants from the structured buffer instead.
+		if(IsInstancedLayer(e->Layer))
+		{
+			if(!batchFill)
+				mTransforms.WriteConstants(index, mTargets.ObjectData + index * mTargets.ObjectDataStride);
+		}
+		else
+		{
+			mTransforms.WriteConstants(index, mTargets.ObjectCB + index * mTargets.ObjectCBStride);
+		}
+	}
+
+	mObjectDirty.ClearPending(mFrameIndex);
+}
+
+void FrameScene::UpdateMaterialCBs()
+{
+	// Only update the buffer data if the constants have changed.  If the buffer data
+	// changes, it needs to be updated for each FrameResource.
+	for(UINT index : mMaterialDirty.Pending(mFrameIndex))
+	{
+		FrameStages::PackMaterial(*mMaterialList[index], mTargets.Materials[index]);
+	}
+
+	mMaterialDirty.ClearPending(mFrameIndex);
+}
+
+void FrameScene::UpdateMainPassCB(const GameTimer& gt)
+{
+	XMMATRIX view = mCamera.GetView();
+	XMMATRIX proj = mCamera.GetProj();
+
+	XMMATRIX viewProj = XMMatrixMultiply(view, proj);
+	XMMATRIX invView = XMMatrixInverse(&XMMatrixDeterminant(view), view);
+	XMMATRIX invProj = XMMatrixInverse(&XMMatrixDeterminant(proj), proj);
+	XMMATRIX invViewProj = XMMatrixInverse(&XMMatrixDeterminant(viewProj), viewProj);
+
+	XMStoreFloat4x4(&mMainPassCB.View, XMMatrixTranspose(view));
+	XMStoreFloat4x4(&mMainPassCB.InvView, XMMatrixTranspose(invView));
+	XMStoreFloat4x4(&mMainPassCB.Proj, XMMatrixTranspose(proj));
+	XMStoreFloat4x4(&mMainPassCB.InvProj, XMMatrixTranspose(invProj));
+	XMStoreFloat4x4(&mMainPassCB.ViewProj, XMMatrixTranspose(viewProj));
+	XMStoreFloat4x4(&mMainPassCB.InvViewProj, XMMatrixTranspose(invViewProj));
+	mMainPassCB.EyePosW = mCamera.GetPosition3f();
+	mMainPassCB.RenderTargetSize = XMFLOAT2((float)mRenderTargetWidth, (float)mRenderTargetHeight);
+	mMainPassCB.InvRenderTargetSize = XMFLOAT2(1.0f / mRenderTargetWidth, 1.0f / mRenderTargetHeight);
+	mMainPassCB.NearZ = 1.0f;
+	mMainPassCB.FarZ = 1000.0f;
+	mMainPassCB.TotalTime = gt.TotalTime();
+	mMainPassCB.DeltaTime = gt.DeltaTime();
+	mMainPassCB.AmbientLight = { 0.375f, 0.375f, 0.4f, 1.0f };
+
+	mMainPassCB.Lights[0].Position = { 3.0f, 6.0f, -13.0f };
+	mMainPassCB.Lights[0].Strength = { 1.0f, 0.5f, 0.0f };
+	mMainPassCB.Lights[1].Position = { -3.0f, 6.0f, -13.0f };
+	mMainPassCB.Lights[1].Strength = { 1.0f, 0.5f, 0.0f };
+	mMainPassCB.Lights[2].Position = { 5.5f, 10.0f, -6.0f };
+	mMainPassCB.Lights[2].Direction = { 0.0f, -1.0f, 0.0f };
+	mMainPassCB.Lights[2].Strength = { 2.0f, 2.0f, 2.0f };
+	mMainPassCB.Lights[2].SpotPower = 1.0;
+
+	*mTargets.Pass = mMainPassCB;
+}
+
+void FrameScene::BuildDrawList()
+{
+	XMMATRIX view = mCamera.GetView();
+	const float nearZ = mCamera.GetNearZ();
+	const float farZ = mCamera.GetFarZ();
+
+	// The view frustum in world space, where the scene graph keeps the bounds.
+	BoundingFrustum frustum(mCamera.GetProj());
+	frustum.Transform(frustum, XMMatrixInverse(&XMMatrixDeterminant(view), view));
+
+	mDrawList.clear();
+	for(int layer = 0; layer < (int)RenderLayer::Count; ++layer)
+	{
+		const UINT drawOrder = gLayerDrawOrder[layer];
+		const bool backToFront = (layer == (int)RenderLayer::Transparent);
+
+		for(auto ri : mRitemLayer[layer])
+		{
+			// Items without bounds, like the waves and the tree sprites, are always drawn.
+			if(ri->HasBounds && frustum.Contains(ri->mBoundingBox) == DISJOINT)
+				continue;
+
+			// Also the item's index in mAllRitems.
+			DrawSortItem item;
+			item.Index = ri->ObjCBIndex;
+			item.Key = FrameStages::MakeDrawKey(view, nearZ, farZ, mTransforms.GetTranslation(ri->ObjCBIndex),
+				backToFront, drawOrder, layer, ri->GeoSortId, ri->SubmeshSortId, ri->Mat->MatCBIndex);
+
+			mDrawList.push_back(item);
+		}
+	}
+
+	DrawSort::RadixSort(mDrawList, mDrawListScratch);
+}
+
+void FrameScene::BuildDrawPackets(std::uint32_t maxChunks, std::uint32_t minChunkCost)
+{
+	PROFILE_SCOPE("BuildDrawPackets");
+
+	std::uint32_t* instanceIndices = mTargets.InstanceIndices;
+	UINT instanceCount = 0;
+
+	mDrawPackets.clear();
+
+	// For each group of items that can be drawn together, in sort key order...
+	for(size_t i = 0; i < mDrawList.size(); )
+	{
+		auto ri = mAllRitems[mDrawList[i].Index].get();
+		const bool instanced = IsInstancedLayer(ri->Layer);
+
+		// Extend the batch over the following items that only differ in their
+		// object data.  Since the mesh and material are part of the key these are
+		// next to each other after the sort.
+		size_t batchEnd = i + 1;
+		if(instanced)
+		{
+			while(batchEnd < mDrawList.size())
+			{
+				auto next = mAllRitems[mDrawList[batchEnd].Index].get();
+				if(next->Layer != ri->Layer || next->Geo != ri->Geo || next->Mat != ri->Mat ||
+					next->PrimitiveType != ri->PrimitiveType ||
+					next->IndexCount != ri->IndexCount ||
+					next->StartIndexLocation != ri->StartIndexLocation ||
+					next->BaseVertexLocation != ri->BaseVertexLocation)
+					break;
+				++batchEnd;
+			}
+		}
+
+		if(ri->GeoSortId >= mSortIdGeometries.size())
+			mSortIdGeometries.resize(ri->GeoSortId + 1, nullptr);
+		mSortIdGeometries[ri->GeoSortId] = ri->Geo;
+
+		DrawPacket packet;
+		packet.Pso = (std::uint32_t)ri->Layer;
+		packet.Geometry = ri->GeoSortId;
+		packet.Topology = (std::uint32_t)ri->PrimitiveType;
+		packet.MatCBIndex = ri->Mat->MatCBIndex;
+		packet.ObjCBIndex = ri->ObjCBIndex;
+		packet.IndexCount = ri->IndexCount;
+		packet.StartIndex = ri->StartIndexLocation;
+		packet.BaseVertex = ri->BaseVertexLocation;
+		packet.Instanced = instanced;
+		packet.InstanceCount = (std::uint32_t)(batchEnd - i);
+
+		if(instanced)
+		{
+			// Write the object index of every instance in the batch up front, so the
+			// workers recording the chunks only read the packets.
+			packet.InstanceBase = instanceCount;
+			for(size_t k = i; k < batchEnd; ++k)
+				instanceIndices[instanceCount++] = mDrawList[k].Index;
+		}
+
+		mDrawPackets.push_back(packet);
+
+		i = batchEnd;
+	}
+
+	mRecordScheduler.Partition(mDrawPackets, maxChunks, minChunkCost);
+}
+
+void FrameScene::RecordChunk(std::size_t chunk, CommandSink& sink, DrawStats& stats)const
+{
+	RecordScheduler::Record(mDrawPackets, mRecordScheduler.GetChunks()[chunk], sink, stats);
+}
+
+// Helper function to add one scene shape.  meshArgs holds the resolved draw arguments
+// of the shape's mesh.
+void FrameScene::BuildShape(int parentNode, const RenderItem& meshArgs, Material* mat, RenderLayer layer,
+	const XMFLOAT4X4& local, const XMFLOAT4X4& texTransform)
+{
+	// The world matrix is filled in by UpdateSceneGraph.
+	auto boxRitem = std::make_unique<RenderItem>(meshArgs);
+	boxRitem->ObjCBIndex = mTransforms.Push(local, texTransform);
+	boxRitem->Mat = mat;
+	boxRitem->Layer = layer;
+
+	// The shapes are unit sized, so the object space box is the unit cube.
+	BoundingBox localBounds(XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT3(0.5f, 0.5f, 0.5f));
+	mShapeNodes.push_back(mSceneGraph.AddNode(parentNode, local, (int)boxRitem->ObjCBIndex, &localBounds));
+	mShapeRitems.push_back(boxRitem.get());
+
+	AddRenderItem(std::move(boxRitem));
+}
+
+void FrameScene::AddRenderItem(std::unique_ptr<RenderItem> ritem)
+{
+	// The draw list, the dirty sets and the scene graph only keep an item's ObjCBIndex
+	// and look the item up in mAllRitems by it.
+	assert(ritem->ObjCBIndex == (UINT)mAllRitems.size());
+
+	mRitemLayer[(int)ritem->Layer].push_back(ritem.get());
+	mAllRitems.push_back(std::move(ritem));
+}
+
+void FrameScene::SetRenderLayer(RenderItem* ritem, RenderLayer layer)
+{
+	auto& oldLayer = mRitemLayer[(int)ritem->Layer];
+	oldLayer.erase(std::find(oldLayer.begin(), oldLayer.end(), ritem));
+
+	ritem->Layer = layer;
+	mRitemLayer[(int)layer].push_back(ritem);
+}
+
+void FrameScene::SetDrawArgs(RenderItem* ritem, MeshGeometry* geo, const std::string& submeshName)
+{
+	const SubmeshGeometry& submesh = geo->DrawArgs[submeshName];
+
+	ritem->Geo = geo;
+	ritem->IndexCount = submesh.IndexCount;
+	ritem->StartIndexLocation = submesh.StartIndexLocation;
+	ritem->BaseVertexLocation = submesh.BaseVertexLocation;
+
+	ritem->GeoSortId = GetSortId(geo->Name);
+	ritem->SubmeshSortId = GetSortId(geo->Name + "/" + submeshName);
+}
+
+UINT FrameScene::GetSortId(const std::string& name)
+{
+	// Ids only influence the draw order, never correctness, so running out of
+	// key bits just makes some groups share an id.
+	auto it = mSortIds.find(name);
+	if(it != mSortIds.end())
+		return it->second;
+
+	UINT id = (UINT)mSortIds.size();
+	mSortIds[name] = id;
+	return id;
+}
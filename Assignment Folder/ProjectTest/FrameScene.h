@@ -0,0 +1,259 @@
+//***************************************************************************************
+// FrameScene.h
+//
+// The CPU side of a TreeBillboards frame: the render items, their transforms and
+// scene graph, the camera and the waves, the update jobs of the frame graph, and the
+// draw list and draw packets built from them.  Nothing here touches the device.  The
+// jobs write their constants through FrameTargets, which the app points at the mapped
+// upload buffers of the current frame resource and FrameBench at plain memory, and the
+// packets are recorded into any CommandSink, so the benchmark runs the app's code.
+//***************************************************************************************
+
+#pragma once
+
+#include "../../Common/Camera.h"
+#include "../../Common/GameTimer.h"
+#include "../../Common/InputLog.h"
+#include "CommandSink.h"
+#include "DirtySet.h"
+#include "DrawSort.h"
+#include "FrameResource.h"
+#include "JobGraph.h"
+#include "ObjectTransforms.h"
+#include "RecordScheduler.h"
+#include "SceneDiff.h"
+#include "SceneFormat.h"
+#include "SceneGraph.h"
+#include "Waves.h"
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+enum class RenderLayer : int
+{
+	Opaque = 0,
+	Transparent,
+	AlphaTested,
+	AlphaTestedTreeSprites,
+	Count
+};
+
+// Lightweight structure stores parameters to draw a shape.  This will
+// vary from app-to-app.
+struct RenderItem
+{
+	RenderItem() = default;
+
+	// Index into GPU constant buffer corresponding to the ObjectCB for this render item.
+	// Also indexes the per-object structured buffer used by instanced draws and the
+	// scene's ObjectTransforms, which holds the item's World and TexTransform matrices,
+	// and is the item's position in the scene's render items (see AddRenderItem).
+	// When the transforms change, mark the item dirty so that every FrameResource gets
+	// the update.
+	UINT ObjCBIndex = -1;
+
+	Material* Mat = nullptr;
+	MeshGeometry* Geo = nullptr;
+
+	// Primitive topology.
+	D3D12_PRIMITIVE_TOPOLOGY PrimitiveType = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
+
+	// World bounds.  Only items placed by the scene graph have them.
+	DirectX::BoundingBox mBoundingBox;
+	bool HasBounds = false;
+
+	// DrawIndexedInstanced parameters.
+	UINT IndexCount = 0;
+	UINT StartIndexLocation = 0;
+	int BaseVertexLocation = 0;
+
+	// Layer the item is drawn in, and small ids of its geometry and submesh used
+	// to build the draw sort key.
+	RenderLayer Layer = RenderLayer::Opaque;
+	UINT GeoSortId = 0;
+	UINT SubmeshSortId = 0;
+};
+
+// Where the frame jobs write.  Element i of ObjectCB and ObjectData belongs to the
+// render item with ObjCBIndex i, element i of Materials to the material with
+// MatCBIndex i.
+struct FrameTargets
+{
+	// Constants of the non-instanced items, and the structured buffer the instanced
+	// ones read.
+	std::uint8_t* ObjectCB = nullptr;
+	UINT ObjectCBStride = 0;
+	std::uint8_t* ObjectData = nullptr;
+	UINT ObjectDataStride = 0;
+
+	MaterialData* Materials = nullptr;
+	PassConstants* Pass = nullptr;
+	Vertex* WaveVertices = nullptr;
+
+	// Object index of every instance, written by BuildDrawPackets.
+	std::uint32_t* InstanceIndices = nullptr;
+};
+
+class FrameScene
+{
+public:
+	// Bits of InputSample::Keys.
+	enum InputKey { KeyWalkForward, KeyWalkBack, KeyStrafeLeft, KeyStrafeRight, KeyToggleFly };
+
+	// Worker command lists per frame resource, and the estimated recording cost below
+	// which a chunk is not worth a command list of its own (about 64 draws).
+	static const UINT RecordWorkerCount = 4;
+	static const std::uint32_t MinRecordChunkCost = 400;
+
+	explicit FrameScene(int frameResourceCount);
+	FrameScene(const FrameScene& rhs) = delete;
+	FrameScene& operator=(const FrameScene& rhs) = delete;
+
+	// Builds the waves, land and tree items and one item per scene shape.  geometries
+	// needs waterGeo, landGeo, treeSpritesGeo and shapeGeo with a submesh per scene
+	// mesh; materials is indexed by MatCBIndex and needs water, grass and treeSprites.
+	// Everything starts dirty.
+	bool Build(const CookedSceneView& scene,
+		const std::unordered_map<std::string, std::unique_ptr<MeshGeometry>>& geometries,
+		const std::vector<Material*>& materials, std::string& error);
+
+	// Draw arguments of each mesh of scene, or false if shapeGeo lacks one.
+	bool ResolveSceneMeshes(const CookedSceneView& scene, std::vector<RenderItem>& meshArgs, std::string& error);
+
+	// Moves the shapes changed by a reload of newScene to their new mesh, material,
+	// group, placement and layer.  meshArgs comes from ResolveSceneMeshes(newScene).
+	void ApplyShapeChanges(const CookedSceneView& newScene, const SceneDelta& delta,
+		const std::vector<RenderItem>& meshArgs);
+
+	// Queues material index for upload to every frame resource.
+	void MarkMaterialDirty(UINT index) { mMaterialDirty.MarkDirty(index); }
+
+	// Moves a scene group, as loaded, by name.
+	void SetGroupLocal(const std::string& group, const DirectX::XMFLOAT4X4& local);
+
+	// Adds the update jobs to graph.  The jobs use gt as it is when the graph runs.
+	// acquire runs before any job writes the targets and stream once the camera and
+	// scene are final; both may be empty.
+	void BuildFrameGraph(JobGraph& graph, const GameTimer& gt,
+		std::function<void()> acquire, std::function<void()> stream);
+
+	// Call before running the graph: the input of the frame, and the frame resource and
+	// targets its jobs write.
+	void SetInput(const InputSample& input);
+	void SetFrame(int frameIndex, const FrameTargets& targets);
+	void SetRenderTargetSize(UINT width, UINT height);
+
+	// Batches the sorted draw list into draw packets, writing the instance indices to
+	// the targets, and splits them into at most maxChunks recording chunks.  Call after
+	// the graph ran.
+	void BuildDrawPackets(std::uint32_t maxChunks, std::uint32_t minChunkCost);
+
+	const std::vector<RecordChunk>& GetRecordChunks()const { return mRecordScheduler.GetChunks(); }
+
+	// Records one chunk of the packets.  Safe to call for different chunks from
+	// different threads.
+	void RecordChunk(std::size_t chunk, CommandSink& sink, DrawStats& stats)const;
+
+	// Geometry of each geometry sort id in the packets, for the sink to bind.
+	const std::vector<MeshGeometry*>& GetSortIdGeometries()const { return mSortIdGeometries; }
+
+	Camera& GetCamera() { return mCamera; }
+	const Camera& GetCamera()const { return mCamera; }
+	const Waves& GetWaves()const { return *mWaves; }
+	const RenderItem* GetWavesItem()const { return mWavesRitem; }
+	const PassConstants& GetPassConstants()const { return mMainPassCB; }
+	const ObjectTransforms& GetTransforms()const { return mTransforms; }
+	const std::vector<std::unique_ptr<RenderItem>>& GetRenderItems()const { return mAllRitems; }
+
+private:
+	void ApplyInput(const GameTimer& gt);
+	void AnimateMaterials(const GameTimer& gt);
+	void UpdateSceneGraph();
+	void AABBCheck();
+	void BlendCamera(const GameTimer& gt);
+	void UpdateWaves(const GameTimer& gt);
+	void UpdateObjectCBs();
+	void UpdateMaterialCBs();
+	void UpdateMainPassCB(const GameTimer& gt);
+	void BuildDrawList();
+
+	void BuildShape(int parentNode, const RenderItem& meshArgs, Material* mat, RenderLayer layer,
+		const DirectX::XMFLOAT4X4& local, const DirectX::XMFLOAT4X4& texTransform);
+	void AddRenderItem(std::unique_ptr<RenderItem> ritem);
+	void SetRenderLayer(RenderItem* ritem, RenderLayer layer);
+	void SetDrawArgs(RenderItem* ritem, MeshGeometry* geo, const std::string& submeshName);
+	UINT GetSortId(const std::string& name);
+
+private:
+	// List of all the render items, indexed by ObjCBIndex.
+	std::vector<std::unique_ptr<RenderItem>> mAllRitems;
+
+	// Render items divided by PSO.
+	std::vector<RenderItem*> mRitemLayer[(int)RenderLayer::Count];
+
+	RenderItem* mWavesRitem = nullptr;
+
+	// Materials indexed by MatCBIndex, and the water material, whose texture scrolls.
+	std::vector<Material*> mMaterialList;
+	Material* mWaterMaterial = nullptr;
+	MeshGeometry* mShapeGeo = nullptr;
+
+	// Render items (by ObjCBIndex) and materials (by MatCBIndex) each frame resource
+	// still has to upload.
+	DirtySet mObjectDirty;
+	DirtySet mMaterialDirty;
+
+	// World and texture transforms of every render item, indexed by ObjCBIndex.
+	ObjectTransforms mTransforms;
+
+	// Transform hierarchy of the shapes; world matrices and bounds of the nodes are
+	// copied into mTransforms and the render items when they change.
+	SceneGraph mSceneGraph;
+
+	// Scene graph node of each scene group, e.g. "castle", by group name.
+	std::unordered_map<std::string, UINT> mGroupNodes;
+
+	// Scene graph node and render item of each scene shape, by shape index.
+	std::vector<UINT> mShapeNodes;
+	std::vector<RenderItem*> mShapeRitems;
+
+	// Visible items of this frame ordered by sort key, plus the radix sort scratch.
+	std::vector<DrawSortItem> mDrawList;
+	std::vector<DrawSortItem> mDrawListScratch;
+	std::unordered_map<std::string, UINT> mSortIds;
+
+	// Batched draws of this frame, their split into recording chunks, and the geometry
+	// of each geometry sort id.
+	std::vector<DrawPacket> mDrawPackets;
+	RecordScheduler mRecordScheduler;
+	std::vector<MeshGeometry*> mSortIdGeometries;
+
+	std::unique_ptr<Waves> mWaves;
+
+	// Simulated time the waves have run, and when the next random wave is due.
+	double mWaveSimTime = 0.0;
+	double mNextWaveDisturb = 0.25;
+
+	PassConstants mMainPassCB;
+	UINT mRenderTargetWidth = 1;
+	UINT mRenderTargetHeight = 1;
+
+	Camera mCamera;
+
+	// The camera position of the last two simulation steps.  mCamera itself holds the
+	// position blended between them for rendering.
+	DirectX::XMFLOAT3 mSimCameraPos = { 0.0f, 4.0f, -15.0f };
+	DirectX::XMFLOAT3 mPrevSimCameraPos = { 0.0f, 4.0f, -15.0f };
+
+	DirectX::BoundingBox mCameraBoundingBox;
+
+	// Input of this frame and the last; the input job only applies samples, so a
+	// replay moves the camera exactly like the recorded run.
+	InputSample mInput;
+	InputSample mPrevInput;
+
+	int mFrameIndex = 0;
+	FrameTargets mTargets;
+};
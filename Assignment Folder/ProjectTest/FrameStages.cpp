@@ -0,0 +1,122 @@
+//***************************************************************************************
+// FrameStages.cpp
+//***************************************************************************************
+
+#include "FrameStages.h"
+#include "DrawSort.h"
+#include <cfloat>
+
+using namespace DirectX;
+
+const float FrameStages::CameraExtent = 1.15f;
+
+bool FrameStages::UseBatchFill(std::size_t pendingCount, std::size_t objectCount)
+{
+	return pendingCount >= BatchFillMinObjects && pendingCount * 4 >= objectCount;
+}
+
+void FrameStages::ClampCameraToBox(Camera& camera, const BoundingBox& cameraBox, const BoundingBox& box)
+{
+	const float cameraCenterX = cameraBox.Center.x;
+	const float cameraCenterZ = cameraBox.Center.z;
+
+	if(box.Center.x - box.Extents.x >= cameraCenterX)
+	{
+		// Set limit for camera on X plane by camera's pos - box extents
+		float limitX = box.Center.x - box.Extents.x - cameraBox.Extents.x;
+		camera.SetPosition(MathHelper::Min(camera.GetPosition3f().x, limitX),
+			camera.GetPosition3f().y,
+			camera.GetPosition3f().z);
+	}
+	else if(box.Center.x + box.Extents.x <= cameraCenterX)
+	{
+		float limitX = box.Center.x + box.Extents.x + cameraBox.Extents.x;
+		camera.SetPosition(MathHelper::Max(camera.GetPosition3f().x, limitX),
+			camera.GetPosition3f().y,
+			camera.GetPosition3f().z);
+	}
+
+	if(box.Center.z - box.Extents.z >= cameraCenterZ)
+	{
+		// Set limit for camera on Z plane by camera's pos - box extents
+		float limitZ = box.Center.z - box.Extents.z - cameraBox.Extents.z;
+		camera.SetPosition(camera.GetPosition3f().x,
+			camera.GetPosition3f().y,
+			MathHelper::Min(camera.GetPosition3f().z, limitZ));
+	}
+	else if(box.Center.z + box.Extents.z <= cameraCenterZ)
+	{
+		float limitZ = box.Center.z + box.Extents.z + cameraBox.Extents.z;
+		camera.SetPosition(camera.GetPosition3f().x,
+			camera.GetPosition3f().y,
+			MathHelper::Max(camera.GetPosition3f().z, limitZ));
+	}
+}
+
+float FrameStages::EstimateTexels(const BoundingBox& bounds, const XMFLOAT3& eye,
+	float projScaleY, float screenHeight, float texRepeat)
+{
+	const XMVECTOR extents = XMLoadFloat3(&bounds.Extents);
+	const XMVECTOR offset = XMVectorSubtract(XMLoadFloat3(&bounds.Center), XMLoadFloat3(&eye));
+	const float radius = XMVectorGetX(XMVector3Length(extents));
+	const float distance = XMVectorGetX(XMVector3Length(offset));
+	if(distance <= radius)
+		return FLT_MAX;
+
+	// The sphere spans 2 * radius / distance * projScaleY of the 2 units of NDC height.
+	return radius / distance * projScaleY * screenHeight * texRepeat;
+}
+
+void FrameStages::ScrollTexture(XMFLOAT4X4& matTransform, float du, float dv)
+{
+	float& tu = matTransform(3, 0);
+	float& tv = matTransform(3, 1);
+
+	tu += du;
+	tv += dv;
+
+	if(tu >= 1.0f)
+		tu -= 1.0f;
+
+	if(tv >= 1.0f)
+		tv -= 1.0f;
+}
+
+void FrameStages::PackMaterial(const Material& mat, MaterialData& data)
+{
+	data.DiffuseAlbedo = mat.DiffuseAlbedo;
+	data.FresnelR0 = mat.FresnelR0;
+	data.Roughness = mat.Roughness;
+	XMStoreFloat4x4(&data.MatTransform, XMMatrixTranspose(XMLoadFloat4x4(&mat.MatTransform)));
+	data.DiffuseMapIndex = (UINT)mat.DiffuseSrvHeapIndex;
+}
+
+void FrameStages::WriteWaveVertices(const Waves& waves, Vertex* vertices)
+{
+	for(int i = 0; i < waves.VertexCount(); ++i)
+	{
+		Vertex& v = vertices[i];
+
+		v.Pos = waves.Position(i);
+		v.Normal = waves.Normal(i);
+
+		// Derive tex-coords from position by 
+		// mapping [-w/2,w/2] --> [0,1]
+		v.TexC.x = 0.5f + v.Pos.x / waves.Width();
+		v.TexC.y = 0.5f - v.Pos.z / waves.Depth();
+	}
+}
+
+std::uint64_t FrameStages::MakeDrawKey(FXMMATRIX view, float nearZ, float farZ,
+	const XMFLOAT3& position, bool backToFront, std::uint32_t drawOrder,
+	std::uint32_t pso, std::uint32_t geometry, std::uint32_t submesh, std::uint32_t material)
+{
+	// Sort on the depth of the object's origin in view space.
+	XMVECTOR posW = XMVectorSet(position.x, position.y, position.z, 1.0f);
+	float viewZ = XMVectorGetZ(XMVector3TransformCoord(posW, view));
+	float depth = DrawSort::NormalizeDepth(viewZ, nearZ, farZ);
+
+	return backToFront ?
+		DrawSort::MakeBackToFrontKey(drawOrder, pso, geometry, submesh, material, depth) :
+		DrawSort::MakeFrontToBackKey(drawOrder, pso, geometry, submesh, material, depth);
+}
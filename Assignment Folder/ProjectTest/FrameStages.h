@@ -0,0 +1,56 @@
+//***************************************************************************************
+// FrameStages.h
+//
+// Pieces of the CPU frame work that the app and the headless benchmark share, so the
+// benchmark measures the same code the app runs.
+//***************************************************************************************
+
+#pragma once
+
+#include "../../Common/Camera.h"
+#include "FrameResource.h"
+#include "Waves.h"
+#include <cstddef>
+#include <cstdint>
+
+class FrameStages
+{
+public:
+	// Half size of the box around the camera used for collision.
+	static const float CameraExtent;
+
+	// Below this many dirty objects they are written individually.
+	static const std::size_t BatchFillMinObjects = 64;
+
+	// When a large part of the scene moved it is cheaper to stream every object into
+	// the structured buffer with the batched SIMD fill than to write the dirty ones
+	// one by one.
+	static bool UseBatchFill(std::size_t pendingCount, std::size_t objectCount);
+
+	// Pushes the camera back out of a box it walked into, along x and z.  cameraBox
+	// is the camera's box before any clamping this frame.
+	static void ClampCameraToBox(Camera& camera, const DirectX::BoundingBox& cameraBox,
+		const DirectX::BoundingBox& box);
+
+	// Scrolls a texture transform by (du, dv), wrapping at 1.
+	static void ScrollTexture(DirectX::XMFLOAT4X4& matTransform, float du, float dv);
+
+	// Packs a material into its element of the material buffer, with the texture
+	// transform transposed for the shaders.
+	static void PackMaterial(const Material& mat, MaterialData& data);
+
+	// Writes the current wave solution as vertices, with the texture coordinates
+	// mapped from the position over the grid.
+	static void WriteWaveVertices(const Waves& waves, Vertex* vertices);
+
+	// Texels across a texture needed to draw it on an item without magnifying it: the
+	// size of the item's bounding sphere on screen, in pixels, times how often the
+	// texture repeats across it.  An item around the camera needs the whole texture.
+	static float EstimateTexels(const DirectX::BoundingBox& bounds, const DirectX::XMFLOAT3& eye,
+		float projScaleY, float screenHeight, float texRepeat);
+
+	// Sort key of an item whose origin is at position in world space.
+	static std::uint64_t MakeDrawKey(DirectX::FXMMATRIX view, float nearZ, float farZ,
+		const DirectX::XMFLOAT3& position, bool backToFront, std::uint32_t drawOrder,
+		std::uint32_t pso, std::uint32_t geometry, std::uint32_t submesh, std::uint32_t material);
+};
@@ -0,0 +1,140 @@
+//***************************************************************************************
+// JobGraph.cpp
+//***************************************************************************************
+
+#include "JobGraph.h"
+#include "../../Common/Profiler.h"
+#include <cstdio>
+
+unsigned JobGraph::AddJob(const std::string& name, std::function<void()> func,
+	std::initializer_list<unsigned> dependencies)
+{
+	const unsigned id = (unsigned)mJobs.size();
+
+	Job job;
+	job.Name = name;
+	job.Func = std::move(func);
+	job.Dependencies.assign(dependencies.begin(), dependencies.end());
+	mJobs.push_back(std::move(job));
+
+	for(unsigned dep : dependencies)
+		mJobs[dep].Dependents.push_back(id);
+
+	return id;
+}
+
+void JobGraph::Run()
+{
+	Start();
+	Wait();
+}
+
+void JobGraph::Start()
+{
+	const unsigned count = (unsigned)mJobs.size();
+	if(mPendingSize != count)
+	{
+		mPending.reset(new std::atomic<int>[count]);
+		mPendingSize = count;
+	}
+
+	for(unsigned i = 0; i < count; ++i)
+	{
+		mPending[i] = (int)mJobs[i].Dependencies.size();
+		mJobs[i].StartMs = 0.0f;
+		mJobs[i].EndMs = 0.0f;
+	}
+
+	mRunStart = std::chrono::steady_clock::now();
+
+	for(unsigned i = 0; i < count; ++i)
+	{
+		if(mJobs[i].Dependencies.empty())
+			Launch(i);
+	}
+}
+
+void JobGraph::Wait()
+{
+	mTasks.wait();
+
+	mWallMs = MsSinceStart();
+	ComputeCriticalPath();
+}
+
+void JobGraph::Launch(unsigned job)
+{
+	mTasks.run([this, job]()
+	{
+		Job& j = mJobs[job];
+
+		j.StartMs = MsSinceStart();
+		{
+			PROFILE_SCOPE(j.Name.c_str());
+			j.Func();
+		}
+		j.EndMs = MsSinceStart();
+
+		for(unsigned dependent : j.Dependents)
+		{
+			if(--mPending[dependent] == 0)
+				Launch(dependent);
+		}
+	});
+}
+
+float JobGraph::MsSinceStart()const
+{
+	auto elapsed = std::chrono::steady_clock::now() - mRunStart;
+	return std::chrono::duration<float, std::milli>(elapsed).count();
+}
+
+void JobGraph::ComputeCriticalPath()
+{
+	// Longest chain of job durations ending at each job.  The ids are in
+	// topological order, so one forward pass sees every dependency first.
+	const unsigned count = (unsigned)mJobs.size();
+	std::vector<float> chainMs(count, 0.0f);
+	std::vector<int> chainPrev(count, -1);
+
+	mWorkMs = 0.0f;
+	int last = -1;
+	for(unsigned i = 0; i < count; ++i)
+	{
+		const float duration = mJobs[i].EndMs - mJobs[i].StartMs;
+		mWorkMs += duration;
+
+		float longest = 0.0f;
+		for(unsigned dep : mJobs[i].Dependencies)
+		{
+			if(chainMs[dep] > longest || chainPrev[i] == -1)
+			{
+				longest = chainMs[dep];
+				chainPrev[i] = (int)dep;
+			}
+		}
+		chainMs[i] = longest + duration;
+
+		if(last == -1 || chainMs[i] > chainMs[last])
+			last = (int)i;
+	}
+
+	mCriticalPath.clear();
+	mCriticalPathMs = last == -1 ? 0.0f : chainMs[last];
+	for(int i = last; i != -1; i = chainPrev[i])
+		mCriticalPath.insert(mCriticalPath.begin(), (unsigned)i);
+}
+
+std::string JobGraph::FormatCriticalPath()const
+{
+	std::string text;
+	char ms[32];
+	for(unsigned job : mCriticalPath)
+	{
+		if(!text.empty())
+			text += " > ";
+		std::snprintf(ms, sizeof(ms), " %.2f", mJobs[job].EndMs - mJobs[job].StartMs);
+		text += mJobs[job].Name + ms;
+	}
+	return text;
+}
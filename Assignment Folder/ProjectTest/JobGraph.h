@@ -0,0 +1,92 @@
+//***************************************************************************************
+// JobGraph.h
+//
+// A fixed graph of frame jobs with dependencies, run on the PPL scheduler.  The
+// graph is built once; every Run starts the jobs without dependencies and each job
+// starts its dependents when it finishes last among their dependencies, so
+// independent work spreads over the worker threads while PPL steals tasks between
+// them.  Every run records the job times and the critical path through the graph.
+//***************************************************************************************
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <initializer_list>
+#include <memory>
+#include <string>
+#include <vector>
+#include <ppl.h>
+
+class JobGraph
+{
+public:
+	JobGraph() = default;
+	JobGraph(const JobGraph& rhs) = delete;
+	JobGraph& operator=(const JobGraph& rhs) = delete;
+
+	// Adds a job that runs after all jobs in dependencies, which must already have
+	// been added.  This keeps the graph acyclic and the ids in topological order.
+	unsigned AddJob(const std::string& name, std::function<void()> func,
+		std::initializer_list<unsigned> dependencies = {});
+
+	// Runs every job once and waits for all of them.  An exception thrown by a job
+	// cancels the jobs not yet started and is rethrown here.
+	void Run();
+
+	// Run in two halves, so the calling thread can do other work while the jobs run.
+	// Every Start must be followed by a Wait, which rethrows as Run does.
+	void Start();
+	void Wait();
+
+	unsigned JobCount()const { return (unsigned)mJobs.size(); }
+	const std::string& GetJobName(unsigned job)const { return mJobs[job].Name; }
+
+	// Times of the last run in milliseconds, relative to the start of Run.
+	float GetJobStart(unsigned job)const { return mJobs[job].StartMs; }
+	float GetJobEnd(unsigned job)const { return mJobs[job].EndMs; }
+
+	// Wall time of the last run, the sum of all job times, and the length of the
+	// longest dependency chain.  Wall time close to the critical path means the
+	// graph is as parallel as its dependencies allow.
+	float GetWallMs()const { return mWallMs; }
+	float GetWorkMs()const { return mWorkMs; }
+	float GetCriticalPathMs()const { return mCriticalPathMs; }
+
+	// Jobs on the critical path of the last run, first to last.
+	const std::vector<unsigned>& GetCriticalPath()const { return mCriticalPath; }
+
+	// "input 0.02 > collision 0.31 > ..." for logging.
+	std::string FormatCriticalPath()const;
+
+private:
+	void Launch(unsigned job);
+	float MsSinceStart()const;
+	void ComputeCriticalPath();
+
+private:
+	struct Job
+	{
+		std::string Name;
+		std::function<void()> Func;
+		std::vector<unsigned> Dependencies;
+		std::vector<unsigned> Dependents;
+		float StartMs = 0.0f;
+		float EndMs = 0.0f;
+	};
+
+	std::vector<Job> mJobs;
+
+	// Dependencies each job is still waiting on in the current run.
+	std::unique_ptr<std::atomic<int>[]> mPending;
+	unsigned mPendingSize = 0;
+
+	concurrency::task_group mTasks;
+	std::chrono::steady_clock::time_point mRunStart;
+
+	float mWallMs = 0.0f;
+	float mWorkMs = 0.0f;
+	float mCriticalPathMs = 0.0f;
+	std::vector<unsigned> mCriticalPath;
+};
@@ -0,0 +1,32 @@
+//***************************************************************************************
+// NullCommandSink.h
+//
+// CommandSink that records nothing and only counts the calls, so draw recording can
+// be run and timed without a device.
+//***************************************************************************************
+
+#pragma once
+
+#include "CommandSink.h"
+
+class NullCommandSink : public CommandSink
+{
+public:
+	void SetPipeline(std::uint32_t pso) override { ++StateCalls; }
+	void SetGeometry(std::uint32_t geometry) override { ++StateCalls; }
+	void SetTopology(std::uint32_t topology) override { ++StateCalls; }
+	void SetMaterial(std::uint32_t matIndex) override { ++StateCalls; }
+	void SetObject(std::uint32_t objCBIndex) override { ++StateCalls; }
+	void SetInstanceBase(std::uint32_t instanceBase) override { ++StateCalls; }
+
+	void DrawIndexed(std::uint32_t indexCount, std::uint32_t instanceCount,
+		std::uint32_t startIndex, std::int32_t baseVertex) override
+	{
+		++DrawCalls;
+		Instances += instanceCount;
+	}
+
+	std::uint32_t StateCalls = 0;
+	std::uint32_t DrawCalls = 0;
+	std::uint32_t Instances = 0;
+};
@@ -0,0 +1,160 @@
+//***************************************************************************************
+// ObjectTransforms.cpp
+//***************************************************************************************
+
+#include "ObjectTransforms.h"
+#include <ppl.h>
+#include <algorithm>
+#include <cassert>
+#include <xmmintrin.h>
+
+using namespace DirectX;
+
+namespace
+{
+	// Objects per job when the fill is split across workers.  Multiple of four so every
+	// job but the last runs only the SIMD path.
+	const std::uint32_t gFillChunkSize = 2048;
+
+	const std::uint32_t gMatrixByteSize = 16 * sizeof(float);
+}
+
+std::uint32_t ObjectTransforms::Size()const
+{
+	return (std::uint32_t)mWorld[0].size();
+}
+
+std::uint32_t ObjectTransforms::Push(const XMFLOAT4X4& world, const XMFLOAT4X4& texTransform)
+{
+	const std::uint32_t index = Size();
+
+	for(int e = 0; e < 16; ++e)
+	{
+		mWorld[e].push_back(world.m[e / 4][e % 4]);
+		mTexTransform[e].push_back(texTransform.m[e / 4][e % 4]);
+	}
+
+	return index;
+}
+
+void ObjectTransforms::SetWorld(std::uint32_t index, const XMFLOAT4X4& world)
+{
+	assert(index < Size());
+
+	for(int e = 0; e < 16; ++e)
+		mWorld[e][index] = world.m[e / 4][e % 4];
+}
+
+void ObjectTransforms::SetTexTransform(std::uint32_t index, const XMFLOAT4X4& texTransform)
+{
+	assert(index < Size());
+
+	for(int e = 0; e < 16; ++e)
+		mTexTransform[e][index] = texTransform.m[e / 4][e % 4];
+}
+
+XMFLOAT4X4 ObjectTransforms::GetWorld(std::uint32_t index)const
+{
+	XMFLOAT4X4 world;
+	for(int e = 0; e < 16; ++e)
+		world.m[e / 4][e % 4] = mWorld[e][index];
+
+	return world;
+}
+
+XMFLOAT4X4 ObjectTransforms::GetTexTransform(std::uint32_t index)const
+{
+	XMFLOAT4X4 texTransform;
+	for(int e = 0; e < 16; ++e)
+		texTransform.m[e / 4][e % 4] = mTexTransform[e][index];
+
+	return texTransform;
+}
+
+XMFLOAT3 ObjectTransforms::GetTranslation(std::uint32_t index)const
+{
+	return XMFLOAT3(mWorld[12][index], mWorld[13][index], mWorld[14][index]);
+}
+
+void ObjectTransforms::WriteConstants(std::uint32_t index, void* dst)const
+{
+	// HLSL expects column major matrices, so write the transpose.
+	float* out = reinterpret_cast<float*>(dst);
+	for(int r = 0; r < 4; ++r)
+	{
+		for(int c = 0; c < 4; ++c)
+		{
+			out[r * 4 + c] = mWorld[c * 4 + r][index];
+			out[16 + r * 4 + c] = mTexTransform[c * 4 + r][index];
+		}
+	}
+}
+
+void ObjectTransforms::WriteConstantsRange(std::uint32_t first, std::uint32_t count,
+	std::uint8_t* dst, std::uint32_t stride)const
+{
+	assert(first + count <= Size());
+	assert(((std::uintptr_t)dst & 15) == 0 && (stride & 15) == 0);
+
+	if(count < 2 * gFillChunkSize)
+	{
+		WriteRangeSerial(first, count, dst, stride);
+		return;
+	}
+
+	const int chunkCount = (int)((count + gFillChunkSize - 1) / gFillChunkSize);
+	concurrency::parallel_for(0, chunkCount, [&](int chunk)
+	{
+		const std::uint32_t chunkFirst = first + (std::uint32_t)chunk * gFillChunkSize;
+		const std::uint32_t chunkSize = std::min(gFillChunkSize, first + count - chunkFirst);
+		WriteRangeSerial(chunkFirst, chunkSize, dst, stride);
+	});
+}
+
+void ObjectTransforms::WriteRangeSerial(std::uint32_t first, std::uint32_t count,
+	std::uint8_t* dst, std::uint32_t stride)const
+{
+	const std::vector<float>* matrices[2] = { mWorld, mTexTransform };
+
+	const std::uint32_t end = first + count;
+	std::uint32_t i = first;
+
+	for(; i + 4 <= end; i += 4)
+	{
+		std::uint8_t* out0 = dst + (size_t)i * stride;
+		std::uint8_t* out1 = out0 + stride;
+		std::uint8_t* out2 = out1 + stride;
+		std::uint8_t* out3 = out2 + stride;
+
+		for(int m = 0; m < 2; ++m)
+		{
+			const std::vector<float>* planes = matrices[m];
+			const size_t offset = m * gMatrixByteSize;
+
+			// Column r of four matrices: each load holds element (k, r) of all four
+			// objects.  After the 4x4 transpose, register j holds column r of object j,
+			// which is row r of its transposed matrix.
+			for(int r = 0; r < 4; ++r)
+			{
+				__m128 c0 = _mm_loadu_ps(&planes[0 + r][i]);
+				__m128 c1 = _mm_loadu_ps(&planes[4 + r][i]);
+				__m128 c2 = _mm_loadu_ps(&planes[8 + r][i]);
+				__m128 c3 = _mm_loadu_ps(&planes[12 + r][i]);
+				_MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+
+				const size_t rowOffset = offset + r * 4 * sizeof(float);
+				_mm_stream_ps(reinterpret_cast<float*>(out0 + rowOffset), c0);
+				_mm_stream_ps(reinterpret_cast<float*>(out1 + rowOffset), c1);
+				_mm_stream_ps(reinterpret_cast<float*>(out2 + rowOffset), c2);
+				_mm_stream_ps(reinterpret_cast<float*>(out3 + rowOffset), c3);
+			}
+		}
+	}
+
+	for(; i < end; ++i)
+		WriteConstants(i, dst + (size_t)i * stride);
+
+	// Streaming stores are weakly ordered; make them visible before the caller submits
+	// the frame.  Each worker fences its own stores.
+	_mm_sfence();
+}
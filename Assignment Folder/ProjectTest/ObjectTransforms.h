@@ -0,0 +1,56 @@
+//***************************************************************************************
+// ObjectTransforms.h
+//
+// World and texture transforms of every render item, indexed by ObjCBIndex and stored
+// as structure-of-arrays: one float array per matrix element.  This lets the constant
+// fill load the same element of four objects with one SSE load, transpose four
+// matrices at a time and stream the results straight into a mapped upload buffer.
+//***************************************************************************************
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <DirectXMath.h>
+
+class ObjectTransforms
+{
+public:
+	ObjectTransforms() = default;
+	ObjectTransforms(const ObjectTransforms& rhs) = delete;
+	ObjectTransforms& operator=(const ObjectTransforms& rhs) = delete;
+	~ObjectTransforms() = default;
+
+	std::uint32_t Size()const;
+
+	// Appends an object and returns its index.
+	std::uint32_t Push(const DirectX::XMFLOAT4X4& world, const DirectX::XMFLOAT4X4& texTransform);
+
+	void SetWorld(std::uint32_t index, const DirectX::XMFLOAT4X4& world);
+	void SetTexTransform(std::uint32_t index, const DirectX::XMFLOAT4X4& texTransform);
+
+	DirectX::XMFLOAT4X4 GetWorld(std::uint32_t index)const;
+	DirectX::XMFLOAT4X4 GetTexTransform(std::uint32_t index)const;
+	DirectX::XMFLOAT3 GetTranslation(std::uint32_t index)const;
+
+	// Writes the transposed World and TexTransform of one object in ObjectConstants
+	// layout (two float4x4, World first) into dst.
+	void WriteConstants(std::uint32_t index, void* dst)const;
+
+	// Writes objects [first, first + count) in ObjectConstants layout.  Object i goes to
+	// dst + i * stride, so dst is the start of the mapped buffer rather than of the range.
+	// dst and stride must be 16 byte aligned.  Uses non-temporal stores, so the target
+	// should be write-only memory such as an upload heap.  Large ranges are split
+	// across the worker pool.
+	void WriteConstantsRange(std::uint32_t first, std::uint32_t count,
+		std::uint8_t* dst, std::uint32_t stride)const;
+
+private:
+	void WriteRangeSerial(std::uint32_t first, std::uint32_t count,
+		std::uint8_t* dst, std::uint32_t stride)const;
+
+private:
+	// mWorld[r * 4 + c][i] is element (r, c) of object i's world matrix.
+	std::vector<float> mWorld[16];
+	std::vector<float> mTexTransform[16];
+};
@@ -0,0 +1,130 @@
+//***************************************************************************************
+// RecordScheduler.cpp
+//***************************************************************************************
+
+#include "RecordScheduler.h"
+#include <algorithm>
+
+std::uint32_t RecordScheduler::EstimateCost(const DrawPacket& packet, const DrawPacket* previous)
+{
+	// Geometry sets both the vertex and the index buffer.
+	std::uint32_t binds = 6;
+	if(previous != nullptr)
+	{
+		binds = 1;
+		if(packet.Pso != previous->Pso)
+			binds++;
+		if(packet.Geometry != previous->Geometry)
+			binds += 2;
+		if(packet.Topology != previous->Topology)
+			binds++;
+		if(packet.MatCBIndex != previous->MatCBIndex)
+			binds++;
+	}
+
+	return DrawCost + binds * BindCost;
+}
+
+void RecordScheduler::Partition(const std::vector<DrawPacket>& packets, std::uint32_t maxChunks, std::uint32_t minChunkCost)
+{
+	mChunks.clear();
+
+	const std::uint32_t count = (std::uint32_t)packets.size();
+	if(count == 0)
+		return;
+
+	mCostPrefix.resize(count + 1);
+	mCostPrefix[0] = 0;
+	for(std::uint32_t i = 0; i < count; ++i)
+		mCostPrefix[i + 1] = mCostPrefix[i] + EstimateCost(packets[i], i > 0 ? &packets[i - 1] : nullptr);
+
+	const std::uint32_t totalCost = mCostPrefix[count];
+
+	std::uint32_t chunkCount = minChunkCost > 0 ? totalCost / minChunkCost : maxChunks;
+	chunkCount = std::min(chunkCount, maxChunks);
+	chunkCount = std::min(chunkCount, count);
+	chunkCount = std::max(chunkCount, 1u);
+
+	// Cut where the running cost crosses each multiple of totalCost / chunkCount,
+	// on whichever side of the crossing packet is closer.  Every chunk keeps at least
+	// one packet.
+	std::uint32_t first = 0;
+	for(std::uint32_t k = 1; k <= chunkCount; ++k)
+	{
+		std::uint32_t end = count;
+		if(k < chunkCount)
+		{
+			const std::uint32_t target = (std::uint32_t)((std::uint64_t)totalCost * k / chunkCount);
+			end = (std::uint32_t)(std::lower_bound(mCostPrefix.begin(), mCostPrefix.end(), target) - mCostPrefix.begin());
+			if(end > 0 && target - mCostPrefix[end - 1] < mCostPrefix[end] - target)
+				end--;
+
+			end = std::max(end, first + 1);
+			end = std::min(end, count - (chunkCount - k));
+		}
+
+		RecordChunk chunk;
+		chunk.First = first;
+		chunk.Count = end - first;
+		chunk.Cost = mCostPrefix[end] - mCostPrefix[first];
+		mChunks.push_back(chunk);
+
+		first = end;
+	}
+}
+
+void RecordScheduler::Record(const std::vector<DrawPacket>& packets, const RecordChunk& chunk,
+	CommandSink& sink, DrawStats& stats)
+{
+	const DrawPacket* prev = nullptr;
+
+	for(std::uint32_t i = chunk.First; i < chunk.First + chunk.Count; ++i)
+	{
+		const DrawPacket& p = packets[i];
+
+		if(prev == nullptr || p.Pso != prev->Pso)
+		{
+			sink.SetPipeline(p.Pso);
+			stats.BindsIssued++;
+		}
+		else
+			stats.BindsSkipped++;
+
+		if(prev == nullptr || p.Geometry != prev->Geometry)
+		{
+			sink.SetGeometry(p.Geometry);
+			stats.BindsIssued += 2;
+		}
+		else
+			stats.BindsSkipped += 2;
+
+		if(prev == nullptr || p.Topology != prev->Topology)
+		{
+			sink.SetTopology(p.Topology);
+			stats.BindsIssued++;
+		}
+		else
+			stats.BindsSkipped++;
+
+		if(prev == nullptr || p.MatCBIndex != prev->MatCBIndex)
+		{
+			sink.SetMaterial(p.MatCBIndex);
+			stats.BindsIssued++;
+		}
+		else
+			stats.BindsSkipped++;
+
+		if(p.Instanced)
+			sink.SetInstanceBase(p.InstanceBase);
+		else
+			sink.SetObject(p.ObjCBIndex);
+		stats.BindsIssued++;
+
+		sink.DrawIndexed(p.IndexCount, p.InstanceCount, p.StartIndex, p.BaseVertex);
+
+		stats.DrawCalls++;
+		stats.Instances += p.InstanceCount;
+
+		prev = &p;
+	}
+}
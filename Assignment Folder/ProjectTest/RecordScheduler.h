@@ -0,0 +1,74 @@
+//***************************************************************************************
+// RecordScheduler.h
+//
+// Splits the sorted draw list into contiguous chunks of similar recording cost so
+// each chunk can be recorded on its own command list by a worker thread.  The lists
+// are submitted in chunk order, which keeps the draw order of the sort.
+//***************************************************************************************
+
+#pragma once
+
+#include "CommandSink.h"
+#include "DrawSort.h"
+#include <cstdint>
+#include <vector>
+
+// One draw after batching: everything needed to record it without looking at the
+// render item again.  Instanced packets draw InstanceCount objects whose indices were
+// already written to InstanceIndices starting at InstanceBase.
+struct DrawPacket
+{
+	std::uint32_t Pso = 0;
+	std::uint32_t Geometry = 0;
+	std::uint32_t Topology = 0;
+	std::uint32_t MatCBIndex = 0;
+	std::uint32_t ObjCBIndex = 0;
+
+	std::uint32_t IndexCount = 0;
+	std::uint32_t StartIndex = 0;
+	std::int32_t BaseVertex = 0;
+
+	bool Instanced = false;
+	std::uint32_t InstanceBase = 0;
+	std::uint32_t InstanceCount = 1;
+};
+
+// Packets [First, First + Count) recorded on one command list.
+struct RecordChunk
+{
+	std::uint32_t First = 0;
+	std::uint32_t Count = 0;
+	std::uint32_t Cost = 0;
+};
+
+class RecordScheduler
+{
+public:
+	// Relative CPU cost of recording a draw and of a state change.  Recording cost is
+	// dominated by the number of calls into the command list, not by the size of the
+	// draw, so a packet costs one draw plus the bindings it changes.
+	static const std::uint32_t DrawCost = 4;
+	static const std::uint32_t BindCost = 1;
+
+	// Cost of recording packet after previous, or from unknown state if previous is null.
+	static std::uint32_t EstimateCost(const DrawPacket& packet, const DrawPacket* previous);
+
+	// Splits the packets into at most maxChunks chunks.  Fewer chunks are used when a
+	// chunk would fall below minChunkCost, since a command list has a fixed setup
+	// cost; an empty list gives no chunks.  Packets are never split.
+	void Partition(const std::vector<DrawPacket>& packets, std::uint32_t maxChunks, std::uint32_t minChunkCost);
+
+	const std::vector<RecordChunk>& GetChunks() const { return mChunks; }
+
+	// Records one chunk into sink.  The state starts out unknown, so the first packet
+	// binds everything and later packets only what changed.  Safe to call for
+	// different chunks from different threads.
+	static void Record(const std::vector<DrawPacket>& packets, const RecordChunk& chunk,
+		CommandSink& sink, DrawStats& stats);
+
+private:
+	std::vector<RecordChunk> mChunks;
+
+	// mCostPrefix[i] is the cost of packets [0, i).
+	std::vector<std::uint32_t> mCostPrefix;
+};
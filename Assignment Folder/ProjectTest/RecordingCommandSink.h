@@ -0,0 +1,78 @@
+//***************************************************************************************
+// RecordingCommandSink.h
+//
+// CommandSink that logs every call in order, so a test can check what the record
+// scheduler issued for a chunk: which state it bound, which it skipped, and the order
+// of the draws.
+//***************************************************************************************
+
+#pragma once
+
+#include "CommandSink.h"
+#include <vector>
+
+class RecordingCommandSink : public CommandSink
+{
+public:
+	enum class Call
+	{
+		Pipeline,
+		Geometry,
+		Topology,
+		Material,
+		Object,
+		InstanceBase,
+		Draw
+	};
+
+	// One call.  Value is the argument of a state call and the index count of a draw.
+	struct Entry
+	{
+		Call Kind;
+		std::uint32_t Value = 0;
+		std::uint32_t InstanceCount = 0;
+		std::uint32_t StartIndex = 0;
+		std::int32_t BaseVertex = 0;
+	};
+
+	void SetPipeline(std::uint32_t pso) override { Log(Call::Pipeline, pso); }
+	void SetGeometry(std::uint32_t geometry) override { Log(Call::Geometry, geometry); }
+	void SetTopology(std::uint32_t topology) override { Log(Call::Topology, topology); }
+	void SetMaterial(std::uint32_t matIndex) override { Log(Call::Material, matIndex); }
+	void SetObject(std::uint32_t objCBIndex) override { Log(Call::Object, objCBIndex); }
+	void SetInstanceBase(std::uint32_t instanceBase) override { Log(Call::InstanceBase, instanceBase); }
+
+	void DrawIndexed(std::uint32_t indexCount, std::uint32_t instanceCount,
+		std::uint32_t startIndex, std::int32_t baseVertex) override
+	{
+		Entry e;
+		e.Kind = Call::Draw;
+		e.Value = indexCount;
+		e.InstanceCount = instanceCount;
+		e.StartIndex = startIndex;
+		e.BaseVertex = baseVertex;
+		Calls.push_back(e);
+	}
+
+	std::uint32_t Count(Call kind) const
+	{
+		std::uint32_t n = 0;
+		for(const Entry& e : Calls)
+		{
+			if(e.Kind == kind)
+				n++;
+		}
+		return n;
+	}
+
+	std::vector<Entry> Calls;
+
+private:
+	void Log(Call kind, std::uint32_t value)
+	{
+		Entry e;
+		e.Kind = kind;
+		e.Value = value;
+		Calls.push_back(e);
+	}
+};
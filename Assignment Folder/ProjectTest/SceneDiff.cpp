@@ -0,0 +1,108 @@
+//***************************************************************************************
+// SceneDiff.cpp
+//***************************************************************************************
+
+#include "SceneDiff.h"
+#include <cstring>
+
+namespace
+{
+	bool SameString(const CookedSceneView& a, std::uint32_t aOffset, const CookedSceneView& b, std::uint32_t bOffset)
+	{
+		return std::strcmp(a.GetString(aOffset), b.GetString(bOffset)) == 0;
+	}
+
+	bool SameMatrix(const DirectX::XMFLOAT4X4& a, const DirectX::XMFLOAT4X4& b)
+	{
+		return std::memcmp(&a, &b, sizeof(DirectX::XMFLOAT4X4)) == 0;
+	}
+
+	SceneDelta Structural(const std::string& reason)
+	{
+		SceneDelta delta;
+		delta.Structural = true;
+		delta.Reason = reason;
+		return delta;
+	}
+}
+
+SceneDelta SceneDiff::Diff(const CookedSceneView& oldScene, const CookedSceneView& newScene)
+{
+	const CookedSceneHeader& oldHeader = *oldScene.Header;
+	const CookedSceneHeader& newHeader = *newScene.Header;
+
+	// Textures own GPU resources and descriptors, so any change there needs a reload.
+	if(oldHeader.TextureCount != newHeader.TextureCount)
+		return Structural("texture count changed");
+
+	for(std::uint32_t i = 0; i < newHeader.TextureCount; ++i)
+	{
+		const CookedTexture& a = oldScene.Textures[i];
+		const CookedTexture& b = newScene.Textures[i];
+		if(!SameString(oldScene, a.Name, newScene, b.Name) ||
+			!SameString(oldScene, a.Filename, newScene, b.Filename) ||
+			a.IsArray != b.IsArray)
+		{
+			return Structural(std::string("texture '") + newScene.GetString(b.Name) + "' changed");
+		}
+	}
+
+	// The material constant buffers are sized and indexed by material.
+	if(oldHeader.MaterialCount != newHeader.MaterialCount)
+		return Structural("material count changed");
+
+	for(std::uint32_t i = 0; i < newHeader.MaterialCount; ++i)
+	{
+		if(!SameString(oldScene, oldScene.Materials[i].Name, newScene, newScene.Materials[i].Name))
+			return Structural("materials were renamed or reordered");
+	}
+
+	// Groups are scene graph nodes created once at startup.
+	if(oldHeader.GroupCount != newHeader.GroupCount)
+		return Structural("group count changed");
+
+	for(std::uint32_t i = 0; i < newHeader.GroupCount; ++i)
+	{
+		if(!SameString(oldScene, oldScene.Groups[i].Name, newScene, newScene.Groups[i].Name) ||
+			oldScene.Groups[i].Parent != newScene.Groups[i].Parent)
+		{
+			return Structural("groups were renamed or reparented");
+		}
+	}
+
+	// The object constant buffers are sized by the number of render items.
+	if(oldHeader.ShapeCount != newHeader.ShapeCount)
+		return Structural("shape count changed");
+
+	SceneDelta delta;
+
+	for(std::uint32_t i = 0; i < newHeader.MaterialCount; ++i)
+	{
+		const CookedMaterial& a = oldScene.Materials[i];
+		const CookedMaterial& b = newScene.Materials[i];
+		if(a.TextureIndex != b.TextureIndex ||
+			std::memcmp(a.DiffuseAlbedo, b.DiffuseAlbedo, sizeof(a.DiffuseAlbedo)) != 0 ||
+			std::memcmp(a.FresnelR0, b.FresnelR0, sizeof(a.FresnelR0)) != 0 ||
+			a.Roughness != b.Roughness ||
+			a.Layer != b.Layer)
+		{
+			delta.ChangedMaterials.push_back(i);
+		}
+	}
+
+	// Mesh tables are rebuilt on every cook, so compare meshes by name.
+	for(std::uint32_t i = 0; i < newHeader.ShapeCount; ++i)
+	{
+		if(!SameMatrix(oldScene.ShapeLocals[i], newScene.ShapeLocals[i]) ||
+			!SameMatrix(oldScene.ShapeTexTransforms[i], newScene.ShapeTexTransforms[i]) ||
+			oldScene.ShapeMaterials[i] != newScene.ShapeMaterials[i] ||
+			oldScene.ShapeGroups[i] != newScene.ShapeGroups[i] ||
+			!SameString(oldScene, oldScene.Meshes[oldScene.ShapeMeshes[i]].Name,
+				newScene, newScene.Meshes[newScene.ShapeMeshes[i]].Name))
+		{
+			delta.ChangedShapes.push_back(i);
+		}
+	}
+
+	return delta;
+}
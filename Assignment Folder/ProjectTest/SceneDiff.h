@@ -0,0 +1,38 @@
+//***************************************************************************************
+// SceneDiff.h
+//
+// Compares two cooked scenes for hot reload.  The result lists the materials and
+// shapes whose data changed, so only those render items and material constants need
+// to be patched.  Changes that alter the set of textures, materials, groups or shapes
+// cannot be patched in place and are reported as structural.
+//
+// Works only on cooked scene data, so it can be run without a device.
+//***************************************************************************************
+
+#pragma once
+
+#include "SceneFormat.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct SceneDelta
+{
+	// Set when the new scene cannot be applied by patching; Reason says why.
+	bool Structural = false;
+	std::string Reason;
+
+	// Indices (in both scenes) of materials whose constants, texture or layer changed.
+	std::vector<std::uint32_t> ChangedMaterials;
+
+	// Indices (in both scenes) of shapes whose transform, mesh, material or group changed.
+	std::vector<std::uint32_t> ChangedShapes;
+
+	bool Empty()const { return !Structural && ChangedMaterials.empty() && ChangedShapes.empty(); }
+};
+
+class SceneDiff
+{
+public:
+	static SceneDelta Diff(const CookedSceneView& oldScene, const CookedSceneView& newScene);
+};
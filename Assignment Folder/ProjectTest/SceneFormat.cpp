@@ -0,0 +1,586 @@
+//***************************************************************************************
+// SceneFormat.cpp
+//
+// Text format, one statement per line, '#' starts a comment:
+//
+//   texture  <name> <filename> [array]
+//   material <name> <texture> <albedo r g b a> <fresnelR0 r g b> <roughness>
+//            [opaque|alphaTested|transparent]
+//   group    <name> [parent group]
+//   shape    <group|-> <mesh> <material> <scale x y z> <offset x y z>
+//            [<rotation x y z> [<texture scale x y z>]]
+//
+// Names and filenames cannot contain whitespace.  A group must be declared before it
+// is used as a parent, so cooked groups are always in parent-before-child order.
+//***************************************************************************************
+
+#include "SceneFormat.h"
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <unordered_map>
+
+using namespace DirectX;
+
+static_assert(sizeof(CookedSceneHeader) == 96, "Cooked scene header layout changed.");
+static_assert(sizeof(CookedTexture) == 16, "Cooked texture layout changed.");
+static_assert(sizeof(CookedMaterial) == 44, "Cooked material layout changed.");
+static_assert(sizeof(XMFLOAT4X4) == 64, "Cooked shapes store XMFLOAT4X4 matrices.");
+
+namespace
+{
+	void SetIdentity(XMFLOAT4X4& m)
+	{
+		for(int r = 0; r < 4; ++r)
+		{
+			for(int c = 0; c < 4; ++c)
+				m.m[r][c] = r == c ? 1.0f : 0.0f;
+		}
+	}
+
+	// Scaling * XMMatrixRotationRollPitchYaw * translation, written out so cooking does
+	// not need DirectXMath.
+	void ComposeLocal(const float scale[3], const float rotation[3], const float offset[3], XMFLOAT4X4& local)
+	{
+		const float cp = std::cos(rotation[0]), sp = std::sin(rotation[0]);
+		const float cy = std::cos(rotation[1]), sy = std::sin(rotation[1]);
+		const float cr = std::cos(rotation[2]), sr = std::sin(rotation[2]);
+
+		const float rotationRows[3][3] =
+		{
+			{ cr * cy + sr * sp * sy, sr * cp, sr * sp * cy - cr * sy },
+			{ cr * sp * sy - sr * cy, cr * cp, sr * sy + cr * sp * cy },
+			{ cp * sy, -sp, cp * cy },
+		};
+
+		SetIdentity(local);
+		for(int r = 0; r < 3; ++r)
+		{
+			for(int c = 0; c < 3; ++c)
+				local.m[r][c] = scale[r] * rotationRows[r][c];
+			local.m[3][r] = offset[r];
+		}
+	}
+
+	bool ParseFloats(std::istringstream& tokens, float* values, int count)
+	{
+		for(int i = 0; i < count; ++i)
+		{
+			std::string token;
+			if(!(tokens >> token))
+				return false;
+
+			char* end = nullptr;
+			values[i] = std::strtof(token.c_str(), &end);
+
+			// Accept the C++ style "1.0f" suffix so values can be pasted from code.
+			if(end == token.c_str() || (*end != '\0' && !(*end == 'f' && end[1] == '\0')))
+				return false;
+		}
+		return true;
+	}
+
+	std::string LineError(int line, const std::string& message)
+	{
+		return "line " + std::to_string(line) + ": " + message;
+	}
+
+	// Appends strings to the cooked string table, sharing identical strings.
+	class StringTable
+	{
+	public:
+		std::uint32_t Add(const std::string& str)
+		{
+			auto it = mOffsets.find(str);
+			if(it != mOffsets.end())
+				return it->second;
+
+			const std::uint32_t offset = (std::uint32_t)mData.size();
+			mData.insert(mData.end(), str.begin(), str.end());
+			mData.push_back('\0');
+			mOffsets[str] = offset;
+			return offset;
+		}
+
+		const std::vector<char>& Data()const { return mData; }
+
+	private:
+		std::vector<char> mData;
+		std::unordered_map<std::string, std::uint32_t> mOffsets;
+	};
+
+	std::uint32_t AlignUp(std::size_t value, std::size_t alignment)
+	{
+		return (std::uint32_t)((value + alignment - 1) & ~(alignment - 1));
+	}
+
+	template<typename T>
+	std::uint32_t AppendArray(std::vector<std::uint8_t>& out, const std::vector<T>& items)
+	{
+		const std::uint32_t offset = AlignUp(out.size(), 16);
+		out.resize(offset + items.size() * sizeof(T));
+		if(!items.empty())
+			std::memcpy(out.data() + offset, items.data(), items.size() * sizeof(T));
+		return offset;
+	}
+
+	template<typename T>
+	bool FixUp(const std::uint8_t* data, std::size_t size, std::uint32_t offset,
+		std::uint32_t count, const T*& ptr)
+	{
+		if(offset % alignof(T) != 0 || offset > size || (size - offset) / sizeof(T) < count)
+			return false;
+
+		ptr = reinterpret_cast<const T*>(data + offset);
+		return true;
+	}
+
+	// Version of a cooked file, or 0 if it cannot be read.
+	std::uint32_t ReadCookedVersion(const std::string& filename)
+	{
+		CookedSceneHeader header = {};
+		std::ifstream fin(filename, std::ios::binary);
+		if(!fin.read(reinterpret_cast<char*>(&header), sizeof(header)) || header.Magic != SceneFormat::CookedMagic)
+			return 0;
+		return header.Version;
+	}
+}
+
+bool SceneFormat::ParseText(const std::string& text, SceneDesc& scene, std::string& error)
+{
+	scene = SceneDesc();
+
+	std::istringstream lines(text);
+	std::string line;
+	int lineNumber = 0;
+
+	while(std::getline(lines, line))
+	{
+		++lineNumber;
+
+		const size_t comment = line.find('#');
+		if(comment != std::string::npos)
+			line.erase(comment);
+
+		std::istringstream tokens(line);
+		std::string keyword;
+		if(!(tokens >> keyword))
+			continue;
+
+		if(keyword == "texture")
+		{
+			SceneTextureDesc tex;
+			std::string option;
+			if(!(tokens >> tex.Name >> tex.Filename))
+			{
+				error = LineError(lineNumber, "expected: texture <name> <filename> [array]");
+				return false;
+			}
+			if(tokens >> option)
+			{
+				if(option != "array")
+				{
+					error = LineError(lineNumber, "unknown texture option '" + option + "'");
+					return false;
+				}
+				tex.IsArray = true;
+			}
+			scene.Textures.push_back(tex);
+		}
+		else if(keyword == "material")
+		{
+			SceneMaterialDesc mat;
+			if(!(tokens >> mat.Name >> mat.Texture) ||
+				!ParseFloats(tokens, mat.DiffuseAlbedo, 4) ||
+				!ParseFloats(tokens, mat.FresnelR0, 3) ||
+				!ParseFloats(tokens, &mat.Roughness, 1))
+			{
+				error = LineError(lineNumber, "expected: material <name> <texture> <r g b a> <r g b> <roughness> [layer]");
+				return false;
+			}
+
+			std::string layer;
+			if(tokens >> layer)
+			{
+				if(layer == "opaque")
+					mat.Layer = SceneLayer::Opaque;
+				else if(layer == "alphaTested")
+					mat.Layer = SceneLayer::AlphaTested;
+				else if(layer == "transparent")
+					mat.Layer = SceneLayer::Transparent;
+				else
+				{
+					error = LineError(lineNumber, "unknown material layer '" + layer + "'");
+					return false;
+				}
+			}
+			scene.Materials.push_back(mat);
+		}
+		else if(keyword == "group")
+		{
+			SceneGroupDesc group;
+			if(!(tokens >> group.Name))
+			{
+				error = LineError(lineNumber, "expected: group <name> [parent]");
+				return false;
+			}
+			tokens >> group.Parent;
+			scene.Groups.push_back(group);
+		}
+		else if(keyword == "shape")
+		{
+			SceneShapeDesc shape;
+			if(!(tokens >> shape.Group >> shape.Mesh >> shape.Material) ||
+				!ParseFloats(tokens, shape.Scale, 3) ||
+				!ParseFloats(tokens, shape.Offset, 3))
+			{
+				error = LineError(lineNumber, "expected: shape <group> <mesh> <material> <scale xyz> <offset xyz> [<rotation xyz> [<tex scale xyz>]]");
+				return false;
+			}
+			if(shape.Group == "-")
+				shape.Group.clear();
+
+			// Rotation and texture scale are optional, but must be complete if present.
+			std::string rest;
+			std::getline(tokens, rest);
+			std::istringstream optional(rest);
+			std::string probe;
+			int optionalCount = 0;
+			while(optional >> probe)
+				++optionalCount;
+
+			std::istringstream values(rest);
+			if((optionalCount != 0 && optionalCount != 3 && optionalCount != 6) ||
+				(optionalCount >= 3 && !ParseFloats(values, shape.Rotation, 3)) ||
+				(optionalCount == 6 && !ParseFloats(values, shape.TexScale, 3)))
+			{
+				error = LineError(lineNumber, "rotation and texture scale need three values each");
+				return false;
+			}
+			scene.Shapes.push_back(shape);
+		}
+		else
+		{
+			error = LineError(lineNumber, "unknown statement '" + keyword + "'");
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool SceneFormat::LoadText(const std::string& filename, SceneDesc& scene, std::string& error)
+{
+	std::ifstream fin(filename, std::ios::binary);
+	if(!fin)
+	{
+		error = "cannot open " + filename;
+		return false;
+	}
+
+	std::ostringstream text;
+	text << fin.rdbuf();
+
+	if(!ParseText(text.str(), scene, error))
+	{
+		error = filename + ", " + error;
+		return false;
+	}
+	return true;
+}
+
+bool SceneFormat::Cook(const SceneDesc& scene, std::vector<std::uint8_t>& cooked, std::string& error)
+{
+	StringTable strings;
+
+	std::unordered_map<std::string, std::uint32_t> textureIndices;
+	std::vector<CookedTexture> textures;
+	for(const auto& tex : scene.Textures)
+	{
+		if(!textureIndices.emplace(tex.Name, (std::uint32_t)textures.size()).second)
+		{
+			error = "duplicate texture '" + tex.Name + "'";
+			return false;
+		}
+
+		CookedTexture cookedTex = {};
+		cookedTex.Name = strings.Add(tex.Name);
+		cookedTex.Filename = strings.Add(tex.Filename);
+		cookedTex.IsArray = tex.IsArray ? 1 : 0;
+		textures.push_back(cookedTex);
+	}
+
+	std::unordered_map<std::string, std::uint32_t> materialIndices;
+	std::vector<CookedMaterial> materials;
+	for(const auto& mat : scene.Materials)
+	{
+		auto tex = textureIndices.find(mat.Texture);
+		if(tex == textureIndices.end())
+		{
+			error = "material '" + mat.Name + "' uses unknown texture '" + mat.Texture + "'";
+			return false;
+		}
+		if(!materialIndices.emplace(mat.Name, (std::uint32_t)materials.size()).second)
+		{
+			error = "duplicate material '" + mat.Name + "'";
+			return false;
+		}
+
+		CookedMaterial cookedMat = {};
+		cookedMat.Name = strings.Add(mat.Name);
+		cookedMat.TextureIndex = tex->second;
+		std::memcpy(cookedMat.DiffuseAlbedo, mat.DiffuseAlbedo, sizeof(cookedMat.DiffuseAlbedo));
+		std::memcpy(cookedMat.FresnelR0, mat.FresnelR0, sizeof(cookedMat.FresnelR0));
+		cookedMat.Roughness = mat.Roughness;
+		cookedMat.Layer = (std::uint32_t)mat.Layer;
+		materials.push_back(cookedMat);
+	}
+
+	std::unordered_map<std::string, std::int32_t> groupIndices;
+	std::vector<CookedGroup> groups;
+	for(const auto& group : scene.Groups)
+	{
+		CookedGroup cookedGroup = {};
+		cookedGroup.Name = strings.Add(group.Name);
+		cookedGroup.Parent = -1;
+
+		if(!group.Parent.empty())
+		{
+			auto parent = groupIndices.find(group.Parent);
+			if(parent == groupIndices.end())
+			{
+				error = "group '" + group.Name + "' uses undeclared parent '" + group.Parent + "'";
+				return false;
+			}
+			cookedGroup.Parent = parent->second;
+		}
+
+		if(!groupIndices.emplace(group.Name, (std::int32_t)groups.size()).second)
+		{
+			error = "duplicate group '" + group.Name + "'";
+			return false;
+		}
+		groups.push_back(cookedGroup);
+	}
+
+	std::unordered_map<std::string, std::uint32_t> meshIndices;
+	std::vector<CookedMesh> meshes;
+
+	const size_t shapeCount = scene.Shapes.size();
+	std::vector<XMFLOAT4X4> locals(shapeCount);
+	std::vector<XMFLOAT4X4> texTransforms(shapeCount);
+	std::vector<std::uint32_t> shapeMeshes(shapeCount);
+	std::vector<std::uint32_t> shapeMaterials(shapeCount);
+	std::vector<std::int32_t> shapeGroups(shapeCount);
+
+	for(size_t i = 0; i < shapeCount; ++i)
+	{
+		const SceneShapeDesc& shape = scene.Shapes[i];
+
+		auto mat = materialIndices.find(shape.Material);
+		if(mat == materialIndices.end())
+		{
+			error = "shape " + std::to_string(i) + " uses unknown material '" + shape.Material + "'";
+			return false;
+		}
+
+		shapeGroups[i] = -1;
+		if(!shape.Group.empty())
+		{
+			auto group = groupIndices.find(shape.Group);
+			if(group == groupIndices.end())
+			{
+				error = "shape " + std::to_string(i) + " uses unknown group '" + shape.Group + "'";
+				return false;
+			}
+			shapeGroups[i] = group->second;
+		}
+
+		auto mesh = meshIndices.find(shape.Mesh);
+		if(mesh == meshIndices.end())
+		{
+			CookedMesh cookedMesh = { strings.Add(shape.Mesh) };
+			mesh = meshIndices.emplace(shape.Mesh, (std::uint32_t)meshes.size()).first;
+			meshes.push_back(cookedMesh);
+		}
+
+		shapeMeshes[i] = mesh->second;
+		shapeMaterials[i] = mat->second;
+
+		ComposeLocal(shape.Scale, shape.Rotation, shape.Offset, locals[i]);
+
+		SetIdentity(texTransforms[i]);
+		for(int axis = 0; axis < 3; ++axis)
+			texTransforms[i].m[axis][axis] = shape.TexScale[axis];
+	}
+
+	CookedSceneHeader header = {};
+	header.Magic = CookedMagic;
+	header.Version = CookedVersion;
+	header.TextureCount = (std::uint32_t)textures.size();
+	header.MaterialCount = (std::uint32_t)materials.size();
+	header.MeshCount = (std::uint32_t)meshes.size();
+	header.GroupCount = (std::uint32_t)groups.size();
+	header.ShapeCount = (std::uint32_t)shapeCount;
+
+	cooked.assign(sizeof(CookedSceneHeader), 0);
+	header.TexturesOffset = AppendArray(cooked, textures);
+	header.MaterialsOffset = AppendArray(cooked, materials);
+	header.MeshesOffset = AppendArray(cooked, meshes);
+	header.GroupsOffset = AppendArray(cooked, groups);
+	header.ShapeLocalsOffset = AppendArray(cooked, locals);
+	header.ShapeTexTransformsOffset = AppendArray(cooked, texTransforms);
+	header.ShapeMeshesOffset = AppendArray(cooked, shapeMeshes);
+	header.ShapeMaterialsOffset = AppendArray(cooked, shapeMaterials);
+	header.ShapeGroupsOffset = AppendArray(cooked, shapeGroups);
+	header.StringsOffset = AppendArray(cooked, strings.Data());
+	header.StringsSize = (std::uint32_t)strings.Data().size();
+	header.FileSize = (std::uint32_t)cooked.size();
+
+	std::memcpy(cooked.data(), &header, sizeof(header));
+	return true;
+}
+
+bool SceneFormat::CookFileIfStale(const std::string& textFilename, const std::string& cookedFilename, std::string& error)
+{
+	std::uint64_t textTime = 0;
+	std::uint64_t cookedTime = 0;
+	const bool hasText = GetFileWriteTime(textFilename, textTime);
+	const bool hasCooked = GetFileWriteTime(cookedFilename, cookedTime);
+
+	// Allow shipping only the cooked file.
+	if(hasCooked && (!hasText || (cookedTime >= textTime && ReadCookedVersion(cookedFilename) == CookedVersion)))
+		return true;
+
+	SceneDesc scene;
+	if(!LoadText(textFilename, scene, error))
+		return false;
+
+	std::vector<std::uint8_t> cooked;
+	if(!Cook(scene, cooked, error))
+	{
+		error = textFilename + ", " + error;
+		return false;
+	}
+
+	return WriteCooked(cookedFilename, cooked.data(), cooked.size(), error);
+}
+
+bool SceneFormat::WriteCooked(const std::string& filename, const std::uint8_t* data, std::size_t size, std::string& error)
+{
+	std::ofstream fout(filename, std::ios::binary | std::ios::trunc);
+	fout.write(reinterpret_cast<const char*>(data), size);
+	if(!fout)
+	{
+		error = "cannot write " + filename;
+		return false;
+	}
+	return true;
+}
+
+bool SceneFormat::CreateView(const std::uint8_t* data, std::size_t size, CookedSceneView& view, std::string& error)
+{
+	view = CookedSceneView();
+
+	const CookedSceneHeader* header = reinterpret_cast<const CookedSceneHeader*>(data);
+	if(data == nullptr || size < sizeof(CookedSceneHeader) || header->Magic != CookedMagic)
+	{
+		error = "not a cooked scene";
+		return false;
+	}
+	if(header->Version != CookedVersion || header->FileSize != size)
+	{
+		error = "cooked scene has a different version or is truncated";
+		return false;
+	}
+
+	CookedSceneView v;
+	v.Header = header;
+	const std::uint32_t shapeCount = header->ShapeCount;
+	if(!FixUp(data, size, header->TexturesOffset, header->TextureCount, v.Textures) ||
+		!FixUp(data, size, header->MaterialsOffset, header->MaterialCount, v.Materials) ||
+		!FixUp(data, size, header->MeshesOffset, header->MeshCount, v.Meshes) ||
+		!FixUp(data, size, header->GroupsOffset, header->GroupCount, v.Groups) ||
+		!FixUp(data, size, header->ShapeLocalsOffset, shapeCount, v.ShapeLocals) ||
+		!FixUp(data, size, header->ShapeTexTransformsOffset, shapeCount, v.ShapeTexTransforms) ||
+		!FixUp(data, size, header->ShapeMeshesOffset, shapeCount, v.ShapeMeshes) ||
+		!FixUp(data, size, header->ShapeMaterialsOffset, shapeCount, v.ShapeMaterials) ||
+		!FixUp(data, size, header->ShapeGroupsOffset, shapeCount, v.ShapeGroups) ||
+		!FixUp(data, size, header->StringsOffset, header->StringsSize, v.Strings) ||
+		header->StringsSize == 0 || v.Strings[header->StringsSize - 1] != '\0')
+	{
+		error = "cooked scene has an array outside the file";
+		return false;
+	}
+
+	// Check every reference once here so the renderer can index without checks.
+	const std::uint32_t stringsSize = header->StringsSize;
+	bool valid = true;
+	for(std::uint32_t i = 0; i < header->TextureCount; ++i)
+		valid = valid && v.Textures[i].Name < stringsSize && v.Textures[i].Filename < stringsSize;
+	for(std::uint32_t i = 0; i < header->MaterialCount; ++i)
+	{
+		valid = valid && v.Materials[i].Name < stringsSize && v.Materials[i].TextureIndex < header->TextureCount &&
+			v.Materials[i].Layer < (std::uint32_t)SceneLayer::Count;
+	}
+	for(std::uint32_t i = 0; i < header->MeshCount; ++i)
+		valid = valid && v.Meshes[i].Name < stringsSize;
+	for(std::uint32_t i = 0; i < header->GroupCount; ++i)
+		valid = valid && v.Groups[i].Name < stringsSize && v.Groups[i].Parent < (std::int32_t)i && v.Groups[i].Parent >= -1;
+	for(std::uint32_t i = 0; i < shapeCount && valid; ++i)
+	{
+		valid = v.ShapeMeshes[i] < header->MeshCount &&
+			v.ShapeMaterials[i] < header->MaterialCount &&
+			v.ShapeGroups[i] >= -1 && v.ShapeGroups[i] < (std::int32_t)header->GroupCount;
+	}
+
+	if(!valid)
+	{
+		error = "cooked scene has an invalid reference";
+		return false;
+	}
+
+	view = v;
+	return true;
+}
+
+bool CookedScene::Open(const std::string& filename, std::string& error)
+{
+	Close();
+
+	if(!mFile.Open(filename))
+	{
+		error = "cannot map " + filename;
+		return false;
+	}
+
+	if(!SceneFormat::CreateView(mFile.Data(), mFile.Size(), mView, error))
+	{
+		error = filename + ", " + error;
+		mFile.Close();
+		return false;
+	}
+	return true;
+}
+
+bool CookedScene::Load(std::vector<std::uint8_t>&& cooked, std::string& error)
+{
+	CookedSceneView view;
+	if(!SceneFormat::CreateView(cooked.data(), cooked.size(), view, error))
+		return false;
+
+	// Moving the vector keeps its buffer, so the view stays valid.
+	Close();
+	mData = std::move(cooked);
+	mView = view;
+	return true;
+}
+
+void CookedScene::Close()
+{
+	mView = CookedSceneView();
+	mFile.Close();
+	mData.clear();
+}
@@ -0,0 +1,226 @@
+//***************************************************************************************
+// SceneFormat.h
+//
+// Scene description used to build the shapes, materials and textures of the demo.
+//
+// Scenes are authored as text (see Scenes/Castle.scene) and cooked into a binary file
+// that is memory mapped at startup.  The cooked file holds flat arrays (textures,
+// materials, meshes, groups and per-shape transforms, mesh refs and material refs)
+// addressed by offsets from the start of the file, so loading it is one mmap plus
+// turning those offsets into pointers.
+//***************************************************************************************
+
+#pragma once
+
+#include "../../Common/MappedFile.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#if defined(_WIN32)
+#include <DirectXMath.h>
+#else
+// The one DirectXMath type of the cooked form, with its layout, so the scene can be
+// cooked and diffed where DirectXMath is not available.
+namespace DirectX
+{
+	struct XMFLOAT4X4
+	{
+		float m[4][4];
+	};
+}
+#endif
+
+//
+// Authored (text) form.
+//
+
+struct SceneTextureDesc
+{
+	std::string Name;
+	std::string Filename;
+	bool IsArray = false;
+};
+
+// Render layer of the shapes using a material, which picks their pipeline state and
+// whether they are sorted front to back or back to front.
+enum class SceneLayer : std::uint32_t
+{
+	Opaque = 0,
+	AlphaTested,
+	Transparent,
+	Count
+};
+
+struct SceneMaterialDesc
+{
+	std::string Name;
+	std::string Texture;
+	float DiffuseAlbedo[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+	float FresnelR0[3] = { 0.01f, 0.01f, 0.01f };
+	float Roughness = 0.25f;
+	SceneLayer Layer = SceneLayer::Opaque;
+};
+
+struct SceneGroupDesc
+{
+	std::string Name;
+
+	// Empty for groups at the root.
+	std::string Parent;
+};
+
+struct SceneShapeDesc
+{
+	// Empty for shapes at the root.
+	std::string Group;
+	std::string Mesh;
+	std::string Material;
+	float Scale[3] = { 1.0f, 1.0f, 1.0f };
+	float Offset[3] = { 0.0f, 0.0f, 0.0f };
+	float Rotation[3] = { 0.0f, 0.0f, 0.0f };
+	float TexScale[3] = { 1.0f, 1.0f, 1.0f };
+};
+
+struct SceneDesc
+{
+	std::vector<SceneTextureDesc> Textures;
+	std::vector<SceneMaterialDesc> Materials;
+	std::vector<SceneGroupDesc> Groups;
+	std::vector<SceneShapeDesc> Shapes;
+};
+
+//
+// Cooked (binary) form.  Every offset is in bytes from the start of the file; string
+// fields are offsets into the string table.
+//
+
+struct CookedSceneHeader
+{
+	std::uint32_t Magic;
+	std::uint32_t Version;
+	std::uint32_t FileSize;
+
+	std::uint32_t TextureCount;
+	std::uint32_t MaterialCount;
+	std::uint32_t MeshCount;
+	std::uint32_t GroupCount;
+	std::uint32_t ShapeCount;
+
+	std::uint32_t TexturesOffset;
+	std::uint32_t MaterialsOffset;
+	std::uint32_t MeshesOffset;
+	std::uint32_t GroupsOffset;
+	std::uint32_t ShapeLocalsOffset;
+	std::uint32_t ShapeTexTransformsOffset;
+	std::uint32_t ShapeMeshesOffset;
+	std::uint32_t ShapeMaterialsOffset;
+	std::uint32_t ShapeGroupsOffset;
+	std::uint32_t StringsOffset;
+	std::uint32_t StringsSize;
+	std::uint32_t Pad[5];
+};
+
+struct CookedTexture
+{
+	std::uint32_t Name;
+	std::uint32_t Filename;
+	std::uint32_t IsArray;
+	std::uint32_t Pad;
+};
+
+struct CookedMaterial
+{
+	std::uint32_t Name;
+	std::uint32_t TextureIndex;
+	float DiffuseAlbedo[4];
+	float FresnelR0[3];
+	float Roughness;
+
+	// A SceneLayer.
+	std::uint32_t Layer;
+};
+
+struct CookedMesh
+{
+	std::uint32_t Name;
+};
+
+struct CookedGroup
+{
+	std::uint32_t Name;
+
+	// Index of an earlier group, or -1 for groups at the root.
+	std::int32_t Parent;
+};
+
+// Read-only view of a cooked scene.  The pointers refer into the mapped file.
+struct CookedSceneView
+{
+	const CookedSceneHeader* Header = nullptr;
+	const CookedTexture* Textures = nullptr;
+	const CookedMaterial* Materials = nullptr;
+	const CookedMesh* Meshes = nullptr;
+	const CookedGroup* Groups = nullptr;
+
+	// One entry per shape.  Locals are relative to the shape's group (-1 for none).
+	const DirectX::XMFLOAT4X4* ShapeLocals = nullptr;
+	const DirectX::XMFLOAT4X4* ShapeTexTransforms = nullptr;
+	const std::uint32_t* ShapeMeshes = nullptr;
+	const std::uint32_t* ShapeMaterials = nullptr;
+	const std::int32_t* ShapeGroups = nullptr;
+
+	const char* Strings = nullptr;
+
+	const char* GetString(std::uint32_t offset)const { return Strings + offset; }
+};
+
+class SceneFormat
+{
+public:
+	static const std::uint32_t CookedMagic = 0x4e435353; // 'SSCN'
+	static const std::uint32_t CookedVersion = 2;
+
+	// Parses the text form.  On failure returns false and describes the first error,
+	// including its line number.
+	static bool ParseText(const std::string& text, SceneDesc& scene, std::string& error);
+	static bool LoadText(const std::string& filename, SceneDesc& scene, std::string& error);
+
+	// Resolves all name references and writes the cooked form into cooked.
+	static bool Cook(const SceneDesc& scene, std::vector<std::uint8_t>& cooked, std::string& error);
+
+	static bool WriteCooked(const std::string& filename, const std::uint8_t* data, std::size_t size, std::string& error);
+
+	// Cooks textFilename into cookedFilename unless the cooked file is newer and of the
+	// current version.
+	static bool CookFileIfStale(const std::string& textFilename, const std::string& cookedFilename, std::string& error);
+
+	// Validates cooked data and fixes up the view's pointers into it.  The data must
+	// stay alive and unchanged while the view is used.
+	static bool CreateView(const std::uint8_t* data, std::size_t size, CookedSceneView& view, std::string& error);
+};
+
+// A cooked scene file mapped into memory.
+class CookedScene
+{
+public:
+	bool Open(const std::string& filename, std::string& error);
+
+	// Uses cooked data held in memory instead of a mapped file, e.g. a scene that was
+	// just re-cooked for hot reload.
+	bool Load(std::vector<std::uint8_t>&& cooked, std::string& error);
+	void Close();
+
+	const CookedSceneView& View()const { return mView; }
+
+	std::uint32_t TextureCount()const { return mView.Header->TextureCount; }
+	std::uint32_t MaterialCount()const { return mView.Header->MaterialCount; }
+	std::uint32_t MeshCount()const { return mView.Header->MeshCount; }
+	std::uint32_t GroupCount()const { return mView.Header->GroupCount; }
+	std::uint32_t ShapeCount()const { return mView.Header->ShapeCount; }
+
+private:
+	MappedFile mFile;
+	std::vector<std::uint8_t> mData;
+	CookedSceneView mView;
+};
@@ -0,0 +1,123 @@
+//***************************************************************************************
+// SceneGraph.cpp
+//***************************************************************************************
+
+#include "SceneGraph.h"
+#include <algorithm>
+#include <cassert>
+
+using namespace DirectX;
+
+std::uint32_t SceneGraph::NodeCount()const
+{
+	return (std::uint32_t)mParents.size();
+}
+
+std::uint32_t SceneGraph::AddNode(std::int32_t parent, const XMFLOAT4X4& local,
+	std::int32_t objectIndex, const BoundingBox* localBounds)
+{
+	const std::uint32_t node = NodeCount();
+	assert(parent == NoParent || (parent >= 0 && (std::uint32_t)parent < node));
+
+	mParents.push_back(parent);
+	mObjects.push_back(objectIndex);
+	mLocal.push_back(local);
+	mWorld.push_back(local);
+	mLocalBounds.push_back(localBounds != nullptr ? *localBounds : BoundingBox());
+	mWorldBounds.push_back(mLocalBounds.back());
+	mHasBounds.push_back(localBounds != nullptr ? 1 : 0);
+	mDirty.push_back(0);
+
+	MarkDirty(node);
+
+	return node;
+}
+
+void SceneGraph::SetLocal(std::uint32_t node, const XMFLOAT4X4& local)
+{
+	mLocal[node] = local;
+	MarkDirty(node);
+}
+
+void SceneGraph::SetParent(std::uint32_t node, std::int32_t parent)
+{
+	assert(parent == NoParent || (parent >= 0 && (std::uint32_t)parent < node));
+
+	mParents[node] = parent;
+	MarkDirty(node);
+}
+
+void SceneGraph::MarkDirty(std::uint32_t node)
+{
+	// Descendants are found during Update(), so only the node itself is flagged.
+	if(node < mFirstDirty)
+		mFirstDirty = node;
+
+	mDirty[node] = 1;
+}
+
+std::int32_t SceneGraph::GetParent(std::uint32_t node)const
+{
+	return mParents[node];
+}
+
+std::int32_t SceneGraph::GetObjectIndex(std::uint32_t node)const
+{
+	return mObjects[node];
+}
+
+bool SceneGraph::HasBounds(std::uint32_t node)const
+{
+	return mHasBounds[node] != 0;
+}
+
+const XMFLOAT4X4& SceneGraph::GetLocal(std::uint32_t node)const
+{
+	return mLocal[node];
+}
+
+const XMFLOAT4X4& SceneGraph::GetWorld(std::uint32_t node)const
+{
+	return mWorld[node];
+}
+
+const BoundingBox& SceneGraph::GetWorldBounds(std::uint32_t node)const
+{
+	return mWorldBounds[node];
+}
+
+const std::vector<std::uint32_t>& SceneGraph::Update()
+{
+	mChanged.clear();
+
+	const std::uint32_t count = NodeCount();
+	for(std::uint32_t i = mFirstDirty; i < count; ++i)
+	{
+		// Parents come first, so a dirty parent has already been processed and
+		// its flag is still set; propagate it down to this node.
+		const std::int32_t parent = mParents[i];
+		if(parent != NoParent && mDirty[parent] != 0)
+			mDirty[i] = 1;
+
+		if(mDirty[i] == 0)
+			continue;
+
+		XMMATRIX world = XMLoadFloat4x4(&mLocal[i]);
+		if(parent != NoParent)
+			world = XMMatrixMultiply(world, XMLoadFloat4x4(&mWorld[parent]));
+
+		XMStoreFloat4x4(&mWorld[i], world);
+
+		if(mHasBounds[i] != 0)
+			mLocalBounds[i].Transform(mWorldBounds[i], world);
+
+		mChanged.push_back(i);
+	}
+
+	for(std::uint32_t node : mChanged)
+		mDirty[node] = 0;
+
+	mFirstDirty = count;
+
+	return mChanged;
+}
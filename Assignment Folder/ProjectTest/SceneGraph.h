@@ -0,0 +1,72 @@
+//***************************************************************************************
+// SceneGraph.h
+//
+// Flat, index based transform hierarchy.  Nodes live in arrays in parent-before-child
+// order (a node can only be added after its parent), so world matrices can be updated
+// with one forward pass.  Changing a local matrix marks the node dirty; Update() then
+// recomputes only dirty nodes and their descendants and keeps their world space
+// bounding boxes in sync.
+//***************************************************************************************
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <DirectXMath.h>
+#include <DirectXCollision.h>
+
+class SceneGraph
+{
+public:
+	static const std::int32_t NoParent = -1;
+	static const std::int32_t NoObject = -1;
+
+	SceneGraph() = default;
+	SceneGraph(const SceneGraph& rhs) = delete;
+	SceneGraph& operator=(const SceneGraph& rhs) = delete;
+	~SceneGraph() = default;
+
+	std::uint32_t NodeCount()const;
+
+	// Adds a node below parent (or NoParent) and returns its index.  objectIndex is the
+	// ObjCBIndex of the render item the node drives, or NoObject for pure groups.
+	// localBounds, if given, is the object space box transformed into world space.
+	std::uint32_t AddNode(std::int32_t parent, const DirectX::XMFLOAT4X4& local,
+		std::int32_t objectIndex = NoObject, const DirectX::BoundingBox* localBounds = nullptr);
+
+	void SetLocal(std::uint32_t node, const DirectX::XMFLOAT4X4& local);
+
+	// Moves a node below another parent.  The parent must come before the node.
+	void SetParent(std::uint32_t node, std::int32_t parent);
+
+	std::int32_t GetParent(std::uint32_t node)const;
+	std::int32_t GetObjectIndex(std::uint32_t node)const;
+	bool HasBounds(std::uint32_t node)const;
+
+	const DirectX::XMFLOAT4X4& GetLocal(std::uint32_t node)const;
+	const DirectX::XMFLOAT4X4& GetWorld(std::uint32_t node)const;
+	const DirectX::BoundingBox& GetWorldBounds(std::uint32_t node)const;
+
+	// Recomputes the world matrix and bounds of every dirty node and its descendants.
+	// Returns the nodes that changed, in parent-before-child order.  The list is valid
+	// until the next call.
+	const std::vector<std::uint32_t>& Update();
+
+private:
+	void MarkDirty(std::uint32_t node);
+
+private:
+	std::vector<std::int32_t> mParents;
+	std::vector<std::int32_t> mObjects;
+	std::vector<DirectX::XMFLOAT4X4> mLocal;
+	std::vector<DirectX::XMFLOAT4X4> mWorld;
+	std::vector<DirectX::BoundingBox> mLocalBounds;
+	std::vector<DirectX::BoundingBox> mWorldBounds;
+	std::vector<std::uint8_t> mHasBounds;
+	std::vector<std::uint8_t> mDirty;
+
+	std::vector<std::uint32_t> mChanged;
+
+	// Nothing before this index is dirty, so Update() starts its pass here.
+	std::uint32_t mFirstDirty = 0;
+};
@@ -0,0 +1,336 @@
+//***************************************************************************************
+// SelfCheck.cpp
+//***************************************************************************************
+
+#include "SelfCheck.h"
+#include "../../Common/TextureLoader.h"
+#include "FrameStages.h"
+#include "SceneFormat.h"
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	int gFailures = 0;
+
+	void Expect(bool condition, const char* what)
+	{
+		if(!condition)
+		{
+			OutputDebugStringA((std::string("Self check failed: ") + what + "\n").c_str());
+			++gFailures;
+		}
+	}
+
+	//
+	// TextureLoader
+	//
+
+	// Loads every texture of the scene, one of them twice, plus a missing file and a
+	// texture whose upload fails, through an upload stage that creates nothing.
+	void CheckTextureLoader(const CookedSceneView& scene)
+	{
+		const std::thread::id uploadThread = std::this_thread::get_id();
+		bool uploadOnCaller = true;
+		bool dataInFile = true;
+		std::size_t uploadCount = 0;
+		std::map<std::string, std::uint64_t> hashes;
+
+		TextureLoader::UploadFunc upload = [&](TextureLoader::ParsedTexture& parsed, Texture& texture)
+		{
+			uploadOnCaller = uploadOnCaller && std::this_thread::get_id() == uploadThread;
+			++uploadCount;
+
+			// Every subresource the worker parsed points into the mapped file.
+			const std::uint8_t* begin = parsed.File.Data();
+			const std::uint8_t* end = begin + parsed.File.Size();
+			for(const D3D12_SUBRESOURCE_DATA& sub : parsed.Data.Subresources)
+			{
+				const std::uint8_t* data = static_cast<const std::uint8_t*>(sub.pData);
+				dataInFile = dataInFile && data >= begin && data + sub.SlicePitch <= end;
+			}
+			dataInFile = dataInFile && !parsed.Data.Subresources.empty();
+
+			hashes[texture.Name] = parsed.ContentHash;
+			return texture.Name == "failing" ? E_OUTOFMEMORY : S_OK;
+		};
+
+		TextureLoader loader;
+		std::vector<std::future<std::unique_ptr<Texture>>> loads;
+		const UINT textureCount = scene.Header->TextureCount;
+		for(UINT i = 0; i < textureCount; ++i)
+		{
+			const std::wstring filename = AnsiToWString(scene.GetString(scene.Textures[i].Filename));
+			loads.push_back(loader.Load(scene.GetString(scene.Textures[i].Name), filename));
+		}
+
+		const std::wstring first = AnsiToWString(scene.GetString(scene.Textures[0].Filename));
+		auto duplicate = loader.Load("duplicate", first);
+		auto capped = loader.Load("capped", first, 1);
+		auto failing = loader.Load("failing", first);
+		auto missing = loader.Load("missing", L"Textures/missing.dds");
+
+		loader.UploadAll(upload);
+
+		Expect(loader.PendingCount() == 0, "TextureLoader: nothing pending after UploadAll");
+		Expect(uploadOnCaller, "TextureLoader: uploads run on the calling thread");
+		Expect(dataInFile, "TextureLoader: parsed subresources lie inside the mapped file");
+		Expect(uploadCount == textureCount + 3, "TextureLoader: every parsed texture reaches the upload stage");
+
+		bool allLoaded = true;
+		for(UINT i = 0; i < textureCount; ++i)
+		{
+			try
+			{
+				std::unique_ptr<Texture> tex = loads[i].get();
+				allLoaded = allLoaded && tex != nullptr && tex->Name == scene.GetString(scene.Textures[i].Name);
+			}
+			catch(DxException&)
+			{
+				allLoaded = false;
+			}
+		}
+		Expect(allLoaded, "TextureLoader: every scene texture loads");
+
+		// Identical files hash the same, different ones do not.
+		const std::uint64_t firstHash = hashes[scene.GetString(scene.Textures[0].Name)];
+		bool distinct = true;
+		for(UINT i = 1; i < textureCount; ++i)
+			distinct = distinct && hashes[scene.GetString(scene.Textures[i].Name)] != firstHash;
+		Expect(firstHash != 0 && hashes["duplicate"] == firstHash, "TextureLoader: the same file hashes the same");
+		Expect(distinct, "TextureLoader: different files hash differently");
+
+		// A size cap smaller than every mip still loads the texture.
+		bool cappedLoaded = false;
+		try
+		{
+			cappedLoaded = capped.get() != nullptr;
+		}
+		catch(DxException&)
+		{
+		}
+		Expect(cappedLoaded, "TextureLoader: a cap below the smallest mip loads at full size");
+
+		bool duplicateLoaded = false;
+		try
+		{
+			duplicateLoaded = duplicate.get() != nullptr;
+		}
+		catch(DxException&)
+		{
+		}
+		Expect(duplicateLoaded, "TextureLoader: the same file loads twice");
+
+		// Failures come back through the future.
+		bool missingThrew = false;
+		try
+		{
+			missing.get();
+		}
+		catch(DxException& e)
+		{
+			missingThrew = e.Filename == L"Textures/missing.dds";
+		}
+		Expect(missingThrew, "TextureLoader: a missing file fails its future");
+
+		bool failingThrew = false;
+		try
+		{
+			failing.get();
+		}
+		catch(DxException& e)
+		{
+			failingThrew = e.ErrorCode == E_OUTOFMEMORY;
+		}
+		Expect(failingThrew, "TextureLoader: a failed upload fails its future");
+	}
+
+	//
+	// MaterialData
+	//
+
+	struct ShaderMember
+	{
+		std::string Type;
+		std::string Name;
+		std::uint32_t Offset = 0;
+		std::uint32_t Size = 0;
+	};
+
+	// Members of the HLSL struct name in shaderFilename, at their offsets in a
+	// structured buffer, which packs them tightly on 4 byte boundaries.  Returns false if
+	// the shader has no such struct; members is left empty if it cannot be read, e.g.
+	// for a type not listed here.
+	bool ReadShaderStruct(const std::string& shaderFilename, const std::string& name,
+		std::vector<ShaderMember>& members)
+	{
+		static const std::map<std::string, std::uint32_t> typeSizes =
+		{
+			{ "float", 4 }, { "float2", 8 }, { "float3", 12 }, { "float4", 16 }, { "float4x4", 64 },
+			{ "uint", 4 }, { "int", 4 }
+		};
+
+		std::ifstream fin(shaderFilename);
+		std::stringstream text;
+		text << fin.rdbuf();
+		const std::string source = text.str();
+
+		members.clear();
+		const std::size_t start = source.find("struct " + name);
+		if(start == std::string::npos)
+			return false;
+
+		const std::size_t open = source.find('{', start);
+		const std::size_t close = source.find('}', open);
+		if(open == std::string::npos || close == std::string::npos)
+			return true;
+
+		std::istringstream body(source.substr(open + 1, close - open - 1));
+		std::uint32_t offset = 0;
+		ShaderMember member;
+		while(body >> member.Type >> member.Name)
+		{
+			if(member.Name.back() != ';')
+			{
+				members.clear();
+				return true;
+			}
+			member.Name.pop_back();
+
+			auto size = typeSizes.find(member.Type);
+			if(size == typeSizes.end())
+			{
+				members.clear();
+				return true;
+			}
+
+			member.Offset = offset;
+			member.Size = size->second;
+			offset += member.Size;
+			members.push_back(member);
+		}
+		return true;
+	}
+
+	// The C++ MaterialData must have the layout of the shaders' MaterialData, member for
+	// member; the padding members may be named differently.
+	void CheckMaterialLayout(const std::vector<std::string>& shaderFilenames)
+	{
+		struct CppMember
+		{
+			const char* Name;
+			std::uint32_t Offset;
+			std::uint32_t Size;
+		};
+		const CppMember cppMembers[] =
+		{
+			{ "DiffuseAlbedo", offsetof(MaterialData, DiffuseAlbedo), sizeof(MaterialData::DiffuseAlbedo) },
+			{ "FresnelR0", offsetof(MaterialData, FresnelR0), sizeof(MaterialData::FresnelR0) },
+			{ "Roughness", offsetof(MaterialData, Roughness), sizeof(MaterialData::Roughness) },
+			{ "MatTransform", offsetof(MaterialData, MatTransform), sizeof(MaterialData::MatTransform) },
+			{ "DiffuseMapIndex", offsetof(MaterialData, DiffuseMapIndex), sizeof(MaterialData::DiffuseMapIndex) },
+			{ nullptr, offsetof(MaterialData, MaterialPad0), sizeof(MaterialData::MaterialPad0) },
+			{ nullptr, offsetof(MaterialData, MaterialPad1), sizeof(MaterialData::MaterialPad1) },
+			{ nullptr, offsetof(MaterialData, MaterialPad2), sizeof(MaterialData::MaterialPad2) },
+		};
+
+		int shadersChecked = 0;
+		for(const std::string& filename : shaderFilenames)
+		{
+			std::vector<ShaderMember> members;
+			if(!ReadShaderStruct(filename, "MaterialData", members))
+				continue;
+			++shadersChecked;
+
+			bool same = members.size() == _countof(cppMembers);
+			for(std::size_t i = 0; same && i < members.size(); ++i)
+			{
+				const CppMember& cpp = cppMembers[i];
+				same = members[i].Offset == cpp.Offset && members[i].Size == cpp.Size &&
+					(cpp.Name == nullptr || members[i].Name == cpp.Name);
+			}
+			same = same && !members.empty() && members.back().Offset + members.back().Size == sizeof(MaterialData);
+
+			Expect(same, ("MaterialData: C++ layout matches " + filename).c_str());
+		}
+		Expect(shadersChecked > 0, "MaterialData: a shader declares MaterialData");
+	}
+
+	void CheckPackMaterial()
+	{
+		Material mat;
+		mat.DiffuseSrvHeapIndex = 9;
+		mat.DiffuseAlbedo = DirectX::XMFLOAT4(0.1f, 0.2f, 0.3f, 0.4f);
+		mat.FresnelR0 = DirectX::XMFLOAT3(0.5f, 0.6f, 0.7f);
+		mat.Roughness = 0.8f;
+		for(int r = 0; r < 4; ++r)
+		{
+			for(int c = 0; c < 4; ++c)
+				mat.MatTransform.m[r][c] = (float)(r * 4 + c);
+		}
+
+		MaterialData data;
+		data.MaterialPad0 = data.MaterialPad1 = data.MaterialPad2 = 0;
+		FrameStages::PackMaterial(mat, data);
+
+		// Read the element as the shader does, by byte offset.
+		const std::uint8_t* bytes = reinterpret_cast<const std::uint8_t*>(&data);
+		auto floatAt = [bytes](std::size_t offset)
+		{
+			float value;
+			std::memcpy(&value, bytes + offset, sizeof(value));
+			return value;
+		};
+		auto uintAt = [bytes](std::size_t offset)
+		{
+			std::uint32_t value;
+			std::memcpy(&value, bytes + offset, sizeof(value));
+			return value;
+		};
+
+		Expect(floatAt(0) == 0.1f && floatAt(12) == 0.4f, "PackMaterial: DiffuseAlbedo at 0");
+		Expect(floatAt(16) == 0.5f && floatAt(24) == 0.7f, "PackMaterial: FresnelR0 at 16");
+		Expect(floatAt(28) == 0.8f, "PackMaterial: Roughness fills the float3's last lane");
+		Expect(uintAt(96) == 9, "PackMaterial: DiffuseMapIndex at 96 from the SRV heap index");
+		Expect(uintAt(100) == 0 && uintAt(104) == 0 && uintAt(108) == 0, "PackMaterial: padding left zero");
+
+		// The shaders read matrices column major, so row r of the texture transform is
+		// stored as column r.
+		bool transposed = true;
+		for(int r = 0; r < 4; ++r)
+		{
+			for(int c = 0; c < 4; ++c)
+				transposed = transposed && floatAt(32 + (c * 4 + r) * sizeof(float)) == mat.MatTransform.m[r][c];
+		}
+		Expect(transposed, "PackMaterial: MatTransform stored transposed at 32");
+	}
+}
+
+int RunSelfChecks(const std::string& sceneFilename, const std::vector<std::string>& shaderFilenames)
+{
+	gFailures = 0;
+
+	std::string error;
+	SceneDesc desc;
+	std::vector<std::uint8_t> cooked;
+	CookedScene scene;
+	if(!SceneFormat::LoadText(sceneFilename, desc, error) ||
+		!SceneFormat::Cook(desc, cooked, error) ||
+		!scene.Load(std::move(cooked), error))
+	{
+		OutputDebugStringA(("Self check: " + error + "\n").c_str());
+		return 1;
+	}
+
+	CheckTextureLoader(scene.View());
+	CheckMaterialLayout(shaderFilenames);
+	CheckPackMaterial();
+
+	OutputDebugStringA(gFailures == 0 ? "Self check: all checks passed\n" : "Self check: checks failed\n");
+	return gFailures;
+}
@@ -0,0 +1,15 @@
+//***************************************************************************************
+// SelfCheck.h
+//
+// Checks of the parts of the app that need the Windows SDK but no window or device,
+// run with "-check".  The platform neutral parts are checked by Tools/FrameCheck.
+//***************************************************************************************
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+// Runs every check against the scene, its textures and the shaders.  Returns the
+// number of failed checks; each failure is also sent to the debugger output.
+int RunSelfChecks(const std::string& sceneFilename, const std::vector<std::string>& shaderFilenames);
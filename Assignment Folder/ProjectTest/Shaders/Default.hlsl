@@ -20,7 +20,8 @@
 // Include structures and functions for lighting.
 #include "LightingUtil.hlsl"
 
-Texture2D    gDiffuseMap : register(t0);
+// Every texture, picked by the material's DiffuseMapIndex.
+Texture2D    gDiffuseMaps[] : register(t0, space1);
 
 
 SamplerState gsamPointWrap        : register(s0);
@@ -68,14 +69,42 @@ cbuffer cbPass : register(b1)
     Light gLights[MaxLights];
 };
 
-cbuffer cbMaterial : register(b2)
+// Every material, picked by gMaterialIndex.
+struct MaterialData
 {
-	float4   gDiffuseAlbedo;
-    float3   gFresnelR0;
-    float    gRoughness;
-	float4x4 gMatTransform;
+	float4   DiffuseAlbedo;
+    float3   FresnelR0;
+    float    Roughness;
+	float4x4 MatTransform;
+	uint     DiffuseMapIndex;
+	uint     MatPad0;
+	uint     MatPad1;
+	uint     MatPad2;
 };
 
+StructuredBuffer<MaterialData> gMaterialData : register(t3);
+
+// Constant data that varies per draw.  A draw's instances start at gInstanceBase in
+// gInstanceIndices.
+cbuffer cbDraw : register(b3)
+{
+    uint gInstanceBase;
+    uint gMaterialIndex;
+};
+
+#ifdef INSTANCING
+// Per-object data of every render item, and the object index of each instance
+// drawn this frame.
+struct ObjectData
+{
+    float4x4 World;
+    float4x4 TexTransform;
+};
+
+StructuredBuffer<ObjectData> gObjectData      : register(t1);
+StructuredBuffer<uint>       gInstanceIndices : register(t2);
+#endif
+
 struct VertexIn
 {
 	float3 PosL    : POSITION;
@@ -91,30 +120,44 @@ struct VertexOut
 	float2 TexC    : TEXCOORD;
 };
 
+#ifdef INSTANCING
+VertexOut VS(VertexIn vin, uint instanceID : SV_InstanceID)
+#else
 VertexOut VS(VertexIn vin)
+#endif
 {
 	VertexOut vout = (VertexOut)0.0f;
+
+#ifdef INSTANCING
+    ObjectData obj = gObjectData[gInstanceIndices[gInstanceBase + instanceID]];
+    float4x4 world = obj.World;
+    float4x4 texTransform = obj.TexTransform;
+#else
+    float4x4 world = gWorld;
+    float4x4 texTransform = gTexTransform;
+#endif
 	
     // Transform to world space.
-    float4 posW = mul(float4(vin.PosL, 1.0f), gWorld);
+    float4 posW = mul(float4(vin.PosL, 1.0f), world);
     vout.PosW = posW.xyz;
 
     // Assumes nonuniform scaling; otherwise, need to use inverse-transpose of world matrix.
-    vout.NormalW = mul(vin.NormalL, (float3x3)gWorld);
+    vout.NormalW = mul(vin.NormalL, (float3x3)world);
 
     // Transform to homogeneous clip space.
     vout.PosH = mul(posW, gViewProj);
 	
 	// Output vertex attributes for interpolation across triangle.
-	float4 texC = mul(float4(vin.TexC, 0.0f, 1.0f), gTexTransform);
-	vout.TexC = mul(texC, gMatTransform).xy;
+	float4 texC = mul(float4(vin.TexC, 0.0f, 1.0f), texTransform);
+	vout.TexC = mul(texC, gMaterialData[gMaterialIndex].MatTransform).xy;
 
     return vout;
 }
 
 float4 PS(VertexOut pin) : SV_Target
 {
-    float4 diffuseAlbedo = gDiffuseMap.Sample(gsamAnisotropicWrap, pin.TexC) * gDiffuseAlbedo;
+    MaterialData matData = gMaterialData[gMaterialIndex];
+    float4 diffuseAlbedo = gDiffuseMaps[matData.DiffuseMapIndex].Sample(gsamAnisotropicWrap, pin.TexC) * matData.DiffuseAlbedo;
 	
 #ifdef ALPHA_TEST
 	// Discard pixel if texture alpha < 0.1.  We do this test as soon 
@@ -134,8 +177,8 @@ float4 PS(VertexOut pin) : SV_Target
     // Light terms.
     float4 ambient = gAmbientLight*diffuseAlbedo;
 
-    const float shininess = 1.0f - gRoughness;
-    Material mat = { diffuseAlbedo, gFresnelR0, shininess };
+    const float shininess = 1.0f - matData.Roughness;
+    Material mat = { diffuseAlbedo, matData.FresnelR0, shininess };
     float3 shadowFactor = 1.0f;
     float4 directLight = ComputeLighting(gLights, mat, pin.PosW,
         pin.NormalW, toEyeW, shadowFactor);
@@ -18,7 +18,8 @@
 // Include structures and functions for lighting.
 #include "LightingUtil.hlsl"
 //step5
-Texture2DArray gTreeMapArray : register(t0);
+// Every texture array, picked by the material's DiffuseMapIndex.
+Texture2DArray gTreeMapArrays[] : register(t0, space2);
 
 //you can use dynamic indexing as well. Pay attention how we changed the sampler!
 //Texture2D gTreeMapArray[3] : register(t0);
@@ -69,12 +70,26 @@ cbuffer cbPass : register(b1)
     Light gLights[MaxLights];
 };
 
-cbuffer cbMaterial : register(b2)
+// Every material, picked by gMaterialIndex.
+struct MaterialData
 {
-	float4   gDiffuseAlbedo;
-    float3   gFresnelR0;
-    float    gRoughness;
-	float4x4 gMatTransform;
+	float4   DiffuseAlbedo;
+    float3   FresnelR0;
+    float    Roughness;
+	float4x4 MatTransform;
+	uint     DiffuseMapIndex;
+	uint     MatPad0;
+	uint     MatPad1;
+	uint     MatPad2;
+};
+
+StructuredBuffer<MaterialData> gMaterialData : register(t3);
+
+// Constant data that varies per draw.
+cbuffer cbDraw : register(b3)
+{
+    uint gInstanceBase;
+    uint gMaterialIndex;
 };
  
 struct VertexIn
@@ -171,7 +186,8 @@ void GS(point VertexOut gin[1], //PrimitiveType InputVertexType InputName[NumEle
 float4 PS(GeoOut pin) : SV_Target
 {
 	float3 uvw = float3(pin.TexC, pin.PrimID%5);
-    float4 diffuseAlbedo = gTreeMapArray.Sample(gsamAnisotropicWrap, uvw) * gDiffuseAlbedo;
+    MaterialData matData = gMaterialData[gMaterialIndex];
+    float4 diffuseAlbedo = gTreeMapArrays[matData.DiffuseMapIndex].Sample(gsamAnisotropicWrap, uvw) * matData.DiffuseAlbedo;
 
     //using dynamic indexing
     //float4 diffuseAlbedo = gTreeMapArray[pin.PrimID % 3].Sample(gsamAnisotropicWrap, pin.TexC) * gDiffuseAlbedo;
@@ -195,8 +211,8 @@ float4 PS(GeoOut pin) : SV_Target
     // Light terms.
     float4 ambient = gAmbientLight*diffuseAlbedo;
 
-    const float shininess = 1.0f - gRoughness;
-    Material mat = { diffuseAlbedo, gFresnelR0, shininess };
+    const float shininess = 1.0f - matData.Roughness;
+    Material mat = { diffuseAlbedo, matData.FresnelR0, shininess };
     float3 shadowFactor = 1.0f;
     float4 directLight = ComputeLighting(gLights, mat, pin.PosW,
         pin.NormalW, toEyeW, shadowFactor);
@@ -14,10 +14,30 @@
 #include "../../Common/UploadBuffer.h"
 #include "../../Common/GeometryGenerator.h"
 #include "../../Common/Camera.h"
+#include "../../Common/FileWatcher.h"
+#include "../../Common/Profiler.h"
+#include "../../Common/InputLog.h"
+#include "../../Common/TextureCache.h"
+#include "../../Common/DescriptorHeap.h"
 #include "FrameResource.h"
-#include "Waves.h"
-
+#include "FrameScene.h"
+#include "SceneFormat.h"
+#include "SceneDiff.h"
+#include "D3D12CommandSink.h"
+#include "JobGraph.h"
+#include "FrameStages.h"
+#include "FrameBench.h"
+#include "SelfCheck.h"
+
+#include <ppl.h>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
+#include <map>
 #include <string>
 
 using Microsoft::WRL::ComPtr;
@@ -30,50 +50,58 @@ using namespace std;
 
 const int gNumFrameResources = 3;
 
-// Lightweight structure stores parameters to draw a shape.  This will
-// vary from app-to-app.
-struct RenderItem
-{
-	RenderItem() = default;
-
-    // World matrix of the shape that describes the object's local space
-    // relative to the world space, which defines the position, orientation,
-    // and scale of the object in the world.
-    XMFLOAT4X4 World = MathHelper::Identity4x4();
-
-	XMFLOAT4X4 TexTransform = MathHelper::Identity4x4();
-
-	// Dirty flag indicating the object data has changed and we need to update the constant buffer.
-	// Because we have an object cbuffer for each FrameResource, we have to apply the
-	// update to each FrameResource.  Thus, when we modify obect data we should set 
-	// NumFramesDirty = gNumFrameResources so that each frame resource gets the update.
-	int NumFramesDirty = gNumFrameResources;
+// Authored scene and its cooked form, relative to the working directory.
+static const char* const gSceneFilename = "Scenes/Castle.scene";
+static const char* const gCookedSceneFilename = "Scenes/Castle.scenebin";
 
-	// Index into GPU constant buffer corresponding to the ObjectCB for this render item.
-	UINT ObjCBIndex = -1;
-
-	Material* Mat = nullptr;
-	MeshGeometry* Geo = nullptr;
+// Shader sources watched for hot reload.
+static const char* const gShaderFilenames[] =
+{
+	"Shaders/Default.hlsl",
+	"Shaders/TreeSprite.hlsl",
+	"Shaders/LightingUtil.hlsl"
+};
 
-    // Primitive topology.
-    D3D12_PRIMITIVE_TOPOLOGY PrimitiveType = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
+// Keys recorded in InputSample::Keys, one bit each in the order of FrameScene::InputKey.
+static const int gInputKeys[] = { 'W', 'S', 'A', 'D', 'Q' };
+
+// The simulation advances in steps of gSimStep seconds, at most gMaxSimSteps per
+// frame.  Playback runs the timer on the same step so every replay simulates the
+// same frames.
+static const double gSimStep = 1.0 / 60.0;
+static const int gMaxSimSteps = 4;
+static const double gInputPlaybackStep = gSimStep;
+
+// Textures load with their mips up to gStreamBaseSize first and stream larger mips in
+// by size on screen, at most gMaxStreamUploads textures per frame, within the
+// texture budget.
+static const std::uint32_t gStreamBaseSize = 64;
+static const std::size_t gMaxStreamUploads = 2;
+static const std::uint64_t gTextureBudget = 256ull << 20;
+
+// Persistent views (one per texture) the SRV heap holds, and the views each frame can
+// allocate for itself on top of those.
+static const UINT gMaxSrvViews = 4096;
+static const UINT gTransientSrvViews = 256;
+
+// CPU time of one frame along its critical path: the critical path of the update
+// job graph, the serial part of Draw and the recording task.
+struct FrameTrace
+{
+	float UpdateMs = 0.0f;
+	float DrawMs = 0.0f;
+	float RecordMs = 0.0f;
 
-	BoundingBox mBoundingBox;
+	// From sampling the frame's input to presenting it.
+	float LatencyMs = 0.0f;
 
-    // DrawIndexedInstanced parameters.
-    UINT IndexCount = 0;
-    UINT StartIndexLocation = 0;
-    int BaseVertexLocation = 0;
+	float CriticalPathMs()const { return UpdateMs + DrawMs + RecordMs; }
 };
 
-enum class RenderLayer : int
+static float MsSince(std::chrono::steady_clock::time_point start)
 {
-	Opaque = 0,
-	Transparent,
-	AlphaTested,
-	AlphaTestedTreeSprites,
-	Count
-};
+	return std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
 
 class TreeBillboardsApp : public D3DApp
 {
@@ -85,6 +113,9 @@ public:
 
     virtual bool Initialize()override;
 
+	// Call before Initialize.  Either file may be empty.
+	void SetInputLogFiles(const std::string& recordFilename, const std::string& playFilename);
+
 private:
     virtual void OnResize()override;
     virtual void Update(const GameTimer& gt)override;
@@ -94,18 +125,24 @@ private:
     virtual void OnMouseUp(WPARAM btnState, int x, int y)override;
     virtual void OnMouseMove(WPARAM btnState, int x, int y)override;
 
-    void OnKeyboardInput(const GameTimer& gt);
+    void SampleInput(const GameTimer& gt);
 	//void UpdateCamera(const GameTimer& gt);
-	void AnimateMaterials(const GameTimer& gt);
-	void UpdateObjectCBs(const GameTimer& gt);
-	void UpdateMaterialCBs(const GameTimer& gt);
-	void UpdateMainPassCB(const GameTimer& gt);
-	void UpdateWaves(const GameTimer& gt); 
 
-	void AABBCheck();
+	void WaitForFrameResource();
+	void WaitForRecording();
+	void PresentRecordedFrame();
+	void BuildFrameGraph();
+	bool LoadScene();
+	void ShowSceneError(const std::string& error);
+	void CheckHotReload(const GameTimer& gt);
+	void ReloadScene();
+	void ReloadShaders();
 	void LoadTextures();
+	void EstimateTextureSizes();
+	void StreamTextures();
     void BuildRootSignature();
 	void BuildDescriptorHeaps();
+	void WriteTextureSrv(UINT texture, UINT slot);
     void BuildShadersAndInputLayouts();
 
 	void BuildShapeGeometry();
@@ -117,13 +154,13 @@ private:
     void BuildPSOs();
     void BuildFrameResources();
     void BuildMaterials();
-    void BuildRenderItems();
-    void DrawRenderItems(ID3D12GraphicsCommandList* cmdList, const std::vector<RenderItem*>& ritems);
-
+    bool BuildRenderItems();
+    void SetFrameTargets();
+    void SetPassState(FrameResource* frame, ID3D12GraphicsCommandList* cmdList);
+    void RecordDrawPackets(FrameResource* frame, ID3D12GraphicsCommandList* mainCmdList);
 
-	void BuildShape(string shapeName, string textureName,	float ScaleX, float ScaleY, float ScaleZ, float OffsetX, float OffsetY, float OffsetZ,
-															float xRotaion = 0.0f, float yRotation = 0.0f, float ZRotation = 0.0f,
-															float xTexScale = 1.0f, float yTexScale = 1.0f, float zTexScale = 1.0f);
+	virtual std::wstring GetFrameStatsText()const override;
+	virtual void LogFrameStats()override;
 
 
 	std::array<const CD3DX12_STATIC_SAMPLER_DESC, 6> GetStaticSamplers();
@@ -142,28 +179,67 @@ private:
 
     ComPtr<ID3D12RootSignature> mRootSignature = nullptr;
 
-	ComPtr<ID3D12DescriptorHeap> mSrvDescriptorHeap = nullptr;
+	DescriptorHeap mSrvHeap;
 
 	std::unordered_map<std::string, std::unique_ptr<MeshGeometry>> mGeometries;
 	std::unordered_map<std::string, std::unique_ptr<Material>> mMaterials;
-	std::unordered_map<std::string, std::unique_ptr<Texture>> mTextures;
+
+	// Materials indexed by MatCBIndex, so updates walk a dense array instead of the map.
+	std::vector<Material*> mMaterialList;
+
+	// Per scene texture: its handle, the texels across it the items using it need this
+	// frame, and the SRV heap slot of its view.  Scene textures sharing a cached texture
+	// share a slot.  A streamed texture gets its new view in the same slot, since the
+	// frames in flight read their own copies of the views.
+	std::vector<TextureCache::Handle> mSceneTextures;
+	std::vector<float> mTextureTexels;
+	std::vector<UINT> mTextureSrvSlots;
+
 	std::unordered_map<std::string, ComPtr<ID3DBlob>> mShaders;
 	std::unordered_map<std::string, ComPtr<ID3D12PipelineState>> mPSOs;
 
     std::vector<D3D12_INPUT_ELEMENT_DESC> mStdInputLayout;
 	std::vector<D3D12_INPUT_ELEMENT_DESC> mTreeSpriteInputLayout;
 
-    RenderItem* mWavesRitem = nullptr;
+	// Render items, camera, waves and the update jobs of a frame, shared with the
+	// benchmark.  Its draw packets are recorded from the frame being drawn.
+	FrameScene mFrameScene;
+
+	// Cooked scene file, mapped for the whole run.
+	CookedScene mScene;
 
-	// List of all the render items.
-	std::vector<std::unique_ptr<RenderItem>> mAllRitems;
+	// Scene and shader files polled for hot reload.
+	FileWatcher mFileWatcher;
+	float mNextHotReloadPoll = 0.0f;
 
-	// Render items divided by PSO.
-	std::vector<RenderItem*> mRitemLayer[(int)RenderLayer::Count];
+	// PSO used by each layer.
+	ID3D12PipelineState* mLayerPSOs[(int)RenderLayer::Count] = {};
 
-	std::unique_ptr<Waves> mWaves;
+	// Binding counters of each recording chunk of the frame being recorded.
+	std::vector<DrawStats> mChunkDrawStats;
 
-    PassConstants mMainPassCB;
+	// Binding counters of the last recorded frame.
+	DrawStats mDrawStats;
+
+	// Jobs of Update, and the task recording and submitting the last drawn frame while
+	// the next frame updates.  Anything the recording reads besides its frame resource
+	// must not change before WaitForRecording.
+	JobGraph mFrameGraph;
+	concurrency::task_group mRecordTasks;
+
+	// Frame whose recording runs, until WaitForRecording signals its fence, and whether
+	// it still has to be presented.  Both are only touched on the window thread.
+	FrameResource* mRecordedFrame = nullptr;
+	bool mPresentPending = false;
+	std::chrono::steady_clock::time_point mRecordedInputTime;
+
+	// WaitForFrameResource waits on a worker, so it cannot share mFenceEvent with the
+	// waits of the window thread.
+	HANDLE mFrameResourceEvent = nullptr;
+
+	// Trace of the frame being recorded, and of the last frame that finished.
+	FrameTrace mRecordingTrace;
+	FrameTrace mLastFrameTrace;
 
 	/*XMFLOAT3 mEyePos = { 0.0f, 0.0f, 0.0f };
 	XMFLOAT4X4 mView = MathHelper::Identity4x4();
@@ -173,13 +249,76 @@ private:
     float mPhi = XM_PIDIV2 - 0.1f;
     float mRadius = 50.0f;*/
 
-	Camera mCamera;
-
-	BoundingBox mCameraBoundingBox;
-
     POINT mLastMousePos;
+
+	// Input is sampled once per frame, live or from a log, and handed to the scene,
+	// whose input job only applies samples, so a replay moves the camera exactly like
+	// the previous run.
+	std::uint8_t mMouseButtons = 0;
+	InputRecorder mInputRecorder;
+	InputPlayback mInputPlayback;
+	std::string mInputRecordFilename;
+	std::string mInputPlayFilename;
+	std::chrono::steady_clock::time_point mInputTime;
+
+	// The fence value the frame being recorded will signal.
+	UINT64 mIssuedFence = 0;
 };
 
+static std::uint8_t MouseButtons(WPARAM btnState)
+{
+	std::uint8_t buttons = 0;
+	if((btnState & MK_LBUTTON) != 0)
+		buttons |= InputSample::LeftButton;
+	if((btnState & MK_RBUTTON) != 0)
+		buttons |= InputSample::RightButton;
+	if((btnState & MK_MBUTTON) != 0)
+		buttons |= InputSample::MiddleButton;
+	return buttons;
+}
+
+// The whitespace separated word following flag on the command line, or "".
+static std::string CommandLineValue(const char* cmdLine, const char* flag)
+{
+	const char* value = std::strstr(cmdLine, flag);
+	if(value == nullptr)
+		return std::string();
+
+	value += std::strlen(flag);
+	while(*value == ' ' || *value == '\t')
+		++value;
+
+	const char* end = value;
+	while(*end != '\0' && *end != ' ' && *end != '\t')
+		++end;
+
+	return std::string(value, end);
+}
+
+// Runs the frame stages without a window or device and writes benchmark.csv.
+static int RunBenchmark(unsigned long frameCount)
+{
+	if(frameCount == 0)
+		frameCount = 1000;
+
+	std::string error;
+	FrameBench bench;
+	if(!bench.Initialize(gSceneFilename, error))
+	{
+		OutputDebugStringA(("Benchmark: " + error + "\n").c_str());
+		return 1;
+	}
+
+	bench.Run((std::uint32_t)frameCount);
+
+	if(!bench.WriteReport("benchmark.csv", error))
+	{
+		OutputDebugStringA(("Benchmark: " + error + "\n").c_str());
+		return 1;
+	}
+	return 0;
+}
+
 int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE prevInstance,
     PSTR cmdLine, int showCmd)
 {
@@ -188,9 +327,27 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE prevInstance,
     _CrtSetDbgFlag(_CRTDBG_ALLOC_MEM_DF | _CRTDBG_LEAK_CHECK_DF);
 #endif
 
+    // "-bench [frames]" runs the headless CPU benchmark instead of the app.
+    const char* bench = std::strstr(cmdLine, "-bench");
+    if(bench != nullptr)
+        return RunBenchmark(std::strtoul(bench + 6, nullptr, 10));
+
+    // "-check" runs the headless self checks; the exit code is the number that failed.
+    if(std::strstr(cmdLine, "-check") != nullptr)
+        return RunSelfChecks(gSceneFilename,
+            std::vector<std::string>(std::begin(gShaderFilenames), std::end(gShaderFilenames)));
+
     try
     {
         TreeBillboardsApp theApp(hInstance);
+
+        // "-record file" saves the input of this run, "-play file" replays a saved one
+        // on a fixed time step and exits when it ends.
+        theApp.SetInputLogFiles(CommandLineValue(cmdLine, "-record"), CommandLineValue(cmdLine, "-play"));
+
+        // "-fps rate" caps the frame rate; F7 cycles the cap at run time.
+        theApp.SetTargetFps((float)std::atof(CommandLineValue(cmdLine, "-fps").c_str()));
+
         if(!theApp.Initialize())
             return 0;
 
@@ -204,14 +361,41 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE prevInstance,
 }
 
 TreeBillboardsApp::TreeBillboardsApp(HINSTANCE hInstance)
-    : D3DApp(hInstance)
+    : D3DApp(hInstance),
+	mFrameScene(gNumFrameResources)
 {
 }
 
 TreeBillboardsApp::~TreeBillboardsApp()
 {
+	// A recording failure is already on its way out through WinMain.
+	try
+	{
+		WaitForRecording();
+	}
+	catch(DxException&)
+	{
+	}
+
     if(md3dDevice != nullptr)
         FlushCommandQueue();
+
+	if(mFrameResourceEvent != nullptr)
+		CloseHandle(mFrameResourceEvent);
+
+	// The cache outlives the app, but its textures must not outlive the device.
+	mSceneTextures.clear();
+	TextureCache::Instance().Clear();
+
+	std::string error;
+	if(!mInputRecordFilename.empty() && !mInputRecorder.Save(mInputRecordFilename, error))
+		OutputDebugStringA(("Input recording: " + error + "\n").c_str());
+}
+
+void TreeBillboardsApp::SetInputLogFiles(const std::string& recordFilename, const std::string& playFilename)
+{
+	mInputRecordFilename = recordFilename;
+	mInputPlayFilename = playFilename;
 }
 
 bool TreeBillboardsApp::Initialize()
@@ -226,10 +410,29 @@ bool TreeBillboardsApp::Initialize()
 	// so we have to query this information.
     mCbvSrvDescriptorSize = md3dDevice->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
 
-    mWaves = std::make_unique<Waves>(128, 128, 1.0f, 0.03f, 4.0f, 0.2f);
+	mTimer.SetSimStep(gSimStep, gMaxSimSteps);
+	mFramePacer.SetMaxFramesInFlight(gNumFrameResources);
+
+	mFrameResourceEvent = CreateEventEx(nullptr, nullptr, false, EVENT_ALL_ACCESS);
+	if(mFrameResourceEvent == nullptr)
+		ThrowIfFailed(HRESULT_FROM_WIN32(GetLastError()));
+
+	if(!mInputPlayFilename.empty())
+	{
+		std::string error;
+		if(!mInputPlayback.Open(mInputPlayFilename, error))
+		{
+			MessageBox(nullptr, AnsiToWString(error).c_str(), L"Input Playback Failed", MB_OK);
+			return false;
+		}
 
-	// Set Camera Position
-	mCamera.SetPosition(0.0f, 4.0f, -15.0f);
+		// The waves disturb at random spots, so start every replay from the same seed.
+		mTimer.SetFixedStep(gInputPlaybackStep);
+		srand(1);
+	}
+
+	if(!LoadScene())
+		return false;
 	
 	LoadTextures();
     BuildRootSignature();
@@ -241,9 +444,15 @@ bool TreeBillboardsApp::Initialize()
 	BuildBoxGeometry();
 	BuildTreeSpritesGeometry();
 	BuildMaterials();
-    BuildRenderItems();
+    if(!BuildRenderItems())
+		return false;
     BuildFrameResources();
     BuildPSOs();
+	BuildFrameGraph();
+
+	mFileWatcher.Watch(gSceneFilename);
+	for(const char* filename : gShaderFilenames)
+		mFileWatcher.Watch(filename);
 
     // Execute the initialization commands.
     ThrowIfFailed(mCommandList->Close());
@@ -253,11 +462,19 @@ bool TreeBillboardsApp::Initialize()
     // Wait until initialization is complete.
     FlushCommandQueue();
 
+	// The uploads have executed, so the staging memory can go.
+	TextureCache::Instance().ReleaseUploadHeaps();
+
     return true;
 }
  
 void TreeBillboardsApp::OnResize()
 {
+	// The recording task uses the back buffers being recreated.  A frame recorded but
+	// not presented yet is dropped, since its back buffer goes away.
+	WaitForRecording();
+	mPresentPending = false;
+
     D3DApp::OnResize();
 
     // The window resized, so update the aspect ratio and recompute the projection matrix.
@@ -265,96 +482,138 @@ void TreeBillboardsApp::OnResize()
     XMStoreFloat4x4(&mProj, P);*/
 
 	// Delegate to Camera
-	mCamera.SetLens(0.25f * MathHelper::Pi, AspectRatio(), 1.0f, 1000.0f);
+	mFrameScene.GetCamera().SetLens(0.25f * MathHelper::Pi, AspectRatio(), 1.0f, 1000.0f);
+	mFrameScene.SetRenderTargetSize(mClientWidth, mClientHeight);
 }
 
 void TreeBillboardsApp::Update(const GameTimer& gt)
 {
-    OnKeyboardInput(gt);
-	//UpdateCamera(gt);
-
-    // Cycle through the circular frame resource array.
+    // Cycle through the circular frame resource array.  Waiting for the GPU to finish
+    // with it is a job of the frame graph, so the simulation overlaps the wait.
     mCurrFrameResourceIndex = (mCurrFrameResourceIndex + 1) % gNumFrameResources;
     mCurrFrameResource = mFrameResources[mCurrFrameResourceIndex].get();
+	SetFrameTargets();
+
+	CheckHotReload(gt);
+	SampleInput(gt);
+
+	// While the jobs run, finish the last frame's recording and signal its fence, which
+	// the frame resource job waits for when one frame is in flight.  The jobs use the
+	// app, so they are waited for even if the recording failed.
+	mFrameGraph.Start();
+	try
+	{
+		WaitForRecording();
+	}
+	catch(...)
+	{
+		mFrameGraph.Wait();
+		throw;
+	}
+	mFrameGraph.Wait();
+}
 
+void TreeBillboardsApp::SetFrameTargets()
+{
+	// The frame jobs write straight into the mapped upload buffers of this frame.
+	FrameResource* frame = mCurrFrameResource;
+
+	FrameTargets targets;
+	targets.ObjectCB = frame->ObjectCB->MappedData();
+	targets.ObjectCBStride = frame->ObjectCB->ElementByteSize();
+	targets.ObjectData = frame->ObjectData->MappedData();
+	targets.ObjectDataStride = frame->ObjectData->ElementByteSize();
+	targets.Materials = reinterpret_cast<MaterialData*>(frame->MaterialBuffer->MappedData());
+	targets.Pass = reinterpret_cast<PassConstants*>(frame->PassCB->MappedData());
+	targets.WaveVertices = reinterpret_cast<Vertex*>(frame->WavesVB->MappedData());
+	targets.InstanceIndices = reinterpret_cast<std::uint32_t*>(frame->InstanceIndices->MappedData());
+
+	mFrameScene.SetFrame(mCurrFrameResourceIndex, targets);
+}
+
+void TreeBillboardsApp::WaitForFrameResource()
+{
     // Has the GPU finished processing the commands of the current frame resource?
     // If not, wait until the GPU has completed commands up to this fence point.
-    if(mCurrFrameResource->Fence != 0 && mFence->GetCompletedValue() < mCurrFrameResource->Fence)
-    {
-        HANDLE eventHandle = CreateEventEx(nullptr, nullptr, false, EVENT_ALL_ACCESS);
-        ThrowIfFailed(mFence->SetEventOnCompletion(mCurrFrameResource->Fence, eventHandle));
-        WaitForSingleObject(eventHandle, INFINITE);
-        CloseHandle(eventHandle);
-    }
+	UINT64 fence = mCurrFrameResource->Fence;
 
-	AnimateMaterials(gt);
-	UpdateObjectCBs(gt);
-	UpdateMaterialCBs(gt);
-	UpdateMainPassCB(gt);
-    UpdateWaves(gt);
-	AABBCheck();
+	// The pacer may allow fewer frames in flight than there are frame resources, when
+	// it makes its target anyway; each queued frame is a frame of latency.
+	const UINT64 queued = (UINT64)(mFramePacer.GetFramesInFlight() - 1);
+	if(mIssuedFence > queued && mIssuedFence - queued > fence)
+		fence = mIssuedFence - queued;
+
+	WaitForFence(fence, mFrameResourceEvent);
 }
 
-void TreeBillboardsApp::AABBCheck()
+void TreeBillboardsApp::WaitForRecording()
 {
-	XMStoreFloat3(&mCameraBoundingBox.Center, XMVectorSet(	mCamera.GetPosition3f().x,
-															mCamera.GetPosition3f().y,
-															mCamera.GetPosition3f().z, 1.0f));
+	// Rethrows anything the recording task threw, dropping its frame.
+	FrameResource* frame = mRecordedFrame;
+	mRecordedFrame = nullptr;
+	mRecordTasks.wait();
 
-	XMStoreFloat3(&mCameraBoundingBox.Extents, XMVectorSet(1.15, 1.15, 1.15, 1.0f));
+	if(frame == nullptr)
+		return;
 
-	for (auto& e : mAllRitems)
-	{
-		if (mCameraBoundingBox.Intersects(e->mBoundingBox) && e->Mat->Name == "headge")
-		{
-			float CameraCenterX = mCameraBoundingBox.Center.x;
-			float CameraCenterZ = mCameraBoundingBox.Center.z;
-
-			if (e->mBoundingBox.Center.x - e->mBoundingBox.Extents.x >= CameraCenterX)
-			{
-				// Set limit for camera on X plane by camera's pos - box extents
-				float LimitX = e->mBoundingBox.Center.x - e->mBoundingBox.Extents.x - mCameraBoundingBox.Extents.x;
-				// Apply Limitation
-					mCamera.SetPosition(MathHelper::Min(mCamera.GetPosition3f().x, LimitX),
-					mCamera.GetPosition3f().y,
-					mCamera.GetPosition3f().z);
-
-			}else if(e->mBoundingBox.Center.x + e->mBoundingBox.Extents.x <= CameraCenterX)
-			{
-				// Set limit for camera on X plane by camera's pos - box extents
-				float LimitX = e->mBoundingBox.Center.x + e->mBoundingBox.Extents.x + mCameraBoundingBox.Extents.x;
-				// Apply Limitation
-					mCamera.SetPosition(MathHelper::Max(mCamera.GetPosition3f().x, LimitX),
-					mCamera.GetPosition3f().y,
-					mCamera.GetPosition3f().z);
-
-			}
-			if (e->mBoundingBox.Center.z - e->mBoundingBox.Extents.z >= CameraCenterZ)
-			{
-				// Set limit for camera on Z plane by camera's pos - box extents
-				float LimitZ = e->mBoundingBox.Center.z - e->mBoundingBox.Extents.z - mCameraBoundingBox.Extents.z;
-				// Apply Limitation
-					mCamera.SetPosition(
-					mCamera.GetPosition3f().x,
-					mCamera.GetPosition3f().y,
-					MathHelper::Min(mCamera.GetPosition3f().z, LimitZ));
-			}
-			else if (e->mBoundingBox.Center.z + e->mBoundingBox.Extents.z <= CameraCenterZ)
-			{
-				// Set limit for camera on Z plane by camera's pos - box extents
-				float LimitZ = e->mBoundingBox.Center.z + e->mBoundingBox.Extents.z + mCameraBoundingBox.Extents.z;
-				// Apply Limitation
-					mCamera.SetPosition(
-					mCamera.GetPosition3f().x,
-					mCamera.GetPosition3f().y,
-					MathHelper::Max(mCamera.GetPosition3f().z, LimitZ));
-			}
-		}
-	}
+	// Advance the fence value to mark commands up to this fence point.
+	frame->Fence = ++mCurrentFence;
+
+	// Add an instruction to the command queue to set a new fence point. 
+	// Because we are on the GPU timeline, the new fence point won't be 
+	// set until the GPU finishes processing all the commands prior to this Signal().
+	ThrowIfFailed(mCommandQueue->Signal(mFence.Get(), mCurrentFence));
+
+	mPresentPending = true;
+}
+
+void TreeBillboardsApp::PresentRecordedFrame()
+{
+	if(!mPresentPending)
+		return;
+
+	// Cleared first: presenting can resize the window, and OnResize drops the frame.
+	mPresentPending = false;
+
+	// Swap the back and front buffers.  Only ever on the window thread: DXGI may need it
+	// to handle window messages while presenting, e.g. for a mode change or a fullscreen
+	// switch, and it would deadlock if the window thread were waiting for the present.
+	ThrowIfFailed(mSwapChain->Present(0, 0));
+	mRecordingTrace.LatencyMs = MsSince(mRecordedInputTime);
+	mCurrBackBuffer = (mCurrBackBuffer + 1) % SwapChainBufferCount;
+}
+
+void TreeBillboardsApp::BuildFrameGraph()
+{
+	// Waiting for the GPU to release the frame resource is a job of the graph, so the
+	// simulation overlaps the wait.
+	mFrameScene.BuildFrameGraph(mFrameGraph, mTimer,
+		[this]() { WaitForFrameResource(); },
+		[this]() { EstimateTextureSizes(); });
 }
 
 void TreeBillboardsApp::Draw(const GameTimer& gt)
 {
+	// The previous frame records on the main command list from the draw packets, so
+	// it has to be done before we touch either, and presented before we draw to the
+	// next back buffer.
+	WaitForRecording();
+	PresentRecordedFrame();
+
+	mLastFrameTrace = mRecordingTrace;
+	if(mLastFrameTrace.LatencyMs > 0.0f)
+		mFramePacer.AddLatency(mLastFrameTrace.LatencyMs);
+
+	mIssuedFence = mCurrentFence + 1;
+	mDrawStats.Reset();
+	for(const auto& stats : mChunkDrawStats)
+		mDrawStats.Add(stats);
+
+	PROFILE_COUNTER("Draw calls", mDrawStats.DrawCalls);
+	PROFILE_COUNTER("Binds issued", mDrawStats.BindsIssued);
+
+	const auto drawStart = std::chrono::steady_clock::now();
+
     auto cmdListAlloc = mCurrFrameResource->CmdListAlloc;
 
     // Reuse the memory associated with command recording.
@@ -365,135 +624,99 @@ void TreeBillboardsApp::Draw(const GameTimer& gt)
     // Reusing the command list reuses memory.
     ThrowIfFailed(mCommandList->Reset(cmdListAlloc.Get(), mPSOs["opaque"].Get()));
 
-    mCommandList->RSSetViewports(1, &mScreenViewport);
-    mCommandList->RSSetScissorRects(1, &mScissorRect);
+	// Before the views are copied for this frame.
+	StreamTextures();
+	mSrvHeap.BeginFrame(mCurrFrameResourceIndex);
 
     // Indicate a state transition on the resource usage.
 	mCommandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(CurrentBackBuffer(),
 		D3D12_RESOURCE_STATE_PRESENT, D3D12_RESOURCE_STATE_RENDER_TARGET));
 
     // Clear the back buffer and depth buffer.
-    mCommandList->ClearRenderTargetView(CurrentBackBufferView(), (float*)&mMainPassCB.FogColor, 0, nullptr);
+    mCommandList->ClearRenderTargetView(CurrentBackBufferView(), (float*)&mFrameScene.GetPassConstants().FogColor, 0, nullptr);
     mCommandList->ClearDepthStencilView(DepthStencilView(), D3D12_CLEAR_FLAG_DEPTH | D3D12_CLEAR_FLAG_STENCIL, 1.0f, 0, 0, nullptr);
 
-    // Specify the buffers we are going to render to.
-    mCommandList->OMSetRenderTargets(1, &CurrentBackBufferView(), true, &DepthStencilView());
-
-	ID3D12DescriptorHeap* descriptorHeaps[] = { mSrvDescriptorHeap.Get() };
-	mCommandList->SetDescriptorHeaps(_countof(descriptorHeaps), descriptorHeaps);
-
-	mCommandList->SetGraphicsRootSignature(mRootSignature.Get());
-
-	auto passCB = mCurrFrameResource->PassCB->Resource();
-	mCommandList->SetGraphicsRootConstantBufferView(2, passCB->GetGPUVirtualAddress());
-
-    DrawRenderItems(mCommandList.Get(), mRitemLayer[(int)RenderLayer::Opaque]);
-
-	mCommandList->SetPipelineState(mPSOs["alphaTested"].Get());
-	DrawRenderItems(mCommandList.Get(), mRitemLayer[(int)RenderLayer::AlphaTested]);
-
-	mCommandList->SetPipelineState(mPSOs["treeSprites"].Get());
-	DrawRenderItems(mCommandList.Get(), mRitemLayer[(int)RenderLayer::AlphaTestedTreeSprites]);
-
-	mCommandList->SetPipelineState(mPSOs["transparent"].Get());
-	DrawRenderItems(mCommandList.Get(), mRitemLayer[(int)RenderLayer::Transparent]);
-
-    // Indicate a state transition on the resource usage.
-	mCommandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(CurrentBackBuffer(),
-		D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PRESENT));
+	mFrameScene.BuildDrawPackets(FrameScene::RecordWorkerCount, FrameScene::MinRecordChunkCost);
 
-    // Done recording commands.
-    ThrowIfFailed(mCommandList->Close());
+	mRecordingTrace.UpdateMs = mFrameGraph.GetCriticalPathMs();
+	mRecordingTrace.DrawMs = MsSince(drawStart);
 
-    // Add the command list to the queue for execution.
-    ID3D12CommandList* cmdsLists[] = { mCommandList.Get() };
-    mCommandQueue->ExecuteCommandLists(_countof(cmdsLists), cmdsLists);
+	// Record and submit on a worker, so the update of the next frame runs while this
+	// one is recorded.  The task only touches its own frame resource, the draw packets
+	// and the command lists; the window thread signals the fence and presents.
+	FrameResource* frame = mCurrFrameResource;
+	mRecordedFrame = frame;
+	mRecordedInputTime = mInputTime;
+	mRecordTasks.run([this, frame]()
+	{
+		PROFILE_SCOPE("RecordFrame");
 
-    // Swap the back and front buffers
-    ThrowIfFailed(mSwapChain->Present(0, 0));
-	mCurrBackBuffer = (mCurrBackBuffer + 1) % SwapChainBufferCount;
+		const auto recordStart = std::chrono::steady_clock::now();
 
-    // Advance the fence value to mark commands up to this fence point.
-    mCurrFrameResource->Fence = ++mCurrentFence;
+		// Records the draws and the transition back to present, closes the lists and
+		// submits them in order.
+		RecordDrawPackets(frame, mCommandList.Get());
 
-    // Add an instruction to the command queue to set a new fence point. 
-    // Because we are on the GPU timeline, the new fence point won't be 
-    // set until the GPU finishes processing all the commands prior to this Signal().
-    mCommandQueue->Signal(mFence.Get(), mCurrentFence);
+		mRecordingTrace.RecordMs = MsSince(recordStart);
+	});
 }
 
 void TreeBillboardsApp::OnMouseDown(WPARAM btnState, int x, int y)
 {
     mLastMousePos.x = x;
     mLastMousePos.y = y;
+	mMouseButtons = MouseButtons(btnState);
 
     SetCapture(mhMainWnd);
 }
 
 void TreeBillboardsApp::OnMouseUp(WPARAM btnState, int x, int y)
 {
+	mMouseButtons = MouseButtons(btnState);
+
     ReleaseCapture();
 }
 
 void TreeBillboardsApp::OnMouseMove(WPARAM btnState, int x, int y)
 {
-    if((btnState & MK_LBUTTON) != 0)
-    {
-        // Make each pixel correspond to a quarter of a degree.
-        float dx = XMConvertToRadians(0.25f*static_cast<float>(x - mLastMousePos.x));
-        float dy = XMConvertToRadians(0.25f*static_cast<float>(y - mLastMousePos.y));
-
-        // Update angles based on input to orbit camera around box.
-        //mTheta += dx;
-        //mPhi += dy;
-
-        //// Restrict the angle mPhi.
-        //mPhi = MathHelper::Clamp(mPhi, 0.1f, MathHelper::Pi - 0.1f);
-
-		mCamera.Pitch(dy);
-		mCamera.RotateY(dx);
-    }
-    //else if((btnState & MK_RBUTTON) != 0)
-    //{
-    //    // Make each pixel correspond to 0.2 unit in the scene.
-    //    float dx = 0.2f*static_cast<float>(x - mLastMousePos.x);
-    //    float dy = 0.2f*static_cast<float>(y - mLastMousePos.y);
-
-    //    // Update the camera radius based on input.
-    //    mRadius += dx - dy;
-
-    //    // Restrict the radius.
-    //    mRadius = MathHelper::Clamp(mRadius, 5.0f, 150.0f);
-    //}
-
+	// Only remembered here; the input job turns movement into camera rotation.
     mLastMousePos.x = x;
     mLastMousePos.y = y;
+	mMouseButtons = MouseButtons(btnState);
 }
- 
-void TreeBillboardsApp::OnKeyboardInput(const GameTimer& gt)
-{
-	//step3: we handle keyboard input to move the camera:
 
-	const float dt = gt.DeltaTime();
+void TreeBillboardsApp::SampleInput(const GameTimer& gt)
+{
+	mInputTime = std::chrono::steady_clock::now();
 
-	//GetAsyncKeyState returns a short (2 bytes)
-	if (GetAsyncKeyState('W') & 0x8000) //most significant bit (MSB) is 1 when key is pressed (1000 000 000 000)
-		mCamera.Walk(10.0f * dt);
+	if(!mInputPlayFilename.empty())
+	{
+		mFrameScene.SetInput(mInputPlayback.Sample(gt.TotalTime()));
+		if(mInputPlayback.Finished())
+			PostQuitMessage(0);
+		return;
+	}
 
-	if (GetAsyncKeyState('S') & 0x8000)
-		mCamera.Walk(-10.0f * dt);
+	InputSample sample;
+	sample.Time = gt.TotalTime();
 
-	if (GetAsyncKeyState('A') & 0x8000)
-		mCamera.Strafe(-10.0f * dt);
+	//GetAsyncKeyState returns a short (2 bytes)
+	for(int i = 0; i < _countof(gInputKeys); ++i)
+	{
+		if(GetAsyncKeyState(gInputKeys[i]) & 0x8000) //most significant bit (MSB) is 1 when key is pressed (1000 000 000 000)
+			sample.Keys |= (std::uint16_t)(1 << i);
+	}
 
-	if (GetAsyncKeyState('D') & 0x8000)
-		mCamera.Strafe(10.0f * dt);
+	sample.Buttons = mMouseButtons;
+	sample.MouseX = (std::int16_t)mLastMousePos.x;
+	sample.MouseY = (std::int16_t)mLastMousePos.y;
 
-	if (GetAsyncKeyState('Q') & 0x8000)
-		mCamera.SetCanFly(!mCamera.GetCanFly());
+	mFrameScene.SetInput(sample);
 
-	mCamera.UpdateViewMatrix();
+	if(!mInputRecordFilename.empty())
+		mInputRecorder.Add(sample);
 }
+
  
 //void TreeBillboardsApp::UpdateCamera(const GameTimer& gt)
 //{
@@ -511,277 +734,227 @@ void TreeBillboardsApp::OnKeyboardInput(const GameTimer& gt)
 //	XMStoreFloat4x4(&mView, view);
 //}
 
-void TreeBillboardsApp::AnimateMaterials(const GameTimer& gt)
+bool TreeBillboardsApp::LoadScene()
 {
-	// Scroll the water material texture coordinates.
-	auto waterMat = mMaterials["water"].get();
-
-	float& tu = waterMat->MatTransform(3, 0);
-	float& tv = waterMat->MatTransform(3, 1);
+	// Re-cook the text scene if it changed, then map the cooked file and use it in place.
+	std::string error;
+	if(!SceneFormat::CookFileIfStale(gSceneFilename, gCookedSceneFilename, error) ||
+		!mScene.Open(gCookedSceneFilename, error))
+	{
+		ShowSceneError(error);
+		return false;
+	}
 
-	tu += 0.1f * gt.DeltaTime();
-	tv += 0.02f * gt.DeltaTime();
+	return true;
+}
 
-	if(tu >= 1.0f)
-		tu -= 1.0f;
+void TreeBillboardsApp::ShowSceneError(const std::string& error)
+{
+	MessageBox(nullptr, AnsiToWString(error).c_str(), L"Scene Load Failed", MB_OK);
+}
 
-	if(tv >= 1.0f)
-		tv -= 1.0f;
+void TreeBillboardsApp::CheckHotReload(const GameTimer& gt)
+{
+	// A few file time queries a few times per second is cheap enough to always run.
+	if(gt.TotalTime() < mNextHotReloadPoll)
+		return;
+	mNextHotReloadPoll = gt.TotalTime() + 0.25f;
 
-	waterMat->MatTransform(3, 0) = tu;
-	waterMat->MatTransform(3, 1) = tv;
+	bool shadersChanged = false;
+	for(const std::string& filename : mFileWatcher.Poll())
+	{
+		if(filename == gSceneFilename)
+			ReloadScene();
+		else
+			shadersChanged = true;
+	}
 
-	// Material has changed, so need to update cbuffer.
-	waterMat->NumFramesDirty = gNumFrameResources;
+	if(shadersChanged)
+		ReloadShaders();
 }
 
-void TreeBillboardsApp::UpdateObjectCBs(const GameTimer& gt)
+void TreeBillboardsApp::ReloadScene()
 {
-	auto currObjectCB = mCurrFrameResource->ObjectCB.get();
-	for(auto& e : mAllRitems)
+	WaitForRecording();
+
+	// Cook into memory; the current scene stays in use until the new one is known good.
+	std::string error;
+	SceneDesc desc;
+	std::vector<std::uint8_t> cooked;
+	CookedSceneView newScene;
+	std::vector<RenderItem> meshArgs;
+	if(!SceneFormat::LoadText(gSceneFilename, desc, error) ||
+		!SceneFormat::Cook(desc, cooked, error) ||
+		!SceneFormat::CreateView(cooked.data(), cooked.size(), newScene, error))
 	{
-		// Only update the cbuffer data if the constants have changed.  
-		// This needs to be tracked per frame resource.
-		if(e->NumFramesDirty > 0)
-		{
-			XMMATRIX world = XMLoadFloat4x4(&e->World);
-			XMMATRIX texTransform = XMLoadFloat4x4(&e->TexTransform);
-
-			ObjectConstants objConstants;
-			XMStoreFloat4x4(&objConstants.World, XMMatrixTranspose(world));
-			XMStoreFloat4x4(&objConstants.TexTransform, XMMatrixTranspose(texTransform));
+		OutputDebugStringA(("Scene reload failed: " + error + "\n").c_str());
+		return;
+	}
 
-			currObjectCB->CopyData(e->ObjCBIndex, objConstants);
+	if(!mFrameScene.ResolveSceneMeshes(newScene, meshArgs, error))
+	{
+		OutputDebugStringA(("Scene reload failed: " + std::string(gSceneFilename) + ", " + error + "\n").c_str());
+		return;
+	}
 
-			// Next FrameResource need to be updated too.
-			e->NumFramesDirty--;
-		}
+	SceneDelta delta = SceneDiff::Diff(mScene.View(), newScene);
+	if(delta.Structural)
+	{
+		OutputDebugStringA(("Scene reload needs a restart: " + delta.Reason + "\n").c_str());
+		return;
 	}
-}
 
-void TreeBillboardsApp::UpdateMaterialCBs(const GameTimer& gt)
-{
-	auto currMaterialCB = mCurrFrameResource->MaterialCB.get();
-	for(auto& e : mMaterials)
+	// Patch only what changed; textures, geometry and the other items are untouched.
+	for(UINT i : delta.ChangedMaterials)
 	{
-		// Only update the cbuffer data if the constants have changed.  If the cbuffer
-		// data changes, it needs to be updated for each FrameResource.
-		Material* mat = e.second.get();
-		if(mat->NumFramesDirty > 0)
-		{
-			XMMATRIX matTransform = XMLoadFloat4x4(&mat->MatTransform);
+		const CookedMaterial& src = newScene.Materials[i];
 
-			MaterialConstants matConstants;
-			matConstants.DiffuseAlbedo = mat->DiffuseAlbedo;
-			matConstants.FresnelR0 = mat->FresnelR0;
-			matConstants.Roughness = mat->Roughness;
-			XMStoreFloat4x4(&matConstants.MatTransform, XMMatrixTranspose(matTransform));
+		Material* mat = mMaterialList[i];
+		mat->DiffuseSrvHeapIndex = mTextureSrvSlots[src.TextureIndex];
+		mat->DiffuseAlbedo = XMFLOAT4(src.DiffuseAlbedo);
+		mat->FresnelR0 = XMFLOAT3(src.FresnelR0);
+		mat->Roughness = src.Roughness;
 
-			currMaterialCB->CopyData(mat->MatCBIndex, matConstants);
+		mFrameScene.MarkMaterialDirty(i);
+	}
 
-			// Next FrameResource need to be updated too.
-			mat->NumFramesDirty--;
-		}
+	mFrameScene.ApplyShapeChanges(newScene, delta, meshArgs);
+
+	// Keep using the new data from memory.  That also unmaps the old cooked file, so
+	// it can be brought up to date.
+	const std::uint32_t cookedSize = (std::uint32_t)cooked.size();
+	if(!mScene.Load(std::move(cooked), error) ||
+		!SceneFormat::WriteCooked(gCookedSceneFilename,
+			reinterpret_cast<const std::uint8_t*>(mScene.View().Header), cookedSize, error))
+	{
+		OutputDebugStringA(("Scene reload: " + error + "\n").c_str());
 	}
 }
 
-void TreeBillboardsApp::UpdateMainPassCB(const GameTimer& gt)
+void TreeBillboardsApp::ReloadShaders()
 {
-	/*XMMATRIX view = XMLoadFloat4x4(&mView);
-	XMMATRIX proj = XMLoadFloat4x4(&mProj);*/
-
-	XMMATRIX view = mCamera.GetView();
-	XMMATRIX proj = mCamera.GetProj();
-
-	XMMATRIX viewProj = XMMatrixMultiply(view, proj);
-	XMMATRIX invView = XMMatrixInverse(&XMMatrixDeterminant(view), view);
-	XMMATRIX invProj = XMMatrixInverse(&XMMatrixDeterminant(proj), proj);
-	XMMATRIX invViewProj = XMMatrixInverse(&XMMatrixDeterminant(viewProj), viewProj);
-
-	XMStoreFloat4x4(&mMainPassCB.View, XMMatrixTranspose(view));
-	XMStoreFloat4x4(&mMainPassCB.InvView, XMMatrixTranspose(invView));
-	XMStoreFloat4x4(&mMainPassCB.Proj, XMMatrixTranspose(proj));
-	XMStoreFloat4x4(&mMainPassCB.InvProj, XMMatrixTranspose(invProj));
-	XMStoreFloat4x4(&mMainPassCB.ViewProj, XMMatrixTranspose(viewProj));
-	XMStoreFloat4x4(&mMainPassCB.InvViewProj, XMMatrixTranspose(invViewProj));
-	mMainPassCB.EyePosW = mCamera.GetPosition3f();
-	mMainPassCB.RenderTargetSize = XMFLOAT2((float)mClientWidth, (float)mClientHeight);
-	mMainPassCB.InvRenderTargetSize = XMFLOAT2(1.0f / mClientWidth, 1.0f / mClientHeight);
-	mMainPassCB.NearZ = 1.0f;
-	mMainPassCB.FarZ = 1000.0f;
-	mMainPassCB.TotalTime = gt.TotalTime();
-	mMainPassCB.DeltaTime = gt.DeltaTime();
-	mMainPassCB.AmbientLight = { 0.375f, 0.375f, 0.4f, 1.0f };
-	/*mMainPassCB.Lights[0].Direction = { 0.57735f, -0.57735f, 0.57735f };
-	mMainPassCB.Lights[0].Strength = { 0.6f, 0.6f, 0.6f };
-	mMainPassCB.Lights[1].Direction = { -0.57735f, -0.57735f, 0.57735f };	Torch1	0.25f, 3.0f, 0.25f, -3.0f, 3.7f, -13.0f);
-	mMainPassCB.Lights[1].Strength = { 0.3f, 0.3f, 0.3f };					Torch2	0.25f, 3.0f, 0.25f, 3.0f, 3.7f, -13.0f);
-	mMainPassCB.Lights[2].Direction = { 0.0f, -0.707f, -0.707f };
-	mMainPassCB.Lights[2].Strength = { 0.15f, 0.15f, 0.15f };*/
-
-	mMainPassCB.Lights[0].Position = { 3.0f, 6.0f, -13.0f };
-	mMainPassCB.Lights[0].Strength = { 1.0f, 0.5f, 0.0f };
-	mMainPassCB.Lights[1].Position = { -3.0f, 6.0f, -13.0f };
-	mMainPassCB.Lights[1].Strength = { 1.0f, 0.5f, 0.0f };
-	mMainPassCB.Lights[2].Position = { 5.5f, 10.0f, -6.0f };
-	mMainPassCB.Lights[2].Direction = { 0.0f, -1.0f, 0.0f };
-	mMainPassCB.Lights[2].Strength = { 2.0f, 2.0f, 2.0f };
-	mMainPassCB.Lights[2].SpotPower = 1.0;
-
-	auto currPassCB = mCurrFrameResource->PassCB.get();
-	currPassCB->CopyData(0, mMainPassCB);
-}
+	WaitForRecording();
 
-void TreeBillboardsApp::UpdateWaves(const GameTimer& gt)
-{
-	// Every quarter second, generate a random wave.
-	static float t_base = 0.0f;
-	if((mTimer.TotalTime() - t_base) >= 0.25f)
+	// Compile first and keep the old blobs if any shader fails, so a typo does not
+	// take the app down.
+	auto oldShaders = mShaders;
+	try
+	{
+		BuildShadersAndInputLayouts();
+	}
+	catch(DxException&)
 	{
-		t_base += 0.25f;
+		mShaders = oldShaders;
+		OutputDebugStringA("Shader reload failed, keeping the previous shaders.\n");
+		return;
+	}
+
+	// The old pipeline states may still be referenced by frames in flight.
+	FlushCommandQueue();
+	BuildPSOs();
+}
 
-		int i = MathHelper::Rand(4, mWaves->RowCount() - 5);
-		int j = MathHelper::Rand(4, mWaves->ColumnCount() - 5);
+void TreeBillboardsApp::LoadTextures()
+{
+	PROFILE_SCOPE("LoadTextures");
 
-		float r = MathHelper::RandF(0.2f, 0.5f);
+	// The textures are shared through the cache, which loads the ones not resident
+	// yet in parallel.
+	TextureCache& cache = TextureCache::Instance();
+	cache.SetBudget(gTextureBudget);
+	cache.SetStreaming(true, gStreamBaseSize);
 
-		mWaves->Disturb(i, j, r);
+	const CookedSceneView& scene = mScene.View();
+	for(UINT i = 0; i < mScene.TextureCount(); ++i)
+	{
+		mSceneTextures.push_back(cache.Acquire(AnsiToWString(scene.GetString(scene.Textures[i].Filename))));
 	}
+	mTextureTexels.assign(mSceneTextures.size(), 0.0f);
+
+	cache.LoadHeld(md3dDevice.Get(), mCommandList.Get());
+}
 
-	// Update the wave simulation.
-	mWaves->Update(gt.DeltaTime());
+void TreeBillboardsApp::EstimateTextureSizes()
+{
+	PROFILE_SCOPE("EstimateTextureSizes");
+
+	// Each texture needs the most texels any item drawn with it needs.
+	std::fill(mTextureTexels.begin(), mTextureTexels.end(), 0.0f);
 
-	// Update the wave vertex buffer with the new solution.
-	auto currWavesVB = mCurrFrameResource->WavesVB.get();
-	for(int i = 0; i < mWaves->VertexCount(); ++i)
+	const CookedSceneView& scene = mScene.View();
+	const Camera& camera = mFrameScene.GetCamera();
+	const XMFLOAT3 eye = camera.GetPosition3f();
+	const float projScaleY = camera.GetProj4x4f()._22;
+	for(const auto& ri : mFrameScene.GetRenderItems())
 	{
-		Vertex v;
+		const UINT texture = scene.Materials[ri->Mat->MatCBIndex].TextureIndex;
 
-		v.Pos = mWaves->Position(i);
-		v.Normal = mWaves->Normal(i);
-		
-		// Derive tex-coords from position by 
-		// mapping [-w/2,w/2] --> [0,1]
-		v.TexC.x = 0.5f + v.Pos.x / mWaves->Width();
-		v.TexC.y = 0.5f - v.Pos.z / mWaves->Depth();
+		// The land, water and trees are around the camera and have no bounds.
+		float texels = FLT_MAX;
+		if(ri->HasBounds)
+		{
+			const XMFLOAT4X4 texTransform = mFrameScene.GetTransforms().GetTexTransform(ri->ObjCBIndex);
+			const XMFLOAT4X4& matTransform = ri->Mat->MatTransform;
+			const float repeat = MathHelper::Max(std::fabs(texTransform._11), std::fabs(texTransform._22)) *
+				MathHelper::Max(std::fabs(matTransform._11), std::fabs(matTransform._22));
 
-		currWavesVB->CopyData(i, v);
-	}
+			texels = FrameStages::EstimateTexels(ri->mBoundingBox, eye, projScaleY, (float)mClientHeight, repeat);
+		}
 
-	// Set the dynamic VB of the wave renderitem to the current frame VB.
-	mWavesRitem->Geo->VertexBufferGPU = currWavesVB->Resource();
+		mTextureTexels[texture] = MathHelper::Max(mTextureTexels[texture], texels);
+	}
 }
 
-void TreeBillboardsApp::LoadTextures()
+void TreeBillboardsApp::StreamTextures()
 {
-	auto grassTex = std::make_unique<Texture>();
-	grassTex->Name = "grassTex";
-	grassTex->Filename = L"../../Textures/grass.dds";
-	ThrowIfFailed(DirectX::CreateDDSTextureFromFile12(md3dDevice.Get(),
-		mCommandList.Get(), grassTex->Filename.c_str(),
-		grassTex->Resource, grassTex->UploadHeap));
-
-	auto waterTex = std::make_unique<Texture>();
-	waterTex->Name = "waterTex";
-	waterTex->Filename = L"../../Textures/water1.dds";
-	ThrowIfFailed(DirectX::CreateDDSTextureFromFile12(md3dDevice.Get(),
-		mCommandList.Get(), waterTex->Filename.c_str(),
-		waterTex->Resource, waterTex->UploadHeap));
-
-	auto drawBrigeTex = std::make_unique<Texture>();
-	drawBrigeTex->Name = "drawBrigeTex";
-	drawBrigeTex->Filename = L"../../Textures/DrawBridge.dds";
-	ThrowIfFailed(DirectX::CreateDDSTextureFromFile12(md3dDevice.Get(),
-		mCommandList.Get(), drawBrigeTex->Filename.c_str(),
-		drawBrigeTex->Resource, drawBrigeTex->UploadHeap));
-
-	auto blackStoneTex = std::make_unique<Texture>();
-	blackStoneTex->Name = "blackStoneTex";
-	blackStoneTex->Filename = L"../../Textures/BlackStone.dds";
-	ThrowIfFailed(DirectX::CreateDDSTextureFromFile12(md3dDevice.Get(),
-		mCommandList.Get(), blackStoneTex->Filename.c_str(),
-		blackStoneTex->Resource, blackStoneTex->UploadHeap));
-
-	auto bloodStoneTex = std::make_unique<Texture>();
-	bloodStoneTex->Name = "bloodStoneTex";
-	bloodStoneTex->Filename = L"../../Textures/BloodStone.dds";
-	ThrowIfFailed(DirectX::CreateDDSTextureFromFile12(md3dDevice.Get(),
-		mCommandList.Get(), bloodStoneTex->Filename.c_str(),
-		bloodStoneTex->Resource, bloodStoneTex->UploadHeap));
-
-	auto jadeWoodTex = std::make_unique<Texture>();
-	jadeWoodTex->Name = "jadeWoodTex";
-	jadeWoodTex->Filename = L"../../Textures/JadeWood.dds";
-	ThrowIfFailed(DirectX::CreateDDSTextureFromFile12(md3dDevice.Get(),
-		mCommandList.Get(), jadeWoodTex->Filename.c_str(),
-		jadeWoodTex->Resource, jadeWoodTex->UploadHeap));
-
-	auto poleTex = std::make_unique<Texture>();
-	poleTex->Name = "poleTex";
-	poleTex->Filename = L"../../Textures/Pole.dds";
-	ThrowIfFailed(DirectX::CreateDDSTextureFromFile12(md3dDevice.Get(),
-		mCommandList.Get(), poleTex->Filename.c_str(),
-		poleTex->Resource, poleTex->UploadHeap));
-
-	auto wellTex = std::make_unique<Texture>();
-	wellTex->Name = "wellTex";
-	wellTex->Filename = L"../../Textures/Well.dds";
-	ThrowIfFailed(DirectX::CreateDDSTextureFromFile12(md3dDevice.Get(),
-		mCommandList.Get(), wellTex->Filename.c_str(),
-		wellTex->Resource, wellTex->UploadHeap));
-
-	auto headgeTex = std::make_unique<Texture>();
-	headgeTex->Name = "headgeTex";
-	headgeTex->Filename = L"../../Textures/Headge.dds";
-	ThrowIfFailed(DirectX::CreateDDSTextureFromFile12(md3dDevice.Get(),
-		mCommandList.Get(), headgeTex->Filename.c_str(),
-		headgeTex->Resource, headgeTex->UploadHeap));
-
-	auto treeArrayTex = std::make_unique<Texture>();
-	treeArrayTex->Name = "treeArrayTex";
-	treeArrayTex->Filename = L"../../Textures/treeArr.dds";
-	ThrowIfFailed(DirectX::CreateDDSTextureFromFile12(md3dDevice.Get(),
-		mCommandList.Get(), treeArrayTex->Filename.c_str(),
-		treeArrayTex->Resource, treeArrayTex->UploadHeap));
-
-	auto qubeTex = std::make_unique<Texture>();
-	qubeTex->Name = "quebertTex";
-	qubeTex->Filename = L"../../Textures/QBert_Icon.dds";
-	ThrowIfFailed(DirectX::CreateDDSTextureFromFile12(md3dDevice.Get(),
-		mCommandList.Get(), qubeTex->Filename.c_str(),
-		qubeTex->Resource, qubeTex->UploadHeap));
-
-	mTextures[grassTex->Name] = std::move(grassTex);
-	mTextures[waterTex->Name] = std::move(waterTex);
-	mTextures[drawBrigeTex->Name] = std::move(drawBrigeTex);
-	mTextures[blackStoneTex->Name] = std::move(blackStoneTex);
-	mTextures[bloodStoneTex->Name] = std::move(bloodStoneTex);
-	mTextures[jadeWoodTex->Name] = std::move(jadeWoodTex);
-	mTextures[poleTex->Name] = std::move(poleTex);
-	mTextures[wellTex->Name] = std::move(wellTex);
-	mTextures[headgeTex->Name] = std::move(headgeTex);
-	mTextures[treeArrayTex->Name] = std::move(treeArrayTex);
-	mTextures[qubeTex->Name] = std::move(qubeTex);
+	PROFILE_SCOPE("StreamTextures");
+
+	TextureCache& cache = TextureCache::Instance();
+	for(size_t i = 0; i < mSceneTextures.size(); ++i)
+		cache.RequestSize(mSceneTextures[i], mTextureTexels[i]);
+
+	// The streamed textures are recorded on the main command list ahead of the draws.
+	const std::vector<Texture*> changed = cache.Stream(md3dDevice.Get(), mCommandList.Get(),
+		mIssuedFence, mFence->GetCompletedValue(), gMaxStreamUploads);
+	if(changed.empty())
+		return;
+
+	// The views are copied into the frame's region of the heap when it begins, so the
+	// frames in flight keep reading the old ones.
+	for(UINT i = 0; i < mScene.TextureCount(); ++i)
+	{
+		if(std::find(changed.begin(), changed.end(), mSceneTextures[i].Get()) != changed.end())
+			WriteTextureSrv(i, mTextureSrvSlots[i]);
+	}
 }
 
 void TreeBillboardsApp::BuildRootSignature()
 {
-	CD3DX12_DESCRIPTOR_RANGE texTable;
-	texTable.Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 0);
+	// Every view of the frame's region of the SRV heap, as 2D textures in space1 and as
+	// texture arrays in space2.  Materials pick theirs by index.
+	CD3DX12_DESCRIPTOR_RANGE texTable[2];
+	texTable[0].Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, UINT_MAX, 0, 1, 0);
+	texTable[1].Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, UINT_MAX, 0, 2, 0);
 
     // Root parameter can be a table, root descriptor or root constants.
-    CD3DX12_ROOT_PARAMETER slotRootParameter[4];
+    CD3DX12_ROOT_PARAMETER slotRootParameter[7];
 
 	// Perfomance TIP: Order from most frequent to least frequent.
-	slotRootParameter[0].InitAsDescriptorTable(1, &texTable, D3D12_SHADER_VISIBILITY_PIXEL);
+	slotRootParameter[0].InitAsDescriptorTable(2, texTable, D3D12_SHADER_VISIBILITY_PIXEL);
     slotRootParameter[1].InitAsConstantBufferView(0);
     slotRootParameter[2].InitAsConstantBufferView(1);
-    slotRootParameter[3].InitAsConstantBufferView(2);
+	// The material structured buffer.
+	slotRootParameter[3].InitAsShaderResourceView(3);
+	// Instancing: per-object structured buffer, per-instance object indices.
+	slotRootParameter[4].InitAsShaderResourceView(1);
+	slotRootParameter[5].InitAsShaderResourceView(2);
+	// The first instance index and the material index of the current draw.
+	slotRootParameter[6].InitAsConstants(2, 3);
 
 	auto staticSamplers = GetStaticSamplers();
 
     // A root signature is an array of root parameters.
-	CD3DX12_ROOT_SIGNATURE_DESC rootSigDesc(4, slotRootParameter,
+	CD3DX12_ROOT_SIGNATURE_DESC rootSigDesc(7, slotRootParameter,
 		(UINT)staticSamplers.size(), staticSamplers.data(),
 		D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT);
 
@@ -806,107 +979,57 @@ void TreeBillboardsApp::BuildRootSignature()
 
 void TreeBillboardsApp::BuildDescriptorHeaps()
 {
-	//
-	// Create the SRV heap.
-	//
-	D3D12_DESCRIPTOR_HEAP_DESC srvHeapDesc = {};
-	srvHeapDesc.NumDescriptors = 11;
-	srvHeapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
-	srvHeapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
-	ThrowIfFailed(md3dDevice->CreateDescriptorHeap(&srvHeapDesc, IID_PPV_ARGS(&mSrvDescriptorHeap)));
-
-	//
-	// Fill out the heap with actual descriptors.
-	//
-	CD3DX12_CPU_DESCRIPTOR_HANDLE hDescriptor(mSrvDescriptorHeap->GetCPUDescriptorHandleForHeapStart());
-
-	auto grassTex = mTextures["grassTex"]->Resource;
-	auto waterTex = mTextures["waterTex"]->Resource;
-	auto drawBrigeTex = mTextures["drawBrigeTex"]->Resource;
-	auto blackStoneTex = mTextures["blackStoneTex"]->Resource;
-	auto bloodStoneTex = mTextures["bloodStoneTex"]->Resource;
-	auto jadeWoodTex = mTextures["jadeWoodTex"]->Resource;
-	auto poleTex = mTextures["poleTex"]->Resource;
-	auto wellTex = mTextures["wellTex"]->Resource;
-	auto headgeTex = mTextures["headgeTex"]->Resource;
-	auto quebertTex = mTextures["quebertTex"]->Resource;
-	auto treeArrayTex = mTextures["treeArrayTex"]->Resource;
-
-	D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
-	srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
-	srvDesc.Format = grassTex->GetDesc().Format;
-	srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
-	srvDesc.Texture2D.MostDetailedMip = 0;
-	srvDesc.Texture2D.MipLevels = -1;
-	md3dDevice->CreateShaderResourceView(grassTex.Get(), &srvDesc, hDescriptor);
+	// Room for every scene texture at least, so the allocations below cannot fail.
+	mSrvHeap.Initialize(md3dDevice.Get(), std::max(gMaxSrvViews, mScene.TextureCount()), gNumFrameResources,
+		gTransientSrvViews);
 
-	// next descriptor
-	hDescriptor.Offset(1, mCbvSrvDescriptorSize);
+	// One view per cached texture and view dimension, however many scene textures
+	// name it.
+	const CookedSceneView& scene = mScene.View();
+	std::map<std::pair<Texture*, bool>, UINT> views;
 
-	srvDesc.Format = waterTex->GetDesc().Format;
-	md3dDevice->CreateShaderResourceView(waterTex.Get(), &srvDesc, hDescriptor);
-
-	// next descriptor
-	hDescriptor.Offset(1, mCbvSrvDescriptorSize);
-
-	srvDesc.Format = drawBrigeTex->GetDesc().Format;
-	md3dDevice->CreateShaderResourceView(drawBrigeTex.Get(), &srvDesc, hDescriptor);
-
-	// next descriptor
-	hDescriptor.Offset(1, mCbvSrvDescriptorSize);
-
-	srvDesc.Format = blackStoneTex->GetDesc().Format;
-	md3dDevice->CreateShaderResourceView(blackStoneTex.Get(), &srvDesc, hDescriptor);
-
-	// next descriptor
-	hDescriptor.Offset(1, mCbvSrvDescriptorSize);
-
-	srvDesc.Format = bloodStoneTex->GetDesc().Format;
-	md3dDevice->CreateShaderResourceView(bloodStoneTex.Get(), &srvDesc, hDescriptor);
-	
-	//next descriptor
-	hDescriptor.Offset(1, mCbvSrvDescriptorSize);
-
-	srvDesc.Format = jadeWoodTex->GetDesc().Format;
-	md3dDevice->CreateShaderResourceView(jadeWoodTex.Get(), &srvDesc, hDescriptor);
-	
-	//next descriptor
-	hDescriptor.Offset(1, mCbvSrvDescriptorSize);
-
-	srvDesc.Format = poleTex->GetDesc().Format;
-	md3dDevice->CreateShaderResourceView(poleTex.Get(), &srvDesc, hDescriptor);
-	
-	//next descriptor
-	hDescriptor.Offset(1, mCbvSrvDescriptorSize);
-
-	srvDesc.Format = wellTex->GetDesc().Format;
-	md3dDevice->CreateShaderResourceView(wellTex.Get(), &srvDesc, hDescriptor);
-
-	//next descriptor
-	hDescriptor.Offset(1, mCbvSrvDescriptorSize);
-
-	srvDesc.Format = headgeTex->GetDesc().Format;
-	md3dDevice->CreateShaderResourceView(headgeTex.Get(), &srvDesc, hDescriptor);
+	mTextureSrvSlots.clear();
+	for(UINT i = 0; i < mScene.TextureCount(); ++i)
+	{
+		const auto key = std::make_pair(mSceneTextures[i].Get(), scene.Textures[i].IsArray != 0);
+		auto view = views.find(key);
+		if(view == views.end())
+		{
+			const UINT slot = mSrvHeap.Allocate();
+			view = views.emplace(key, slot).first;
+			WriteTextureSrv(i, slot);
+		}
 
-	//next descriptor
-	hDescriptor.Offset(1, mCbvSrvDescriptorSize);
+		mTextureSrvSlots.push_back(view->second);
+	}
+}
 
-	srvDesc.Format = quebertTex->GetDesc().Format;
-	md3dDevice->CreateShaderResourceView(quebertTex.Get(), &srvDesc, hDescriptor);
+void TreeBillboardsApp::WriteTextureSrv(UINT texture, UINT slot)
+{
+	const CookedSceneView& scene = mScene.View();
+	auto tex = mSceneTextures[texture]->Resource;
+	const D3D12_CPU_DESCRIPTOR_HANDLE hDescriptor = mSrvHeap.CpuHandle(slot);
 
-	// next descriptor
-	hDescriptor.Offset(1, mCbvSrvDescriptorSize);
+	D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+	srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+	srvDesc.Format = tex->GetDesc().Format;
 
-	auto desc = treeArrayTex->GetDesc();
-	srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2DARRAY;
-	srvDesc.Format = treeArrayTex->GetDesc().Format;
-	srvDesc.Texture2DArray.MostDetailedMip = 0;
-	srvDesc.Texture2DArray.MipLevels = -1;
-	srvDesc.Texture2DArray.FirstArraySlice = 0;
-	srvDesc.Texture2DArray.ArraySize = treeArrayTex->GetDesc().DepthOrArraySize;
-	md3dDevice->CreateShaderResourceView(treeArrayTex.Get(), &srvDesc, hDescriptor);
+	if(scene.Textures[texture].IsArray)
+	{
+		srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2DARRAY;
+		srvDesc.Texture2DArray.MostDetailedMip = 0;
+		srvDesc.Texture2DArray.MipLevels = -1;
+		srvDesc.Texture2DArray.FirstArraySlice = 0;
+		srvDesc.Texture2DArray.ArraySize = tex->GetDesc().DepthOrArraySize;
+	}
+	else
+	{
+		srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
+		srvDesc.Texture2D.MostDetailedMip = 0;
+		srvDesc.Texture2D.MipLevels = -1;
+	}
 
-	
+	md3dDevice->CreateShaderResourceView(tex.Get(), &srvDesc, hDescriptor);
 }
 
 void TreeBillboardsApp::BuildShadersAndInputLayouts()
@@ -924,7 +1047,14 @@ void TreeBillboardsApp::BuildShadersAndInputLayouts()
 		NULL, NULL
 	};
 
+	const D3D_SHADER_MACRO instancingDefines[] =
+	{
+		"INSTANCING", "1",
+		NULL, NULL
+	};
+
 	mShaders["standardVS"] = d3dUtil::CompileShader(L"Shaders\\Default.hlsl", nullptr, "VS", "vs_5_1");
+	mShaders["instancedVS"] = d3dUtil::CompileShader(L"Shaders\\Default.hlsl", instancingDefines, "VS", "vs_5_1");
 	mShaders["opaquePS"] = d3dUtil::CompileShader(L"Shaders\\Default.hlsl", defines, "PS", "ps_5_1");
 	mShaders["alphaTestedPS"] = d3dUtil::CompileShader(L"Shaders\\Default.hlsl", alphaTestDefines, "PS", "ps_5_1");
 	
@@ -1280,12 +1410,12 @@ void TreeBillboardsApp::BuildLandGeometry()
 
 void TreeBillboardsApp::BuildWavesGeometry()
 {
-    std::vector<std::uint16_t> indices(3 * mWaves->TriangleCount()); // 3 indices per face
-	assert(mWaves->VertexCount() < 0x0000ffff);
+    std::vector<std::uint16_t> indices(3 * mFrameScene.GetWaves().TriangleCount()); // 3 indices per face
+	assert(mFrameScene.GetWaves().VertexCount() < 0x0000ffff);
 
     // Iterate over each quad.
-    int m = mWaves->RowCount();
-    int n = mWaves->ColumnCount();
+    int m = mFrameScene.GetWaves().RowCount();
+    int n = mFrameScene.GetWaves().ColumnCount();
     int k = 0;
     for(int i = 0; i < m - 1; ++i)
     {
@@ -1303,7 +1433,7 @@ void TreeBillboardsApp::BuildWavesGeometry()
         }
     }
 
-	UINT vbByteSize = mWaves->VertexCount()*sizeof(Vertex);
+	UINT vbByteSize = mFrameScene.GetWaves().VertexCount()*sizeof(Vertex);
 	UINT ibByteSize = (UINT)indices.size()*sizeof(std::uint16_t);
 
 	auto geo = std::make_unique<MeshGeometry>();
@@ -1469,8 +1599,8 @@ void TreeBillboardsApp::BuildPSOs()
 	opaquePsoDesc.pRootSignature = mRootSignature.Get();
 	opaquePsoDesc.VS = 
 	{ 
-		reinterpret_cast<BYTE*>(mShaders["standardVS"]->GetBufferPointer()), 
-		mShaders["standardVS"]->GetBufferSize()
+		reinterpret_cast<BYTE*>(mShaders["instancedVS"]->GetBufferPointer()), 
+		mShaders["instancedVS"]->GetBufferSize()
 	};
 	opaquePsoDesc.PS = 
 	{ 
@@ -1555,6 +1685,11 @@ void TreeBillboardsApp::BuildPSOs()
 	treeSpritePsoDesc.RasterizerState.CullMode = D3D12_CULL_MODE_NONE;
 
 	ThrowIfFailed(md3dDevice->CreateGraphicsPipelineState(&treeSpritePsoDesc, IID_PPV_ARGS(&mPSOs["treeSprites"])));
+
+	mLayerPSOs[(int)RenderLayer::Opaque] = mPSOs["opaque"].Get();
+	mLayerPSOs[(int)RenderLayer::Transparent] = mPSOs["transparent"].Get();
+	mLayerPSOs[(int)RenderLayer::AlphaTested] = mPSOs["alphaTested"].Get();
+	mLayerPSOs[(int)RenderLayer::AlphaTestedTreeSprites] = mPSOs["treeSprites"].Get();
 }
 
 void TreeBillboardsApp::BuildFrameResources()
@@ -1562,386 +1697,159 @@ void TreeBillboardsApp::BuildFrameResources()
     for(int i = 0; i < gNumFrameResources; ++i)
     {
         mFrameResources.push_back(std::make_unique<FrameResource>(md3dDevice.Get(),
-            1, (UINT)mAllRitems.size(), (UINT)mMaterials.size(), mWaves->VertexCount()));
+            1, (UINT)mFrameScene.GetRenderItems().size(), (UINT)mMaterials.size(),
+            mFrameScene.GetWaves().VertexCount(), FrameScene::RecordWorkerCount));
     }
 }
 
 void TreeBillboardsApp::BuildMaterials()
 {
-	auto grass = std::make_unique<Material>();
-	grass->Name = "grass";
-	grass->MatCBIndex = 0;
-	grass->DiffuseSrvHeapIndex = 0;
-	grass->DiffuseAlbedo = XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f);
-	grass->FresnelR0 = XMFLOAT3(0.01f, 0.01f, 0.01f);
-	grass->Roughness = 0.125f;
-
-	// This is not a good water material definition, but we do not have all the rendering
-	// tools we need (transparency, environment reflection), so we fake it for now.
-	auto water = std::make_unique<Material>();
-	water->Name = "water";
-	water->MatCBIndex = 1;
-	water->DiffuseSrvHeapIndex = 1;
-	water->DiffuseAlbedo = XMFLOAT4(1.0f, 1.0f, 1.0f, 0.5f);
-	water->FresnelR0 = XMFLOAT3(0.1f, 0.1f, 0.1f);
-	water->Roughness = 0.0f;
-
-	auto DrawBridge = std::make_unique<Material>();
-	DrawBridge->Name = "drawbridge";
-	DrawBridge->MatCBIndex = 2;
-	DrawBridge->DiffuseSrvHeapIndex = 2;
-	DrawBridge->DiffuseAlbedo = XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f);
-	DrawBridge->FresnelR0 = XMFLOAT3(0.02f, 0.02f, 0.02f);
-	DrawBridge->Roughness = 0.25f;
-
-	auto BlackStone = std::make_unique<Material>();
-	BlackStone->Name = "blackstone";
-	BlackStone->MatCBIndex = 3;
-	BlackStone->DiffuseSrvHeapIndex = 3;
-	BlackStone->DiffuseAlbedo = XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f);
-	BlackStone->FresnelR0 = XMFLOAT3(0.02f, 0.02f, 0.02f);
-	BlackStone->Roughness = 0.25f;
-
-	auto BloodStone = std::make_unique<Material>();
-	BloodStone->Name = "bloodstone";
-	BloodStone->MatCBIndex = 4;
-	BloodStone->DiffuseSrvHeapIndex = 4;
-	BloodStone->DiffuseAlbedo = XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f);
-	BloodStone->FresnelR0 = XMFLOAT3(0.02f, 0.02f, 0.02f);
-	BloodStone->Roughness = 0.25f;
-
-	auto JadeWood = std::make_unique<Material>();
-	JadeWood->Name = "jadewood";
-	JadeWood->MatCBIndex = 5;
-	JadeWood->DiffuseSrvHeapIndex = 5;
-	JadeWood->DiffuseAlbedo = XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f);
-	JadeWood->FresnelR0 = XMFLOAT3(0.02f, 0.02f, 0.02f);
-	JadeWood->Roughness = 0.25f;
-
-	auto Pole = std::make_unique<Material>();
-	Pole->Name = "pole";
-	Pole->MatCBIndex = 6;
-	Pole->DiffuseSrvHeapIndex = 6;
-	Pole->DiffuseAlbedo = XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f);
-	Pole->FresnelR0 = XMFLOAT3(0.02f, 0.02f, 0.02f);
-	Pole->Roughness = 0.25f;
-
-	auto Well = std::make_unique<Material>();
-	Well->Name = "well";
-	Well->MatCBIndex = 7;
-	Well->DiffuseSrvHeapIndex = 7;
-	Well->DiffuseAlbedo = XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f);
-	Well->FresnelR0 = XMFLOAT3(0.02f, 0.02f, 0.02f);
-	Well->Roughness = 0.25f;
-
-	auto Headge = std::make_unique<Material>();
-	Headge->Name = "headge";
-	Headge->MatCBIndex = 8;
-	Headge->DiffuseSrvHeapIndex = 8;
-	Headge->DiffuseAlbedo = XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f);
-	Headge->FresnelR0 = XMFLOAT3(0.02f, 0.02f, 0.02f);
-	Headge->Roughness = 0.25f;
-
-	auto Quebert = std::make_unique<Material>();
-	Quebert->Name = "quebert";
-	Quebert->MatCBIndex = 9;
-	Quebert->DiffuseSrvHeapIndex = 9;
-	Quebert->DiffuseAlbedo = XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f);
-	Quebert->FresnelR0 = XMFLOAT3(0.02f, 0.02f, 0.02f);
-	Quebert->Roughness = 0.25f;
-
-	auto treeSprites = std::make_unique<Material>();
-	treeSprites->Name = "treeSprites";
-	treeSprites->MatCBIndex = 10;
-	treeSprites->DiffuseSrvHeapIndex = 10;
-	treeSprites->DiffuseAlbedo = XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f);
-	treeSprites->FresnelR0 = XMFLOAT3(0.01f, 0.01f, 0.01f);
-	treeSprites->Roughness = 0.125f;
-
-	mMaterials["grass"] = std::move(grass);
-	mMaterials["water"] = std::move(water);
-	mMaterials["drawbridge"] = std::move(DrawBridge);
-	mMaterials["blackstone"] = std::move(BlackStone);
-	mMaterials["bloodstone"] = std::move(BloodStone);
-	mMaterials["jadewood"] = std::move(JadeWood);
-	mMaterials["pole"] = std::move(Pole);
-	mMaterials["well"] = std::move(Well);
-	mMaterials["headge"] = std::move(Headge);
-	mMaterials["quebert"] = std::move(Quebert);
-	mMaterials["treeSprites"] = std::move(treeSprites);
+	// Material constant buffer indices follow the scene's material order.
+	const CookedSceneView& scene = mScene.View();
+	for(UINT i = 0; i < mScene.MaterialCount(); ++i)
+	{
+		const CookedMaterial& src = scene.Materials[i];
+
+		auto mat = std::make_unique<Material>();
+		mat->Name = scene.GetString(src.Name);
+		mat->MatCBIndex = i;
+		mat->DiffuseSrvHeapIndex = mTextureSrvSlots[src.TextureIndex];
+		mat->DiffuseAlbedo = XMFLOAT4(src.DiffuseAlbedo);
+		mat->FresnelR0 = XMFLOAT3(src.FresnelR0);
+		mat->Roughness = src.Roughness;
+
+		mMaterialList.push_back(mat.get());
+		mMaterials[mat->Name] = std::move(mat);
+	}
 }
 
-// Helper function to build any shape objects (Rotation is optional)
-void TreeBillboardsApp::BuildShape(string shapeName, string textureName,	float ScaleX, float ScaleY, float ScaleZ, 
-																			float OffsetX, float OffsetY, float OffsetZ, 
-																			float xRotation, float yRotation, float ZRotation,
-																			float xTexScale, float yTexScale, float zTexScale)
+bool TreeBillboardsApp::BuildRenderItems()
 {
-	auto boxRitem = std::make_unique<RenderItem>();
-	XMStoreFloat4x4(&boxRitem->World, XMMatrixScaling(ScaleX, ScaleY, ScaleZ) *
-		XMMatrixRotationRollPitchYaw(xRotation, yRotation, ZRotation) *
-		XMMatrixTranslation(OffsetX, OffsetY, OffsetZ));
-
-	XMStoreFloat4x4(&boxRitem->TexTransform, XMMatrixScaling(xTexScale, yTexScale, zTexScale));
+	std::string error;
+	if(!mFrameScene.Build(mScene.View(), mGeometries, mMaterialList, error))
+	{
+		ShowSceneError(std::string(gSceneFilename) + ", " + error);
+		return false;
+	}
 
-	boxRitem->ObjCBIndex = mAllRitems.size();
+	return true;
+}
 
-	boxRitem->Mat = mMaterials[textureName].get();	// For later changing we will add a material string
+void TreeBillboardsApp::SetPassState(FrameResource* frame, ID3D12GraphicsCommandList* cmdList)
+{
+    cmdList->RSSetViewports(1, &mScreenViewport);
+    cmdList->RSSetScissorRects(1, &mScissorRect);
 
-	boxRitem->Geo = mGeometries["shapeGeo"].get();
-	boxRitem->PrimitiveType = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
-	boxRitem->IndexCount = boxRitem->Geo->DrawArgs[shapeName].IndexCount;  //36
-	boxRitem->StartIndexLocation = boxRitem->Geo->DrawArgs[shapeName].StartIndexLocation; //0
-	boxRitem->BaseVertexLocation = boxRitem->Geo->DrawArgs[shapeName].BaseVertexLocation; //0
+    // Specify the buffers we are going to render to.
+	D3D12_CPU_DESCRIPTOR_HANDLE backBufferView = CurrentBackBufferView();
+	D3D12_CPU_DESCRIPTOR_HANDLE depthStencilView = DepthStencilView();
+    cmdList->OMSetRenderTargets(1, &backBufferView, true, &depthStencilView);
 
+	ID3D12DescriptorHeap* descriptorHeaps[] = { mSrvHeap.ShaderVisibleHeap() };
+	cmdList->SetDescriptorHeaps(_countof(descriptorHeaps), descriptorHeaps);
 
-	boxRitem->mBoundingBox.Transform(boxRitem->mBoundingBox, XMMatrixScaling(ScaleX / 2, ScaleY / 2, ScaleZ / 2)
-		* XMMatrixRotationX(xRotation)
-		* XMMatrixRotationY(yRotation)
-		* XMMatrixRotationZ(ZRotation) *
-		XMMatrixTranslation(OffsetX, OffsetY, OffsetZ));
+	cmdList->SetGraphicsRootSignature(mRootSignature.Get());
 
+	auto passCB = frame->PassCB->Resource();
+	cmdList->SetGraphicsRootConstantBufferView(2, passCB->GetGPUVirtualAddress());
 
-	mRitemLayer[(int)RenderLayer::Opaque].push_back(boxRitem.get());
+	// The textures and materials of every draw; draws only pick a material index.
+	cmdList->SetGraphicsRootDescriptorTable(0, mSrvHeap.FrameStart());
+	cmdList->SetGraphicsRootShaderResourceView(3, frame->MaterialBuffer->Resource()->GetGPUVirtualAddress());
 
-	mAllRitems.push_back(std::move(boxRitem));
+	cmdList->SetGraphicsRootShaderResourceView(4, frame->ObjectData->Resource()->GetGPUVirtualAddress());
+	cmdList->SetGraphicsRootShaderResourceView(5, frame->InstanceIndices->Resource()->GetGPUVirtualAddress());
 }
 
-void TreeBillboardsApp::BuildRenderItems()
+void TreeBillboardsApp::RecordDrawPackets(FrameResource* frame, ID3D12GraphicsCommandList* mainCmdList)
 {
-    auto wavesRitem = std::make_unique<RenderItem>();
-	XMStoreFloat4x4(&wavesRitem->World, XMMatrixScaling(5.0f, 1.0f, 5.0f) *
-		XMMatrixTranslation(0.0f, -5.0f, 0.0f));
-	XMStoreFloat4x4(&wavesRitem->TexTransform, XMMatrixScaling(20.0f, 20.0f, 20.0f));
-	wavesRitem->ObjCBIndex = 0;
-	wavesRitem->Mat = mMaterials["water"].get();
-	wavesRitem->Geo = mGeometries["waterGeo"].get();
-	wavesRitem->PrimitiveType = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
-	wavesRitem->IndexCount = wavesRitem->Geo->DrawArgs["grid"].IndexCount;
-	wavesRitem->StartIndexLocation = wavesRitem->Geo->DrawArgs["grid"].StartIndexLocation;
-	wavesRitem->BaseVertexLocation = wavesRitem->Geo->DrawArgs["grid"].BaseVertexLocation;
-
-    mWavesRitem = wavesRitem.get();
-
-	mRitemLayer[(int)RenderLayer::Transparent].push_back(wavesRitem.get());
-
-    auto gridRitem = std::make_unique<RenderItem>();
-    gridRitem->World = MathHelper::Identity4x4();
-	XMStoreFloat4x4(&gridRitem->TexTransform, XMMatrixScaling(15.0f, 15.0f, 15.0f));
-	gridRitem->ObjCBIndex = 1;
-	gridRitem->Mat = mMaterials["grass"].get();
-	gridRitem->Geo = mGeometries["landGeo"].get();
-	gridRitem->PrimitiveType = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
-    gridRitem->IndexCount = gridRitem->Geo->DrawArgs["grid"].IndexCount;
-    gridRitem->StartIndexLocation = gridRitem->Geo->DrawArgs["grid"].StartIndexLocation;
-    gridRitem->BaseVertexLocation = gridRitem->Geo->DrawArgs["grid"].BaseVertexLocation;
-
-	mRitemLayer[(int)RenderLayer::Opaque].push_back(gridRitem.get());
-
-	auto wavesRitem2 = std::make_unique<RenderItem>();
-	XMStoreFloat4x4(&wavesRitem2->World, XMMatrixScaling(0.015f, 1.0f, 0.015f) *
-		XMMatrixTranslation(5.5f, 3.5f, -6.0f));
-	XMStoreFloat4x4(&wavesRitem2->TexTransform, XMMatrixScaling(0.5f, 0.5f, 0.5f));
-	wavesRitem2->ObjCBIndex = 2;
-	wavesRitem2->Mat = mMaterials["water"].get();
-	wavesRitem2->Geo = mGeometries["waterGeo"].get();
-	wavesRitem2->PrimitiveType = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
-	wavesRitem2->IndexCount = wavesRitem2->Geo->DrawArgs["grid"].IndexCount;
-	wavesRitem2->StartIndexLocation = wavesRitem2->Geo->DrawArgs["grid"].StartIndexLocation;
-	wavesRitem2->BaseVertexLocation = wavesRitem2->Geo->DrawArgs["grid"].BaseVertexLocation;
-
-	mWavesRitem = wavesRitem2.get();
-
-	mRitemLayer[(int)RenderLayer::Transparent].push_back(wavesRitem2.get());
-
-	auto treeSpritesRitem = std::make_unique<RenderItem>();
-	treeSpritesRitem->World = MathHelper::Identity4x4();
-	treeSpritesRitem->ObjCBIndex = 3;
-	treeSpritesRitem->Mat = mMaterials["treeSprites"].get();
-	treeSpritesRitem->Geo = mGeometries["treeSpritesGeo"].get();
-	//step2
-	treeSpritesRitem->PrimitiveType = D3D_PRIMITIVE_TOPOLOGY_POINTLIST;
-	treeSpritesRitem->IndexCount = treeSpritesRitem->Geo->DrawArgs["points"].IndexCount;
-	treeSpritesRitem->StartIndexLocation = treeSpritesRitem->Geo->DrawArgs["points"].StartIndexLocation;
-	treeSpritesRitem->BaseVertexLocation = treeSpritesRitem->Geo->DrawArgs["points"].BaseVertexLocation;
-
-	mRitemLayer[(int)RenderLayer::AlphaTestedTreeSprites].push_back(treeSpritesRitem.get());
-
-    mAllRitems.push_back(std::move(wavesRitem));
-    mAllRitems.push_back(std::move(gridRitem));
-	mAllRitems.push_back(std::move(wavesRitem2));
-	mAllRitems.push_back(std::move(treeSpritesRitem));
-
-	//Base
-	BuildShape("box", "jadewood", 20.0f, 1.0f, 20.0f, 0.0f, 2.0f, 0.0f);
-
-	// Front wall 1
-	BuildShape("box", "blackstone", 8.0f, 5.0f, 1.0f, -6.0f, 5.0f, -9.5f);
-	// Front wall 2
-	BuildShape("box", "blackstone", 8.0f, 5.0f, 1.0f, 6.0f, 5.0f, -9.5f);
-	// Left wall
-	BuildShape("box", "blackstone", 1.0f, 5.0f, 20.0f, -9.5f, 5.0f, 0.0f);
-	// Back wall
-	BuildShape("box", "blackstone", 20.0f, 5.0f, 1.0f, 0.0f, 5.0f, 9.5f);
-	// Right wall
-	BuildShape("box", "blackstone", 1.0f, 5.0f, 20.0f, 9.5f, 5.0f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f, 1.0f, 20.0f);
-
-	// Inner Building
-	BuildShape("box2", "bloodstone", 6.0f, 7.0f, 6.0f, -5.0f, 6.0f, 0.0f);
-	// Inner Building Roof
-	BuildShape("pyramid", "jadewood", 6.0f, 3.5f, 6.0f, -5.0f, 11.25f, 0.0f, 0.0f, 3.95f, 0.0f);
-
-	// Towers
-	BuildShape("cylinder", "bloodstone", 2.0f, 10.0f, 2.0f, -9.5f, 6.5f, -9.5f);
-	BuildShape("cylinder", "bloodstone", 2.0f, 10.0f, 2.0f, 9.5f, 6.5f, -9.5f);
-	BuildShape("cylinder", "bloodstone", 2.0f, 10.0f, 2.0f, -9.5f, 6.5f, 9.5f);
-	BuildShape("cylinder", "bloodstone", 2.0f, 10.0f, 2.0f, 9.5f, 6.5f, 9.5f);
-
-	// Tower Toppers
-	BuildShape("cone", "jadewood", 3.0f, 3.0f, 3.0f, 9.5f, 13.0f, 9.5f);
-	BuildShape("cone", "jadewood", 3.0f, 3.0f, 3.0f, -9.5f, 13.0f, 9.5f);
-	BuildShape("cone", "jadewood", 3.0f, 3.0f, 3.0f, 9.5f, 13.0f, -9.5f);
-	BuildShape("cone", "jadewood", 3.0f, 3.0f, 3.0f, -9.5f, 13.0f, -9.5f);
-
-	// Gate Decal
-	BuildShape("box2", "drawbridge", 4.0f, 1.0f, 6.0f, 0.0f, 2.0f, -13.0f);
-
-	// Stairs
-	BuildShape("wedge", "pole", 8.0f, 5.25f, 1.0f, 0.0f, 5.0f, 8.5f, 22.0);
-
-	// Fence Vertical
-	BuildShape("box2", "drawbridge", 0.2f, 1.0f, 0.2f, 2.0f, 3.0f, -9.0f);
-	BuildShape("box2", "drawbridge", 0.2f, 1.0f, 0.2f, 2.0f, 3.0f, -8.0f);
-	BuildShape("box2", "drawbridge", 0.2f, 1.0f, 0.2f, 2.0f, 3.0f, -7.0f);
-	BuildShape("box2", "drawbridge", 0.2f, 1.0f, 0.2f, 2.0f, 3.0f, -6.0f);
-	BuildShape("box2", "drawbridge", 0.2f, 1.0f, 0.2f, 2.0f, 3.0f, -5.0f);
-	BuildShape("box2", "drawbridge", 0.2f, 1.0f, 0.2f, 2.0f, 3.0f, -4.0f);
-	BuildShape("box2", "drawbridge", 0.2f, 1.0f, 0.2f, 2.0f, 3.0f, -3.0f);
-	BuildShape("box2", "drawbridge", 0.2f, 1.0f, 0.2f, 3.0f, 3.0f, -3.0f);
-	BuildShape("box2", "drawbridge", 0.2f, 1.0f, 0.2f, 4.0f, 3.0f, -3.0f);
-	BuildShape("box2", "drawbridge", 0.2f, 1.0f, 0.2f, 5.0f, 3.0f, -3.0f);
-	BuildShape("box2", "drawbridge", 0.2f, 1.0f, 0.2f, 6.0f, 3.0f, -3.0f);
-	BuildShape("box2", "drawbridge", 0.2f, 1.0f, 0.2f, 7.0f, 3.0f, -3.0f);
-	BuildShape("box2", "drawbridge", 0.2f, 1.0f, 0.2f, 8.0f, 3.0f, -3.0f);
-	BuildShape("box2", "drawbridge", 0.2f, 1.0f, 0.2f, 9.0f, 3.0f, -3.0f);
-
-	// Fence Horizontal
-	BuildShape("box2", "drawbridge", 0.2f, 0.2f, 6.0f, 2.0f, 3.0f, -6.0f);
-	BuildShape("box2", "drawbridge", 7.0f, 0.2f, 0.2f, 5.5f, 3.0f, -3.0f);
-
-	// Fence Decals
-	BuildShape("diamond", "bloodstone", 0.2f, 0.2f, 0.2f, 2.0f, 4.0f, -8.0f);
-	BuildShape("diamond", "bloodstone", 0.2f, 0.2f, 0.2f, 2.0f, 4.0f, -6.0f);
-	BuildShape("diamond", "bloodstone", 0.2f, 0.2f, 0.2f, 2.0f, 4.0f, -4.0f);
-	BuildShape("diamond", "bloodstone", 0.2f, 0.2f, 0.2f, 3.0f, 4.0f, -3.0f);
-	BuildShape("diamond", "bloodstone", 0.2f, 0.2f, 0.2f, 5.0f, 4.0f, -3.0f);
-	BuildShape("diamond", "bloodstone", 0.2f, 0.2f, 0.2f, 7.0f, 4.0f, -3.0f);
-	BuildShape("diamond", "bloodstone", 0.2f, 0.2f, 0.2f, 7.0f, 4.0f, -3.0f);
-
-	// Well
-	BuildShape("box2", "blackstone", 4.0f, 0.5f, 4.0f, 5.5f, 3.0f, -6.0f);
-	BuildShape("pipe", "well", 1.4f, 0.5f, 1.4f, 5.5f, 3.5f, -6.0f);
-
-	//Flagpole
-	BuildShape("cylinder", "blackstone", 1.0f, 1.0f, 1.0f, 5.0f, 3.0f, 0.0f);
-	BuildShape("cylinder", "pole", 0.5f, 12.0f, 0.5f, 5.0f, 9.5f, 0.0f);
-	BuildShape("flag", "jadewood", 3.0f, 1.0f, 2.0f, 7.0f, 13.5f, 0.0f, 4.7f, 0.0f, 0.0f);
-	//Flag Decal
-	BuildShape("box", "quebert", 1.70f, 1.70f, 1.05f, 6.9f, 13.5f, 0.0f);
-
-	//Torchs
-	BuildShape("cylinder", "blackstone", 0.25f, 3.0f, 0.25f, -3.0f, 3.7f, -13.0f);
-	BuildShape("cylinder", "blackstone", 0.25f, 3.0f, 0.25f, 3.0f, 3.7f, -13.0f);
-
-	//Maze
-	/*Maze exit*/
-	BuildShape("box", "headge", 11.0f, 3.0f, 1.0f, -7.0f, 3.0f, -20.5f	,0.0f,0.0f,0.0f, 11.0f, 3.0f, 1.0f);
-	BuildShape("box", "headge", 11.0f, 3.0f, 1.0f, 7.0f, 3.0f, -20.5f	,0.0f,0.0f,0.0f, 11.0f, 3.0f, 1.0f);
-	BuildShape("box", "headge", 1.0f, 3.0f, 42.0f, -13.0f, 3.0f, 0.0f	,0.0f,0.0f,0.0f, 42.0f, 3.0f, 42.0f);
-	BuildShape("box", "headge", 1.0f, 3.0f, 42.0f, 13.0f, 3.0f, 0.0f	,0.0f,0.0f,0.0f, 42.0f, 3.0f, 42.0f);
-	BuildShape("box", "headge", 25.0f, 3.0f, 1.0f, 0.0f, 3.0f, 20.5f	,0.0f,0.0f,0.0f, 25.0f, 3.0f, 1.0f);
-
-	/*Maze Enterence*/
-	BuildShape("box", "headge", 59.0f, 3.0f, 1.0f, 0.0f, 3.0f, -40.5f	,0.0f,0.0f,0.0f, 59.0f, 3.0f, 1.0f);
-	BuildShape("box", "headge", 1.0f, 3.0f, 82.0f, -30.0f, 3.0f, 0.0f	,0.0f,0.0f,0.0f, 82.0f, 3.0f, 82.0f);
-	BuildShape("box", "headge", 1.0f, 3.0f, 82.0f, 30.0f, 3.0f, 0.0f	,0.0f,0.0f,0.0f, 82.0f, 3.0f, 82.0f);
-	BuildShape("box", "headge", 59.0f, 3.0f, 1.0f, 0.0f, 3.0f, 40.5f	,0.0f,0.0f,0.0f, 59.0f, 3.0f, 1.0f);
-			
-
-	//BuildShape("box", "headge", 59.0f, 3.0f, 1.0f, 0.0f, 13.0f, -43.5f, 0.0f, 0.0f, 0.0f, 59.0f, 3.0f, 30.0f);
-	//BuildShape("box", "headge", 1.0f, 3.0f, 82.0f, -30.0f, 13.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 3.0f, 30.0f);
-
-
-	/*The Maze*/																	   
-	BuildShape("box", "headge", 25.0f, 3.0f, 1.0f, 0.0f, 3.0f, -27.5f	,0.0f,0.0f,0.0f, 25.0f, 3.0f, 1.0f);
-	BuildShape("box", "headge", 8.0f, 3.0f, 1.0f, -23.0f, 3.0f, -20.5f	,0.0f,0.0f,0.0f, 8.0f, 3.0f, 1.0f);
-	BuildShape("box", "headge", 1.0f, 3.0f, 13.0f, -23.0f, 3.0f, -20.5f	,0.0f,0.0f,0.0f, 13.0f, 3.0f, 13.0f);
-	BuildShape("box", "headge", 11.0f, 3.0f, 1.0f, -18.0f, 3.0f, -27.5f	,0.0f,0.0f,0.0f, 11.0f, 3.0f, 1.0f);
-	BuildShape("box", "headge", 7.0f, 3.0f, 1.0f, 16.0f, 3.0f, -27.5f	,0.0f,0.0f,0.0f, 7.0f, 3.0f, 1.0f);
-	BuildShape("box", "headge", 7.0f, 3.0f, 1.0f, 17.0f, 3.0f, -20.5f	,0.0f,0.0f,0.0f, 7.0f, 3.0f, 1.0f);
-	BuildShape("box", "headge", 4.0f, 3.0f, 1.0f, 25.0f, 3.0f, -20.5f	,0.0f,0.0f,0.0f, 4.0f, 3.0f, 1.0f);
-	BuildShape("box", "headge", 7.0f, 3.0f, 1.0f, 23.0f, 3.0f, -27.5f	,0.0f,0.0f,0.0f, 7.0f, 3.0f, 1.0f);
-	BuildShape("box", "headge", 1.0f, 3.0f, 6.0f, 23.5f, 3.0f, -24.0f	,0.0f,0.0f,0.0f, 6.0f, 3.0f, 6.0f);
-	BuildShape("box", "headge", 1.0f, 3.0f, 6.0f, 23.5f, 3.0f, -17.0f	, 0.0f, 0.0f, 0.0f, 6.0f, 3.0f, 6.0f);
-	BuildShape("box", "headge", 1.0f, 3.0f, 6.0f, 19.5f, 3.0f, -11.0f	, 0.0f, 0.0f, 0.0f, 6.0f, 3.0f, 6.0f);
-	BuildShape("box", "headge", 4.0f, 3.0f, 1.0f, 21.0f, 3.0f, -14.5f	,0.0f,0.0f,0.0f, 4.0f, 3.0f, 1.0f);
-	BuildShape("box", "headge", 1.0f, 3.0f, 40.0f, 19.5f, 3.0f, 12.0f	,0.0f,0.0f,0.0f, 40.0f, 3.0f, 40.0f);
-	BuildShape("box", "headge", 1.0f, 3.0f, 6.0f, -13.0f, 3.0f, -24.0f	,0.0f,0.0f,0.0f, 6.0f, 3.0f, 6.0f);
-	BuildShape("box", "headge", 1.0f, 3.0f, 15.0f, -23.0f, 3.0f, 0.0f	,0.0f,0.0f,0.0f, 15.0f, 3.0f, 15.0f);
-	BuildShape("box", "headge", 6.0f, 3.0f, 1.0f, 23.0f, 3.0f, 35.0f	,0.0f,0.0f,0.0f, 6.0f, 3.0f, 1.0f);
-	BuildShape("box", "headge", 10.0f, 3.0f, 1.0f, 14.0f, 3.0f, 31.5f	,0.0f,0.0f,0.0f, 10.0f, 3.0f, 1.0f);
-	//BuildShape("box", "headge", 1.0f, 3.0f, 5.0f, 8.5f, 6.0f, 33.5f);				   
-	BuildShape("box", "headge", 10.0f, 3.0f, 1.0f, 3.0f, 3.0f, 35.5f	,0.0f,0.0f,0.0f, 10.0f, 3.0f, 1.0f);//
-	BuildShape("box", "headge", 10.0f, 3.0f, 1.0f, -10.0f, 3.0f, 35.5f	,0.0f,0.0f,0.0f, 10.0f, 3.0f, 1.0f);
-	BuildShape("box", "headge", 1.0f, 3.0f, 5.0f, -1.5f, 3.0f, 32.5f	,0.0f,0.0f,0.0f, 5.0f, 3.0f, 5.0f);
-	BuildShape("box", "headge", 10.0f, 3.0f, 1.0f, -7.0f, 3.0f, 30.5f	,0.0f,0.0f,0.0f, 10.0f, 3.0f, 1.0f);
-	//BuildShape("box", "headge", 1.0f, 3.0f, 9.0f, -6.5f, 3.0f, 25.5f);			   
-	BuildShape("box", "headge", 6.0f, 3.0f, 1.0f, -26.5f, 3.0f, 0.0f	,0.0f,0.0f,0.0f, 6.0f, 3.0f, 1.0f);
-	//BuildShape("box", "headge", 3.0f, 3.0f, 1.0f, -18.0f, 3.0f, -8.0f);			   
-	BuildShape("box", "headge", 1.0f, 3.0f, 40.0f, -18.5f, 3.0f, -1.0f	,0.0f,0.0f,0.0f, 40.0f, 3.0f, 40.0f);
-	BuildShape("box", "headge", 1.0f, 3.0f, 6.0f, -15.5f, 3.0f, 33.0f	,0.0f,0.0f,0.0f, 6.0f, 3.0f, 6.0f);
-	BuildShape("box", "headge", 1.0f, 3.0f, 6.0f, -18.5f, 3.0f, 22.0f	,0.0f,0.0f,0.0f, 6.0f, 3.0f, 6.0f);
-	BuildShape("box", "headge", 1.0f, 3.0f, 4.0f, -18.5f, 3.0f, 27.0f	,0.0f,0.0f,0.0f, 4.0f, 3.0f, 4.0f);
-	BuildShape("box", "headge", 4.0f, 3.0f, 1.0f, -17.0f, 3.0f, 29.5f	,0.0f,0.0f,0.0f, 4.0f, 3.0f, 1.0f);
-	BuildShape("box", "headge", 1.0f, 3.0f, 9.0f, -11.5f, 3.0f, 25.5f	,0.0f,0.0f,0.0f, 9.0f, 3.0f, 9.0f);
-	BuildShape("box", "headge", 1.0f, 3.0f, 8.0f, 3.0f, 3.0f, 25.0f		,0.0f,0.0f,0.0f, 8.0f, 3.0f, 8.0f);
-	BuildShape("box", "headge", 1.0f, 3.0f, 34.0f, 25.0f, 3.0f, 17.5f	,0.0f,0.0f,0.0f, 34.0f, 3.0f, 34.0f);
-	BuildShape("box", "headge", 1.0f, 3.0f, 4.0f, 19.5f, 3.0f, 34.0f	,0.0f,0.0f,0.0f, 4.0f, 3.0f, 4.0f);
-	BuildShape("box", "headge", 8.0f, 3.0f, 1.0f, -23.0f, 3.0f, 20.5f	,0.0f,0.0f,0.0f, 8.0f, 3.0f, 1.0f);
-	BuildShape("box", "headge", 8.0f, 3.0f, 1.0f, -20.0f, 3.0f, 35.5f	,0.0f,0.0f,0.0f, 8.0f, 3.0f, 1.0f);
+	PROFILE_SCOPE("RecordDrawPackets");
 
-}
+	D3D12CommandSink::Bindings bindings;
+	bindings.Psos = mLayerPSOs;
+	bindings.Geometries = &mFrameScene.GetSortIdGeometries();
+	bindings.ObjectCB = frame->ObjectCB->Resource()->GetGPUVirtualAddress();
+	bindings.ObjCBByteSize = d3dUtil::CalcConstantBufferByteSize(sizeof(ObjectConstants));
 
-void TreeBillboardsApp::DrawRenderItems(ID3D12GraphicsCommandList* cmdList, const std::vector<RenderItem*>& ritems)
-{
-    UINT objCBByteSize = d3dUtil::CalcConstantBufferByteSize(sizeof(ObjectConstants));
-    UINT matCBByteSize = d3dUtil::CalcConstantBufferByteSize(sizeof(MaterialConstants));
+	// The waves come from this frame's copy of their vertex buffer.
+	const MeshGeometry* wavesGeo = mFrameScene.GetWavesItem()->Geo;
+	bindings.DynamicGeometry = wavesGeo;
+	bindings.DynamicVertexBuffer.BufferLocation = frame->WavesVB->Resource()->GetGPUVirtualAddress();
+	bindings.DynamicVertexBuffer.StrideInBytes = wavesGeo->VertexByteStride;
+	bindings.DynamicVertexBuffer.SizeInBytes = wavesGeo->VertexBufferByteSize;
 
-	auto objectCB = mCurrFrameResource->ObjectCB->Resource();
-	auto matCB = mCurrFrameResource->MaterialCB->Resource();
+	const auto& chunks = mFrameScene.GetRecordChunks();
+	mChunkDrawStats.assign(chunks.size(), DrawStats());
 
-    // For each render item...
-    for(size_t i = 0; i < ritems.size(); ++i)
-    {
-        auto ri = ritems[i];
+	auto toPresent = CD3DX12_RESOURCE_BARRIER::Transition(CurrentBackBuffer(),
+		D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PRESENT);
+
+	std::vector<ID3D12CommandList*> cmdsLists;
+	cmdsLists.push_back(mainCmdList);
+
+	if(chunks.size() <= 1)
+	{
+		// Not enough work to pay for extra command lists; record on the main list.
+		SetPassState(frame, mainCmdList);
+		if(!chunks.empty())
+		{
+			D3D12CommandSink sink(mainCmdList, bindings);
+			mFrameScene.RecordChunk(0, sink, mChunkDrawStats[0]);
+		}
+		mainCmdList->ResourceBarrier(1, &toPresent);
+		ThrowIfFailed(mainCmdList->Close());
+	}
+	else
+	{
+		// The main list only holds the clear.  Each chunk goes to its own worker list,
+		// and the last one also transitions the back buffer back to present.
+		ThrowIfFailed(mainCmdList->Close());
 
-        cmdList->IASetVertexBuffers(0, 1, &ri->Geo->VertexBufferView());
-        cmdList->IASetIndexBuffer(&ri->Geo->IndexBufferView());
-		//step3
-        cmdList->IASetPrimitiveTopology(ri->PrimitiveType);
+		const int chunkCount = (int)chunks.size();
+		concurrency::parallel_for(0, chunkCount, [&](int c)
+		{
+			PROFILE_SCOPE("RecordChunk");
 
-		CD3DX12_GPU_DESCRIPTOR_HANDLE tex(mSrvDescriptorHeap->GetGPUDescriptorHandleForHeapStart());
-		tex.Offset(ri->Mat->DiffuseSrvHeapIndex, mCbvSrvDescriptorSize);
+			auto alloc = frame->WorkerCmdListAllocs[c];
+			auto cmdList = frame->WorkerCmdLists[c];
 
-        D3D12_GPU_VIRTUAL_ADDRESS objCBAddress = objectCB->GetGPUVirtualAddress() + ri->ObjCBIndex*objCBByteSize;
-		D3D12_GPU_VIRTUAL_ADDRESS matCBAddress = matCB->GetGPUVirtualAddress() + ri->Mat->MatCBIndex*matCBByteSize;
+			ThrowIfFailed(alloc->Reset());
+			ThrowIfFailed(cmdList->Reset(alloc.Get(), nullptr));
 
-		cmdList->SetGraphicsRootDescriptorTable(0, tex);
-        cmdList->SetGraphicsRootConstantBufferView(1, objCBAddress);
-        cmdList->SetGraphicsRootConstantBufferView(3, matCBAddress);
+			SetPassState(frame, cmdList.Get());
 
-        cmdList->DrawIndexedInstanced(ri->IndexCount, 1, ri->StartIndexLocation, ri->BaseVertexLocation, 0);
-    }
+			D3D12CommandSink sink(cmdList.Get(), bindings);
+			mFrameScene.RecordChunk(c, sink, mChunkDrawStats[c]);
+
+			if(c == chunkCount - 1)
+				cmdList->ResourceBarrier(1, &toPresent);
+			ThrowIfFailed(cmdList->Close());
+		});
+
+		for(int c = 0; c < chunkCount; ++c)
+			cmdsLists.push_back(frame->WorkerCmdLists[c].Get());
+	}
+
+    // Add the command lists to the queue for execution, in draw order.
+    mCommandQueue->ExecuteCommandLists((UINT)cmdsLists.size(), cmdsLists.data());
+}
+
+std::wstring TreeBillboardsApp::GetFrameStatsText()const
+{
+	return L"   draws: " + std::to_wstring(mDrawStats.DrawCalls) +
+		L"   instances: " + std::to_wstring(mDrawStats.Instances) +
+		L"   binds: " + std::to_wstring(mDrawStats.BindsIssued) +
+		L"   skipped: " + std::to_wstring(mDrawStats.BindsSkipped) +
+		L"   crit: " + std::to_wstring(mLastFrameTrace.CriticalPathMs()) + L" ms";
+}
+
+void TreeBillboardsApp::LogFrameStats()
+{
+	// Which jobs made up the critical path of the last recorded frame.
+	char recordText[96];
+	std::snprintf(recordText, sizeof(recordText), " > draw %.2f > record %.2f\n",
+		mLastFrameTrace.DrawMs, mLastFrameTrace.RecordMs);
+	OutputDebugStringA(("Critical path: " + mFrameGraph.FormatCriticalPath() + recordText).c_str());
 }
 
 std::array<const CD3DX12_STATIC_SAMPLER_DESC, 6> TreeBillboardsApp::GetStaticSamplers()
@@ -0,0 +1,770 @@
+//***************************************************************************************
+// DDSFormat.cpp
+//
+// BitsPerPixel, GetSurfaceInfo and GetDXGIFormat come from DDSTextureLoader.cpp,
+// Copyright (c) Microsoft Corporation.
+//***************************************************************************************
+
+#include "DDSFormat.h"
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+	// Copies a field out of the file, which may not be aligned for it.
+	template<typename T>
+	bool ReadField(const std::uint8_t* data, std::size_t size, std::size_t offset, T& value)
+	{
+		if(offset > size || size - offset < sizeof(T))
+			return false;
+
+		std::memcpy(&value, data + offset, sizeof(T));
+		return true;
+	}
+}
+
+DDSStatus DDSFormat::Parse(const std::uint8_t* data, std::size_t size, DDSInfo& info)
+{
+	// Keep the capacity of the subresource array for the next file.
+	std::vector<DDSSubresource> subresources;
+	subresources.swap(info.Subresources);
+	subresources.clear();
+	info = DDSInfo();
+
+	if(data == nullptr)
+		return DDSStatus::Truncated;
+
+	std::uint32_t magic = 0;
+	DDS_HEADER header;
+	if(!ReadField(data, size, 0, magic) || !ReadField(data, size, sizeof(std::uint32_t), header))
+		return DDSStatus::Truncated;
+
+	if(magic != DDS_MAGIC || header.size != sizeof(DDS_HEADER) || header.ddspf.size != sizeof(DDS_PIXELFORMAT))
+		return DDSStatus::InvalidData;
+
+	std::uint32_t offset = sizeof(std::uint32_t) + sizeof(DDS_HEADER);
+	std::uint32_t width = header.width;
+	std::uint32_t height = header.height;
+	std::uint32_t depth = header.depth;
+	std::uint32_t mipCount = std::max(header.mipMapCount, 1u);
+	std::uint32_t arraySize = 1;
+	bool isCubeMap = false;
+	DDSDimension dimension = DDSDimension::Unknown;
+	DXGI_FORMAT format = DXGI_FORMAT_UNKNOWN;
+
+	const bool hasDx10 = (header.ddspf.flags & DDS_FOURCC) && MAKEFOURCC('D', 'X', '1', '0') == header.ddspf.fourCC;
+	DDS_HEADER_DXT10 dx10;
+	if(hasDx10)
+	{
+		if(!ReadField(data, size, offset, dx10))
+			return DDSStatus::Truncated;
+		offset += sizeof(DDS_HEADER_DXT10);
+
+		arraySize = dx10.arraySize;
+		if(arraySize == 0)
+			return DDSStatus::InvalidData;
+
+		switch(dx10.dxgiFormat)
+		{
+		case DXGI_FORMAT_AI44:
+		case DXGI_FORMAT_IA44:
+		case DXGI_FORMAT_P8:
+		case DXGI_FORMAT_A8P8:
+			return DDSStatus::NotSupported;
+
+		default:
+			if(BitsPerPixel(dx10.dxgiFormat) == 0)
+				return DDSStatus::NotSupported;
+		}
+		format = dx10.dxgiFormat;
+
+		switch(dx10.resourceDimension)
+		{
+		case DDS_DIMENSION_TEXTURE1D:
+			if((header.flags & DDS_HEIGHT) && height != 1)
+				return DDSStatus::InvalidData;
+			height = depth = 1;
+			dimension = DDSDimension::Texture1D;
+			break;
+
+		case DDS_DIMENSION_TEXTURE2D:
+			if(dx10.miscFlag & DDS_RESOURCE_MISC_TEXTURECUBE)
+			{
+				// Bounded before multiplying so it cannot wrap.
+				if(arraySize > MaxArraySize / 6)
+					return DDSStatus::NotSupported;
+				arraySize *= 6;
+				isCubeMap = true;
+			}
+			depth = 1;
+			dimension = DDSDimension::Texture2D;
+			break;
+
+		case DDS_DIMENSION_TEXTURE3D:
+			if(!(header.flags & DDS_HEADER_FLAGS_VOLUME))
+				return DDSStatus::InvalidData;
+			if(arraySize > 1)
+				return DDSStatus::NotSupported;
+			dimension = DDSDimension::Texture3D;
+			break;
+
+		default:
+			return DDSStatus::NotSupported;
+		}
+	}
+	else
+	{
+		format = GetDXGIFormat(header.ddspf);
+		if(format == DXGI_FORMAT_UNKNOWN)
+			return DDSStatus::NotSupported;
+
+		if(header.flags & DDS_HEADER_FLAGS_VOLUME)
+		{
+			dimension = DDSDimension::Texture3D;
+		}
+		else
+		{
+			if(header.caps2 & DDS_CUBEMAP)
+			{
+				if((header.caps2 & DDS_CUBEMAP_ALLFACES) != DDS_CUBEMAP_ALLFACES)
+					return DDSStatus::NotSupported;
+				arraySize = 6;
+				isCubeMap = true;
+			}
+
+			depth = 1;
+			dimension = DDSDimension::Texture2D;
+		}
+	}
+
+	// A mip chain cannot be longer than the one down to 1x1x1.
+	if(width == 0 || height == 0 || depth == 0)
+		return DDSStatus::InvalidData;
+	if(mipCount > MaxMipLevels)
+		return DDSStatus::NotSupported;
+	if(mipCount > CountMips(width, height, depth))
+		return DDSStatus::InvalidData;
+
+	switch(dimension)
+	{
+	case DDSDimension::Texture1D:
+		if(arraySize > MaxArraySize || width > MaxTexture1DSize)
+			return DDSStatus::NotSupported;
+		break;
+
+	case DDSDimension::Texture2D:
+		if(isCubeMap)
+		{
+			// arraySize already counts six faces per cube.
+			if(arraySize > MaxArraySize || width > MaxTextureCubeSize || height > MaxTextureCubeSize)
+				return DDSStatus::NotSupported;
+		}
+		else if(arraySize > MaxArraySize || width > MaxTexture2DSize || height > MaxTexture2DSize)
+		{
+			return DDSStatus::NotSupported;
+		}
+		break;
+
+	case DDSDimension::Texture3D:
+		if(arraySize > 1 || width > MaxTexture3DSize || height > MaxTexture3DSize || depth > MaxTexture3DSize)
+			return DDSStatus::NotSupported;
+		break;
+
+	default:
+		return DDSStatus::NotSupported;
+	}
+
+	// Lay out the subresources and check each one ends inside the data.  The bounds
+	// above keep every size well inside 64 bits.
+	subresources.resize((std::size_t)mipCount * arraySize);
+
+	std::uint64_t position = offset;
+	std::size_t index = 0;
+	for(std::uint32_t item = 0; item < arraySize; ++item)
+	{
+		std::uint32_t w = width;
+		std::uint32_t h = height;
+		std::uint32_t d = depth;
+		for(std::uint32_t mip = 0; mip < mipCount; ++mip)
+		{
+			DDSSubresource& sub = subresources[index++];
+			if(!GetSurfaceInfo(w, h, format, &sub.SliceBytes, &sub.RowBytes, &sub.NumRows))
+				return DDSStatus::NotSupported;
+
+			sub.Offset = position;
+			sub.Size = sub.SliceBytes * d;
+			sub.Width = w;
+			sub.Height = h;
+			sub.Depth = d;
+
+			if(sub.Size > size - position)
+				return DDSStatus::Truncated;
+			position += sub.Size;
+
+			w = std::max(w >> 1, 1u);
+			h = std::max(h >> 1, 1u);
+			d = std::max(d >> 1, 1u);
+		}
+	}
+
+	info.Format = format;
+	info.Dimension = dimension;
+	info.Width = width;
+	info.Height = height;
+	info.Depth = depth;
+	info.MipCount = mipCount;
+	info.ArraySize = arraySize;
+	info.IsCubeMap = isCubeMap;
+	info.AlphaMode = GetAlphaMode(header, hasDx10 ? &dx10 : nullptr);
+	info.DataOffset = offset;
+	info.Subresources.swap(subresources);
+
+	return DDSStatus::Ok;
+}
+
+const char* DDSFormat::StatusString(DDSStatus status)
+{
+	switch(status)
+	{
+	case DDSStatus::Ok:
+		return "ok";
+	case DDSStatus::Truncated:
+		return "the file is truncated";
+	case DDSStatus::InvalidData:
+		return "the DDS header is invalid";
+	case DDSStatus::NotSupported:
+		return "the format or size is not supported";
+	}
+	return "unknown status";
+}
+
+std::uint32_t DDSFormat::CountMips(std::uint32_t width, std::uint32_t height, std::uint32_t depth)
+{
+	std::uint32_t size = std::max(width, std::max(height, depth));
+	std::uint32_t count = 1;
+	while(size > 1)
+	{
+		size >>= 1;
+		++count;
+	}
+	return count;
+}
+
+std::size_t DDSFormat::BitsPerPixel(DXGI_FORMAT fmt)
+{
+	switch( fmt )
+	{
+	case DXGI_FORMAT_R32G32B32A32_TYPELESS:
+	case DXGI_FORMAT_R32G32B32A32_FLOAT:
+	case DXGI_FORMAT_R32G32B32A32_UINT:
+	case DXGI_FORMAT_R32G32B32A32_SINT:
+		return 128;
+
+	case DXGI_FORMAT_R32G32B32_TYPELESS:
+	case DXGI_FORMAT_R32G32B32_FLOAT:
+	case DXGI_FORMAT_R32G32B32_UINT:
+	case DXGI_FORMAT_R32G32B32_SINT:
+		return 96;
+
+	case DXGI_FORMAT_R16G16B16A16_TYPELESS:
+	case DXGI_FORMAT_R16G16B16A16_FLOAT:
+	case DXGI_FORMAT_R16G16B16A16_UNORM:
+	case DXGI_FORMAT_R16G16B16A16_UINT:
+	case DXGI_FORMAT_R16G16B16A16_SNORM:
+	case DXGI_FORMAT_R16G16B16A16_SINT:
+	case DXGI_FORMAT_R32G32_TYPELESS:
+	case DXGI_FORMAT_R32G32_FLOAT:
+	case DXGI_FORMAT_R32G32_UINT:
+	case DXGI_FORMAT_R32G32_SINT:
+	case DXGI_FORMAT_R32G8X24_TYPELESS:
+	case DXGI_FORMAT_D32_FLOAT_S8X24_UINT:
+	case DXGI_FORMAT_R32_FLOAT_X8X24_TYPELESS:
+	case DXGI_FORMAT_X32_TYPELESS_G8X24_UINT:
+	case DXGI_FORMAT_Y416:
+	case DXGI_FORMAT_Y210:
+	case DXGI_FORMAT_Y216:
+		return 64;
+
+	case DXGI_FORMAT_R10G10B10A2_TYPELESS:
+	case DXGI_FORMAT_R10G10B10A2_UNORM:
+	case DXGI_FORMAT_R10G10B10A2_UINT:
+	case DXGI_FORMAT_R11G11B10_FLOAT:
+	case DXGI_FORMAT_R8G8B8A8_TYPELESS:
+	case DXGI_FORMAT_R8G8B8A8_UNORM:
+	case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
+	case DXGI_FORMAT_R8G8B8A8_UINT:
+	case DXGI_FORMAT_R8G8B8A8_SNORM:
+	case DXGI_FORMAT_R8G8B8A8_SINT:
+	case DXGI_FORMAT_R16G16_TYPELESS:
+	case DXGI_FORMAT_R16G16_FLOAT:
+	case DXGI_FORMAT_R16G16_UNORM:
+	case DXGI_FORMAT_R16G16_UINT:
+	case DXGI_FORMAT_R16G16_SNORM:
+	case DXGI_FORMAT_R16G16_SINT:
+	case DXGI_FORMAT_R32_TYPELESS:
+	case DXGI_FORMAT_D32_FLOAT:
+	case DXGI_FORMAT_R32_FLOAT:
+	case DXGI_FORMAT_R32_UINT:
+	case DXGI_FORMAT_R32_SINT:
+	case DXGI_FORMAT_R24G8_TYPELESS:
+	case DXGI_FORMAT_D24_UNORM_S8_UINT:
+	case DXGI_FORMAT_R24_UNORM_X8_TYPELESS:
+	case DXGI_FORMAT_X24_TYPELESS_G8_UINT:
+	case DXGI_FORMAT_R9G9B9E5_SHAREDEXP:
+	case DXGI_FORMAT_R8G8_B8G8_UNORM:
+	case DXGI_FORMAT_G8R8_G8B8_UNORM:
+	case DXGI_FORMAT_B8G8R8A8_UNORM:
+	case DXGI_FORMAT_B8G8R8X8_UNORM:
+	case DXGI_FORMAT_R10G10B10_XR_BIAS_A2_UNORM:
+	case DXGI_FORMAT_B8G8R8A8_TYPELESS:
+	case DXGI_FORMAT_B8G8R8A8_UNORM_SRGB:
+	case DXGI_FORMAT_B8G8R8X8_TYPELESS:
+	case DXGI_FORMAT_B8G8R8X8_UNORM_SRGB:
+	case DXGI_FORMAT_AYUV:
+	case DXGI_FORMAT_Y410:
+	case DXGI_FORMAT_YUY2:
+		return 32;
+
+	case DXGI_FORMAT_P010:
+	case DXGI_FORMAT_P016:
+		return 24;
+
+	case DXGI_FORMAT_R8G8_TYPELESS:
+	case DXGI_FORMAT_R8G8_UNORM:
+	case DXGI_FORMAT_R8G8_UINT:
+	case DXGI_FORMAT_R8G8_SNORM:
+	case DXGI_FORMAT_R8G8_SINT:
+	case DXGI_FORMAT_R16_TYPELESS:
+	case DXGI_FORMAT_R16_FLOAT:
+	case DXGI_FORMAT_D16_UNORM:
+	case DXGI_FORMAT_R16_UNORM:
+	case DXGI_FORMAT_R16_UINT:
+	case DXGI_FORMAT_R16_SNORM:
+	case DXGI_FORMAT_R16_SINT:
+	case DXGI_FORMAT_B5G6R5_UNORM:
+	case DXGI_FORMAT_B5G5R5A1_UNORM:
+	case DXGI_FORMAT_A8P8:
+	case DXGI_FORMAT_B4G4R4A4_UNORM:
+		return 16;
+
+	case DXGI_FORMAT_NV12:
+	case DXGI_FORMAT_420_OPAQUE:
+	case DXGI_FORMAT_NV11:
+		return 12;
+
+	case DXGI_FORMAT_R8_TYPELESS:
+	case DXGI_FORMAT_R8_UNORM:
+	case DXGI_FORMAT_R8_UINT:
+	case DXGI_FORMAT_R8_SNORM:
+	case DXGI_FORMAT_R8_SINT:
+	case DXGI_FORMAT_A8_UNORM:
+	case DXGI_FORMAT_AI44:
+	case DXGI_FORMAT_IA44:
+	case DXGI_FORMAT_P8:
+		return 8;
+
+	case DXGI_FORMAT_R1_UNORM:
+		return 1;
+
+	case DXGI_FORMAT_BC1_TYPELESS:
+	case DXGI_FORMAT_BC1_UNORM:
+	case DXGI_FORMAT_BC1_UNORM_SRGB:
+	case DXGI_FORMAT_BC4_TYPELESS:
+	case DXGI_FORMAT_BC4_UNORM:
+	case DXGI_FORMAT_BC4_SNORM:
+		return 4;
+
+	case DXGI_FORMAT_BC2_TYPELESS:
+	case DXGI_FORMAT_BC2_UNORM:
+	case DXGI_FORMAT_BC2_UNORM_SRGB:
+	case DXGI_FORMAT_BC3_TYPELESS:
+	case DXGI_FORMAT_BC3_UNORM:
+	case DXGI_FORMAT_BC3_UNORM_SRGB:
+	case DXGI_FORMAT_BC5_TYPELESS:
+	case DXGI_FORMAT_BC5_UNORM:
+	case DXGI_FORMAT_BC5_SNORM:
+	case DXGI_FORMAT_BC6H_TYPELESS:
+	case DXGI_FORMAT_BC6H_UF16:
+	case DXGI_FORMAT_BC6H_SF16:
+	case DXGI_FORMAT_BC7_TYPELESS:
+	case DXGI_FORMAT_BC7_UNORM:
+	case DXGI_FORMAT_BC7_UNORM_SRGB:
+		return 8;
+
+	default:
+		return 0;
+	}
+}
+
+bool DDSFormat::GetSurfaceInfo(std::uint64_t width, std::uint64_t height, DXGI_FORMAT fmt,
+	std::uint64_t* outNumBytes, std::uint64_t* outRowBytes, std::uint64_t* outNumRows)
+{
+	std::uint64_t numBytes = 0;
+	std::uint64_t rowBytes = 0;
+	std::uint64_t numRows = 0;
+
+	bool bc = false;
+	bool packed = false;
+	bool planar = false;
+	std::uint64_t bpe = 0;
+	switch (fmt)
+	{
+	case DXGI_FORMAT_BC1_TYPELESS:
+	case DXGI_FORMAT_BC1_UNORM:
+	case DXGI_FORMAT_BC1_UNORM_SRGB:
+	case DXGI_FORMAT_BC4_TYPELESS:
+	case DXGI_FORMAT_BC4_UNORM:
+	case DXGI_FORMAT_BC4_SNORM:
+		bc=true;
+		bpe = 8;
+		break;
+
+	case DXGI_FORMAT_BC2_TYPELESS:
+	case DXGI_FORMAT_BC2_UNORM:
+	case DXGI_FORMAT_BC2_UNORM_SRGB:
+	case DXGI_FORMAT_BC3_TYPELESS:
+	case DXGI_FORMAT_BC3_UNORM:
+	case DXGI_FORMAT_BC3_UNORM_SRGB:
+	case DXGI_FORMAT_BC5_TYPELESS:
+	case DXGI_FORMAT_BC5_UNORM:
+	case DXGI_FORMAT_BC5_SNORM:
+	case DXGI_FORMAT_BC6H_TYPELESS:
+	case DXGI_FORMAT_BC6H_UF16:
+	case DXGI_FORMAT_BC6H_SF16:
+	case DXGI_FORMAT_BC7_TYPELESS:
+	case DXGI_FORMAT_BC7_UNORM:
+	case DXGI_FORMAT_BC7_UNORM_SRGB:
+		bc = true;
+		bpe = 16;
+		break;
+
+	case DXGI_FORMAT_R8G8_B8G8_UNORM:
+	case DXGI_FORMAT_G8R8_G8B8_UNORM:
+	case DXGI_FORMAT_YUY2:
+		packed = true;
+		bpe = 4;
+		break;
+
+	case DXGI_FORMAT_Y210:
+	case DXGI_FORMAT_Y216:
+		packed = true;
+		bpe = 8;
+		break;
+
+	case DXGI_FORMAT_NV12:
+	case DXGI_FORMAT_420_OPAQUE:
+		planar = true;
+		bpe = 2;
+		break;
+
+	case DXGI_FORMAT_P010:
+	case DXGI_FORMAT_P016:
+		planar = true;
+		bpe = 4;
+		break;
+
+	default:
+		break;
+	}
+
+	if (bc)
+	{
+		std::uint64_t numBlocksWide = 0;
+		if (width > 0)
+		{
+			numBlocksWide = std::max<std::uint64_t>( 1, (width + 3) / 4 );
+		}
+		std::uint64_t numBlocksHigh = 0;
+		if (height > 0)
+		{
+			numBlocksHigh = std::max<std::uint64_t>( 1, (height + 3) / 4 );
+		}
+		rowBytes = numBlocksWide * bpe;
+		numRows = numBlocksHigh;
+		numBytes = rowBytes * numBlocksHigh;
+	}
+	else if (packed)
+	{
+		rowBytes = ( ( width + 1 ) >> 1 ) * bpe;
+		numRows = height;
+		numBytes = rowBytes * height;
+	}
+	else if ( fmt == DXGI_FORMAT_NV11 )
+	{
+		rowBytes = ( ( width + 3 ) >> 2 ) * 4;
+		numRows = height * 2; // Direct3D makes this simplifying assumption, although it is larger than the 4:1:1 data
+		numBytes = rowBytes * numRows;
+	}
+	else if (planar)
+	{
+		rowBytes = ( ( width + 1 ) >> 1 ) * bpe;
+		numBytes = ( rowBytes * height ) + ( ( rowBytes * height + 1 ) >> 1 );
+		numRows = height + ( ( height + 1 ) >> 1 );
+	}
+	else
+	{
+		const std::uint64_t bpp = BitsPerPixel( fmt );
+		if (bpp == 0)
+		{
+			return false;
+		}
+		rowBytes = ( width * bpp + 7 ) / 8; // round up to nearest byte
+		numRows = height;
+		numBytes = rowBytes * height;
+	}
+
+	if (outNumBytes)
+	{
+		*outNumBytes = numBytes;
+	}
+	if (outRowBytes)
+	{
+		*outRowBytes = rowBytes;
+	}
+	if (outNumRows)
+	{
+		*outNumRows = numRows;
+	}
+
+	return true;
+}
+
+#define ISBITMASK( r,g,b,a ) ( ddpf.RBitMask == r && ddpf.GBitMask == g && ddpf.BBitMask == b && ddpf.ABitMask == a )
+
+DXGI_FORMAT DDSFormat::GetDXGIFormat(const DDS_PIXELFORMAT& ddpf)
+{
+	if (ddpf.flags & DDS_RGB)
+	{
+		// Note that sRGB formats are written using the "DX10" extended header
+
+		switch (ddpf.RGBBitCount)
+		{
+		case 32:
+			if (ISBITMASK(0x000000ff,0x0000ff00,0x00ff0000,0xff000000))
+			{
+				return DXGI_FORMAT_R8G8B8A8_UNORM;
+			}
+
+			if (ISBITMASK(0x00ff0000,0x0000ff00,0x000000ff,0xff000000))
+			{
+				return DXGI_FORMAT_B8G8R8A8_UNORM;
+			}
+
+			if (ISBITMASK(0x00ff0000,0x0000ff00,0x000000ff,0x00000000))
+			{
+				return DXGI_FORMAT_B8G8R8X8_UNORM;
+			}
+
+			// No DXGI format maps to ISBITMASK(0x000000ff,0x0000ff00,0x00ff0000,0x00000000) aka D3DFMT_X8B8G8R8
+
+			// Note that many common DDS reader/writers (including D3DX) swap the
+			// the RED/BLUE masks for 10:10:10:2 formats. We assume
+			// below that the 'backwards' header mask is being used since it is most
+			// likely written by D3DX. The more robust solution is to use the 'DX10'
+			// header extension and specify the DXGI_FORMAT_R10G10B10A2_UNORM format directly
+
+			// For 'correct' writers, this should be 0x000003ff,0x000ffc00,0x3ff00000 for RGB data
+			if (ISBITMASK(0x3ff00000,0x000ffc00,0x000003ff,0xc0000000))
+			{
+				return DXGI_FORMAT_R10G10B10A2_UNORM;
+			}
+
+			// No DXGI format maps to ISBITMASK(0x000003ff,0x000ffc00,0x3ff00000,0xc0000000) aka D3DFMT_A2R10G10B10
+
+			if (ISBITMASK(0x0000ffff,0xffff0000,0x00000000,0x00000000))
+			{
+				return DXGI_FORMAT_R16G16_UNORM;
+			}
+
+			if (ISBITMASK(0xffffffff,0x00000000,0x00000000,0x00000000))
+			{
+				// Only 32-bit color channel format in D3D9 was R32F
+				return DXGI_FORMAT_R32_FLOAT; // D3DX writes this out as a FourCC of 114
+			}
+			break;
+
+		case 24:
+			// No 24bpp DXGI formats aka D3DFMT_R8G8B8
+			break;
+
+		case 16:
+			if (ISBITMASK(0x7c00,0x03e0,0x001f,0x8000))
+			{
+				return DXGI_FORMAT_B5G5R5A1_UNORM;
+			}
+			if (ISBITMASK(0xf800,0x07e0,0x001f,0x0000))
+			{
+				return DXGI_FORMAT_B5G6R5_UNORM;
+			}
+
+			// No DXGI format maps to ISBITMASK(0x7c00,0x03e0,0x001f,0x0000) aka D3DFMT_X1R5G5B5
+
+			if (ISBITMASK(0x0f00,0x00f0,0x000f,0xf000))
+			{
+				return DXGI_FORMAT_B4G4R4A4_UNORM;
+			}
+
+			// No DXGI format maps to ISBITMASK(0x0f00,0x00f0,0x000f,0x0000) aka D3DFMT_X4R4G4B4
+
+			// No 3:3:2, 3:3:2:8, or paletted DXGI formats aka D3DFMT_A8R3G3B2, D3DFMT_R3G3B2, D3DFMT_P8, D3DFMT_A8P8, etc.
+			break;
+		}
+	}
+	else if (ddpf.flags & DDS_LUMINANCE)
+	{
+		if (8 == ddpf.RGBBitCount)
+		{
+			if (ISBITMASK(0x000000ff,0x00000000,0x00000000,0x00000000))
+			{
+				return DXGI_FORMAT_R8_UNORM; // D3DX10/11 writes this out as DX10 extension
+			}
+
+			// No DXGI format maps to ISBITMASK(0x0f,0x00,0x00,0xf0) aka D3DFMT_A4L4
+		}
+
+		if (16 == ddpf.RGBBitCount)
+		{
+			if (ISBITMASK(0x0000ffff,0x00000000,0x00000000,0x00000000))
+			{
+				return DXGI_FORMAT_R16_UNORM; // D3DX10/11 writes this out as DX10 extension
+			}
+			if (ISBITMASK(0x000000ff,0x00000000,0x00000000,0x0000ff00))
+			{
+				return DXGI_FORMAT_R8G8_UNORM; // D3DX10/11 writes this out as DX10 extension
+			}
+		}
+	}
+	else if (ddpf.flags & DDS_ALPHA)
+	{
+		if (8 == ddpf.RGBBitCount)
+		{
+			return DXGI_FORMAT_A8_UNORM;
+		}
+	}
+	else if (ddpf.flags & DDS_FOURCC)
+	{
+		if (MAKEFOURCC( 'D', 'X', 'T', '1' ) == ddpf.fourCC)
+		{
+			return DXGI_FORMAT_BC1_UNORM;
+		}
+		if (MAKEFOURCC( 'D', 'X', 'T', '3' ) == ddpf.fourCC)
+		{
+			return DXGI_FORMAT_BC2_UNORM;
+		}
+		if (MAKEFOURCC( 'D', 'X', 'T', '5' ) == ddpf.fourCC)
+		{
+			return DXGI_FORMAT_BC3_UNORM;
+		}
+
+		// While pre-multiplied alpha isn't directly supported by the DXGI formats,
+		// they are basically the same as these BC formats so they can be mapped
+		if (MAKEFOURCC( 'D', 'X', 'T', '2' ) == ddpf.fourCC)
+		{
+			return DXGI_FORMAT_BC2_UNORM;
+		}
+		if (MAKEFOURCC( 'D', 'X', 'T', '4' ) == ddpf.fourCC)
+		{
+			return DXGI_FORMAT_BC3_UNORM;
+		}
+
+		if (MAKEFOURCC( 'A', 'T', 'I', '1' ) == ddpf.fourCC)
+		{
+			return DXGI_FORMAT_BC4_UNORM;
+		}
+		if (MAKEFOURCC( 'B', 'C', '4', 'U' ) == ddpf.fourCC)
+		{
+			return DXGI_FORMAT_BC4_UNORM;
+		}
+		if (MAKEFOURCC( 'B', 'C', '4', 'S' ) == ddpf.fourCC)
+		{
+			return DXGI_FORMAT_BC4_SNORM;
+		}
+
+		if (MAKEFOURCC( 'A', 'T', 'I', '2' ) == ddpf.fourCC)
+		{
+			return DXGI_FORMAT_BC5_UNORM;
+		}
+		if (MAKEFOURCC( 'B', 'C', '5', 'U' ) == ddpf.fourCC)
+		{
+			return DXGI_FORMAT_BC5_UNORM;
+		}
+		if (MAKEFOURCC( 'B', 'C', '5', 'S' ) == ddpf.fourCC)
+		{
+			return DXGI_FORMAT_BC5_SNORM;
+		}
+
+		// BC6H and BC7 are written using the "DX10" extended header
+
+		if (MAKEFOURCC( 'R', 'G', 'B', 'G' ) == ddpf.fourCC)
+		{
+			return DXGI_FORMAT_R8G8_B8G8_UNORM;
+		}
+		if (MAKEFOURCC( 'G', 'R', 'G', 'B' ) == ddpf.fourCC)
+		{
+			return DXGI_FORMAT_G8R8_G8B8_UNORM;
+		}
+
+		if (MAKEFOURCC('Y','U','Y','2') == ddpf.fourCC)
+		{
+			return DXGI_FORMAT_YUY2;
+		}
+
+		// Check for D3DFORMAT enums being set here
+		switch( ddpf.fourCC )
+		{
+		case 36: // D3DFMT_A16B16G16R16
+			return DXGI_FORMAT_R16G16B16A16_UNORM;
+
+		case 110: // D3DFMT_Q16W16V16U16
+			return DXGI_FORMAT_R16G16B16A16_SNORM;
+
+		case 111: // D3DFMT_R16F
+			return DXGI_FORMAT_R16_FLOAT;
+
+		case 112: // D3DFMT_G16R16F
+			return DXGI_FORMAT_R16G16_FLOAT;
+
+		case 113: // D3DFMT_A16B16G16R16F
+			return DXGI_FORMAT_R16G16B16A16_FLOAT;
+
+		case 114: // D3DFMT_R32F
+			return DXGI_FORMAT_R32_FLOAT;
+
+		case 115: // D3DFMT_G32R32F
+			return DXGI_FORMAT_R32G32_FLOAT;
+
+		case 116: // D3DFMT_A32B32G32R32F
+			return DXGI_FORMAT_R32G32B32A32_FLOAT;
+		}
+	}
+
+	return DXGI_FORMAT_UNKNOWN;
+}
+
+DirectX::DDS_ALPHA_MODE DDSFormat::GetAlphaMode(const DDS_HEADER& header, const DDS_HEADER_DXT10* dx10)
+{
+	if(header.ddspf.flags & DDS_FOURCC)
+	{
+		if(dx10 != nullptr)
+		{
+			auto mode = static_cast<DirectX::DDS_ALPHA_MODE>(dx10->miscFlags2 & DDS_MISC_FLAGS2_ALPHA_MODE_MASK);
+			switch(mode)
+			{
+			case DirectX::DDS_ALPHA_MODE_STRAIGHT:
+			case DirectX::DDS_ALPHA_MODE_PREMULTIPLIED:
+			case DirectX::DDS_ALPHA_MODE_OPAQUE:
+			case DirectX::DDS_ALPHA_MODE_CUSTOM:
+				return mode;
+			default:
+				break;
+			}
+		}
+		else if((MAKEFOURCC('D', 'X', 'T', '2') == header.ddspf.fourCC) ||
+			(MAKEFOURCC('D', 'X', 'T', '4') == header.ddspf.fourCC))
+		{
+			return DirectX::DDS_ALPHA_MODE_PREMULTIPLIED;
+		}
+	}
+
+	return DirectX::DDS_ALPHA_MODE_UNKNOWN;
+}
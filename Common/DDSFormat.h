@@ -0,0 +1,351 @@
+//***************************************************************************************
+// DDSFormat.h
+//
+// Portable DDS parsing.  Reads the headers of a DDS file in memory and works out its
+// format, dimensions, mips, array size and where every subresource lies in the file.
+// Needs neither Direct3D nor any OS API, so the texture loaders and the offline tools
+// share one parser, and it can be fuzzed and benchmarked on any platform.
+//
+// Nothing read from the file is trusted: sizes are bounded by the Direct3D 12 limits,
+// the layout is computed in 64 bits and every subresource is checked to lie inside the
+// data, so a malformed or truncated file fails to parse instead of being read out of
+// bounds.
+//***************************************************************************************
+
+#ifndef DDSFORMAT_H
+#define DDSFORMAT_H
+
+#include <stdint.h>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#if defined(_WIN32)
+#include <dxgiformat.h>
+#else
+// The values of dxgiformat.h, which is only part of the Windows SDK.
+enum DXGI_FORMAT
+{
+	DXGI_FORMAT_UNKNOWN = 0,
+	DXGI_FORMAT_R32G32B32A32_TYPELESS = 1,
+	DXGI_FORMAT_R32G32B32A32_FLOAT = 2,
+	DXGI_FORMAT_R32G32B32A32_UINT = 3,
+	DXGI_FORMAT_R32G32B32A32_SINT = 4,
+	DXGI_FORMAT_R32G32B32_TYPELESS = 5,
+	DXGI_FORMAT_R32G32B32_FLOAT = 6,
+	DXGI_FORMAT_R32G32B32_UINT = 7,
+	DXGI_FORMAT_R32G32B32_SINT = 8,
+	DXGI_FORMAT_R16G16B16A16_TYPELESS = 9,
+	DXGI_FORMAT_R16G16B16A16_FLOAT = 10,
+	DXGI_FORMAT_R16G16B16A16_UNORM = 11,
+	DXGI_FORMAT_R16G16B16A16_UINT = 12,
+	DXGI_FORMAT_R16G16B16A16_SNORM = 13,
+	DXGI_FORMAT_R16G16B16A16_SINT = 14,
+	DXGI_FORMAT_R32G32_TYPELESS = 15,
+	DXGI_FORMAT_R32G32_FLOAT = 16,
+	DXGI_FORMAT_R32G32_UINT = 17,
+	DXGI_FORMAT_R32G32_SINT = 18,
+	DXGI_FORMAT_R32G8X24_TYPELESS = 19,
+	DXGI_FORMAT_D32_FLOAT_S8X24_UINT = 20,
+	DXGI_FORMAT_R32_FLOAT_X8X24_TYPELESS = 21,
+	DXGI_FORMAT_X32_TYPELESS_G8X24_UINT = 22,
+	DXGI_FORMAT_R10G10B10A2_TYPELESS = 23,
+	DXGI_FORMAT_R10G10B10A2_UNORM = 24,
+	DXGI_FORMAT_R10G10B10A2_UINT = 25,
+	DXGI_FORMAT_R11G11B10_FLOAT = 26,
+	DXGI_FORMAT_R8G8B8A8_TYPELESS = 27,
+	DXGI_FORMAT_R8G8B8A8_UNORM = 28,
+	DXGI_FORMAT_R8G8B8A8_UNORM_SRGB = 29,
+	DXGI_FORMAT_R8G8B8A8_UINT = 30,
+	DXGI_FORMAT_R8G8B8A8_SNORM = 31,
+	DXGI_FORMAT_R8G8B8A8_SINT = 32,
+	DXGI_FORMAT_R16G16_TYPELESS = 33,
+	DXGI_FORMAT_R16G16_FLOAT = 34,
+	DXGI_FORMAT_R16G16_UNORM = 35,
+	DXGI_FORMAT_R16G16_UINT = 36,
+	DXGI_FORMAT_R16G16_SNORM = 37,
+	DXGI_FORMAT_R16G16_SINT = 38,
+	DXGI_FORMAT_R32_TYPELESS = 39,
+	DXGI_FORMAT_D32_FLOAT = 40,
+	DXGI_FORMAT_R32_FLOAT = 41,
+	DXGI_FORMAT_R32_UINT = 42,
+	DXGI_FORMAT_R32_SINT = 43,
+	DXGI_FORMAT_R24G8_TYPELESS = 44,
+	DXGI_FORMAT_D24_UNORM_S8_UINT = 45,
+	DXGI_FORMAT_R24_UNORM_X8_TYPELESS = 46,
+	DXGI_FORMAT_X24_TYPELESS_G8_UINT = 47,
+	DXGI_FORMAT_R8G8_TYPELESS = 48,
+	DXGI_FORMAT_R8G8_UNORM = 49,
+	DXGI_FORMAT_R8G8_UINT = 50,
+	DXGI_FORMAT_R8G8_SNORM = 51,
+	DXGI_FORMAT_R8G8_SINT = 52,
+	DXGI_FORMAT_R16_TYPELESS = 53,
+	DXGI_FORMAT_R16_FLOAT = 54,
+	DXGI_FORMAT_D16_UNORM = 55,
+	DXGI_FORMAT_R16_UNORM = 56,
+	DXGI_FORMAT_R16_UINT = 57,
+	DXGI_FORMAT_R16_SNORM = 58,
+	DXGI_FORMAT_R16_SINT = 59,
+	DXGI_FORMAT_R8_TYPELESS = 60,
+	DXGI_FORMAT_R8_UNORM = 61,
+	DXGI_FORMAT_R8_UINT = 62,
+	DXGI_FORMAT_R8_SNORM = 63,
+	DXGI_FORMAT_R8_SINT = 64,
+	DXGI_FORMAT_A8_UNORM = 65,
+	DXGI_FORMAT_R1_UNORM = 66,
+	DXGI_FORMAT_R9G9B9E5_SHAREDEXP = 67,
+	DXGI_FORMAT_R8G8_B8G8_UNORM = 68,
+	DXGI_FORMAT_G8R8_G8B8_UNORM = 69,
+	DXGI_FORMAT_BC1_TYPELESS = 70,
+	DXGI_FORMAT_BC1_UNORM = 71,
+	DXGI_FORMAT_BC1_UNORM_SRGB = 72,
+	DXGI_FORMAT_BC2_TYPELESS = 73,
+	DXGI_FORMAT_BC2_UNORM = 74,
+	DXGI_FORMAT_BC2_UNORM_SRGB = 75,
+	DXGI_FORMAT_BC3_TYPELESS = 76,
+	DXGI_FORMAT_BC3_UNORM = 77,
+	DXGI_FORMAT_BC3_UNORM_SRGB = 78,
+	DXGI_FORMAT_BC4_TYPELESS = 79,
+	DXGI_FORMAT_BC4_UNORM = 80,
+	DXGI_FORMAT_BC4_SNORM = 81,
+	DXGI_FORMAT_BC5_TYPELESS = 82,
+	DXGI_FORMAT_BC5_UNORM = 83,
+	DXGI_FORMAT_BC5_SNORM = 84,
+	DXGI_FORMAT_B5G6R5_UNORM = 85,
+	DXGI_FORMAT_B5G5R5A1_UNORM = 86,
+	DXGI_FORMAT_B8G8R8A8_UNORM = 87,
+	DXGI_FORMAT_B8G8R8X8_UNORM = 88,
+	DXGI_FORMAT_R10G10B10_XR_BIAS_A2_UNORM = 89,
+	DXGI_FORMAT_B8G8R8A8_TYPELESS = 90,
+	DXGI_FORMAT_B8G8R8A8_UNORM_SRGB = 91,
+	DXGI_FORMAT_B8G8R8X8_TYPELESS = 92,
+	DXGI_FORMAT_B8G8R8X8_UNORM_SRGB = 93,
+	DXGI_FORMAT_BC6H_TYPELESS = 94,
+	DXGI_FORMAT_BC6H_UF16 = 95,
+	DXGI_FORMAT_BC6H_SF16 = 96,
+	DXGI_FORMAT_BC7_TYPELESS = 97,
+	DXGI_FORMAT_BC7_UNORM = 98,
+	DXGI_FORMAT_BC7_UNORM_SRGB = 99,
+	DXGI_FORMAT_AYUV = 100,
+	DXGI_FORMAT_Y410 = 101,
+	DXGI_FORMAT_Y416 = 102,
+	DXGI_FORMAT_NV12 = 103,
+	DXGI_FORMAT_P010 = 104,
+	DXGI_FORMAT_P016 = 105,
+	DXGI_FORMAT_420_OPAQUE = 106,
+	DXGI_FORMAT_YUY2 = 107,
+	DXGI_FORMAT_Y210 = 108,
+	DXGI_FORMAT_Y216 = 109,
+	DXGI_FORMAT_NV11 = 110,
+	DXGI_FORMAT_AI44 = 111,
+	DXGI_FORMAT_IA44 = 112,
+	DXGI_FORMAT_P8 = 113,
+	DXGI_FORMAT_A8P8 = 114,
+	DXGI_FORMAT_B4G4R4A4_UNORM = 115,
+	DXGI_FORMAT_P208 = 130,
+	DXGI_FORMAT_V208 = 131,
+	DXGI_FORMAT_V408 = 132,
+	DXGI_FORMAT_FORCE_UINT = 0xffffffff
+};
+#endif
+
+#ifndef MAKEFOURCC
+	#define MAKEFOURCC(ch0, ch1, ch2, ch3)                              \
+				((uint32_t)(uint8_t)(ch0) | ((uint32_t)(uint8_t)(ch1) << 8) |       \
+				((uint32_t)(uint8_t)(ch2) << 16) | ((uint32_t)(uint8_t)(ch3) << 24 ))
+#endif /* defined(MAKEFOURCC) */
+
+//--------------------------------------------------------------------------------------
+// DDS file structure definitions
+//
+// See DDS.h in the 'Texconv' sample and the 'DirectXTex' library
+//--------------------------------------------------------------------------------------
+#pragma pack(push,1)
+
+const uint32_t DDS_MAGIC = 0x20534444; // "DDS "
+
+struct DDS_PIXELFORMAT
+{
+	uint32_t    size;
+	uint32_t    flags;
+	uint32_t    fourCC;
+	uint32_t    RGBBitCount;
+	uint32_t    RBitMask;
+	uint32_t    GBitMask;
+	uint32_t    BBitMask;
+	uint32_t    ABitMask;
+};
+
+#define DDS_FOURCC      0x00000004  // DDPF_FOURCC
+#define DDS_RGB         0x00000040  // DDPF_RGB
+#define DDS_LUMINANCE   0x00020000  // DDPF_LUMINANCE
+#define DDS_ALPHA       0x00000002  // DDPF_ALPHA
+
+#define DDS_HEADER_FLAGS_TEXTURE        0x00001007  // DDSD_CAPS | DDSD_HEIGHT | DDSD_WIDTH | DDSD_PIXELFORMAT
+#define DDS_HEADER_FLAGS_MIPMAP         0x00020000  // DDSD_MIPMAPCOUNT
+#define DDS_HEADER_FLAGS_VOLUME         0x00800000  // DDSD_DEPTH
+#define DDS_HEADER_FLAGS_PITCH          0x00000008  // DDSD_PITCH
+#define DDS_HEADER_FLAGS_LINEARSIZE     0x00080000  // DDSD_LINEARSIZE
+
+#define DDS_SURFACE_FLAGS_TEXTURE 0x00001000 // DDSCAPS_TEXTURE
+#define DDS_SURFACE_FLAGS_MIPMAP  0x00400008 // DDSCAPS_COMPLEX | DDSCAPS_MIPMAP
+
+#define DDS_HEIGHT 0x00000002 // DDSD_HEIGHT
+#define DDS_WIDTH  0x00000004 // DDSD_WIDTH
+
+#define DDS_CUBEMAP_POSITIVEX 0x00000600 // DDSCAPS2_CUBEMAP | DDSCAPS2_CUBEMAP_POSITIVEX
+#define DDS_CUBEMAP_NEGATIVEX 0x00000a00 // DDSCAPS2_CUBEMAP | DDSCAPS2_CUBEMAP_NEGATIVEX
+#define DDS_CUBEMAP_POSITIVEY 0x00001200 // DDSCAPS2_CUBEMAP | DDSCAPS2_CUBEMAP_POSITIVEY
+#define DDS_CUBEMAP_NEGATIVEY 0x00002200 // DDSCAPS2_CUBEMAP | DDSCAPS2_CUBEMAP_NEGATIVEY
+#define DDS_CUBEMAP_POSITIVEZ 0x00004200 // DDSCAPS2_CUBEMAP | DDSCAPS2_CUBEMAP_POSITIVEZ
+#define DDS_CUBEMAP_NEGATIVEZ 0x00008200 // DDSCAPS2_CUBEMAP | DDSCAPS2_CUBEMAP_NEGATIVEZ
+
+#define DDS_CUBEMAP_ALLFACES ( DDS_CUBEMAP_POSITIVEX | DDS_CUBEMAP_NEGATIVEX |\
+							   DDS_CUBEMAP_POSITIVEY | DDS_CUBEMAP_NEGATIVEY |\
+							   DDS_CUBEMAP_POSITIVEZ | DDS_CUBEMAP_NEGATIVEZ )
+
+#define DDS_CUBEMAP 0x00000200 // DDSCAPS2_CUBEMAP
+
+// DDS_HEADER_DXT10::resourceDimension, the D3D10/11 resource dimensions.
+#define DDS_DIMENSION_TEXTURE1D 2
+#define DDS_DIMENSION_TEXTURE2D 3
+#define DDS_DIMENSION_TEXTURE3D 4
+
+// DDS_HEADER_DXT10::miscFlag, D3D11_RESOURCE_MISC_TEXTURECUBE.
+#define DDS_RESOURCE_MISC_TEXTURECUBE 0x4
+
+enum DDS_MISC_FLAGS2
+{
+	DDS_MISC_FLAGS2_ALPHA_MODE_MASK = 0x7L,
+};
+
+struct DDS_HEADER
+{
+	uint32_t        size;
+	uint32_t        flags;
+	uint32_t        height;
+	uint32_t        width;
+	uint32_t        pitchOrLinearSize;
+	uint32_t        depth; // only if DDS_HEADER_FLAGS_VOLUME is set in flags
+	uint32_t        mipMapCount;
+	uint32_t        reserved1[11];
+	DDS_PIXELFORMAT ddspf;
+	uint32_t        caps;
+	uint32_t        caps2;
+	uint32_t        caps3;
+	uint32_t        caps4;
+	uint32_t        reserved2;
+};
+
+struct DDS_HEADER_DXT10
+{
+	DXGI_FORMAT     dxgiFormat;
+	uint32_t        resourceDimension;
+	uint32_t        miscFlag; // see D3D11_RESOURCE_MISC_FLAG
+	uint32_t        arraySize;
+	uint32_t        miscFlags2;
+};
+
+#pragma pack(pop)
+
+namespace DirectX
+{
+	enum DDS_ALPHA_MODE
+	{
+		DDS_ALPHA_MODE_UNKNOWN       = 0,
+		DDS_ALPHA_MODE_STRAIGHT      = 1,
+		DDS_ALPHA_MODE_PREMULTIPLIED = 2,
+		DDS_ALPHA_MODE_OPAQUE        = 3,
+		DDS_ALPHA_MODE_CUSTOM        = 4,
+	};
+}
+
+// The values match D3D12_RESOURCE_DIMENSION.
+enum class DDSDimension : std::uint32_t
+{
+	Unknown = 0,
+	Texture1D = 2,
+	Texture2D = 3,
+	Texture3D = 4
+};
+
+enum class DDSStatus
+{
+	Ok,
+	Truncated,     // The data ends before a header or subresource does.
+	InvalidData,   // The headers contradict themselves.
+	NotSupported   // A valid file Direct3D 12 cannot create a texture from.
+};
+
+// Where one mip of one array slice lies in the file.
+struct DDSSubresource
+{
+	std::uint64_t Offset = 0;     // From the start of the file.
+	std::uint64_t Size = 0;       // SliceBytes * Depth.
+	std::uint32_t Width = 0;
+	std::uint32_t Height = 0;
+	std::uint32_t Depth = 0;
+	std::uint64_t RowBytes = 0;
+	std::uint64_t NumRows = 0;
+	std::uint64_t SliceBytes = 0;
+};
+
+struct DDSInfo
+{
+	DXGI_FORMAT Format = DXGI_FORMAT_UNKNOWN;
+	DDSDimension Dimension = DDSDimension::Unknown;
+	std::uint32_t Width = 0;
+	std::uint32_t Height = 0;
+	std::uint32_t Depth = 0;
+	std::uint32_t MipCount = 0;
+
+	// Six per cube for cube maps.
+	std::uint32_t ArraySize = 0;
+	bool IsCubeMap = false;
+	DirectX::DDS_ALPHA_MODE AlphaMode = DirectX::DDS_ALPHA_MODE_UNKNOWN;
+
+	// Offset of the first subresource, after the headers.
+	std::uint32_t DataOffset = 0;
+
+	// In subresource index order: the mips of the first array slice, then those of the
+	// next one, and so on.
+	std::vector<DDSSubresource> Subresources;
+};
+
+class DDSFormat
+{
+public:
+	// The Direct3D 12 resource limits, which bound what a file may declare.
+	static const std::uint32_t MaxMipLevels = 15;
+	static const std::uint32_t MaxTexture1DSize = 16384;
+	static const std::uint32_t MaxTexture2DSize = 16384;
+	static const std::uint32_t MaxTextureCubeSize = 16384;
+	static const std::uint32_t MaxTexture3DSize = 2048;
+	static const std::uint32_t MaxArraySize = 2048;
+
+	// Parses and validates a whole DDS file.  info.Subresources keeps its capacity, so
+	// parsing many files into one DDSInfo does not allocate once it is large enough.
+	static DDSStatus Parse(const std::uint8_t* data, std::size_t size, DDSInfo& info);
+
+	static const char* StatusString(DDSStatus status);
+
+	// The DXGI format of a legacy (not "DX10") pixel format, DXGI_FORMAT_UNKNOWN if there
+	// is none.
+	static DXGI_FORMAT GetDXGIFormat(const DDS_PIXELFORMAT& ddpf);
+
+	// 0 for formats with no fixed size per pixel or that are not known.
+	static std::size_t BitsPerPixel(DXGI_FORMAT fmt);
+
+	// Sizes of one slice of a surface.  Returns false for formats of unknown size.
+	static bool GetSurfaceInfo(std::uint64_t width, std::uint64_t height, DXGI_FORMAT fmt,
+		std::uint64_t* outNumBytes, std::uint64_t* outRowBytes, std::uint64_t* outNumRows);
+
+	// The alpha mode of the DX10 header, or of the premultiplied legacy formats.  dx10
+	// is nullptr when the file has no DX10 header.
+	static DirectX::DDS_ALPHA_MODE GetAlphaMode(const DDS_HEADER& header, const DDS_HEADER_DXT10* dx10);
+
+	// Number of mips in a full chain down to 1x1x1.
+	static std::uint32_t CountMips(std::uint32_t width, std::uint32_t height, std::uint32_t depth);
+};
+
+#endif // DDSFORMAT_H
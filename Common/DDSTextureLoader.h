@@ -24,7 +24,10 @@
 
 #include <wrl.h>
 #include <d3d11_1.h>
+#include <vector>
 #include "d3dx12.h"
+#include "MappedFile.h"
+#include "DDSFormat.h"
 
 #pragma warning(push)
 #pragma warning(disable : 4005)
@@ -46,13 +49,20 @@
 
 namespace DirectX
 {
-    enum DDS_ALPHA_MODE
+    // A DDS texture parsed on the CPU, ready to create and upload.  The subresource
+    // data points into the memory the file was parsed from.
+    struct DDSTextureData12
     {
-        DDS_ALPHA_MODE_UNKNOWN       = 0,
-        DDS_ALPHA_MODE_STRAIGHT      = 1,
-        DDS_ALPHA_MODE_PREMULTIPLIED = 2,
-        DDS_ALPHA_MODE_OPAQUE        = 3,
-        DDS_ALPHA_MODE_CUSTOM        = 4,
+        D3D12_RESOURCE_DIMENSION Dimension = D3D12_RESOURCE_DIMENSION_UNKNOWN;
+        size_t Width = 0;
+        size_t Height = 0;
+        size_t Depth = 0;
+        size_t MipCount = 0;
+        size_t ArraySize = 0;
+        DXGI_FORMAT Format = DXGI_FORMAT_UNKNOWN;
+        bool IsCubeMap = false;
+        DDS_ALPHA_MODE AlphaMode = DDS_ALPHA_MODE_UNKNOWN;
+        std::vector<D3D12_SUBRESOURCE_DATA> Subresources;
     };
 
     // Standard version
@@ -92,6 +102,30 @@ namespace DirectX
 		                               _Out_opt_ DDS_ALPHA_MODE* alphaMode = nullptr
 		                               );
 
+	// The two halves of CreateDDSTextureFromFile12.  Loading maps and parses the file
+	// without a device, so it can run on any thread; the subresources point into
+	// ddsFile, which must stay open until the upload has been recorded.
+	HRESULT LoadDDSTextureDataFromFile12(_In_z_ const wchar_t* szFileName,
+		                                 MappedFile& ddsFile,
+		                                 DDSTextureData12& data,
+		                                 _In_ size_t maxsize = 0
+		                                 );
+
+	// Parses a DDS file already in memory, such as one kept mapped to load it again at
+	// another maxsize.  The subresources point into ddsData.
+	HRESULT ParseDDSTextureData12(_In_reads_bytes_(ddsDataSize) const uint8_t* ddsData,
+		                          _In_ size_t ddsDataSize,
+		                          DDSTextureData12& data,
+		                          _In_ size_t maxsize = 0
+		                          );
+
+	HRESULT CreateDDSTextureFromData12(_In_ ID3D12Device* device,
+		                               _In_ ID3D12GraphicsCommandList* cmdList,
+		                               const DDSTextureData12& data,
+		                               _Out_ Microsoft::WRL::ComPtr<ID3D12Resource>& texture,
+		                               _Out_ Microsoft::WRL::ComPtr<ID3D12Resource>& textureUploadHeap
+		                               );
+
     // Standard version with optional auto-gen mipmap support
     HRESULT CreateDDSTextureFromMemory( _In_ ID3D11Device* d3dDevice,
                                         _In_opt_ ID3D11DeviceContext* d3dContext,
@@ -0,0 +1,79 @@
+//***************************************************************************************
+// DescriptorAllocator.cpp
+//***************************************************************************************
+
+#include "DescriptorAllocator.h"
+#include <cassert>
+
+DescriptorAllocator::DescriptorAllocator(std::uint32_t capacity, std::uint32_t frameCount, std::uint32_t transientPerFrame)
+{
+	Reset(capacity, frameCount, transientPerFrame);
+}
+
+void DescriptorAllocator::Reset(std::uint32_t capacity, std::uint32_t frameCount, std::uint32_t transientPerFrame)
+{
+	mCapacity = capacity;
+	mFrameCount = frameCount;
+	mTransientPerFrame = transientPerFrame;
+
+	mFreeSlots = decltype(mFreeSlots)();
+	mAllocated.assign(capacity, false);
+	mAllocatedCount = 0;
+	mHighWater = 0;
+
+	mFrameStart = 0;
+	mTransientUsed = 0;
+}
+
+std::uint32_t DescriptorAllocator::Allocate()
+{
+	std::uint32_t slot;
+	if(!mFreeSlots.empty())
+	{
+		slot = mFreeSlots.top();
+		mFreeSlots.pop();
+	}
+	else if(mHighWater < mCapacity)
+		slot = mHighWater++;
+	else
+		return Invalid;
+
+	mAllocated[slot] = true;
+	++mAllocatedCount;
+	return slot;
+}
+
+void DescriptorAllocator::Free(std::uint32_t slot)
+{
+	assert(IsAllocated(slot));
+	if(!IsAllocated(slot))
+		return;
+
+	mAllocated[slot] = false;
+	--mAllocatedCount;
+	mFreeSlots.push(slot);
+}
+
+bool DescriptorAllocator::IsAllocated(std::uint32_t slot)const
+{
+	return slot < mCapacity && mAllocated[slot];
+}
+
+std::uint32_t DescriptorAllocator::BeginFrame(std::uint32_t frameIndex)
+{
+	assert(frameIndex < mFrameCount);
+
+	mFrameStart = frameIndex * GetRegionSize();
+	mTransientUsed = 0;
+	return mFrameStart;
+}
+
+std::uint32_t DescriptorAllocator::AllocateTransient(std::uint32_t count)
+{
+	if(count > mTransientPerFrame - mTransientUsed)
+		return Invalid;
+
+	const std::uint32_t slot = mFrameStart + mCapacity + mTransientUsed;
+	mTransientUsed += count;
+	return slot;
+}
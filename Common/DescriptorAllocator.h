@@ -0,0 +1,76 @@
+//***************************************************************************************
+// DescriptorAllocator.h
+//
+// Slot bookkeeping for a descriptor heap, with no Direct3D in it.
+//
+// Persistent views, such as one per texture, get a stable slot from a free list and
+// keep it until they are freed.  Their descriptors live in a CPU only staging heap, so
+// a view can be rewritten in place at any time.  Each frame resource owns one region of
+// the shader visible heap: at the start of a frame the staging slots are copied to the
+// front of the region, so slot s is found at the region start plus s, and the rest of
+// the region is a linear allocator for views that only live for the frame.  A region is
+// only reused once its frame resource is free, so nothing the GPU reads is overwritten.
+//***************************************************************************************
+
+#ifndef DESCRIPTORALLOCATOR_H
+#define DESCRIPTORALLOCATOR_H
+
+#include <cstdint>
+#include <functional>
+#include <queue>
+#include <vector>
+
+class DescriptorAllocator
+{
+public:
+	static const std::uint32_t Invalid = 0xffffffff;
+
+	DescriptorAllocator() = default;
+	DescriptorAllocator(std::uint32_t capacity, std::uint32_t frameCount, std::uint32_t transientPerFrame);
+
+	// Frees everything and sets the number of persistent slots, frame regions and
+	// transient slots in each region.
+	void Reset(std::uint32_t capacity, std::uint32_t frameCount, std::uint32_t transientPerFrame);
+
+	// The lowest free persistent slot, or Invalid if all are taken.
+	std::uint32_t Allocate();
+	void Free(std::uint32_t slot);
+	bool IsAllocated(std::uint32_t slot)const;
+
+	std::uint32_t GetCapacity()const { return mCapacity; }
+	std::uint32_t GetAllocatedCount()const { return mAllocatedCount; }
+
+	// One past the highest persistent slot ever allocated: the range each frame copies.
+	std::uint32_t GetHighWater()const { return mHighWater; }
+
+	// Slots in the shader visible heap: one region per frame resource.
+	std::uint32_t GetRegionSize()const { return mCapacity + mTransientPerFrame; }
+	std::uint32_t GetHeapSize()const { return GetRegionSize() * mFrameCount; }
+
+	// Starts a frame on the region of frameIndex, dropping its transient views, and
+	// returns the first heap slot of the region.  Call once the frame resource is free.
+	std::uint32_t BeginFrame(std::uint32_t frameIndex);
+	std::uint32_t GetFrameStart()const { return mFrameStart; }
+
+	// count contiguous heap slots in the current frame's region, valid until the region
+	// is begun again, or Invalid if the region is out of transient slots.
+	std::uint32_t AllocateTransient(std::uint32_t count = 1);
+	std::uint32_t GetTransientCount()const { return mTransientUsed; }
+
+private:
+	std::uint32_t mCapacity = 0;
+	std::uint32_t mFrameCount = 0;
+	std::uint32_t mTransientPerFrame = 0;
+
+	// Freed slots below the high water mark, lowest on top so the copied range stays
+	// as short as it can.
+	std::priority_queue<std::uint32_t, std::vector<std::uint32_t>, std::greater<std::uint32_t>> mFreeSlots;
+	std::vector<bool> mAllocated;
+	std::uint32_t mAllocatedCount = 0;
+	std::uint32_t mHighWater = 0;
+
+	std::uint32_t mFrameStart = 0;
+	std::uint32_t mTransientUsed = 0;
+};
+
+#endif // DESCRIPTORALLOCATOR_H
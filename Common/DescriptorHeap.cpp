@@ -0,0 +1,63 @@
+//***************************************************************************************
+// DescriptorHeap.cpp
+//***************************************************************************************
+
+#include "DescriptorHeap.h"
+
+void DescriptorHeap::Initialize(ID3D12Device* device, UINT capacity, UINT frameCount, UINT transientPerFrame)
+{
+	mDevice = device;
+	mDescriptorSize = device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+	mAllocator.Reset(capacity, frameCount, transientPerFrame);
+
+	D3D12_DESCRIPTOR_HEAP_DESC stagingDesc = {};
+	stagingDesc.NumDescriptors = capacity;
+	stagingDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
+	stagingDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_NONE;
+	ThrowIfFailed(device->CreateDescriptorHeap(&stagingDesc, IID_PPV_ARGS(&mStaging)));
+
+	D3D12_DESCRIPTOR_HEAP_DESC visibleDesc = {};
+	visibleDesc.NumDescriptors = mAllocator.GetHeapSize();
+	visibleDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
+	visibleDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
+	ThrowIfFailed(device->CreateDescriptorHeap(&visibleDesc, IID_PPV_ARGS(&mShaderVisible)));
+}
+
+D3D12_CPU_DESCRIPTOR_HANDLE DescriptorHeap::CpuHandle(UINT slot)const
+{
+	CD3DX12_CPU_DESCRIPTOR_HANDLE handle(mStaging->GetCPUDescriptorHandleForHeapStart());
+	handle.Offset(slot, mDescriptorSize);
+	return handle;
+}
+
+void DescriptorHeap::BeginFrame(UINT frameIndex)
+{
+	const UINT start = mAllocator.BeginFrame(frameIndex);
+
+	// Freed slots below the high water mark are copied too; nothing references them.
+	if(mAllocator.GetHighWater() > 0)
+	{
+		CD3DX12_CPU_DESCRIPTOR_HANDLE dest(mShaderVisible->GetCPUDescriptorHandleForHeapStart());
+		dest.Offset(start, mDescriptorSize);
+		mDevice->CopyDescriptorsSimple(mAllocator.GetHighWater(), dest, mStaging->GetCPUDescriptorHandleForHeapStart(),
+			D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+	}
+}
+
+D3D12_GPU_DESCRIPTOR_HANDLE DescriptorHeap::FrameStart()const
+{
+	CD3DX12_GPU_DESCRIPTOR_HANDLE handle(mShaderVisible->GetGPUDescriptorHandleForHeapStart());
+	handle.Offset(mAllocator.GetFrameStart(), mDescriptorSize);
+	return handle;
+}
+
+bool DescriptorHeap::AllocateTransient(UINT count, D3D12_CPU_DESCRIPTOR_HANDLE& cpu, D3D12_GPU_DESCRIPTOR_HANDLE& gpu)
+{
+	const UINT slot = mAllocator.AllocateTransient(count);
+	if(slot == DescriptorAllocator::Invalid)
+		return false;
+
+	cpu = CD3DX12_CPU_DESCRIPTOR_HANDLE(mShaderVisible->GetCPUDescriptorHandleForHeapStart(), slot, mDescriptorSize);
+	gpu = CD3DX12_GPU_DESCRIPTOR_HANDLE(mShaderVisible->GetGPUDescriptorHandleForHeapStart(), slot, mDescriptorSize);
+	return true;
+}
@@ -0,0 +1,53 @@
+//***************************************************************************************
+// DescriptorHeap.h
+//
+// The CBV/SRV/UAV heaps of an app: a CPU only staging heap holding the persistent views
+// in stable slots, and a shader visible heap with a region per frame resource that the
+// staging slots are copied into each frame.  See DescriptorAllocator.h for the layout.
+//***************************************************************************************
+
+#ifndef DESCRIPTORHEAP_H
+#define DESCRIPTORHEAP_H
+
+#include "d3dUtil.h"
+#include "DescriptorAllocator.h"
+
+class DescriptorHeap
+{
+public:
+	DescriptorHeap() = default;
+	DescriptorHeap(const DescriptorHeap& rhs) = delete;
+	DescriptorHeap& operator=(const DescriptorHeap& rhs) = delete;
+
+	void Initialize(ID3D12Device* device, UINT capacity, UINT frameCount, UINT transientPerFrame);
+
+	// A stable slot for a persistent view, or DescriptorAllocator::Invalid if the heap is
+	// full.  Write the view at CpuHandle(slot); shaders find it at slot from FrameStart.
+	UINT Allocate() { return mAllocator.Allocate(); }
+	void Free(UINT slot) { mAllocator.Free(slot); }
+	D3D12_CPU_DESCRIPTOR_HANDLE CpuHandle(UINT slot)const;
+
+	// Copies the persistent views into the region of frameIndex.  Call once the frame
+	// resource is free and the views for the frame are written.
+	void BeginFrame(UINT frameIndex);
+
+	// Where the current frame's region starts; persistent slot s is at FrameStart + s.
+	D3D12_GPU_DESCRIPTOR_HANDLE FrameStart()const;
+
+	// count contiguous views for the current frame only, written through cpu and read
+	// through gpu.  Returns false if the frame is out of transient slots.
+	bool AllocateTransient(UINT count, D3D12_CPU_DESCRIPTOR_HANDLE& cpu, D3D12_GPU_DESCRIPTOR_HANDLE& gpu);
+
+	ID3D12DescriptorHeap* ShaderVisibleHeap()const { return mShaderVisible.Get(); }
+	const DescriptorAllocator& GetAllocator()const { return mAllocator; }
+
+private:
+	Microsoft::WRL::ComPtr<ID3D12Device> mDevice;
+	Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> mStaging;
+	Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> mShaderVisible;
+	UINT mDescriptorSize = 0;
+
+	DescriptorAllocator mAllocator;
+};
+
+#endif // DESCRIPTORHEAP_H
@@ -0,0 +1,39 @@
+//***************************************************************************************
+// FileWatcher.cpp
+//***************************************************************************************
+
+#include "FileWatcher.h"
+#include "MappedFile.h"
+
+void FileWatcher::Watch(const std::string& filename)
+{
+	WatchedFile file;
+	file.Filename = filename;
+	GetFileWriteTime(filename, file.ReportedTime);
+	file.LastSeenTime = file.ReportedTime;
+
+	mFiles.push_back(file);
+}
+
+std::vector<std::string> FileWatcher::Poll()
+{
+	std::vector<std::string> changed;
+
+	for(auto& file : mFiles)
+	{
+		// A missing file (e.g. while an editor replaces it) is not a change.
+		std::uint64_t writeTime = 0;
+		if(!GetFileWriteTime(file.Filename, writeTime))
+			continue;
+
+		if(writeTime != file.ReportedTime && writeTime == file.LastSeenTime)
+		{
+			file.ReportedTime = writeTime;
+			changed.push_back(file.Filename);
+		}
+
+		file.LastSeenTime = writeTime;
+	}
+
+	return changed;
+}
@@ -0,0 +1,37 @@
+//***************************************************************************************
+// FileWatcher.h
+//
+// Polls the write times of a set of files and reports the ones that changed.  A change
+// is only reported once the write time has been stable for one poll, so a file that
+// an editor is still saving is not picked up half written.
+//***************************************************************************************
+
+#ifndef FILEWATCHER_H
+#define FILEWATCHER_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class FileWatcher
+{
+public:
+	// Starts watching a file.  Its current write time is the baseline, so only later
+	// changes are reported.
+	void Watch(const std::string& filename);
+
+	// Returns the files whose changes settled since the last call.
+	std::vector<std::string> Poll();
+
+private:
+	struct WatchedFile
+	{
+		std::string Filename;
+		std::uint64_t ReportedTime = 0;
+		std::uint64_t LastSeenTime = 0;
+	};
+
+	std::vector<WatchedFile> mFiles;
+};
+
+#endif // FILEWATCHER_H
@@ -0,0 +1,198 @@
+//***************************************************************************************
+// FramePacer.cpp
+//***************************************************************************************
+
+#include "FramePacer.h"
+
+#if defined(_WIN32)
+#include <windows.h>
+#pragma comment(lib, "winmm.lib")
+#else
+#include <chrono>
+#include <thread>
+#endif
+
+namespace
+{
+	// Sleeps shorter than this are not worth the risk of waking up late.
+	const double gMinSleep = 0.001;
+
+	// How fast the oversleep estimate fades, per sleep.
+	const double gOversleepDecay = 0.98;
+
+	// Frames per frames-in-flight decision, and the share of them that may miss the
+	// target before another frame in flight is allowed.
+	const std::uint32_t gAdaptWindow = 60;
+	const std::uint32_t gMissDivisor = 20;
+
+	// Windows to wait before trying one frame fewer again after that missed.
+	const int gHoldWindows = 8;
+
+	const float gLatencySmoothing = 0.1f;
+
+	class SystemClock : public FramePacer::Clock
+	{
+	public:
+#if defined(_WIN32)
+		SystemClock()
+		{
+			LARGE_INTEGER frequency;
+			QueryPerformanceFrequency(&frequency);
+			mSecondsPerCount = 1.0 / (double)frequency.QuadPart;
+
+			// Millisecond sleep resolution instead of the default scheduler tick.
+			timeBeginPeriod(1);
+		}
+
+		~SystemClock()
+		{
+			timeEndPeriod(1);
+		}
+
+		virtual double Now()override
+		{
+			LARGE_INTEGER count;
+			QueryPerformanceCounter(&count);
+			return (double)count.QuadPart * mSecondsPerCount;
+		}
+
+		virtual void Sleep(double seconds)override
+		{
+			::Sleep((DWORD)(seconds * 1000.0));
+		}
+
+	private:
+		double mSecondsPerCount = 0.0;
+#else
+		virtual double Now()override
+		{
+			return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+		}
+
+		virtual void Sleep(double seconds)override
+		{
+			std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+		}
+#endif
+	};
+}
+
+FramePacer::FramePacer(Clock* clock)
+{
+	if(clock == nullptr)
+	{
+		mOwnedClock = new SystemClock();
+		clock = mOwnedClock;
+	}
+	mClock = clock;
+}
+
+FramePacer::~FramePacer()
+{
+	delete mOwnedClock;
+}
+
+void FramePacer::SetTargetFps(float fps)
+{
+	mTargetFps = fps > 0.0f ? fps : 0.0f;
+	mNextDeadline = -1.0;
+	mFramesInFlight = mMaxFramesInFlight;
+	mHoldWindows = 0;
+	mWindowFrames = 0;
+	mWindowMisses = 0;
+}
+
+void FramePacer::SetMaxFramesInFlight(int count)
+{
+	mMaxFramesInFlight = count > 1 ? count : 1;
+	mFramesInFlight = mMaxFramesInFlight;
+}
+
+void FramePacer::WaitForNextFrame()
+{
+	if(mTargetFps <= 0.0f)
+	{
+		mFramesInFlight = mMaxFramesInFlight;
+		return;
+	}
+
+	const double period = 1.0 / mTargetFps;
+	const double now = mClock->Now();
+
+	if(mNextDeadline < 0.0)
+		mNextDeadline = now;
+	mNextDeadline += period;
+
+	// The frame took longer than its slot.  Start the next one right away instead of
+	// rushing later frames to catch up.
+	if(now > mNextDeadline)
+	{
+		++mMissedFrames;
+		mNextDeadline = now;
+		AdaptFramesInFlight(true);
+		return;
+	}
+
+	for(;;)
+	{
+		const double before = mClock->Now();
+		const double sleepFor = mNextDeadline - before - mSpinThreshold;
+		if(sleepFor < gMinSleep)
+			break;
+
+		mClock->Sleep(sleepFor);
+
+		// Track how late the sleeps wake up and stop sleeping that much earlier.
+		const double oversleep = mClock->Now() - before - sleepFor;
+		mOversleep *= gOversleepDecay;
+		if(oversleep > mOversleep)
+			mOversleep = oversleep;
+		mSpinThreshold = mOversleep + gMinSleep * 0.5;
+	}
+
+	while(mClock->Now() < mNextDeadline)
+	{
+	}
+
+	AdaptFramesInFlight(false);
+}
+
+void FramePacer::AdaptFramesInFlight(bool missed)
+{
+	++mWindowFrames;
+	if(missed)
+		++mWindowMisses;
+
+	if(mWindowFrames < gAdaptWindow)
+		return;
+
+	if(mWindowMisses * gMissDivisor > mWindowFrames)
+	{
+		// Missing the target: let the CPU run further ahead to absorb the stalls, and
+		// stay there a while before trying one frame fewer again.
+		if(mFramesInFlight < mMaxFramesInFlight)
+		{
+			++mFramesInFlight;
+			mHoldWindows = gHoldWindows;
+		}
+	}
+	else if(mWindowMisses == 0)
+	{
+		// Making the target with room to spare: drop a queued frame of latency.
+		if(mHoldWindows > 0)
+			--mHoldWindows;
+		else if(mFramesInFlight > 1)
+			--mFramesInFlight;
+	}
+
+	mWindowFrames = 0;
+	mWindowMisses = 0;
+}
+
+void FramePacer::AddLatency(float ms)
+{
+	if(mLatencyMs == 0.0f)
+		mLatencyMs = ms;
+	else
+		mLatencyMs += (ms - mLatencyMs) * gLatencySmoothing;
+}
@@ -0,0 +1,99 @@
+//***************************************************************************************
+// FramePacer.h
+//
+// Caps the main loop at a target frame rate.  The wait before each frame sleeps while
+// the deadline is far off and spins for the last stretch, because Sleep can overshoot
+// by a millisecond or more.  The pacer also averages the input-to-present latency the
+// app reports, and picks how many frames the CPU may run ahead of the GPU: the fewest
+// that still make the target, since every queued frame adds a frame of latency.
+//
+// All timing goes through a Clock, so the pacing can be driven by a simulated clock.
+//***************************************************************************************
+
+#ifndef FRAMEPACER_H
+#define FRAMEPACER_H
+
+#include <cstdint>
+
+class FramePacer
+{
+public:
+	class Clock
+	{
+	public:
+		virtual ~Clock() = default;
+
+		// Seconds from an arbitrary start.
+		virtual double Now() = 0;
+
+		// Sleeps for about the given seconds; may sleep longer.
+		virtual void Sleep(double seconds) = 0;
+	};
+
+	// Time only passes when asked to.  Every Now() costs SpinCost seconds, as a spin
+	// iteration would, and every Sleep oversleeps by Oversleep seconds.
+	class SimulatedClock : public Clock
+	{
+	public:
+		virtual double Now()override { mTime += SpinCost; return mTime; }
+		virtual void Sleep(double seconds)override { mTime += seconds + Oversleep; }
+
+		// Stands in for the work of a frame.
+		void Advance(double seconds) { mTime += seconds; }
+
+		double SpinCost = 1e-6;
+		double Oversleep = 0.0;
+
+	private:
+		double mTime = 0.0;
+	};
+
+	// With no clock the pacer uses the system clock.
+	explicit FramePacer(Clock* clock = nullptr);
+	FramePacer(const FramePacer& rhs) = delete;
+	FramePacer& operator=(const FramePacer& rhs) = delete;
+	~FramePacer();
+
+	// 0 runs uncapped.
+	void SetTargetFps(float fps);
+	float GetTargetFps()const { return mTargetFps; }
+
+	// The most frames the app can keep in flight.
+	void SetMaxFramesInFlight(int count);
+
+	// Call once per frame after presenting.  Blocks until the next frame is due.
+	void WaitForNextFrame();
+
+	// Called with the time from sampling a frame's input to presenting it.
+	void AddLatency(float ms);
+
+	float GetLatencyMs()const { return mLatencyMs; }
+	int GetFramesInFlight()const { return mFramesInFlight; }
+	double GetSpinThreshold()const { return mSpinThreshold; }
+	std::uint64_t GetMissedFrames()const { return mMissedFrames; }
+
+private:
+	void AdaptFramesInFlight(bool missed);
+
+	Clock* mClock = nullptr;
+	Clock* mOwnedClock = nullptr;
+
+	float mTargetFps = 0.0f;
+	double mNextDeadline = -1.0;
+
+	// Sleep stops this long before the deadline.  It follows the worst recent
+	// oversleep, which fades so one bad sleep does not make us spin forever.
+	double mSpinThreshold = 0.002;
+	double mOversleep = 0.0;
+
+	float mLatencyMs = 0.0f;
+
+	int mFramesInFlight = 1;
+	int mMaxFramesInFlight = 1;
+	int mHoldWindows = 0;
+	std::uint32_t mWindowFrames = 0;
+	std::uint32_t mWindowMisses = 0;
+	std::uint64_t mMissedFrames = 0;
+};
+
+#endif // FRAMEPACER_H
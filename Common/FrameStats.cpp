@@ -0,0 +1,166 @@
+//***************************************************************************************
+// FrameStats.cpp
+//***************************************************************************************
+
+#include "FrameStats.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+FrameStats::Histogram::Histogram()
+{
+	std::memset(mCounts, 0, sizeof(mCounts));
+}
+
+int FrameStats::Histogram::BucketIndex(std::uint32_t us)
+{
+	if(us < LinearBuckets)
+		return (int)us;
+
+	// Shift the value down until it is in [SubBuckets, LinearBuckets); the shift picks
+	// the power of two range and the remaining bits the bucket inside it.
+	int shift = 1;
+	while((us >> shift) >= LinearBuckets)
+		++shift;
+
+	return LinearBuckets + (shift - 1) * SubBuckets + (int)((us >> shift) - SubBuckets);
+}
+
+std::uint32_t FrameStats::Histogram::BucketHighest(int index)
+{
+	if(index < LinearBuckets)
+		return (std::uint32_t)index;
+
+	const int shift = (index - LinearBuckets) / SubBuckets + 1;
+	const std::uint32_t sub = (std::uint32_t)((index - LinearBuckets) % SubBuckets + SubBuckets);
+	return ((sub + 1) << shift) - 1;
+}
+
+void FrameStats::Histogram::Add(std::uint32_t us)
+{
+	mCounts[BucketIndex(us)]++;
+}
+
+void FrameStats::Histogram::Remove(std::uint32_t us)
+{
+	mCounts[BucketIndex(us)]--;
+}
+
+std::uint32_t FrameStats::Histogram::Percentile(float fraction, std::uint32_t sampleCount)const
+{
+	const std::uint32_t rank = std::max(1u, (std::uint32_t)(fraction * sampleCount + 0.999f));
+
+	std::uint32_t seen = 0;
+	for(int i = 0; i < BucketCount; ++i)
+	{
+		seen += mCounts[i];
+		if(seen >= rank)
+			return BucketHighest(i);
+	}
+	return 0;
+}
+
+FrameStats::FrameStats(std::uint32_t windowSize, float hitchMs)
+	: mWindowSize(std::max(windowSize, 1u)), mHitchUs(ToMicroseconds(hitchMs))
+{
+	mWindow.reserve(mWindowSize);
+}
+
+std::uint32_t FrameStats::ToMicroseconds(float ms)
+{
+	// Clamp to the range of the histogram, a bit over half an hour.
+	const float us = ms * 1000.0f;
+	if(!(us > 0.0f))
+		return 0;
+	return (std::uint32_t)std::min(us + 0.5f, 2000000000.0f);
+}
+
+void FrameStats::AddFrame(float frameMs, float cpuMs)
+{
+	Frame frame;
+	frame.FrameUs = ToMicroseconds(frameMs);
+	frame.CpuUs = ToMicroseconds(cpuMs);
+
+	if(mWindow.size() < mWindowSize)
+		mWindow.push_back(frame);
+	else
+	{
+		// Evict the oldest frame.
+		Frame& oldest = mWindow[mNext];
+		mFrameHistogram.Remove(oldest.FrameUs);
+		mCpuHistogram.Remove(oldest.CpuUs);
+		if(oldest.FrameUs > mHitchUs)
+			mWindowHitches--;
+
+		oldest = frame;
+	}
+	mNext = (mNext + 1) % mWindowSize;
+
+	mFrameHistogram.Add(frame.FrameUs);
+	mCpuHistogram.Add(frame.CpuUs);
+
+	mTotalFrames++;
+	if(frame.FrameUs > mHitchUs)
+	{
+		mWindowHitches++;
+		mTotalHitches++;
+	}
+}
+
+FrameStats::Summary FrameStats::Summarize(const Histogram& histogram, std::uint32_t Frame::*measure)const
+{
+	Summary summary;
+	summary.Frames = (std::uint32_t)mWindow.size();
+	summary.Hitches = mWindowHitches;
+	if(mWindow.empty())
+		return summary;
+
+	// The histogram rounds up inside a bucket; never report more than the real maximum.
+	std::uint32_t maxUs = 0;
+	for(const Frame& frame : mWindow)
+		maxUs = std::max(maxUs, frame.*measure);
+
+	summary.P50 = std::min(histogram.Percentile(0.50f, summary.Frames), maxUs) / 1000.0f;
+	summary.P95 = std::min(histogram.Percentile(0.95f, summary.Frames), maxUs) / 1000.0f;
+	summary.P99 = std::min(histogram.Percentile(0.99f, summary.Frames), maxUs) / 1000.0f;
+	summary.Max = maxUs / 1000.0f;
+
+	return summary;
+}
+
+FrameStats::Summary FrameStats::GetFrameTimes()const
+{
+	return Summarize(mFrameHistogram, &Frame::FrameUs);
+}
+
+FrameStats::Summary FrameStats::GetCpuTimes()const
+{
+	return Summarize(mCpuHistogram, &Frame::CpuUs);
+}
+
+bool FrameStats::WriteCsv(const std::string& filename, std::string& error)const
+{
+	std::ofstream fout(filename, std::ios::trunc);
+	fout.setf(std::ios::fixed);
+	fout.precision(3);
+
+	fout << "frame,frame_ms,cpu_ms\n";
+
+	// Before the window has filled up the oldest frame is at 0, afterwards at mNext.
+	const std::uint32_t count = (std::uint32_t)mWindow.size();
+	const std::uint32_t oldest = count < mWindowSize ? 0 : mNext;
+	const std::uint64_t firstFrame = mTotalFrames - count;
+
+	for(std::uint32_t i = 0; i < count; ++i)
+	{
+		const Frame& frame = mWindow[(oldest + i) % count];
+		fout << firstFrame + i << ',' << frame.FrameUs / 1000.0f << ',' << frame.CpuUs / 1000.0f << '\n';
+	}
+
+	if(!fout)
+	{
+		error = "cannot write " + filename;
+		return false;
+	}
+	return true;
+}
@@ -0,0 +1,98 @@
+//***************************************************************************************
+// FrameStats.h
+//
+// Rolling window of per-frame times with log-linear histograms in the style of
+// HdrHistogram, so percentiles over thousands of frames cost a walk over a few
+// hundred buckets.  Averages hide stutters; the tail percentiles, the worst frame
+// and the number of hitches are what show frame pacing regressions.
+//***************************************************************************************
+
+#ifndef FRAMESTATS_H
+#define FRAMESTATS_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class FrameStats
+{
+public:
+	// Statistics of one measure over the window, in milliseconds.
+	struct Summary
+	{
+		std::uint32_t Frames = 0;
+		std::uint32_t Hitches = 0;
+		float P50 = 0.0f;
+		float P95 = 0.0f;
+		float P99 = 0.0f;
+		float Max = 0.0f;
+	};
+
+	// Keeps the last windowSize frames.  A frame longer than hitchMs is a hitch.
+	FrameStats(std::uint32_t windowSize, float hitchMs);
+
+	// frameMs is the time since the previous frame, cpuMs the time spent in Update
+	// and Draw.
+	void AddFrame(float frameMs, float cpuMs);
+
+	Summary GetFrameTimes()const;
+	Summary GetCpuTimes()const;
+
+	std::uint64_t GetTotalFrames()const { return mTotalFrames; }
+	std::uint64_t GetTotalHitches()const { return mTotalHitches; }
+
+	// Writes the frames in the window, oldest first, as frame,frame_ms,cpu_ms rows.
+	bool WriteCsv(const std::string& filename, std::string& error)const;
+
+private:
+	// Values are whole microseconds.  Below 128us every value has its own bucket;
+	// above, each power of two range is split into 64 buckets, which bounds the error
+	// of a reported percentile to 1/64 of the value.
+	class Histogram
+	{
+	public:
+		Histogram();
+
+		void Add(std::uint32_t us);
+		void Remove(std::uint32_t us);
+
+		// Highest value of the bucket holding the given fraction of the samples.
+		std::uint32_t Percentile(float fraction, std::uint32_t sampleCount)const;
+
+	private:
+		static int BucketIndex(std::uint32_t us);
+		static std::uint32_t BucketHighest(int index);
+
+		static const int SubBuckets = 64;
+		static const int LinearBuckets = 2 * SubBuckets;
+		static const int BucketCount = LinearBuckets + 24 * SubBuckets;
+
+		std::uint32_t mCounts[BucketCount];
+	};
+
+	struct Frame
+	{
+		std::uint32_t FrameUs;
+		std::uint32_t CpuUs;
+	};
+
+	Summary Summarize(const Histogram& histogram, std::uint32_t Frame::*measure)const;
+
+	static std::uint32_t ToMicroseconds(float ms);
+
+private:
+	std::vector<Frame> mWindow;
+	std::uint32_t mWindowSize;
+	std::uint32_t mNext = 0;
+
+	std::uint32_t mHitchUs;
+	std::uint32_t mWindowHitches = 0;
+
+	Histogram mFrameHistogram;
+	Histogram mCpuHistogram;
+
+	std::uint64_t mTotalFrames = 0;
+	std::uint64_t mTotalHitches = 0;
+};
+
+#endif // FRAMESTATS_H
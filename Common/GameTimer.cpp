@@ -2,22 +2,58 @@
 // GameTimer.cpp by Frank Luna (C) 2011 All Rights Reserved.
 //***************************************************************************************
 
+#if defined(_WIN32)
 #include <windows.h>
+#else
+#include <chrono>
+#endif
 #include "GameTimer.h"
+#include <cmath>
+
+namespace
+{
+	// The high resolution counter: QueryPerformanceCounter on Windows, the steady
+	// clock elsewhere, so the clocks can be checked off Windows too.
+	std::int64_t ReadCounter()
+	{
+#if defined(_WIN32)
+		LARGE_INTEGER count;
+		QueryPerformanceCounter(&count);
+		return count.QuadPart;
+#else
+		return std::chrono::steady_clock::now().time_since_epoch().count();
+#endif
+	}
+
+	double CountsPerSecond()
+	{
+#if defined(_WIN32)
+		LARGE_INTEGER frequency;
+		QueryPerformanceFrequency(&frequency);
+		return (double)frequency.QuadPart;
+#else
+		return (double)std::chrono::steady_clock::period::den / std::chrono::steady_clock::period::num;
+#endif
+	}
+}
 
 GameTimer::GameTimer()
-: mSecondsPerCount(0.0), mDeltaTime(-1.0), mBaseTime(0), 
+: mSecondsPerCount(0.0), mDeltaTime(-1.0), mFixedStep(0.0), mFixedTime(0.0),
+  mSimStep(1.0 / 60.0), mSimAccumulator(0.0), mTimeScale(1.0), mMaxSimSteps(4), mSimSteps(0), mBaseTime(0), 
   mPausedTime(0), mPrevTime(0), mCurrTime(0), mStopped(false)
 {
-	__int64 countsPerSec;
-	QueryPerformanceFrequency((LARGE_INTEGER*)&countsPerSec);
-	mSecondsPerCount = 1.0 / (double)countsPerSec;
+	mSecondsPerCount = 1.0 / CountsPerSecond();
 }
 
 // Returns the total time elapsed since Reset() was called, NOT counting any
 // time when the clock is stopped.
 float GameTimer::TotalTime()const
 {
+	if( mFixedStep > 0.0 )
+	{
+		return (float)mFixedTime;
+	}
+
 	// If we are stopped, do not count the time that has passed since we stopped.
 	// Moreover, if we previously already had a pause, the distance 
 	// mStopTime - mBaseTime includes paused time, which we do not want to count.
@@ -53,21 +89,63 @@ float GameTimer::DeltaTime()const
 	return (float)mDeltaTime;
 }
 
+float GameTimer::SimStep()const
+{
+	return (float)mSimStep;
+}
+
+int GameTimer::SimSteps()const
+{
+	return mSimSteps;
+}
+
+float GameTimer::SimAlpha()const
+{
+	return (float)(mSimAccumulator / mSimStep);
+}
+
+float GameTimer::TimeScale()const
+{
+	return (float)mTimeScale;
+}
+
 void GameTimer::Reset()
 {
-	__int64 currTime;
-	QueryPerformanceCounter((LARGE_INTEGER*)&currTime);
+	const std::int64_t currTime = ReadCounter();
 
 	mBaseTime = currTime;
 	mPrevTime = currTime;
 	mStopTime = 0;
 	mStopped  = false;
+	mFixedTime = 0.0;
+	mSimAccumulator = 0.0;
+	mSimSteps = 0;
+}
+
+void GameTimer::SetFixedStep(double step)
+{
+	mFixedStep = step > 0.0 ? step : 0.0;
+	mFixedTime = 0.0;
+}
+
+void GameTimer::SetSimStep(double step, int maxSteps)
+{
+	if( step > 0.0 )
+	{
+		mSimStep = step;
+	}
+	mMaxSimSteps = maxSteps > 1 ? maxSteps : 1;
+	mSimAccumulator = 0.0;
+}
+
+void GameTimer::SetTimeScale(double scale)
+{
+	mTimeScale = scale > 0.0 ? scale : 0.0;
 }
 
 void GameTimer::Start()
 {
-	__int64 startTime;
-	QueryPerformanceCounter((LARGE_INTEGER*)&startTime);
+	const std::int64_t startTime = ReadCounter();
 
 
 	// Accumulate the time elapsed between stop and start pairs.
@@ -90,8 +168,7 @@ void GameTimer::Stop()
 {
 	if( !mStopped )
 	{
-		__int64 currTime;
-		QueryPerformanceCounter((LARGE_INTEGER*)&currTime);
+		const std::int64_t currTime = ReadCounter();
 
 		mStopTime = currTime;
 		mStopped  = true;
@@ -103,11 +180,11 @@ void GameTimer::Tick()
 	if( mStopped )
 	{
 		mDeltaTime = 0.0;
+		mSimSteps = 0;
 		return;
 	}
 
-	__int64 currTime;
-	QueryPerformanceCounter((LARGE_INTEGER*)&currTime);
+	const std::int64_t currTime = ReadCounter();
 	mCurrTime = currTime;
 
 	// Time difference between this frame and the previous.
@@ -116,6 +193,14 @@ void GameTimer::Tick()
 	// Prepare for next frame.
 	mPrevTime = mCurrTime;
 
+	if( mFixedStep > 0.0 )
+	{
+		mDeltaTime = mFixedStep;
+		mFixedTime += mFixedStep;
+		AdvanceSim();
+		return;
+	}
+
 	// Force nonnegative.  The DXSDK's CDXUTTimer mentions that if the 
 	// processor goes into a power save mode or we get shuffled to another
 	// processor, then mDeltaTime can be negative.
@@ -123,10 +208,22 @@ void GameTimer::Tick()
 	{
 		mDeltaTime = 0.0;
 	}
-}
-
-
 
+	AdvanceSim();
+}
 
+void GameTimer::AdvanceSim()
+{
+	mSimAccumulator += mDeltaTime * mTimeScale;
 
+	// Take every whole step out of the accumulator, but only simulate up to the
+	// catch-up limit; the rest of the backlog is dropped.
+	const double steps = std::floor(mSimAccumulator / mSimStep);
+	mSimAccumulator -= steps * mSimStep;
+	if( mSimAccumulator < 0.0 || mSimAccumulator >= mSimStep )
+	{
+		mSimAccumulator = 0.0;
+	}
 
+	mSimSteps = steps < mMaxSimSteps ? (int)steps : mMaxSimSteps;
+}
@@ -5,6 +5,8 @@
 #ifndef GAMETIMER_H
 #define GAMETIMER_H
 
+#include <cstdint>
+
 class GameTimer
 {
 public:
@@ -18,15 +20,43 @@ public:
 	void Stop();  // Call when paused.
 	void Tick();  // Call every frame.
 
+	// With a step > 0 every Tick advances the clock by exactly that many seconds,
+	// whatever the real frame took, so a recorded run replays identically.
+	// 0 goes back to real time.
+	void SetFixedStep(double step);
+	double FixedStep()const { return mFixedStep; }
+
+	// Fixed-step simulation clock.  Every Tick adds the frame time, times the time
+	// scale, to an accumulator and takes whole steps of SimStep() seconds out of it.
+	// At most maxSteps are taken per frame and any further backlog is dropped, so a
+	// slow frame cannot snowball into ever more simulation work.  Render state can
+	// be blended between the last two steps with SimAlpha().
+	void SetSimStep(double step, int maxSteps);
+	void SetTimeScale(double scale);
+
+	float SimStep()const;   // seconds per simulation step
+	int SimSteps()const;    // steps due this frame
+	float SimAlpha()const;  // fraction of a step left over, in [0, 1)
+	float TimeScale()const;
+
 private:
+	void AdvanceSim();
+
 	double mSecondsPerCount;
 	double mDeltaTime;
+	double mFixedStep;
+	double mFixedTime;
+	double mSimStep;
+	double mSimAccumulator;
+	double mTimeScale;
+	int mMaxSimSteps;
+	int mSimSteps;
 
-	__int64 mBaseTime;
-	__int64 mPausedTime;
-	__int64 mStopTime;
-	__int64 mPrevTime;
-	__int64 mCurrTime;
+	std::int64_t mBaseTime;
+	std::int64_t mPausedTime;
+	std::int64_t mStopTime;
+	std::int64_t mPrevTime;
+	std::int64_t mCurrTime;
 
 	bool mStopped;
 };
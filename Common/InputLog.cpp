@@ -0,0 +1,71 @@
+//***************************************************************************************
+// InputLog.cpp
+//***************************************************************************************
+
+#include "InputLog.h"
+#include <fstream>
+
+bool InputRecorder::Save(const std::string& filename, std::string& error)const
+{
+	InputLogHeader header = {};
+	header.Magic = InputPlayback::Magic;
+	header.Version = InputPlayback::Version;
+	header.SampleCount = (std::uint32_t)mSamples.size();
+
+	std::ofstream fout(filename, std::ios::binary | std::ios::trunc);
+	fout.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	if(!mSamples.empty())
+		fout.write(reinterpret_cast<const char*>(mSamples.data()), mSamples.size() * sizeof(InputSample));
+
+	if(!fout)
+	{
+		error = "cannot write " + filename;
+		return false;
+	}
+	return true;
+}
+
+bool InputPlayback::Open(const std::string& filename, std::string& error)
+{
+	if(!mFile.Open(filename))
+	{
+		error = "cannot open " + filename;
+		return false;
+	}
+
+	const InputLogHeader* header = reinterpret_cast<const InputLogHeader*>(mFile.Data());
+	if(mFile.Size() < sizeof(InputLogHeader) || header->Magic != Magic || header->Version != Version)
+	{
+		error = filename + " is not an input log";
+		return false;
+	}
+
+	if((mFile.Size() - sizeof(InputLogHeader)) / sizeof(InputSample) < header->SampleCount)
+	{
+		error = filename + " is truncated";
+		return false;
+	}
+
+	mSamples = reinterpret_cast<const InputSample*>(mFile.Data() + sizeof(InputLogHeader));
+	mSampleCount = header->SampleCount;
+	mCursor = 0;
+	mFinished = mSampleCount == 0;
+
+	return true;
+}
+
+InputSample InputPlayback::Sample(float time)
+{
+	if(mSampleCount == 0)
+		return InputSample();
+
+	while(mCursor + 1 < mSampleCount && mSamples[mCursor + 1].Time <= time)
+		++mCursor;
+
+	if(mCursor + 1 == mSampleCount && time > mSamples[mCursor].Time)
+		mFinished = true;
+
+	InputSample sample = mSamples[mCursor];
+	sample.Time = time;
+	return sample;
+}
@@ -0,0 +1,85 @@
+//***************************************************************************************
+// InputLog.h
+//
+// Per-frame input samples and a compact binary log of them.  The app records the
+// state of its keys and the mouse every frame, and a playback hands the same states
+// back by time, so a fixed time step replays exactly the same camera path run after
+// run and the runs can be compared frame by frame.
+//***************************************************************************************
+
+#ifndef INPUTLOG_H
+#define INPUTLOG_H
+
+#include "MappedFile.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Input state at one point in time.  Keys is a bit per key, in an order the app
+// chooses; Buttons uses the InputSample::*Button bits.
+struct InputSample
+{
+	static const std::uint8_t LeftButton = 1;
+	static const std::uint8_t RightButton = 2;
+	static const std::uint8_t MiddleButton = 4;
+
+	float Time = 0.0f;
+	std::uint16_t Keys = 0;
+	std::uint8_t Buttons = 0;
+	std::uint8_t Pad = 0;
+	std::int16_t MouseX = 0;
+	std::int16_t MouseY = 0;
+
+	// Keys down in this sample that were up in prev.  A key held over several frames
+	// is pressed once, however many frames the recording or the replay splits it into.
+	std::uint16_t PressedSince(const InputSample& prev)const { return (std::uint16_t)(Keys & ~prev.Keys); }
+};
+
+static_assert(sizeof(InputSample) == 12, "InputSample is stored as is in the log");
+
+struct InputLogHeader
+{
+	std::uint32_t Magic;
+	std::uint32_t Version;
+	std::uint32_t SampleCount;
+	std::uint32_t Pad;
+};
+
+class InputRecorder
+{
+public:
+	// Samples must be added in time order.
+	void Add(const InputSample& sample) { mSamples.push_back(sample); }
+
+	std::size_t SampleCount()const { return mSamples.size(); }
+
+	bool Save(const std::string& filename, std::string& error)const;
+
+private:
+	std::vector<InputSample> mSamples;
+};
+
+class InputPlayback
+{
+public:
+	static const std::uint32_t Magic = 0x4c504e49; // 'INPL'
+	static const std::uint32_t Version = 1;
+
+	bool Open(const std::string& filename, std::string& error);
+
+	// The input at time: the last sample at or before it.  Times must not decrease
+	// between calls.
+	InputSample Sample(float time);
+
+	// True once time has passed the last sample.
+	bool Finished()const { return mFinished; }
+
+private:
+	MappedFile mFile;
+	const InputSample* mSamples = nullptr;
+	std::uint32_t mSampleCount = 0;
+	std::uint32_t mCursor = 0;
+	bool mFinished = false;
+};
+
+#endif // INPUTLOG_H
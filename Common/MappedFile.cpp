@@ -0,0 +1,230 @@
+//***************************************************************************************
+// MappedFile.cpp
+//***************************************************************************************
+
+#include "MappedFile.h"
+#include <utility>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <cstdlib>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile(MappedFile&& rhs)
+{
+	Swap(rhs);
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& rhs)
+{
+	if(this != &rhs)
+	{
+		Close();
+		Swap(rhs);
+	}
+	return *this;
+}
+
+MappedFile::~MappedFile()
+{
+	Close();
+}
+
+void MappedFile::Swap(MappedFile& rhs)
+{
+	std::swap(mData, rhs.mData);
+	std::swap(mSize, rhs.mSize);
+	std::swap(mIsOpen, rhs.mIsOpen);
+#if defined(_WIN32)
+	std::swap(mFile, rhs.mFile);
+	std::swap(mMapping, rhs.mMapping);
+#else
+	std::swap(mFd, rhs.mFd);
+#endif
+}
+
+bool MappedFile::IsOpen()const
+{
+	return mIsOpen;
+}
+
+const std::uint8_t* MappedFile::Data()const
+{
+	return mData;
+}
+
+std::size_t MappedFile::Size()const
+{
+	return mSize;
+}
+
+#if defined(_WIN32)
+
+bool MappedFile::Open(const std::string& filename)
+{
+	Close();
+
+	HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+		OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if(file == INVALID_HANDLE_VALUE)
+		return false;
+
+	mFile = file;
+	return MapOpenedFile();
+}
+
+bool MappedFile::Open(const std::wstring& filename)
+{
+	Close();
+
+	HANDLE file = CreateFileW(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+		OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if(file == INVALID_HANDLE_VALUE)
+		return false;
+
+	mFile = file;
+	return MapOpenedFile();
+}
+
+bool MappedFile::MapOpenedFile()
+{
+	LARGE_INTEGER fileSize = {};
+	if(!GetFileSizeEx((HANDLE)mFile, &fileSize) || (std::uint64_t)fileSize.QuadPart > (std::uint64_t)SIZE_MAX)
+	{
+		Close();
+		return false;
+	}
+
+	mIsOpen = true;
+	mSize = (std::size_t)fileSize.QuadPart;
+
+	// Zero sized files cannot be mapped.
+	if(mSize == 0)
+		return true;
+
+	mMapping = CreateFileMappingW((HANDLE)mFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if(mMapping == nullptr)
+	{
+		Close();
+		return false;
+	}
+
+	mData = (const std::uint8_t*)MapViewOfFile((HANDLE)mMapping, FILE_MAP_READ, 0, 0, 0);
+	if(mData == nullptr)
+	{
+		Close();
+		return false;
+	}
+
+	return true;
+}
+
+void MappedFile::Close()
+{
+	if(mData != nullptr)
+		UnmapViewOfFile(mData);
+	if(mMapping != nullptr)
+		CloseHandle((HANDLE)mMapping);
+	if(mFile != nullptr)
+		CloseHandle((HANDLE)mFile);
+
+	mData = nullptr;
+	mSize = 0;
+	mIsOpen = false;
+	mFile = nullptr;
+	mMapping = nullptr;
+}
+
+bool GetFileWriteTime(const std::string& filename, std::uint64_t& writeTime)
+{
+	WIN32_FILE_ATTRIBUTE_DATA data;
+	if(!GetFileAttributesExA(filename.c_str(), GetFileExInfoStandard, &data))
+		return false;
+
+	writeTime = ((std::uint64_t)data.ftLastWriteTime.dwHighDateTime << 32) | data.ftLastWriteTime.dwLowDateTime;
+	return true;
+}
+
+#else
+
+bool MappedFile::Open(const std::string& filename)
+{
+	Close();
+
+	mFd = open(filename.c_str(), O_RDONLY);
+	if(mFd < 0)
+		return false;
+
+	return MapOpenedFile();
+}
+
+bool MappedFile::Open(const std::wstring& filename)
+{
+	std::string narrow(filename.size() * MB_CUR_MAX + 1, '\0');
+	std::size_t length = std::wcstombs(&narrow[0], filename.c_str(), narrow.size());
+	if(length == (std::size_t)-1)
+		return false;
+
+	narrow.resize(length);
+	return Open(narrow);
+}
+
+bool MappedFile::MapOpenedFile()
+{
+	struct stat info;
+	if(fstat(mFd, &info) != 0)
+	{
+		Close();
+		return false;
+	}
+
+	mIsOpen = true;
+	mSize = (std::size_t)info.st_size;
+
+	if(mSize == 0)
+		return true;
+
+	void* data = mmap(nullptr, mSize, PROT_READ, MAP_PRIVATE, mFd, 0);
+	if(data == MAP_FAILED)
+	{
+		Close();
+		return false;
+	}
+
+	mData = (const std::uint8_t*)data;
+	return true;
+}
+
+void MappedFile::Close()
+{
+	if(mData != nullptr)
+		munmap((void*)mData, mSize);
+	if(mFd >= 0)
+		close(mFd);
+
+	mData = nullptr;
+	mSize = 0;
+	mIsOpen = false;
+	mFd = -1;
+}
+
+bool GetFileWriteTime(const std::string& filename, std::uint64_t& writeTime)
+{
+	struct stat info;
+	if(stat(filename.c_str(), &info) != 0)
+		return false;
+
+#if defined(__APPLE__)
+	writeTime = (std::uint64_t)info.st_mtimespec.tv_sec * 1000000000ull + info.st_mtimespec.tv_nsec;
+#else
+	writeTime = (std::uint64_t)info.st_mtim.tv_sec * 1000000000ull + info.st_mtim.tv_nsec;
+#endif
+	return true;
+}
+
+#endif
@@ -0,0 +1,57 @@
+//***************************************************************************************
+// MappedFile.h
+//
+// Read-only memory mapping of a whole file, for loading cooked data in place without
+// copying it through a read buffer.  Uses CreateFileMapping on Windows and mmap on
+// POSIX systems.
+//***************************************************************************************
+
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+class MappedFile
+{
+public:
+	MappedFile() = default;
+	MappedFile(const MappedFile& rhs) = delete;
+	MappedFile& operator=(const MappedFile& rhs) = delete;
+	MappedFile(MappedFile&& rhs);
+	MappedFile& operator=(MappedFile&& rhs);
+	~MappedFile();
+
+	// Maps the whole file.  Returns false if the file cannot be opened or mapped.
+	// An empty file opens successfully with Data() == nullptr and Size() == 0.
+	bool Open(const std::string& filename);
+	bool Open(const std::wstring& filename);
+	void Close();
+
+	bool IsOpen()const;
+	const std::uint8_t* Data()const;
+	std::size_t Size()const;
+
+private:
+	bool MapOpenedFile();
+	void Swap(MappedFile& rhs);
+
+private:
+	const std::uint8_t* mData = nullptr;
+	std::size_t mSize = 0;
+	bool mIsOpen = false;
+
+#if defined(_WIN32)
+	void* mFile = nullptr;
+	void* mMapping = nullptr;
+#else
+	int mFd = -1;
+#endif
+};
+
+// Last write time of a file in an unspecified but monotonic unit, used to tell whether
+// a file changed.  Returns false if the file does not exist.
+bool GetFileWriteTime(const std::string& filename, std::uint64_t& writeTime);
+
+#endif // MAPPEDFILE_H
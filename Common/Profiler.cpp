@@ -0,0 +1,248 @@
+//***************************************************************************************
+// Profiler.cpp
+//***************************************************************************************
+
+#include "Profiler.h"
+#include <algorithm>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <chrono>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+std::atomic<bool> Profiler::sEnabled(true);
+
+namespace
+{
+	enum class ProfileEventType : std::uint32_t
+	{
+		Scope,
+		Counter
+	};
+
+	struct ProfileEvent
+	{
+		const char* Name;
+		std::int64_t Begin;
+		std::int64_t End;
+		double Value;
+		ProfileEventType Type;
+	};
+
+	// Written only by the owning thread.  Head counts every event ever recorded; the
+	// release store publishes the event before it, so a reader that loads Head with
+	// acquire sees complete events up to it.
+	struct ThreadRing
+	{
+		std::uint32_t ThreadIndex = 0;
+		std::string ThreadName;
+		std::atomic<std::uint64_t> Head;
+		ProfileEvent Events[Profiler::RingCapacity];
+
+		ThreadRing() : Head(0) {}
+	};
+
+	static_assert((Profiler::RingCapacity & (Profiler::RingCapacity - 1)) == 0,
+		"RingCapacity must be a power of two");
+
+	// Rings live until exit, so a thread pool thread can come and go freely.  The
+	// mutex is only taken the first time a thread records and while writing.
+	std::mutex gRingsMutex;
+	std::vector<std::unique_ptr<ThreadRing>> gRings;
+
+	thread_local ThreadRing* tRing = nullptr;
+
+	ThreadRing* GetThreadRing()
+	{
+		if(tRing == nullptr)
+		{
+			std::unique_ptr<ThreadRing> ring(new ThreadRing());
+
+			std::lock_guard<std::mutex> lock(gRingsMutex);
+			ring->ThreadIndex = (std::uint32_t)gRings.size();
+			tRing = ring.get();
+			gRings.push_back(std::move(ring));
+		}
+		return tRing;
+	}
+
+	void Push(const ProfileEvent& event)
+	{
+		ThreadRing* ring = GetThreadRing();
+		const std::uint64_t head = ring->Head.load(std::memory_order_relaxed);
+		ring->Events[head & (Profiler::RingCapacity - 1)] = event;
+		ring->Head.store(head + 1, std::memory_order_release);
+	}
+
+	// Profiler ticks and wall clock at startup, to convert ticks to time when writing.
+	const std::int64_t gStartTicks = Profiler::Now();
+	const std::chrono::steady_clock::time_point gStartTime = std::chrono::steady_clock::now();
+
+	double TicksPerMicrosecond()
+	{
+		const std::int64_t ticks = Profiler::Now() - gStartTicks;
+		const double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - gStartTime).count();
+		return us > 0.0 ? (double)ticks / us : 1.0;
+	}
+
+	void WriteJsonString(std::ofstream& fout, const std::string& text)
+	{
+		fout << '"';
+		for(char c : text)
+		{
+			if(c == '"' || c == '\\')
+				fout << '\\' << c;
+			else if((unsigned char)c < 0x20)
+				fout << ' ';
+			else
+				fout << c;
+		}
+		fout << '"';
+	}
+}
+
+std::int64_t Profiler::Now()
+{
+	// The time stamp counter is a few nanoseconds to read, where the OS clocks can
+	// cost tens.  It runs at a constant rate on every CPU from the last decade; the
+	// rate is measured against the wall clock when the trace is written.
+#if defined(_MSC_VER) || defined(__x86_64__) || defined(__i386__)
+	return (std::int64_t)__rdtsc();
+#else
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+void Profiler::RecordScope(const char* name, std::int64_t begin, std::int64_t end)
+{
+	ProfileEvent event;
+	event.Name = name;
+	event.Begin = begin;
+	event.End = end;
+	event.Value = 0.0;
+	event.Type = ProfileEventType::Scope;
+	Push(event);
+}
+
+void Profiler::RecordCounter(const char* name, double value)
+{
+	ProfileEvent event;
+	event.Name = name;
+	event.Begin = Now();
+	event.End = event.Begin;
+	event.Value = value;
+	event.Type = ProfileEventType::Counter;
+	Push(event);
+}
+
+void Profiler::SetThreadName(const std::string& name)
+{
+	ThreadRing* ring = GetThreadRing();
+
+	std::lock_guard<std::mutex> lock(gRingsMutex);
+	ring->ThreadName = name;
+}
+
+bool Profiler::WriteChromeTrace(const std::string& filename, std::string& error)
+{
+	struct ThreadEvents
+	{
+		std::uint32_t ThreadIndex;
+		std::string ThreadName;
+		std::vector<ProfileEvent> Events;
+	};
+
+	std::vector<ThreadEvents> threads;
+	{
+		std::lock_guard<std::mutex> lock(gRingsMutex);
+		for(const auto& ring : gRings)
+		{
+			ThreadEvents thread;
+			thread.ThreadIndex = ring->ThreadIndex;
+			thread.ThreadName = ring->ThreadName;
+
+			const std::uint64_t head = ring->Head.load(std::memory_order_acquire);
+			const std::uint64_t first = head > RingCapacity ? head - RingCapacity : 0;
+			for(std::uint64_t i = first; i < head; ++i)
+				thread.Events.push_back(ring->Events[i & (RingCapacity - 1)]);
+
+			// The owner may have wrapped around onto the oldest events while we copied.
+			// It may also be writing slot newHead right now, which holds event
+			// newHead - RingCapacity, so that one is dropped too.
+			const std::uint64_t newHead = ring->Head.load(std::memory_order_acquire);
+			const std::uint64_t valid = newHead >= RingCapacity ? newHead - RingCapacity + 1 : 0;
+			if(valid > first)
+			{
+				const std::size_t overwritten = (std::size_t)std::min<std::uint64_t>(valid - first, thread.Events.size());
+				thread.Events.erase(thread.Events.begin(), thread.Events.begin() + overwritten);
+			}
+
+			threads.push_back(std::move(thread));
+		}
+	}
+
+	// Timestamps are microseconds since the first event in the trace.
+	std::int64_t origin = 0;
+	bool haveOrigin = false;
+	for(const auto& thread : threads)
+	{
+		for(const auto& event : thread.Events)
+		{
+			if(!haveOrigin || event.Begin < origin)
+			{
+				origin = event.Begin;
+				haveOrigin = true;
+			}
+		}
+	}
+
+	const double ticksPerUs = TicksPerMicrosecond();
+
+	std::ofstream fout(filename, std::ios::trunc);
+	fout.setf(std::ios::fixed);
+	fout.precision(3);
+
+	fout << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+
+	bool firstEntry = true;
+	for(const auto& thread : threads)
+	{
+		const std::string threadName = thread.ThreadName.empty() ?
+			"Thread " + std::to_string(thread.ThreadIndex) : thread.ThreadName;
+
+		fout << (firstEntry ? "\n" : ",\n");
+		firstEntry = false;
+		fout << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << thread.ThreadIndex << ",\"args\":{\"name\":";
+		WriteJsonString(fout, threadName);
+		fout << "}}";
+
+		for(const auto& event : thread.Events)
+		{
+			fout << ",\n{\"name\":";
+			WriteJsonString(fout, event.Name);
+			fout << ",\"pid\":1,\"tid\":" << thread.ThreadIndex << ",\"ts\":" << (event.Begin - origin) / ticksPerUs;
+
+			if(event.Type == ProfileEventType::Scope)
+				fout << ",\"ph\":\"X\",\"dur\":" << (event.End - event.Begin) / ticksPerUs << "}";
+			else
+				fout << ",\"ph\":\"C\",\"args\":{\"value\":" << event.Value << "}}";
+		}
+	}
+
+	fout << "\n]}\n";
+
+	if(!fout)
+	{
+		error = "cannot write " + filename;
+		return false;
+	}
+	return true;
+}
@@ -0,0 +1,81 @@
+//***************************************************************************************
+// Profiler.h
+//
+// Low overhead CPU instrumentation.  PROFILE_SCOPE records the begin and end time of
+// the enclosing scope and PROFILE_COUNTER a named value, into a ring buffer owned by
+// the calling thread, so recording takes no locks.  The rings can be written out as
+// Chrome trace event JSON at any time and opened in chrome://tracing or Perfetto.
+//
+// Define PROFILER_DISABLED to compile the macros out.
+//***************************************************************************************
+
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+class Profiler
+{
+public:
+	// Events kept per thread.  Older events are overwritten once a ring is full.
+	static const std::uint32_t RingCapacity = 16384;
+
+	// Current time in profiler clock ticks (the CPU time stamp counter on x86).
+	static std::int64_t Now();
+
+	// Record on the calling thread's ring.  Names are stored as pointers, so they
+	// must stay valid until the trace is written; string literals always do.
+	static void RecordScope(const char* name, std::int64_t begin, std::int64_t end);
+	static void RecordCounter(const char* name, double value);
+
+	// Names the calling thread in the trace.  Unnamed threads show up by index.
+	static void SetThreadName(const std::string& name);
+
+	static void SetEnabled(bool enabled) { sEnabled.store(enabled, std::memory_order_relaxed); }
+	static bool IsEnabled() { return sEnabled.load(std::memory_order_relaxed); }
+
+	// Writes the events currently in the rings.  Threads may keep recording while
+	// this runs; events overwritten during the copy are dropped.
+	static bool WriteChromeTrace(const std::string& filename, std::string& error);
+
+private:
+	static std::atomic<bool> sEnabled;
+};
+
+class ProfileScope
+{
+public:
+	explicit ProfileScope(const char* name)
+		: mName(name), mBegin(Profiler::IsEnabled() ? Profiler::Now() : 0)
+	{
+	}
+
+	~ProfileScope()
+	{
+		if(mBegin != 0)
+			Profiler::RecordScope(mName, mBegin, Profiler::Now());
+	}
+
+	ProfileScope(const ProfileScope& rhs) = delete;
+	ProfileScope& operator=(const ProfileScope& rhs) = delete;
+
+private:
+	const char* mName;
+	std::int64_t mBegin;
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+
+#ifndef PROFILER_DISABLED
+#define PROFILE_SCOPE(name) ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(name)
+#define PROFILE_COUNTER(name, value) \
+	do { if(Profiler::IsEnabled()) Profiler::RecordCounter(name, (double)(value)); } while(false)
+#else
+#define PROFILE_SCOPE(name) do { } while(false)
+#define PROFILE_COUNTER(name, value) do { } while(false)
+#endif
+
+#endif // PROFILER_H
@@ -0,0 +1,383 @@
+//***************************************************************************************
+// TextureCache.cpp
+//***************************************************************************************
+
+#include "TextureCache.h"
+#include <algorithm>
+#include <cwctype>
+
+namespace
+{
+	std::string WideToUtf8(const std::wstring& text)
+	{
+		const int length = WideCharToMultiByte(CP_UTF8, 0, text.c_str(), (int)text.size(), nullptr, 0, nullptr, nullptr);
+		std::string utf8(length > 0 ? length : 0, '\0');
+		if(length > 0)
+			WideCharToMultiByte(CP_UTF8, 0, text.c_str(), (int)text.size(), &utf8[0], length, nullptr, nullptr);
+		return utf8;
+	}
+
+	std::uint32_t LargestMip(const DirectX::DDSTextureData12& data)
+	{
+		return (std::uint32_t)std::max(data.Width, data.Height);
+	}
+}
+
+TextureCache::Handle::Handle(FileEntry* file)
+	: mFile(file)
+{
+	if(mFile != nullptr)
+		++mFile->Refs;
+}
+
+TextureCache::Handle::Handle(const Handle& rhs)
+	: Handle(rhs.mFile)
+{
+}
+
+TextureCache::Handle::Handle(Handle&& rhs)
+	: mFile(rhs.mFile)
+{
+	rhs.mFile = nullptr;
+}
+
+TextureCache::Handle& TextureCache::Handle::operator=(Handle rhs)
+{
+	std::swap(mFile, rhs.mFile);
+	return *this;
+}
+
+TextureCache::Handle::~Handle()
+{
+	// The texture stays resident until Trim needs the memory.
+	if(mFile != nullptr)
+		--mFile->Refs;
+}
+
+Texture* TextureCache::Handle::Get()const
+{
+	if(mFile == nullptr || !mFile->Resident)
+		return nullptr;
+
+	auto& contents = TextureCache::Instance().mContents;
+	auto it = contents.find(mFile->ContentHash);
+	return it != contents.end() ? it->second.Tex.get() : nullptr;
+}
+
+TextureCache& TextureCache::Instance()
+{
+	static TextureCache cache;
+	return cache;
+}
+
+void TextureCache::SetBudget(std::uint64_t bytes)
+{
+	mBudget = bytes;
+}
+
+void TextureCache::SetStreaming(bool enabled, std::uint32_t baseSize)
+{
+	mStreaming = enabled;
+	mStreamBaseSize = std::max(baseSize, 1u);
+}
+
+std::wstring TextureCache::CanonicalPath(const std::wstring& filename)
+{
+	std::wstring path(MAX_PATH, L'\0');
+	DWORD length = GetFullPathNameW(filename.c_str(), (DWORD)path.size(), &path[0], nullptr);
+	if(length > path.size())
+	{
+		path.resize(length);
+		length = GetFullPathNameW(filename.c_str(), (DWORD)path.size(), &path[0], nullptr);
+	}
+	path.resize(length != 0 ? length : 0);
+	if(path.empty())
+		path = filename;
+
+	// Windows paths are case insensitive and take either slash.
+	for(auto& c : path)
+		c = c == L'/' ? L'\\' : (wchar_t)std::towlower(c);
+
+	return path;
+}
+
+TextureCache::Handle TextureCache::Acquire(const std::wstring& filename)
+{
+	const std::wstring path = CanonicalPath(filename);
+
+	FileEntry& file = mFiles[path];
+	if(file.Path.empty())
+		file.Path = path;
+
+	return Handle(&file);
+}
+
+Texture* TextureCache::Use(const Handle& handle, ID3D12Device* device, ID3D12GraphicsCommandList* cmdList)
+{
+	if(!handle)
+		return nullptr;
+
+	if(!handle.mFile->Resident)
+		Load({ handle.mFile }, device, cmdList);
+
+	ContentEntry& content = mContents[handle.mFile->ContentHash];
+	content.LastUse = ++mUseClock;
+	return content.Tex.get();
+}
+
+void TextureCache::LoadHeld(ID3D12Device* device, ID3D12GraphicsCommandList* cmdList)
+{
+	std::vector<FileEntry*> files;
+	for(auto& file : mFiles)
+	{
+		if(file.second.Refs > 0 && !file.second.Resident)
+			files.push_back(&file.second);
+	}
+
+	if(!files.empty())
+		Load(files, device, cmdList);
+}
+
+void TextureCache::Load(const std::vector<FileEntry*>& files, ID3D12Device* device, ID3D12GraphicsCommandList* cmdList)
+{
+	const std::size_t maxSize = mStreaming ? mStreamBaseSize : 0;
+
+	TextureLoader loader;
+	std::vector<std::future<std::unique_ptr<Texture>>> loads;
+	for(FileEntry* file : files)
+		loads.push_back(loader.Load(WideToUtf8(file->Path), file->Path, maxSize));
+
+	// Files with the same contents as a resident texture share it instead of uploading
+	// a second copy.
+	const TextureLoader::UploadFunc deviceUpload = TextureLoader::DeviceUpload(device, cmdList);
+	loader.UploadAll([this, &deviceUpload, device](TextureLoader::ParsedTexture& parsed, Texture& texture)
+	{
+		FileEntry& file = mFiles[parsed.Tex->Filename];
+		file.ContentHash = parsed.ContentHash;
+
+		auto it = mContents.find(parsed.ContentHash);
+		if(it == mContents.end())
+		{
+			const HRESULT hr = deviceUpload(parsed, texture);
+			if(FAILED(hr))
+				return hr;
+
+			const D3D12_RESOURCE_DESC desc = texture.Resource->GetDesc();
+
+			ContentEntry& content = mContents[parsed.ContentHash];
+			content.Tex = std::make_unique<Texture>(texture);
+			content.Bytes = device->GetResourceAllocationInfo(0, 1, &desc).SizeInBytes;
+			content.ResidentSize = LargestMip(parsed.Data);
+			content.FullSize = content.ResidentSize;
+			mResidentBytes += content.Bytes;
+
+			// Textures with mips left out keep their file to load them later.
+			if(mStreaming)
+			{
+				DirectX::DDSTextureData12 full;
+				if(SUCCEEDED(DirectX::ParseDDSTextureData12(parsed.File.Data(), parsed.File.Size(), full)))
+					content.FullSize = LargestMip(full);
+				if(content.FullSize > content.ResidentSize)
+					content.File = std::move(parsed.File);
+			}
+			it = mContents.find(parsed.ContentHash);
+		}
+
+		it->second.LastUse = ++mUseClock;
+		file.Resident = true;
+		return S_OK;
+	});
+
+	// Rethrows the DxException of a texture that failed to load.
+	for(auto& load : loads)
+		load.get();
+}
+
+void TextureCache::RequestSize(const Handle& handle, float texels)
+{
+	ContentEntry* content = FindContent(handle);
+	if(content == nullptr)
+		return;
+
+	const std::uint32_t size = texels >= (float)content->FullSize ? content->FullSize
+		: (texels > 0.0f ? (std::uint32_t)texels : 0u);
+	content->RequestedSize = std::max(content->RequestedSize, size);
+	content->LastUse = ++mUseClock;
+}
+
+std::uint32_t TextureCache::GetResidentSize(const Handle& handle)const
+{
+	if(!handle || !handle.mFile->Resident)
+		return 0;
+
+	auto it = mContents.find(handle.mFile->ContentHash);
+	return it != mContents.end() ? it->second.ResidentSize : 0;
+}
+
+TextureCache::ContentEntry* TextureCache::FindContent(const Handle& handle)
+{
+	if(!handle || !handle.mFile->Resident)
+		return nullptr;
+
+	auto it = mContents.find(handle.mFile->ContentHash);
+	return it != mContents.end() ? &it->second : nullptr;
+}
+
+std::vector<Texture*> TextureCache::Stream(ID3D12Device* device, ID3D12GraphicsCommandList* cmdList,
+	std::uint64_t frameFence, std::uint64_t completedFence, std::size_t maxUploads)
+{
+	mRetired.erase(std::remove_if(mRetired.begin(), mRetired.end(),
+		[completedFence](const RetiredResource& retired) { return retired.Fence <= completedFence; }),
+		mRetired.end());
+
+	std::vector<Texture*> changed;
+	if(!mStreaming)
+		return changed;
+
+	// The wanted size is the smallest mip that covers the request, never below the
+	// base size.  Requests start over every frame.
+	std::vector<std::pair<float, ContentEntry*>> grow;   // wanted / resident, texture
+	std::vector<std::pair<std::uint64_t, ContentEntry*>> shrink; // last use, texture
+	for(auto& entry : mContents)
+	{
+		ContentEntry& content = entry.second;
+		if(!content.File.IsOpen())
+			continue;
+
+		const std::uint32_t minSize = std::max(content.RequestedSize, mStreamBaseSize);
+		content.WantedSize = content.FullSize;
+		while(content.WantedSize / 2 >= minSize)
+			content.WantedSize /= 2;
+		content.RequestedSize = 0;
+
+		if(content.BusyUntil > completedFence)
+			continue;
+
+		if(content.WantedSize > content.ResidentSize)
+			grow.push_back(std::make_pair((float)content.WantedSize / content.ResidentSize, &content));
+		else if(content.WantedSize < content.ResidentSize)
+			shrink.push_back(std::make_pair(content.LastUse, &content));
+	}
+
+	std::sort(grow.begin(), grow.end(),
+		[](const std::pair<float, ContentEntry*>& a, const std::pair<float, ContentEntry*>& b) { return a.first > b.first; });
+	std::sort(shrink.begin(), shrink.end(),
+		[](const std::pair<std::uint64_t, ContentEntry*>& a, const std::pair<std::uint64_t, ContentEntry*>& b) { return a.first < b.first; });
+
+	// Textures only shrink to make room, so one that is briefly smaller on screen does
+	// not load its large mips again as soon as it comes back.
+	std::size_t nextShrink = 0;
+	for(const auto& candidate : grow)
+	{
+		if(changed.size() >= maxUploads)
+			break;
+
+		ContentEntry& content = *candidate.second;
+
+		// The memory of a mip chain grows with the area of its largest mip.
+		const float scale = candidate.first;
+		const std::uint64_t growth = (std::uint64_t)((float)content.Bytes * (scale * scale - 1.0f));
+
+		while(mResidentBytes + growth > mBudget && nextShrink < shrink.size())
+		{
+			ContentEntry& victim = *shrink[nextShrink++].second;
+			if(Resize(victim, victim.WantedSize, device, cmdList, frameFence))
+				changed.push_back(victim.Tex.get());
+		}
+
+		if(mResidentBytes + growth > mBudget)
+			break;
+
+		if(Resize(content, content.WantedSize, device, cmdList, frameFence))
+			changed.push_back(content.Tex.get());
+	}
+
+	return changed;
+}
+
+bool TextureCache::Resize(ContentEntry& content, std::uint32_t size, ID3D12Device* device,
+	ID3D12GraphicsCommandList* cmdList, std::uint64_t frameFence)
+{
+	DirectX::DDSTextureData12 data;
+	if(FAILED(DirectX::ParseDDSTextureData12(content.File.Data(), content.File.Size(), data, size)))
+		return false;
+
+	Microsoft::WRL::ComPtr<ID3D12Resource> resource;
+	Microsoft::WRL::ComPtr<ID3D12Resource> uploadHeap;
+	ThrowIfFailed(DirectX::CreateDDSTextureFromData12(device, cmdList, data, resource, uploadHeap));
+
+	// Earlier frames still read the old resource and this one reads the upload heap.
+	RetiredResource retired;
+	retired.Fence = frameFence;
+	retired.Resource = content.Tex->Resource;
+	mRetired.push_back(retired);
+	retired.Resource = uploadHeap;
+	mRetired.push_back(retired);
+
+	const D3D12_RESOURCE_DESC desc = resource->GetDesc();
+	const std::uint64_t bytes = device->GetResourceAllocationInfo(0, 1, &desc).SizeInBytes;
+	mResidentBytes = mResidentBytes - content.Bytes + bytes;
+
+	content.Tex->Resource = resource;
+	content.Bytes = bytes;
+	content.ResidentSize = LargestMip(data);
+	content.BusyUntil = frameFence;
+	return true;
+}
+
+void TextureCache::ReleaseUploadHeaps()
+{
+	for(auto& content : mContents)
+		content.second.Tex->UploadHeap = nullptr;
+}
+
+void TextureCache::Trim()
+{
+	if(mResidentBytes <= mBudget)
+		return;
+
+	std::unordered_map<std::uint64_t, bool> held;
+	for(const auto& file : mFiles)
+	{
+		if(file.second.Refs > 0 && file.second.Resident)
+			held[file.second.ContentHash] = true;
+	}
+
+	std::vector<std::pair<std::uint64_t, std::uint64_t>> unheld; // last use, hash
+	for(const auto& content : mContents)
+	{
+		if(held.find(content.first) == held.end())
+			unheld.push_back(std::make_pair(content.second.LastUse, content.first));
+	}
+	std::sort(unheld.begin(), unheld.end());
+
+	for(const auto& entry : unheld)
+	{
+		if(mResidentBytes <= mBudget)
+			break;
+		Evict(entry.second);
+	}
+}
+
+void TextureCache::Clear()
+{
+	mRetired.clear();
+	while(!mContents.empty())
+		Evict(mContents.begin()->first);
+}
+
+void TextureCache::Evict(std::uint64_t contentHash)
+{
+	auto it = mContents.find(contentHash);
+	if(it == mContents.end())
+		return;
+
+	mResidentBytes -= it->second.Bytes;
+	mContents.erase(it);
+
+	for(auto& file : mFiles)
+	{
+		if(file.second.Resident && file.second.ContentHash == contentHash)
+			file.second.Resident = false;
+	}
+}
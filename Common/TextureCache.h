@@ -0,0 +1,154 @@
+//***************************************************************************************
+// TextureCache.h
+//
+// Process-wide cache of loaded textures.  Files are keyed by their canonical path and
+// loaded textures by a hash of the file contents, so a texture referenced under several
+// names, paths or copies is only loaded once.  Users hold counted handles; nothing is
+// loaded until a texture is first used, and textures nobody holds stay resident until
+// the cache goes over its memory budget, least recently used first.
+//
+// With streaming on, textures first load only their small mips and grow or shrink
+// toward the size their users request each frame, within the budget.
+//
+// The cache is not thread safe; use it from the thread that owns the command list.
+//***************************************************************************************
+
+#ifndef TEXTURECACHE_H
+#define TEXTURECACHE_H
+
+#include "TextureLoader.h"
+#include <unordered_map>
+
+class TextureCache
+{
+	struct FileEntry;
+
+public:
+	// A counted reference to a texture file.
+	class Handle
+	{
+	public:
+		Handle() = default;
+		Handle(const Handle& rhs);
+		Handle(Handle&& rhs);
+		Handle& operator=(Handle rhs);
+		~Handle();
+
+		// The texture if it is resident, nullptr otherwise.
+		Texture* Get()const;
+		Texture* operator->()const { return Get(); }
+		explicit operator bool()const { return mFile != nullptr; }
+
+	private:
+		friend class TextureCache;
+		explicit Handle(FileEntry* file);
+
+		FileEntry* mFile = nullptr;
+	};
+
+	static TextureCache& Instance();
+
+	// Resident textures nobody holds are freed once the total goes over this.
+	void SetBudget(std::uint64_t bytes);
+	std::uint64_t GetBudget()const { return mBudget; }
+
+	// References a texture file without loading it.
+	Handle Acquire(const std::wstring& filename);
+
+	// The texture, loaded first if this is its first use.
+	Texture* Use(const Handle& handle, ID3D12Device* device, ID3D12GraphicsCommandList* cmdList);
+
+	// Loads every held texture that is not resident, in parallel, and records the
+	// uploads on cmdList.
+	void LoadHeld(ID3D12Device* device, ID3D12GraphicsCommandList* cmdList);
+
+	// Frees the upload heaps.  Call once the GPU has executed the recorded uploads.
+	void ReleaseUploadHeaps();
+
+	// Frees textures nobody holds, least recently used first, until the cache fits its
+	// budget.  Call only when the GPU is no longer using textures that were released.
+	void Trim();
+
+	// Frees every texture, held or not.  Handles stay valid and load again on use.
+	void Clear();
+
+	// Loads textures with their mips up to baseSize only, and keeps their files mapped
+	// so Stream can load larger mips later.  Affects textures loaded afterwards.
+	void SetStreaming(bool enabled, std::uint32_t baseSize = 64);
+	bool IsStreaming()const { return mStreaming; }
+
+	// Asks for at least texels across the largest mip of the texture this frame.
+	// Requests from every user of a texture are combined by taking the largest.
+	void RequestSize(const Handle& handle, float texels);
+
+	// Moves streamed textures toward the sizes requested since the last call.  The
+	// textures furthest below their request grow first, at most maxUploads per call;
+	// when growing would go over the budget, textures larger than requested shrink,
+	// least recently used first.  A texture that changed gets a new resource, so the
+	// caller must create new views for every texture returned.  The resources replaced
+	// are kept until completedFence reaches frameFence, the fence the frame recorded on
+	// cmdList signals, and a texture does not change again until then.
+	std::vector<Texture*> Stream(ID3D12Device* device, ID3D12GraphicsCommandList* cmdList,
+		std::uint64_t frameFence, std::uint64_t completedFence, std::size_t maxUploads = 2);
+
+	// Size of the largest resident mip of the texture, 0 if it is not resident.
+	std::uint32_t GetResidentSize(const Handle& handle)const;
+
+	std::uint64_t GetResidentBytes()const { return mResidentBytes; }
+	std::size_t GetResidentCount()const { return mContents.size(); }
+
+	static std::wstring CanonicalPath(const std::wstring& filename);
+
+private:
+	struct FileEntry
+	{
+		std::wstring Path;
+		std::uint32_t Refs = 0;
+		bool Resident = false;
+		std::uint64_t ContentHash = 0;
+	};
+
+	struct ContentEntry
+	{
+		std::unique_ptr<Texture> Tex;
+		std::uint64_t Bytes = 0;
+		std::uint64_t LastUse = 0;
+
+		// Streaming state.  File stays mapped while the texture can still grow.
+		MappedFile File;
+		std::uint32_t FullSize = 0;
+		std::uint32_t ResidentSize = 0;
+		std::uint32_t RequestedSize = 0;
+		std::uint32_t WantedSize = 0;
+		std::uint64_t BusyUntil = 0;
+	};
+
+	// A replaced resource the GPU may still be reading.
+	struct RetiredResource
+	{
+		std::uint64_t Fence = 0;
+		Microsoft::WRL::ComPtr<ID3D12Resource> Resource;
+	};
+
+	TextureCache() = default;
+
+	void Load(const std::vector<FileEntry*>& files, ID3D12Device* device, ID3D12GraphicsCommandList* cmdList);
+	void Evict(std::uint64_t contentHash);
+	bool Resize(ContentEntry& content, std::uint32_t size, ID3D12Device* device,
+		ID3D12GraphicsCommandList* cmdList, std::uint64_t frameFence);
+	ContentEntry* FindContent(const Handle& handle);
+
+	std::unordered_map<std::wstring, FileEntry> mFiles;
+	std::unordered_map<std::uint64_t, ContentEntry> mContents;
+
+	std::vector<RetiredResource> mRetired;
+
+	bool mStreaming = false;
+	std::uint32_t mStreamBaseSize = 64;
+
+	std::uint64_t mBudget = 512ull << 20;
+	std::uint64_t mResidentBytes = 0;
+	std::uint64_t mUseClock = 0;
+};
+
+#endif // TEXTURECACHE_H
@@ -0,0 +1,164 @@
+//***************************************************************************************
+// TextureLoader.cpp
+//***************************************************************************************
+
+#include "TextureLoader.h"
+#include "Profiler.h"
+#include <cstring>
+
+namespace
+{
+	std::exception_ptr LoadError(HRESULT hr, const wchar_t* functionName, const std::wstring& filename)
+	{
+		return std::make_exception_ptr(DxException(hr, functionName, filename, __LINE__));
+	}
+}
+
+TextureLoader::~TextureLoader()
+{
+	// Nothing may still write to the queue once it is gone.
+	mWorkers.wait();
+}
+
+std::future<std::unique_ptr<Texture>> TextureLoader::Load(const std::string& name, const std::wstring& filename,
+	std::size_t maxSize)
+{
+	auto parsed = std::make_unique<ParsedTexture>();
+	parsed->Tex = std::make_unique<Texture>();
+	parsed->Tex->Name = name;
+	parsed->Tex->Filename = filename;
+	parsed->MaxSize = maxSize;
+
+	std::future<std::unique_ptr<Texture>> done = parsed->Done.get_future();
+
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		++mPending;
+	}
+
+	// task_group copies the functor, so the worker takes ownership from a raw pointer.
+	ParsedTexture* work = parsed.release();
+	mWorkers.run([this, work]()
+	{
+		std::unique_ptr<ParsedTexture> parsed(work);
+		Parse(*parsed);
+
+		std::lock_guard<std::mutex> lock(mMutex);
+		mReady.push_back(std::move(parsed));
+		mReadyChanged.notify_all();
+	});
+
+	return done;
+}
+
+void TextureLoader::Parse(ParsedTexture& parsed)
+{
+	PROFILE_SCOPE("ParseTexture");
+
+	parsed.Result = DirectX::LoadDDSTextureDataFromFile12(parsed.Tex->Filename.c_str(), parsed.File, parsed.Data,
+		parsed.MaxSize);
+
+	// A texture whose mips are all larger than MaxSize loads at full size.
+	if(parsed.Result == E_FAIL && parsed.MaxSize != 0 && parsed.File.IsOpen())
+		parsed.Result = DirectX::ParseDDSTextureData12(parsed.File.Data(), parsed.File.Size(), parsed.Data);
+	if(FAILED(parsed.Result))
+		return;
+
+	// Hashing reads every page, so the file is read here and not while the upload stage
+	// copies it into the upload heap.
+	parsed.ContentHash = HashContents(parsed.File.Data(), parsed.File.Size());
+}
+
+std::uint64_t TextureLoader::HashContents(const std::uint8_t* data, std::size_t size)
+{
+	// FNV-1a over 64-bit words, with a final avalanche so the low bits mix too.
+	const std::uint64_t prime = 0x100000001b3ull;
+	std::uint64_t hash = 0xcbf29ce484222325ull ^ (std::uint64_t)size;
+
+	std::size_t i = 0;
+	for(; i + sizeof(std::uint64_t) <= size; i += sizeof(std::uint64_t))
+	{
+		std::uint64_t word;
+		std::memcpy(&word, data + i, sizeof(word));
+		hash = (hash ^ word) * prime;
+	}
+	for(; i < size; ++i)
+		hash = (hash ^ data[i]) * prime;
+
+	hash ^= hash >> 33;
+	hash *= 0xff51afd7ed558ccdull;
+	hash ^= hash >> 33;
+	return hash;
+}
+
+std::size_t TextureLoader::UploadReady(const UploadFunc& upload)
+{
+	std::deque<std::unique_ptr<ParsedTexture>> ready;
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		ready.swap(mReady);
+	}
+
+	for(auto& parsed : ready)
+	{
+		PROFILE_SCOPE("UploadTexture");
+
+		if(FAILED(parsed->Result))
+		{
+			parsed->Done.set_exception(LoadError(parsed->Result, L"LoadDDSTextureDataFromFile12", parsed->Tex->Filename));
+			continue;
+		}
+
+		try
+		{
+			const HRESULT hr = upload(*parsed, *parsed->Tex);
+			if(FAILED(hr))
+				parsed->Done.set_exception(LoadError(hr, L"CreateDDSTextureFromData12", parsed->Tex->Filename));
+			else
+				parsed->Done.set_value(std::move(parsed->Tex));
+		}
+		catch(...)
+		{
+			parsed->Done.set_exception(std::current_exception());
+		}
+	}
+
+	if(!ready.empty())
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mPending -= ready.size();
+	}
+
+	// Unmaps the files.
+	return ready.size();
+}
+
+void TextureLoader::UploadAll(const UploadFunc& upload)
+{
+	for(;;)
+	{
+		{
+			std::unique_lock<std::mutex> lock(mMutex);
+			mReadyChanged.wait(lock, [this]() { return !mReady.empty() || mPending == 0; });
+			if(mReady.empty())
+				return;
+		}
+
+		UploadReady(upload);
+	}
+}
+
+std::size_t TextureLoader::PendingCount()const
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	return mPending;
+}
+
+TextureLoader::UploadFunc TextureLoader::DeviceUpload(ID3D12Device* device, ID3D12GraphicsCommandList* cmdList)
+{
+	return [device, cmdList](ParsedTexture& parsed, Texture& texture)
+	{
+		return DirectX::CreateDDSTextureFromData12(device, cmdList, parsed.Data,
+			texture.Resource, texture.UploadHeap);
+	};
+}
@@ -0,0 +1,83 @@
+//***************************************************************************************
+// TextureLoader.h
+//
+// Loads textures in parallel.  Workers map and parse the DDS files and hash their
+// contents, so the disk reads overlap instead of queueing behind each other, then hand the
+// parsed textures to the upload stage through a queue.  The upload stage runs on the
+// thread recording the command list and creates and uploads one texture at a time.
+// Every load returns a future that is ready once its texture has been uploaded.
+//
+// The workers never touch a device, and the upload stage is a function the caller
+// passes in, so the whole pipeline can run headless.
+//***************************************************************************************
+
+#ifndef TEXTURELOADER_H
+#define TEXTURELOADER_H
+
+#include "d3dUtil.h"
+#include <ppl.h>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+
+class TextureLoader
+{
+public:
+	// A texture parsed by a worker, waiting for the upload stage.  Data points into
+	// File, which is unmapped once the upload stage is done with it unless the stage
+	// moves it out to keep it.
+	struct ParsedTexture
+	{
+		std::unique_ptr<Texture> Tex;
+		MappedFile File;
+		std::size_t MaxSize = 0;
+		DirectX::DDSTextureData12 Data;
+		std::uint64_t ContentHash = 0;
+		HRESULT Result = S_OK;
+		std::promise<std::unique_ptr<Texture>> Done;
+	};
+
+	// Creates the resources for a parsed texture and records its upload.
+	typedef std::function<HRESULT(ParsedTexture& parsed, Texture& texture)> UploadFunc;
+
+	TextureLoader() = default;
+	TextureLoader(const TextureLoader& rhs) = delete;
+	TextureLoader& operator=(const TextureLoader& rhs) = delete;
+	~TextureLoader();
+
+	// Queues the file for a worker.  Mips larger than maxSize are skipped unless that
+	// leaves none.  The future throws a DxException if the file cannot be loaded or
+	// uploaded.
+	std::future<std::unique_ptr<Texture>> Load(const std::string& name, const std::wstring& filename,
+		std::size_t maxSize = 0);
+
+	// Runs the upload stage on the textures parsed so far and returns how many.
+	std::size_t UploadReady(const UploadFunc& upload);
+
+	// Runs the upload stage until every queued load has finished.
+	void UploadAll(const UploadFunc& upload);
+
+	// Loads queued and not through the upload stage yet.
+	std::size_t PendingCount()const;
+
+	// 64-bit hash of a block of memory, used to spot identical files.
+	static std::uint64_t HashContents(const std::uint8_t* data, std::size_t size);
+
+	// The upload stage of a device: creates the texture and its upload heap and
+	// records the copy on cmdList.
+	static UploadFunc DeviceUpload(ID3D12Device* device, ID3D12GraphicsCommandList* cmdList);
+
+private:
+	void Parse(ParsedTexture& parsed);
+
+	concurrency::task_group mWorkers;
+
+	mutable std::mutex mMutex;
+	std::condition_variable mReadyChanged;
+	std::deque<std::unique_ptr<ParsedTexture>> mReady;
+	std::size_t mPending = 0;
+};
+
+#endif // TEXTURELOADER_H
@@ -3,6 +3,8 @@
 //***************************************************************************************
 
 #include "d3dApp.h"
+#include "Profiler.h"
+#include <chrono>
 #include <WindowsX.h>
 
 using Microsoft::WRL::ComPtr;
@@ -17,6 +19,11 @@ MainWndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
     return D3DApp::GetApp()->MsgProc(hwnd, msg, wParam, lParam);
 }
 
+// Frames kept for the frame time percentiles, and the frame time counted as a hitch
+// (two missed vsyncs at 60 Hz).
+static const std::uint32_t gFrameStatsWindow = 4096;
+static const float gHitchMs = 33.3f;
+
 D3DApp* D3DApp::mApp = nullptr;
 D3DApp* D3DApp::GetApp()
 {
@@ -24,7 +31,8 @@ D3DApp* D3DApp::GetApp()
 }
 
 D3DApp::D3DApp(HINSTANCE hInstance)
-:	mhAppInst(hInstance)
+:	mhAppInst(hInstance),
+	mFrameStats(gFrameStatsWindow, gHitchMs)
 {
     // Only one D3DApp can be constructed.
     assert(mApp == nullptr);
@@ -35,6 +43,9 @@ D3DApp::~D3DApp()
 {
 	if(md3dDevice != nullptr)
 		FlushCommandQueue();
+
+	if(mFenceEvent != nullptr)
+		CloseHandle(mFenceEvent);
 }
 
 HINSTANCE D3DApp::AppInst()const
@@ -69,12 +80,23 @@ void D3DApp::Set4xMsaaState(bool value)
     }
 }
 
+void D3DApp::SetTargetFps(float fps)
+{
+	mFramePacer.SetTargetFps(fps);
+}
+
 int D3DApp::Run()
 {
 	MSG msg = {0};
  
 	mTimer.Reset();
 
+	Profiler::SetThreadName("Main");
+
+	// Frame times come from the wall clock rather than the timer, which may be
+	// running on a fixed step.
+	auto lastFrame = std::chrono::steady_clock::now();
+
 	while(msg.message != WM_QUIT)
 	{
 		// If there are Window messages then process them.
@@ -88,19 +110,38 @@ int D3DApp::Run()
         {	
 			mTimer.Tick();
 
+			const auto cpuStart = std::chrono::steady_clock::now();
+			const float frameMs = std::chrono::duration<float, std::milli>(cpuStart - lastFrame).count();
+			lastFrame = cpuStart;
+
 			if( !mAppPaused )
 			{
 				CalculateFrameStats();
-				Update(mTimer);	
-                Draw(mTimer);
+
+				{
+					PROFILE_SCOPE("Update");
+					Update(mTimer);
+				}
+				{
+					PROFILE_SCOPE("Draw");
+					Draw(mTimer);
+				}
+				const float cpuMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - cpuStart).count();
+
+				mFrameStats.AddFrame(frameMs, cpuMs);
+
+				mFramePacer.WaitForNextFrame();
 			}
 			else
 			{
 				Sleep(100);
+				lastFrame = std::chrono::steady_clock::now();
 			}
         }
     }
 
+	WriteFrameStats();
+
 	return (int)msg.wParam;
 }
 
@@ -364,6 +405,23 @@ LRESULT D3DApp::MsgProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
         }
         else if((int)wParam == VK_F2)
             Set4xMsaaState(!m4xMsaaState);
+        else if((int)wParam == VK_F7)
+        {
+            // Cycle the frame rate cap: off, 30, 60, 120.
+            const float target = mFramePacer.GetTargetFps();
+            const float next = target == 0.0f ? 30.0f : (target < 120.0f ? target * 2.0f : 0.0f);
+            mFramePacer.SetTargetFps(next);
+        }
+        else if((int)wParam == VK_F8)
+            WriteFrameStats();
+        else if((int)wParam == VK_F9)
+        {
+            std::string error;
+            if(Profiler::WriteChromeTrace("profile.json", error))
+                OutputDebugStringA("Wrote profile.json\n");
+            else
+                OutputDebugStringA(("Profiler: " + error + "\n").c_str());
+        }
 
         return 0;
 	}
@@ -465,6 +523,12 @@ bool D3DApp::InitDirect3D()
 	ThrowIfFailed(md3dDevice->CreateFence(0, D3D12_FENCE_FLAG_NONE,
 		IID_PPV_ARGS(&mFence)));
 
+	// One event serves every fence wait of the window thread instead of creating one
+	// per wait.
+	mFenceEvent = CreateEventEx(nullptr, nullptr, false, EVENT_ALL_ACCESS);
+	if(mFenceEvent == nullptr)
+		ThrowIfFailed(HRESULT_FROM_WIN32(GetLastError()));
+
 	mRtvDescriptorSize = md3dDevice->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_RTV);
 	mDsvDescriptorSize = md3dDevice->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_DSV);
 	mCbvSrvUavDescriptorSize = md3dDevice->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
@@ -563,16 +627,23 @@ void D3DApp::FlushCommandQueue()
     ThrowIfFailed(mCommandQueue->Signal(mFence.Get(), mCurrentFence));
 
 	//! Wait until the GPU has completed commands up to this fence point.
-    if(mFence->GetCompletedValue() < mCurrentFence)
-	{
-		HANDLE eventHandle = CreateEventEx(nullptr, nullptr, false, EVENT_ALL_ACCESS);
+	WaitForFence(mCurrentFence);
+}
+
+void D3DApp::WaitForFence(UINT64 value)
+{
+	WaitForFence(value, mFenceEvent);
+}
 
-        //! Fire event when GPU hits current fence.  
-        ThrowIfFailed(mFence->SetEventOnCompletion(mCurrentFence, eventHandle));
+void D3DApp::WaitForFence(UINT64 value, HANDLE event)
+{
+    if(mFence->GetCompletedValue() < value)
+	{
+        //! Fire event when GPU hits the fence value.
+        ThrowIfFailed(mFence->SetEventOnCompletion(value, event));
 
         //! Wait until the GPU hits current fence event is fired.
-		WaitForSingleObject(eventHandle, INFINITE);
-        CloseHandle(eventHandle);
+		WaitForSingleObject(event, INFINITE);
 	}
 }
 
@@ -598,36 +669,51 @@ D3D12_CPU_DESCRIPTOR_HANDLE D3DApp::DepthStencilView()const
 
 void D3DApp::CalculateFrameStats()
 {
-	// Code computes the average frames per second, and also the 
-	// average time it takes to render one frame.  These stats 
-	// are appended to the window caption bar.
-    
-	static int frameCnt = 0;
-	static float timeElapsed = 0.0f;
+	// Code computes the average frames per second over one second, plus the
+	// percentiles of the recent frame times, which show the stutters an average
+	// hides.  These stats are appended to the window caption bar.
 
-	frameCnt++;
+	mStatsFrameCount++;
 
 	// Compute averages over one second period.
-	if( (mTimer.TotalTime() - timeElapsed) >= 1.0f )
+	if( (mTimer.TotalTime() - mStatsTimeElapsed) >= 1.0f )
 	{
-		float fps = (float)frameCnt; // fps = frameCnt / 1
+		float fps = (float)mStatsFrameCount; // fps = frameCnt / 1
 		float mspf = 1000.0f / fps;
 
+		const FrameStats::Summary frameTimes = mFrameStats.GetFrameTimes();
+
         wstring fpsStr = to_wstring(fps);
         wstring mspfStr = to_wstring(mspf);
 
         wstring windowText = mMainWndCaption +
             L"    fps: " + fpsStr +
-            L"   mspf: " + mspfStr;
+            L"   mspf: " + mspfStr +
+            L"   p50/p95/p99/max: " + to_wstring(frameTimes.P50) + L"/" + to_wstring(frameTimes.P95) +
+            L"/" + to_wstring(frameTimes.P99) + L"/" + to_wstring(frameTimes.Max) +
+            L"   hitches: " + to_wstring(frameTimes.Hitches) +
+            L"   latency: " + to_wstring(mFramePacer.GetLatencyMs()) +
+            L"   in flight: " + to_wstring(mFramePacer.GetFramesInFlight()) +
+            GetFrameStatsText();
 
         SetWindowText(mhMainWnd, windowText.c_str());
+		LogFrameStats();
 		
 		// Reset for next average.
-		frameCnt = 0;
-		timeElapsed += 1.0f;
+		mStatsFrameCount = 0;
+		mStatsTimeElapsed += 1.0f;
 	}
 }
 
+void D3DApp::WriteFrameStats()
+{
+	std::string error;
+	if(mFrameStats.WriteCsv("frame_stats.csv", error))
+		OutputDebugStringA("Wrote frame_stats.csv\n");
+	else
+		OutputDebugStringA(("Frame stats: " + error + "\n").c_str());
+}
+
 //! Display adapters implement graphical functionality. Usually, the display adapter
 //! is a physical piece of hardware(e.g., graphics card); however, a system can also have a
 //! software display adapter that emulates hardware graphics functionality.A system can have
@@ -9,6 +9,8 @@
 
 #include "d3dUtil.h"
 #include "GameTimer.h"
+#include "FrameStats.h"
+#include "FramePacer.h"
 
 // Link necessary d3d12 libraries.
 #pragma comment(lib,"d3dcompiler.lib")
@@ -35,6 +37,9 @@ public:
     bool Get4xMsaaState()const;
     void Set4xMsaaState(bool value);
 
+	// Caps the frame rate; 0 runs uncapped.
+	void SetTargetFps(float fps);
+
 	int Run();
  
     virtual bool Initialize();
@@ -60,11 +65,23 @@ protected:
 
 	void FlushCommandQueue();
 
+	// Blocks until the GPU has passed the fence value.  mFenceEvent serves one waiting
+	// thread at a time; another thread has to wait on an event of its own.
+	void WaitForFence(UINT64 value);
+	void WaitForFence(UINT64 value, HANDLE event);
+
 	ID3D12Resource* CurrentBackBuffer()const;
 	D3D12_CPU_DESCRIPTOR_HANDLE CurrentBackBufferView()const;
 	D3D12_CPU_DESCRIPTOR_HANDLE DepthStencilView()const;
 
 	void CalculateFrameStats();
+	void WriteFrameStats();
+
+	// Derived classes can append their own per-frame statistics to the window caption.
+	virtual std::wstring GetFrameStatsText()const { return L""; }
+
+	// Called with the caption update, once per second, for stats that go to the debug output.
+	virtual void LogFrameStats() { }
 
     void LogAdapters();
     void LogAdapterOutputs(IDXGIAdapter* adapter);
@@ -88,6 +105,16 @@ protected:
 
 	// Used to keep track of the delta-time and game time.
 	GameTimer mTimer;
+
+	// Frame and CPU times of the recent frames, and the frames counted toward the
+	// caption's one second fps average.
+	FrameStats mFrameStats;
+	int mStatsFrameCount = 0;
+	float mStatsTimeElapsed = 0.0f;
+
+	// Waits out the rest of each frame at the target rate, and decides how many
+	// frames may be in flight.
+	FramePacer mFramePacer;
 	
     Microsoft::WRL::ComPtr<IDXGIFactory4> mdxgiFactory;
     Microsoft::WRL::ComPtr<IDXGISwapChain> mSwapChain;
@@ -95,6 +122,7 @@ protected:
 
     Microsoft::WRL::ComPtr<ID3D12Fence> mFence;
     UINT64 mCurrentFence = 0;
+	HANDLE mFenceEvent = nullptr;
 	
     Microsoft::WRL::ComPtr<ID3D12CommandQueue> mCommandQueue;
     Microsoft::WRL::ComPtr<ID3D12CommandAllocator> mDirectCmdListAlloc;
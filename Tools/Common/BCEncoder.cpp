@@ -0,0 +1,1125 @@
+//***************************************************************************************
+// BCEncoder.cpp
+//***************************************************************************************
+
+#include "BCEncoder.h"
+#include <algorithm>
+#include <atomic>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <thread>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define BCENCODER_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+	const std::uint32_t AllTexels = 0xffff;
+
+	// The texels of one block, an array per channel so four texels fill an SSE register.
+	struct alignas(16) BlockTexels
+	{
+		float C[4][16];
+	};
+
+	void LoadTexels(const std::uint8_t texels[64], BlockTexels& block)
+	{
+		for(int i = 0; i < 16; ++i)
+		{
+			for(int c = 0; c < 4; ++c)
+				block.C[c][i] = texels[i * 4 + c];
+		}
+	}
+
+	int Count(std::uint32_t mask)
+	{
+		int count = 0;
+		for(; mask; mask &= mask - 1)
+			++count;
+		return count;
+	}
+
+	float Clamp255(float value)
+	{
+		return value < 0.0f ? 0.0f : (value > 255.0f ? 255.0f : value);
+	}
+
+	int ClampInt(int value, int lo, int hi)
+	{
+		return value < lo ? lo : (value > hi ? hi : value);
+	}
+
+	// Picks the nearest palette entry for every texel, comparing channelCount channels
+	// from firstChannel.  Returns the squared error summed over the texels in mask.
+	float SelectIndices(const BlockTexels& block, int firstChannel, int channelCount,
+		const float (*palette)[4], int paletteSize, std::uint32_t mask, std::uint8_t indices[16])
+	{
+		alignas(16) float errors[16];
+
+#ifdef BCENCODER_SSE2
+		for(int group = 0; group < 16; group += 4)
+		{
+			__m128 texel[4];
+			for(int c = 0; c < channelCount; ++c)
+				texel[c] = _mm_load_ps(&block.C[firstChannel + c][group]);
+
+			__m128 best = _mm_set1_ps(FLT_MAX);
+			__m128i bestIndex = _mm_setzero_si128();
+
+			for(int p = 0; p < paletteSize; ++p)
+			{
+				__m128 distance = _mm_setzero_ps();
+				for(int c = 0; c < channelCount; ++c)
+				{
+					const __m128 diff = _mm_sub_ps(texel[c], _mm_set1_ps(palette[p][firstChannel + c]));
+					distance = _mm_add_ps(distance, _mm_mul_ps(diff, diff));
+				}
+
+				// Strictly less, so ties keep the lower index like the scalar path.
+				const __m128i closer = _mm_castps_si128(_mm_cmplt_ps(distance, best));
+				best = _mm_min_ps(distance, best);
+				bestIndex = _mm_or_si128(_mm_and_si128(closer, _mm_set1_epi32(p)), _mm_andnot_si128(closer, bestIndex));
+			}
+
+			alignas(16) std::int32_t picked[4];
+			_mm_store_si128(reinterpret_cast<__m128i*>(picked), bestIndex);
+			_mm_store_ps(&errors[group], best);
+			for(int i = 0; i < 4; ++i)
+				indices[group + i] = (std::uint8_t)picked[i];
+		}
+#else
+		for(int i = 0; i < 16; ++i)
+		{
+			float best = FLT_MAX;
+			int bestIndex = 0;
+			for(int p = 0; p < paletteSize; ++p)
+			{
+				float distance = 0.0f;
+				for(int c = 0; c < channelCount; ++c)
+				{
+					const float diff = block.C[firstChannel + c][i] - palette[p][firstChannel + c];
+					distance += diff * diff;
+				}
+				if(distance < best)
+				{
+					best = distance;
+					bestIndex = p;
+				}
+			}
+			indices[i] = (std::uint8_t)bestIndex;
+			errors[i] = best;
+		}
+#endif
+
+		float total = 0.0f;
+		for(int i = 0; i < 16; ++i)
+		{
+			if(mask & (1u << i))
+				total += errors[i];
+		}
+		return total;
+	}
+
+	// The ends of the texels' principal axis, over the texels in mask.
+	void FitLine(const BlockTexels& block, int firstChannel, int channelCount, std::uint32_t mask,
+		float e0[4], float e1[4])
+	{
+		const float count = (float)Count(mask);
+
+		float mean[4] = {};
+		for(int c = 0; c < channelCount; ++c)
+		{
+			for(int i = 0; i < 16; ++i)
+			{
+				if(mask & (1u << i))
+					mean[c] += block.C[firstChannel + c][i];
+			}
+			mean[c] /= count;
+		}
+
+		float covariance[4][4] = {};
+		for(int i = 0; i < 16; ++i)
+		{
+			if(!(mask & (1u << i)))
+				continue;
+			for(int a = 0; a < channelCount; ++a)
+			{
+				const float da = block.C[firstChannel + a][i] - mean[a];
+				for(int b = a; b < channelCount; ++b)
+					covariance[a][b] += da * (block.C[firstChannel + b][i] - mean[b]);
+			}
+		}
+		for(int a = 0; a < channelCount; ++a)
+		{
+			for(int b = 0; b < a; ++b)
+				covariance[a][b] = covariance[b][a];
+		}
+
+		// Power iteration, starting from the column of the channel that varies the most.
+		int start = 0;
+		for(int c = 1; c < channelCount; ++c)
+		{
+			if(covariance[c][c] > covariance[start][start])
+				start = c;
+		}
+
+		float axis[4] = {};
+		for(int c = 0; c < channelCount; ++c)
+			axis[c] = covariance[c][start];
+
+		for(int iteration = 0; iteration < 8; ++iteration)
+		{
+			float next[4] = {};
+			float length = 0.0f;
+			for(int a = 0; a < channelCount; ++a)
+			{
+				for(int b = 0; b < channelCount; ++b)
+					next[a] += covariance[a][b] * axis[b];
+				length += next[a] * next[a];
+			}
+
+			if(length < 1e-12f)
+				break;
+			length = 1.0f / std::sqrt(length);
+			for(int c = 0; c < channelCount; ++c)
+				axis[c] = next[c] * length;
+		}
+
+		float tMin = FLT_MAX, tMax = -FLT_MAX;
+		for(int i = 0; i < 16; ++i)
+		{
+			if(!(mask & (1u << i)))
+				continue;
+			float t = 0.0f;
+			for(int c = 0; c < channelCount; ++c)
+				t += (block.C[firstChannel + c][i] - mean[c]) * axis[c];
+			tMin = std::min(tMin, t);
+			tMax = std::max(tMax, t);
+		}
+
+		for(int c = 0; c < channelCount; ++c)
+		{
+			e0[c] = Clamp255(mean[c] + tMin * axis[c]);
+			e1[c] = Clamp255(mean[c] + tMax * axis[c]);
+		}
+	}
+
+	// The endpoints that best reproduce the texels in mask given their palette picks,
+	// where picking index k puts a texel weights[k] of the way from e0 to e1.  Entries
+	// of weights below zero are not interpolated and their texels are skipped.
+	bool LeastSquares(const BlockTexels& block, int firstChannel, int channelCount, std::uint32_t mask,
+		const std::uint8_t indices[16], const float* weights, float e0[4], float e1[4])
+	{
+		float a = 0.0f, b = 0.0f, c = 0.0f;
+		float x[4] = {}, y[4] = {};
+
+		for(int i = 0; i < 16; ++i)
+		{
+			const float w = weights[indices[i]];
+			if(!(mask & (1u << i)) || w < 0.0f)
+				continue;
+
+			const float iw = 1.0f - w;
+			a += iw * iw;
+			b += iw * w;
+			c += w * w;
+			for(int ch = 0; ch < channelCount; ++ch)
+			{
+				x[ch] += iw * block.C[firstChannel + ch][i];
+				y[ch] += w * block.C[firstChannel + ch][i];
+			}
+		}
+
+		const float det = a * c - b * b;
+		if(std::fabs(det) < 1e-6f)
+			return false;
+
+		const float invDet = 1.0f / det;
+		for(int ch = 0; ch < channelCount; ++ch)
+		{
+			e0[ch] = Clamp255((c * x[ch] - b * y[ch]) * invDet);
+			e1[ch] = Clamp255((a * y[ch] - b * x[ch]) * invDet);
+		}
+
+		return true;
+	}
+
+	int RefinePasses(BCQuality quality)
+	{
+		switch(quality)
+		{
+		case BCQuality::Fast: return 0;
+		case BCQuality::Normal: return 2;
+		default: return 6;
+		}
+	}
+
+	void PutLE16(std::uint8_t* p, std::uint16_t value)
+	{
+		p[0] = (std::uint8_t)value;
+		p[1] = (std::uint8_t)(value >> 8);
+	}
+
+	//***********************************************************************************
+	// BC1 colors, also the color half of BC3
+	//***********************************************************************************
+
+	std::uint16_t To565(const float color[4])
+	{
+		const int r = ClampInt((int)(color[0] * 31.0f / 255.0f + 0.5f), 0, 31);
+		const int g = ClampInt((int)(color[1] * 63.0f / 255.0f + 0.5f), 0, 63);
+		const int b = ClampInt((int)(color[2] * 31.0f / 255.0f + 0.5f), 0, 31);
+		return (std::uint16_t)((r << 11) | (g << 5) | b);
+	}
+
+	void From565(std::uint16_t value, int color[3])
+	{
+		const int r = value >> 11;
+		const int g = (value >> 5) & 63;
+		const int b = value & 31;
+		color[0] = (r << 3) | (r >> 2);
+		color[1] = (g << 2) | (g >> 4);
+		color[2] = (b << 3) | (b >> 2);
+	}
+
+	// The four colors of a BC1 block, with index 3 transparent black in three color mode.
+	void ColorPalette(std::uint16_t c0, std::uint16_t c1, bool fourColor, std::uint8_t palette[4][4])
+	{
+		int a[3], b[3];
+		From565(c0, a);
+		From565(c1, b);
+
+		for(int c = 0; c < 3; ++c)
+		{
+			palette[0][c] = (std::uint8_t)a[c];
+			palette[1][c] = (std::uint8_t)b[c];
+			if(fourColor)
+			{
+				palette[2][c] = (std::uint8_t)((2 * a[c] + b[c]) / 3);
+				palette[3][c] = (std::uint8_t)((a[c] + 2 * b[c]) / 3);
+			}
+			else
+			{
+				palette[2][c] = (std::uint8_t)((a[c] + b[c]) / 2);
+				palette[3][c] = 0;
+			}
+		}
+
+		palette[0][3] = palette[1][3] = palette[2][3] = 255;
+		palette[3][3] = fourColor ? 255 : 0;
+	}
+
+	struct ColorBlock
+	{
+		std::uint16_t C0 = 0;
+		std::uint16_t C1 = 0;
+		std::uint8_t Indices[16] = {};
+		float Error = FLT_MAX;
+	};
+
+	// Fits the texels in mask in four or three color mode.  Texels outside mask are left
+	// transparent, which needs three color mode.
+	ColorBlock EncodeColors(const BlockTexels& block, std::uint32_t mask, bool fourColor, BCQuality quality)
+	{
+		static const float fourWeights[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+		static const float threeWeights[4] = { 0.0f, 1.0f, 0.5f, -1.0f };
+
+		ColorBlock best;
+		if(mask == 0)
+		{
+			// Nothing but transparent texels: equal endpoints select three color mode.
+			std::memset(best.Indices, 3, sizeof(best.Indices));
+			best.Error = 0.0f;
+			return best;
+		}
+
+		float e0[4], e1[4];
+		FitLine(block, 0, 3, mask, e0, e1);
+
+		const int passes = RefinePasses(quality);
+		for(int pass = 0; pass <= passes; ++pass)
+		{
+			ColorBlock candidate;
+			candidate.C0 = To565(e0);
+			candidate.C1 = To565(e1);
+
+			std::uint8_t palette8[4][4];
+			ColorPalette(candidate.C0, candidate.C1, fourColor, palette8);
+			float palette[4][4];
+			for(int p = 0; p < 4; ++p)
+			{
+				for(int c = 0; c < 4; ++c)
+					palette[p][c] = palette8[p][c];
+			}
+
+			candidate.Error = SelectIndices(block, 0, 3, palette, fourColor ? 4 : 3, mask, candidate.Indices);
+			if(candidate.Error < best.Error)
+				best = candidate;
+
+			if(pass == passes || !LeastSquares(block, 0, 3, mask, candidate.Indices,
+				fourColor ? fourWeights : threeWeights, e0, e1))
+				break;
+		}
+
+		// Put the endpoints in the order that selects the mode, renumbering the indices.
+		if(fourColor)
+		{
+			if(best.C0 == best.C1)
+				std::memset(best.Indices, 0, sizeof(best.Indices));
+			else if(best.C0 < best.C1)
+			{
+				std::swap(best.C0, best.C1);
+				for(int i = 0; i < 16; ++i)
+					best.Indices[i] ^= 1;
+			}
+		}
+		else if(best.C0 > best.C1)
+		{
+			std::swap(best.C0, best.C1);
+			for(int i = 0; i < 16; ++i)
+			{
+				if(best.Indices[i] < 2)
+					best.Indices[i] ^= 1;
+			}
+		}
+
+		for(int i = 0; i < 16; ++i)
+		{
+			if(!(mask & (1u << i)))
+				best.Indices[i] = 3;
+		}
+
+		return best;
+	}
+
+	void WriteColorBlock(const ColorBlock& colors, std::uint8_t* out)
+	{
+		std::uint32_t bits = 0;
+		for(int i = 0; i < 16; ++i)
+			bits |= (std::uint32_t)colors.Indices[i] << (i * 2);
+
+		PutLE16(out, colors.C0);
+		PutLE16(out + 2, colors.C1);
+		PutLE16(out + 4, (std::uint16_t)bits);
+		PutLE16(out + 6, (std::uint16_t)(bits >> 16));
+	}
+
+	void DecodeColorBlock(const std::uint8_t* in, bool allowThreeColor, std::uint8_t texels[64])
+	{
+		const std::uint16_t c0 = (std::uint16_t)(in[0] | (in[1] << 8));
+		const std::uint16_t c1 = (std::uint16_t)(in[2] | (in[3] << 8));
+		const std::uint32_t bits = in[4] | (in[5] << 8) | (in[6] << 16) | ((std::uint32_t)in[7] << 24);
+
+		std::uint8_t palette[4][4];
+		ColorPalette(c0, c1, !allowThreeColor || c0 > c1, palette);
+
+		for(int i = 0; i < 16; ++i)
+			std::memcpy(texels + i * 4, palette[(bits >> (i * 2)) & 3], 4);
+	}
+
+	void EncodeBC1(const BlockTexels& block, BCQuality quality, std::uint8_t* out)
+	{
+		std::uint32_t opaque = 0;
+		for(int i = 0; i < 16; ++i)
+		{
+			if(block.C[3][i] >= BCEncoder::AlphaThreshold)
+				opaque |= 1u << i;
+		}
+
+		ColorBlock colors;
+		if(opaque != AllTexels)
+			colors = EncodeColors(block, opaque, false, quality);
+		else
+		{
+			colors = EncodeColors(block, AllTexels, true, quality);
+			if(quality == BCQuality::Best)
+			{
+				// Three color mode's midpoint sometimes fits better than two thirds.
+				ColorBlock three = EncodeColors(block, AllTexels, false, quality);
+				if(three.Error < colors.Error)
+					colors = three;
+			}
+		}
+
+		WriteColorBlock(colors, out);
+	}
+
+	//***********************************************************************************
+	// BC3 alpha
+	//***********************************************************************************
+
+	void AlphaPalette(int a0, int a1, std::uint8_t palette[8])
+	{
+		palette[0] = (std::uint8_t)a0;
+		palette[1] = (std::uint8_t)a1;
+		if(a0 > a1)
+		{
+			for(int k = 2; k < 8; ++k)
+				palette[k] = (std::uint8_t)(((8 - k) * a0 + (k - 1) * a1 + 3) / 7);
+		}
+		else
+		{
+			for(int k = 2; k < 6; ++k)
+				palette[k] = (std::uint8_t)(((6 - k) * a0 + (k - 1) * a1 + 2) / 5);
+			palette[6] = 0;
+			palette[7] = 255;
+		}
+	}
+
+	struct AlphaBlock
+	{
+		int A0 = 0;
+		int A1 = 0;
+		std::uint8_t Indices[16] = {};
+		float Error = FLT_MAX;
+	};
+
+	// Eight value mode interpolates across the whole range.  Six value mode spends two
+	// indices on exact 0 and 255 and interpolates between the values in between.
+	AlphaBlock EncodeAlpha(const BlockTexels& block, bool eightValues, BCQuality quality)
+	{
+		static const float eightWeights[8] = { 0.0f, 1.0f, 1.0f / 7, 2.0f / 7, 3.0f / 7, 4.0f / 7, 5.0f / 7, 6.0f / 7 };
+		static const float sixWeights[8] = { 0.0f, 1.0f, 1.0f / 5, 2.0f / 5, 3.0f / 5, 4.0f / 5, -1.0f, -1.0f };
+
+		float lo = 255.0f, hi = 0.0f;
+		for(int i = 0; i < 16; ++i)
+		{
+			const float a = block.C[3][i];
+			if(!eightValues && (a == 0.0f || a == 255.0f))
+				continue;
+			lo = std::min(lo, a);
+			hi = std::max(hi, a);
+		}
+		if(lo > hi)
+			lo = hi = 0.0f;
+
+		// LeastSquares writes the one channel it fits to the first element.
+		float e0[4] = {}, e1[4] = {};
+		e0[0] = eightValues ? hi : lo;
+		e1[0] = eightValues ? lo : hi;
+
+		AlphaBlock best;
+		const int passes = RefinePasses(quality);
+		for(int pass = 0; pass <= passes; ++pass)
+		{
+			AlphaBlock candidate;
+			candidate.A0 = (int)(e0[0] + 0.5f);
+			candidate.A1 = (int)(e1[0] + 0.5f);
+
+			// Keep the endpoint order that selects the mode.
+			if(eightValues ? candidate.A0 < candidate.A1 : candidate.A0 > candidate.A1)
+				std::swap(candidate.A0, candidate.A1);
+			if(eightValues && candidate.A0 == candidate.A1)
+			{
+				if(candidate.A0 < 255)
+					++candidate.A0;
+				else
+					--candidate.A1;
+			}
+
+			std::uint8_t palette8[8];
+			AlphaPalette(candidate.A0, candidate.A1, palette8);
+			float palette[8][4] = {};
+			for(int p = 0; p < 8; ++p)
+				palette[p][3] = palette8[p];
+
+			candidate.Error = SelectIndices(block, 3, 1, palette, 8, AllTexels, candidate.Indices);
+			if(candidate.Error < best.Error)
+				best = candidate;
+
+			if(pass == passes || best.Error == 0.0f)
+				break;
+
+			if(!LeastSquares(block, 3, 1, AllTexels, candidate.Indices, eightValues ? eightWeights : sixWeights, e0, e1))
+				break;
+		}
+
+		return best;
+	}
+
+	void WriteAlphaBlock(const AlphaBlock& alpha, std::uint8_t* out)
+	{
+		std::uint64_t bits = 0;
+		for(int i = 0; i < 16; ++i)
+			bits |= (std::uint64_t)alpha.Indices[i] << (i * 3);
+
+		out[0] = (std::uint8_t)alpha.A0;
+		out[1] = (std::uint8_t)alpha.A1;
+		for(int i = 0; i < 6; ++i)
+			out[2 + i] = (std::uint8_t)(bits >> (i * 8));
+	}
+
+	void DecodeAlphaBlock(const std::uint8_t* in, std::uint8_t texels[64])
+	{
+		std::uint8_t palette[8];
+		AlphaPalette(in[0], in[1], palette);
+
+		std::uint64_t bits = 0;
+		for(int i = 0; i < 6; ++i)
+			bits |= (std::uint64_t)in[2 + i] << (i * 8);
+
+		for(int i = 0; i < 16; ++i)
+			texels[i * 4 + 3] = palette[(bits >> (i * 3)) & 7];
+	}
+
+	void EncodeBC3(const BlockTexels& block, BCQuality quality, std::uint8_t* out)
+	{
+		AlphaBlock alpha = EncodeAlpha(block, true, quality);
+		if(quality != BCQuality::Fast && alpha.Error > 0.0f)
+		{
+			AlphaBlock six = EncodeAlpha(block, false, quality);
+			if(six.Error < alpha.Error)
+				alpha = six;
+		}
+		WriteAlphaBlock(alpha, out);
+
+		// BC3 always decodes its colors in four color mode.
+		WriteColorBlock(EncodeColors(block, AllTexels, true, quality), out + 8);
+	}
+
+	//***********************************************************************************
+	// BC7 modes 5 and 6
+	//***********************************************************************************
+
+	const int Weights2[4] = { 0, 21, 43, 64 };
+	const float Weights2f[4] = { 0.0f, 21 / 64.0f, 43 / 64.0f, 1.0f };
+
+	const int Weights4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+	const float Weights4f[16] =
+	{
+		0 / 64.0f, 4 / 64.0f, 9 / 64.0f, 13 / 64.0f, 17 / 64.0f, 21 / 64.0f, 26 / 64.0f, 30 / 64.0f,
+		34 / 64.0f, 38 / 64.0f, 43 / 64.0f, 47 / 64.0f, 51 / 64.0f, 55 / 64.0f, 60 / 64.0f, 64 / 64.0f
+	};
+
+	int Interpolate(int a, int b, int weight)
+	{
+		return ((64 - weight) * a + weight * b + 32) >> 6;
+	}
+
+	class BitWriter
+	{
+	public:
+		explicit BitWriter(std::uint8_t* out) : mOut(out)
+		{
+			std::memset(mOut, 0, 16);
+		}
+
+		void Write(std::uint32_t value, int count)
+		{
+			for(int i = 0; i < count; ++i, ++mPos)
+			{
+				if(value & (1u << i))
+					mOut[mPos >> 3] |= (std::uint8_t)(1u << (mPos & 7));
+			}
+		}
+
+	private:
+		std::uint8_t* mOut;
+		int mPos = 0;
+	};
+
+	class BitReader
+	{
+	public:
+		explicit BitReader(const std::uint8_t* in) : mIn(in)
+		{
+		}
+
+		int Read(int count)
+		{
+			int value = 0;
+			for(int i = 0; i < count; ++i, ++mPos)
+				value |= ((mIn[mPos >> 3] >> (mPos & 7)) & 1) << i;
+			return value;
+		}
+
+	private:
+		const std::uint8_t* mIn;
+		int mPos = 0;
+	};
+
+	// Mode 6: 7-bit RGBA endpoints with a p-bit each as the lowest bit, 4-bit indices.
+	struct Mode6Block
+	{
+		int Q0[4] = {};
+		int Q1[4] = {};
+		int P0 = 0;
+		int P1 = 0;
+		std::uint8_t Indices[16] = {};
+		float Error = FLT_MAX;
+	};
+
+	void Mode6Palette(const int q0[4], int p0, const int q1[4], int p1, float palette[16][4])
+	{
+		for(int c = 0; c < 4; ++c)
+		{
+			const int a = (q0[c] << 1) | p0;
+			const int b = (q1[c] << 1) | p1;
+			for(int k = 0; k < 16; ++k)
+				palette[k][c] = (float)Interpolate(a, b, Weights4[k]);
+		}
+	}
+
+	void QuantizeMode6(const float e[4], int p, int q[4])
+	{
+		for(int c = 0; c < 4; ++c)
+			q[c] = ClampInt((int)std::floor((e[c] - p) * 0.5f + 0.5f), 0, 127);
+	}
+
+	float QuantizeError(const float e[4], int p)
+	{
+		int q[4];
+		QuantizeMode6(e, p, q);
+		float error = 0.0f;
+		for(int c = 0; c < 4; ++c)
+		{
+			const float diff = e[c] - (float)((q[c] << 1) | p);
+			error += diff * diff;
+		}
+		return error;
+	}
+
+	Mode6Block EncodeMode6(const BlockTexels& block, bool opaque, BCQuality quality)
+	{
+		float e0[4], e1[4];
+		FitLine(block, 0, 4, AllTexels, e0, e1);
+
+		Mode6Block best;
+		const int passes = RefinePasses(quality);
+		for(int pass = 0; pass <= passes; ++pass)
+		{
+			Mode6Block passBest;
+
+			for(int pbits = 0; pbits < 4; ++pbits)
+			{
+				Mode6Block candidate;
+				if(opaque)
+				{
+					// Only set p-bits reach an alpha of 255.
+					if(pbits > 0)
+						break;
+					candidate.P0 = candidate.P1 = 1;
+				}
+				else if(quality == BCQuality::Fast)
+				{
+					// Only try the p-bits that quantize each endpoint best on its own.
+					if(pbits > 0)
+						break;
+					candidate.P0 = QuantizeError(e0, 1) < QuantizeError(e0, 0) ? 1 : 0;
+					candidate.P1 = QuantizeError(e1, 1) < QuantizeError(e1, 0) ? 1 : 0;
+				}
+				else
+				{
+					candidate.P0 = pbits & 1;
+					candidate.P1 = pbits >> 1;
+				}
+
+				QuantizeMode6(e0, candidate.P0, candidate.Q0);
+				QuantizeMode6(e1, candidate.P1, candidate.Q1);
+
+				float palette[16][4];
+				Mode6Palette(candidate.Q0, candidate.P0, candidate.Q1, candidate.P1, palette);
+				candidate.Error = SelectIndices(block, 0, 4, palette, 16, AllTexels, candidate.Indices);
+
+				if(candidate.Error < passBest.Error)
+					passBest = candidate;
+			}
+
+			if(passBest.Error < best.Error)
+				best = passBest;
+
+			if(pass == passes || best.Error == 0.0f ||
+				!LeastSquares(block, 0, 4, AllTexels, passBest.Indices, Weights4f, e0, e1))
+				break;
+		}
+
+		// The first index is stored without its top bit, so it must be below 8.
+		if(best.Indices[0] & 8)
+		{
+			for(int c = 0; c < 4; ++c)
+				std::swap(best.Q0[c], best.Q1[c]);
+			std::swap(best.P0, best.P1);
+			for(int i = 0; i < 16; ++i)
+				best.Indices[i] = (std::uint8_t)(15 - best.Indices[i]);
+		}
+
+		return best;
+	}
+
+	void WriteMode6(const Mode6Block& mode6, std::uint8_t* out)
+	{
+		BitWriter bits(out);
+		bits.Write(1u << 6, 7);
+		for(int c = 0; c < 4; ++c)
+		{
+			bits.Write((std::uint32_t)mode6.Q0[c], 7);
+			bits.Write((std::uint32_t)mode6.Q1[c], 7);
+		}
+		bits.Write((std::uint32_t)mode6.P0, 1);
+		bits.Write((std::uint32_t)mode6.P1, 1);
+		bits.Write(mode6.Indices[0], 3);
+		for(int i = 1; i < 16; ++i)
+			bits.Write(mode6.Indices[i], 4);
+	}
+
+	// Mode 5: 7-bit RGB and 8-bit alpha endpoints, with separate 2-bit indices for the
+	// colors and the alpha.  Suits blocks whose alpha does not follow their colors, such
+	// as cut out edges.  The channel rotation is not used.
+	struct Mode5Block
+	{
+		int C0[3] = {};
+		int C1[3] = {};
+		int A0 = 0;
+		int A1 = 0;
+		std::uint8_t ColorIndices[16] = {};
+		std::uint8_t AlphaIndices[16] = {};
+		float Error = FLT_MAX;
+	};
+
+	int Expand7(int q)
+	{
+		return (q << 1) | (q >> 6);
+	}
+
+	void Mode5Palette(const Mode5Block& mode5, float palette[4][4])
+	{
+		for(int k = 0; k < 4; ++k)
+		{
+			for(int c = 0; c < 3; ++c)
+				palette[k][c] = (float)Interpolate(Expand7(mode5.C0[c]), Expand7(mode5.C1[c]), Weights2[k]);
+			palette[k][3] = (float)Interpolate(mode5.A0, mode5.A1, Weights2[k]);
+		}
+	}
+
+	Mode5Block EncodeMode5(const BlockTexels& block, BCQuality quality)
+	{
+		const int passes = RefinePasses(quality);
+		Mode5Block best;
+
+		// The colors and the alpha are fitted separately since their indices are.
+		float e0[4], e1[4];
+		FitLine(block, 0, 3, AllTexels, e0, e1);
+
+		float colorError = FLT_MAX;
+		for(int pass = 0; pass <= passes; ++pass)
+		{
+			Mode5Block candidate;
+			for(int c = 0; c < 3; ++c)
+			{
+				candidate.C0[c] = ClampInt((int)(e0[c] * 127.0f / 255.0f + 0.5f), 0, 127);
+				candidate.C1[c] = ClampInt((int)(e1[c] * 127.0f / 255.0f + 0.5f), 0, 127);
+			}
+
+			float palette[4][4];
+			Mode5Palette(candidate, palette);
+			const float error = SelectIndices(block, 0, 3, palette, 4, AllTexels, candidate.ColorIndices);
+			if(error < colorError)
+			{
+				colorError = error;
+				std::memcpy(best.C0, candidate.C0, sizeof(best.C0));
+				std::memcpy(best.C1, candidate.C1, sizeof(best.C1));
+				std::memcpy(best.ColorIndices, candidate.ColorIndices, sizeof(best.ColorIndices));
+			}
+
+			if(pass == passes || colorError == 0.0f ||
+				!LeastSquares(block, 0, 3, AllTexels, candidate.ColorIndices, Weights2f, e0, e1))
+				break;
+		}
+
+		float lo = 255.0f, hi = 0.0f;
+		for(int i = 0; i < 16; ++i)
+		{
+			lo = std::min(lo, block.C[3][i]);
+			hi = std::max(hi, block.C[3][i]);
+		}
+		e0[0] = lo;
+		e1[0] = hi;
+
+		float alphaError = FLT_MAX;
+		for(int pass = 0; pass <= passes; ++pass)
+		{
+			Mode5Block candidate;
+			candidate.A0 = (int)(e0[0] + 0.5f);
+			candidate.A1 = (int)(e1[0] + 0.5f);
+
+			float palette[4][4];
+			Mode5Palette(candidate, palette);
+			const float error = SelectIndices(block, 3, 1, palette, 4, AllTexels, candidate.AlphaIndices);
+			if(error < alphaError)
+			{
+				alphaError = error;
+				best.A0 = candidate.A0;
+				best.A1 = candidate.A1;
+				std::memcpy(best.AlphaIndices, candidate.AlphaIndices, sizeof(best.AlphaIndices));
+			}
+
+			if(pass == passes || alphaError == 0.0f ||
+				!LeastSquares(block, 3, 1, AllTexels, candidate.AlphaIndices, Weights2f, e0, e1))
+				break;
+		}
+
+		best.Error = colorError + alphaError;
+
+		// Each set of indices stores its first without the top bit.
+		if(best.ColorIndices[0] & 2)
+		{
+			for(int c = 0; c < 3; ++c)
+				std::swap(best.C0[c], best.C1[c]);
+			for(int i = 0; i < 16; ++i)
+				best.ColorIndices[i] = (std::uint8_t)(3 - best.ColorIndices[i]);
+		}
+		if(best.AlphaIndices[0] & 2)
+		{
+			std::swap(best.A0, best.A1);
+			for(int i = 0; i < 16; ++i)
+				best.AlphaIndices[i] = (std::uint8_t)(3 - best.AlphaIndices[i]);
+		}
+
+		return best;
+	}
+
+	void WriteMode5(const Mode5Block& mode5, std::uint8_t* out)
+	{
+		BitWriter bits(out);
+		bits.Write(1u << 5, 6);
+		bits.Write(0, 2);
+		for(int c = 0; c < 3; ++c)
+		{
+			bits.Write((std::uint32_t)mode5.C0[c], 7);
+			bits.Write((std::uint32_t)mode5.C1[c], 7);
+		}
+		bits.Write((std::uint32_t)mode5.A0, 8);
+		bits.Write((std::uint32_t)mode5.A1, 8);
+		for(int i = 0; i < 16; ++i)
+			bits.Write(mode5.ColorIndices[i], i == 0 ? 1 : 2);
+		for(int i = 0; i < 16; ++i)
+			bits.Write(mode5.AlphaIndices[i], i == 0 ? 1 : 2);
+	}
+
+	void EncodeBC7(const BlockTexels& block, BCQuality quality, std::uint8_t* out)
+	{
+		float alphaLo = 255.0f, alphaHi = 0.0f;
+		for(int i = 0; i < 16; ++i)
+		{
+			alphaLo = std::min(alphaLo, block.C[3][i]);
+			alphaHi = std::max(alphaHi, block.C[3][i]);
+		}
+		const bool opaque = alphaLo == 255.0f;
+
+		// The fast preset only tries mode 5 where the alpha varies.
+		const Mode6Block mode6 = EncodeMode6(block, opaque, quality);
+		if(quality != BCQuality::Fast || alphaLo != alphaHi)
+		{
+			const Mode5Block mode5 = EncodeMode5(block, quality);
+			if(mode5.Error < mode6.Error)
+			{
+				WriteMode5(mode5, out);
+				return;
+			}
+		}
+
+		WriteMode6(mode6, out);
+	}
+
+	bool DecodeBC7(const std::uint8_t* in, std::uint8_t texels[64])
+	{
+		// The mode is the position of the first set bit.
+		BitReader bits(in);
+		if((in[0] & 0x7f) == 0x40)
+		{
+			bits.Read(7);
+
+			int q0[4], q1[4];
+			for(int c = 0; c < 4; ++c)
+			{
+				q0[c] = bits.Read(7);
+				q1[c] = bits.Read(7);
+			}
+			const int p0 = bits.Read(1);
+			const int p1 = bits.Read(1);
+
+			float palette[16][4];
+			Mode6Palette(q0, p0, q1, p1, palette);
+
+			for(int i = 0; i < 16; ++i)
+			{
+				const int index = bits.Read(i == 0 ? 3 : 4);
+				for(int c = 0; c < 4; ++c)
+					texels[i * 4 + c] = (std::uint8_t)palette[index][c];
+			}
+			return true;
+		}
+
+		if((in[0] & 0x3f) == 0x20)
+		{
+			bits.Read(6);
+			const int rotation = bits.Read(2);
+
+			Mode5Block mode5;
+			for(int c = 0; c < 3; ++c)
+			{
+				mode5.C0[c] = bits.Read(7);
+				mode5.C1[c] = bits.Read(7);
+			}
+			mode5.A0 = bits.Read(8);
+			mode5.A1 = bits.Read(8);
+
+			float palette[4][4];
+			Mode5Palette(mode5, palette);
+
+			for(int i = 0; i < 16; ++i)
+			{
+				const int index = bits.Read(i == 0 ? 1 : 2);
+				for(int c = 0; c < 3; ++c)
+					texels[i * 4 + c] = (std::uint8_t)palette[index][c];
+			}
+			for(int i = 0; i < 16; ++i)
+			{
+				const int index = bits.Read(i == 0 ? 1 : 2);
+				texels[i * 4 + 3] = (std::uint8_t)palette[index][3];
+				if(rotation > 0)
+					std::swap(texels[i * 4 + 3], texels[i * 4 + rotation - 1]);
+			}
+			return true;
+		}
+
+		return false;
+	}
+}
+
+DXGI_FORMAT BCEncoder::GetDXGIFormat(BCFormat format, bool srgb)
+{
+	switch(format)
+	{
+	case BCFormat::BC1: return srgb ? DXGI_FORMAT_BC1_UNORM_SRGB : DXGI_FORMAT_BC1_UNORM;
+	case BCFormat::BC3: return srgb ? DXGI_FORMAT_BC3_UNORM_SRGB : DXGI_FORMAT_BC3_UNORM;
+	default: return srgb ? DXGI_FORMAT_BC7_UNORM_SRGB : DXGI_FORMAT_BC7_UNORM;
+	}
+}
+
+std::size_t BCEncoder::BlockBytes(BCFormat format)
+{
+	return format == BCFormat::BC1 ? 8 : 16;
+}
+
+void BCEncoder::EncodeBlock(BCFormat format, BCQuality quality, const std::uint8_t texels[64], std::uint8_t* block)
+{
+	BlockTexels loaded;
+	LoadTexels(texels, loaded);
+
+	switch(format)
+	{
+	case BCFormat::BC1: EncodeBC1(loaded, quality, block); break;
+	case BCFormat::BC3: EncodeBC3(loaded, quality, block); break;
+	default: EncodeBC7(loaded, quality, block); break;
+	}
+}
+
+bool BCEncoder::DecodeBlock(BCFormat format, const std::uint8_t* block, std::uint8_t texels[64])
+{
+	switch(format)
+	{
+	case BCFormat::BC1:
+		DecodeColorBlock(block, true, texels);
+		return true;
+	case BCFormat::BC3:
+		DecodeColorBlock(block + 8, false, texels);
+		DecodeAlphaBlock(block, texels);
+		return true;
+	default:
+		return DecodeBC7(block, texels);
+	}
+}
+
+void BCEncoder::Compress(BCFormat format, BCQuality quality, const std::uint8_t* rgba, std::uint32_t width,
+	std::uint32_t height, std::vector<std::uint8_t>& blocks, unsigned threadCount)
+{
+	const std::uint32_t blocksWide = std::max(1u, (width + 3) / 4);
+	const std::uint32_t blocksHigh = std::max(1u, (height + 3) / 4);
+	const std::size_t blockBytes = BlockBytes(format);
+	blocks.resize(blocksWide * blocksHigh * blockBytes);
+
+	std::atomic<std::uint32_t> nextRow(0);
+	auto worker = [&]()
+	{
+		std::uint8_t texels[64];
+		for(std::uint32_t by = nextRow++; by < blocksHigh; by = nextRow++)
+		{
+			for(std::uint32_t bx = 0; bx < blocksWide; ++bx)
+			{
+				for(std::uint32_t i = 0; i < 16; ++i)
+				{
+					const std::uint32_t x = std::min(bx * 4 + (i & 3), width - 1);
+					const std::uint32_t y = std::min(by * 4 + (i >> 2), height - 1);
+					std::memcpy(texels + i * 4, rgba + ((std::size_t)y * width + x) * 4, 4);
+				}
+
+				EncodeBlock(format, quality, texels, blocks.data() + (by * blocksWide + bx) * blockBytes);
+			}
+		}
+	};
+
+	if(threadCount == 0)
+		threadCount = std::max(1u, std::thread::hardware_concurrency());
+	threadCount = std::min(threadCount, blocksHigh);
+
+	std::vector<std::thread> threads;
+	for(unsigned i = 1; i < threadCount; ++i)
+		threads.emplace_back(worker);
+	worker();
+	for(auto& thread : threads)
+		thread.join();
+}
+
+bool BCEncoder::Decompress(BCFormat format, const std::uint8_t* blocks, std::uint32_t width, std::uint32_t height,
+	std::vector<std::uint8_t>& rgba)
+{
+	const std::uint32_t blocksWide = std::max(1u, (width + 3) / 4);
+	const std::uint32_t blocksHigh = std::max(1u, (height + 3) / 4);
+	const std::size_t blockBytes = BlockBytes(format);
+	rgba.resize((std::size_t)width * height * 4);
+
+	std::uint8_t texels[64];
+	for(std::uint32_t by = 0; by < blocksHigh; ++by)
+	{
+		for(std::uint32_t bx = 0; bx < blocksWide; ++bx)
+		{
+			if(!DecodeBlock(format, blocks + (by * blocksWide + bx) * blockBytes, texels))
+				return false;
+
+			for(std::uint32_t i = 0; i < 16; ++i)
+			{
+				const std::uint32_t x = bx * 4 + (i & 3);
+				const std::uint32_t y = by * 4 + (i >> 2);
+				if(x < width && y < height)
+					std::memcpy(rgba.data() + ((std::size_t)y * width + x) * 4, texels + i * 4, 4);
+			}
+		}
+	}
+
+	return true;
+}
+
+double BCEncoder::PSNR(const std::uint8_t* a, const std::uint8_t* b, std::size_t pixelCount,
+	int firstChannel, int channelCount)
+{
+	double sum = 0.0;
+	for(std::size_t i = 0; i < pixelCount; ++i)
+	{
+		for(int c = firstChannel; c < firstChannel + channelCount; ++c)
+		{
+			const double diff = (double)a[i * 4 + c] - (double)b[i * 4 + c];
+			sum += diff * diff;
+		}
+	}
+
+	if(sum == 0.0)
+		return std::numeric_limits<double>::infinity();
+
+	const double mse = sum / ((double)pixelCount * channelCount);
+	return 10.0 * std::log10(255.0 * 255.0 / mse);
+}
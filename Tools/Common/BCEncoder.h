@@ -0,0 +1,74 @@
+//***************************************************************************************
+// BCEncoder.h
+//
+// CPU block compression for the texture cooking tools.  Encodes 8-bit RGBA texels to
+// BC1, BC3 or BC7 4x4 blocks and decodes them again so the cooker can report the error
+// it introduced.
+//
+// Every encoder fits a line through the block's colors (the principal axis), quantizes
+// its ends to the format's endpoints, picks the nearest palette entry for each texel,
+// then refines the endpoints by least squares against those picks.  The quality preset
+// sets how many refinement passes run and how many endpoint encodings are tried.  The
+// palette search runs four texels at a time with SSE2 when it is available.
+//
+// BC7 blocks are written in one of the two single subset modes: mode 6, with RGBA
+// endpoints and 4-bit indices, or mode 5, which indexes the colors and the alpha
+// separately and suits cut out edges where the alpha does not follow the colors.
+//***************************************************************************************
+
+#ifndef BCENCODER_H
+#define BCENCODER_H
+
+#include "DDSFormat.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+enum class BCFormat
+{
+	BC1,
+	BC3,
+	BC7
+};
+
+enum class BCQuality
+{
+	Fast,
+	Normal,
+	Best
+};
+
+class BCEncoder
+{
+public:
+	static DXGI_FORMAT GetDXGIFormat(BCFormat format, bool srgb);
+
+	// 8 for BC1, 16 for the others.
+	static std::size_t BlockBytes(BCFormat format);
+
+	// In BC1, texels with alpha below this are encoded as transparent black.
+	static const std::uint8_t AlphaThreshold = 128;
+
+	// Encodes one block of 16 RGBA texels, row by row.
+	static void EncodeBlock(BCFormat format, BCQuality quality, const std::uint8_t texels[64], std::uint8_t* block);
+
+	// Decodes one block.  Returns false for BC7 modes other than 5 and 6, which are never
+	// written here.
+	static bool DecodeBlock(BCFormat format, const std::uint8_t* block, std::uint8_t texels[64]);
+
+	// Compresses a whole surface.  Blocks past the right and bottom edges repeat the edge
+	// texels.  The rows of blocks are shared between threadCount threads, or one per core
+	// if it is 0.
+	static void Compress(BCFormat format, BCQuality quality, const std::uint8_t* rgba, std::uint32_t width,
+		std::uint32_t height, std::vector<std::uint8_t>& blocks, unsigned threadCount = 0);
+
+	static bool Decompress(BCFormat format, const std::uint8_t* blocks, std::uint32_t width, std::uint32_t height,
+		std::vector<std::uint8_t>& rgba);
+
+	// Peak signal to noise ratio in dB over count channels starting at firstChannel, of
+	// two RGBA images of pixelCount texels.  Infinite if they are the same.
+	static double PSNR(const std::uint8_t* a, const std::uint8_t* b, std::size_t pixelCount,
+		int firstChannel, int channelCount);
+};
+
+#endif // BCENCODER_H
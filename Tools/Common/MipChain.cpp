@@ -0,0 +1,413 @@
+//***************************************************************************************
+// MipChain.cpp
+//***************************************************************************************
+
+#include "MipChain.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <thread>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MIPCHAIN_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+	const double Pi = 3.14159265358979323846;
+
+	// Half the width of each filter, in output texels.
+	const double BoxRadius = 0.5;
+	const double KaiserRadius = 3.0;
+	const double KaiserAlpha = 4.0;
+
+	// The linear value of each 8-bit sRGB value.
+	struct SRGBDecodeTable
+	{
+		float Values[256];
+
+		SRGBDecodeTable()
+		{
+			for(int i = 0; i < 256; ++i)
+			{
+				const double c = i / 255.0;
+				Values[i] = (float)(c <= 0.04045 ? c / 12.92 : std::pow((c + 0.055) / 1.055, 2.4));
+			}
+		}
+	};
+
+	// The nearest 8-bit sRGB value of each linear value, in steps of 1/65535.  Fine
+	// enough that the steps below the first sRGB value still land on the right side of it.
+	struct SRGBEncodeTable
+	{
+		static const int Steps = 65536;
+		std::uint8_t Values[Steps];
+
+		SRGBEncodeTable()
+		{
+			for(int i = 0; i < Steps; ++i)
+			{
+				const double l = (double)i / (Steps - 1);
+				const double c = l <= 0.0031308 ? l * 12.92 : 1.055 * std::pow(l, 1.0 / 2.4) - 0.055;
+				Values[i] = (std::uint8_t)std::min(255.0, c * 255.0 + 0.5);
+			}
+		}
+	};
+
+	const SRGBDecodeTable& DecodeTable()
+	{
+		static const SRGBDecodeTable table;
+		return table;
+	}
+
+	const SRGBEncodeTable& EncodeTable()
+	{
+		static const SRGBEncodeTable table;
+		return table;
+	}
+
+	float Clamp01(float value)
+	{
+		return value < 0.0f ? 0.0f : (value > 1.0f ? 1.0f : value);
+	}
+
+	// Zeroth order modified Bessel function of the first kind.
+	double BesselI0(double x)
+	{
+		double sum = 1.0, term = 1.0;
+		for(int k = 1; k < 32; ++k)
+		{
+			term *= (x / (2.0 * k)) * (x / (2.0 * k));
+			sum += term;
+			if(term < sum * 1e-12)
+				break;
+		}
+		return sum;
+	}
+
+	double Kaiser(double t)
+	{
+		const double sinc = t == 0.0 ? 1.0 : std::sin(Pi * t) / (Pi * t);
+		const double x = t / KaiserRadius;
+		return sinc * BesselI0(KaiserAlpha * std::sqrt(std::max(0.0, 1.0 - x * x))) / BesselI0(KaiserAlpha);
+	}
+
+	// The source texels and weights that make up each output texel along one axis.  Every
+	// output texel has the same number of taps, padded with zero weights, and taps past
+	// the edges repeat the edge texel.
+	struct FilterTable
+	{
+		std::uint32_t Taps = 0;
+		std::vector<std::uint32_t> Index;
+		std::vector<float> Weight;
+
+		FilterTable(MipFilter filter, std::uint32_t srcSize, std::uint32_t dstSize)
+		{
+			const double scale = (double)srcSize / dstSize;
+			const double radius = (filter == MipFilter::Box ? BoxRadius : KaiserRadius) * scale;
+
+			std::vector<std::vector<std::pair<std::uint32_t, double>>> taps(dstSize);
+			for(std::uint32_t o = 0; o < dstSize; ++o)
+			{
+				const double center = (o + 0.5) * scale;
+				double sum = 0.0;
+
+				for(std::int64_t s = (std::int64_t)std::floor(center - radius); s < (std::int64_t)std::ceil(center + radius); ++s)
+				{
+					double weight;
+					if(filter == MipFilter::Box)
+						weight = std::max(0.0, std::min(s + 1.0, center + radius) - std::max((double)s, center - radius));
+					else
+					{
+						const double t = (s + 0.5 - center) / scale;
+						weight = std::abs(t) < KaiserRadius ? Kaiser(t) : 0.0;
+					}
+
+					if(weight != 0.0)
+					{
+						const std::int64_t clamped = std::min<std::int64_t>(std::max<std::int64_t>(s, 0), srcSize - 1);
+						taps[o].emplace_back((std::uint32_t)clamped, weight);
+						sum += weight;
+					}
+				}
+
+				for(auto& tap : taps[o])
+					tap.second /= sum;
+				Taps = std::max(Taps, (std::uint32_t)taps[o].size());
+			}
+
+			Index.assign((std::size_t)dstSize * Taps, 0);
+			Weight.assign((std::size_t)dstSize * Taps, 0.0f);
+			for(std::uint32_t o = 0; o < dstSize; ++o)
+			{
+				for(std::size_t t = 0; t < taps[o].size(); ++t)
+				{
+					Index[o * Taps + t] = taps[o][t].first;
+					Weight[o * Taps + t] = (float)taps[o][t].second;
+				}
+			}
+		}
+	};
+
+	// Runs fn(0) to fn(count - 1) on threadCount threads, or one per core if it is 0.
+	template<typename Fn>
+	void ParallelFor(std::uint32_t count, unsigned threadCount, Fn fn)
+	{
+		std::atomic<std::uint32_t> next(0);
+		auto worker = [&]()
+		{
+			for(std::uint32_t i = next++; i < count; i = next++)
+				fn(i);
+		};
+
+		if(threadCount == 0)
+			threadCount = std::max(1u, std::thread::hardware_concurrency());
+		threadCount = std::min(threadCount, count);
+
+		std::vector<std::thread> threads;
+		for(unsigned i = 1; i < threadCount; ++i)
+			threads.emplace_back(worker);
+		worker();
+		for(auto& thread : threads)
+			thread.join();
+	}
+
+	// out = the sum of weights[t] * rows[t] over count float RGBA texels.
+	void CombineRows(const float* const* rows, const float* weights, std::uint32_t taps, std::uint32_t count,
+		float* out, bool scalar)
+	{
+#ifdef MIPCHAIN_SSE2
+		if(!scalar)
+		{
+			for(std::uint32_t x = 0; x < count; ++x)
+			{
+				__m128 sum = _mm_setzero_ps();
+				for(std::uint32_t t = 0; t < taps; ++t)
+					sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(weights[t]), _mm_loadu_ps(rows[t] + x * 4)));
+				_mm_storeu_ps(out + x * 4, sum);
+			}
+			return;
+		}
+#endif
+		for(std::uint32_t x = 0; x < count; ++x)
+		{
+			for(int c = 0; c < 4; ++c)
+			{
+				float sum = 0.0f;
+				for(std::uint32_t t = 0; t < taps; ++t)
+					sum = sum + weights[t] * rows[t][x * 4 + c];
+				out[x * 4 + c] = sum;
+			}
+		}
+	}
+
+	// Filters one row of float RGBA texels along its length.
+	void FilterRow(const float* src, const FilterTable& table, std::uint32_t count, float* out, bool scalar)
+	{
+#ifdef MIPCHAIN_SSE2
+		if(!scalar)
+		{
+			for(std::uint32_t x = 0; x < count; ++x)
+			{
+				const std::uint32_t* index = &table.Index[x * table.Taps];
+				const float* weight = &table.Weight[x * table.Taps];
+
+				__m128 sum = _mm_setzero_ps();
+				for(std::uint32_t t = 0; t < table.Taps; ++t)
+					sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(weight[t]), _mm_loadu_ps(src + index[t] * 4)));
+				_mm_storeu_ps(out + x * 4, sum);
+			}
+			return;
+		}
+#endif
+		for(std::uint32_t x = 0; x < count; ++x)
+		{
+			const std::uint32_t* index = &table.Index[x * table.Taps];
+			const float* weight = &table.Weight[x * table.Taps];
+
+			for(int c = 0; c < 4; ++c)
+			{
+				float sum = 0.0f;
+				for(std::uint32_t t = 0; t < table.Taps; ++t)
+					sum = sum + weight[t] * src[index[t] * 4 + c];
+				out[x * 4 + c] = sum;
+			}
+		}
+	}
+
+	void DecodeRow(const std::uint8_t* src, std::uint32_t count, bool linearData, float* out)
+	{
+		const float* decode = DecodeTable().Values;
+		for(std::uint32_t x = 0; x < count; ++x)
+		{
+			for(int c = 0; c < 3; ++c)
+				out[x * 4 + c] = linearData ? src[x * 4 + c] / 255.0f : decode[src[x * 4 + c]];
+			out[x * 4 + 3] = src[x * 4 + 3] / 255.0f;
+		}
+	}
+
+	void EncodeRow(const float* src, std::uint32_t count, bool linearData, std::uint8_t* out)
+	{
+		const std::uint8_t* encode = EncodeTable().Values;
+		for(std::uint32_t x = 0; x < count; ++x)
+		{
+			for(int c = 0; c < 4; ++c)
+			{
+				const float value = Clamp01(src[x * 4 + c]);
+				if(c < 3 && !linearData)
+					out[x * 4 + c] = encode[(int)(value * (SRGBEncodeTable::Steps - 1) + 0.5f)];
+				else
+					out[x * 4 + c] = (std::uint8_t)(value * 255.0f + 0.5f);
+			}
+		}
+	}
+
+	void BuildChains(const TextureImage* const* slices, std::uint32_t sliceCount, std::uint32_t mipCount,
+		std::vector<TextureImage>* mips, const MipOptions& options)
+	{
+		for(std::uint32_t s = 0; s < sliceCount; ++s)
+		{
+			mips[s].resize(mipCount);
+			if(mipCount > 0)
+				mips[s][0] = *slices[s];
+		}
+		if(mipCount < 2 || sliceCount == 0)
+			return;
+
+		std::uint32_t width = slices[0]->Width;
+		std::uint32_t height = slices[0]->Height;
+
+		// The level above the one being built, in linear float RGBA, for every slice.
+		std::vector<std::vector<float>> above(sliceCount), below(sliceCount);
+		for(std::uint32_t s = 0; s < sliceCount; ++s)
+			above[s].resize((std::size_t)width * height * 4);
+
+		ParallelFor(sliceCount * height, options.Threads, [&](std::uint32_t job)
+		{
+			const std::uint32_t s = job / height, y = job % height;
+			DecodeRow(&slices[s]->Pixels[(std::size_t)y * width * 4], width, options.LinearData,
+				&above[s][(std::size_t)y * width * 4]);
+		});
+
+		for(std::uint32_t level = 1; level < mipCount; ++level)
+		{
+			const std::uint32_t mipWidth = std::max(1u, width / 2);
+			const std::uint32_t mipHeight = std::max(1u, height / 2);
+			const FilterTable columns(options.Filter, width, mipWidth);
+			const FilterTable rows(options.Filter, height, mipHeight);
+
+			for(std::uint32_t s = 0; s < sliceCount; ++s)
+			{
+				TextureImage& mip = mips[s][level];
+				mip.Width = mipWidth;
+				mip.Height = mipHeight;
+				mip.SRGB = slices[s]->SRGB;
+				mip.Pixels.resize((std::size_t)mipWidth * mipHeight * 4);
+				below[s].resize((std::size_t)mipWidth * mipHeight * 4);
+			}
+
+			// Each output row filters its source rows together into one row the width of
+			// the level above, then filters that across.
+			ParallelFor(sliceCount * mipHeight, options.Threads, [&](std::uint32_t job)
+			{
+				const std::uint32_t s = job / mipHeight, y = job % mipHeight;
+
+				std::vector<const float*> sourceRows(rows.Taps);
+				for(std::uint32_t t = 0; t < rows.Taps; ++t)
+					sourceRows[t] = &above[s][(std::size_t)rows.Index[y * rows.Taps + t] * width * 4];
+
+				std::vector<float> combined((std::size_t)width * 4);
+				CombineRows(sourceRows.data(), &rows.Weight[y * rows.Taps], rows.Taps, width, combined.data(),
+					options.Scalar);
+
+				float* out = &below[s][(std::size_t)y * mipWidth * 4];
+				FilterRow(combined.data(), columns, mipWidth, out, options.Scalar);
+				EncodeRow(out, mipWidth, options.LinearData, &mips[s][level].Pixels[(std::size_t)y * mipWidth * 4]);
+			});
+
+			std::swap(above, below);
+			width = mipWidth;
+			height = mipHeight;
+		}
+	}
+}
+
+void MipChain::Resize(const TextureImage& src, std::uint32_t width, std::uint32_t height, TextureImage& dst)
+{
+	dst.Width = width;
+	dst.Height = height;
+	dst.SRGB = src.SRGB;
+	dst.Pixels.resize((std::size_t)width * height * 4);
+
+	const float scaleX = (float)src.Width / width;
+	const float scaleY = (float)src.Height / height;
+
+	for(std::uint32_t y = 0; y < height; ++y)
+	{
+		const float fy = std::max(0.0f, (y + 0.5f) * scaleY - 0.5f);
+		const std::uint32_t y0 = std::min((std::uint32_t)fy, src.Height - 1);
+		const std::uint32_t y1 = std::min(y0 + 1, src.Height - 1);
+		const float ty = fy - y0;
+
+		for(std::uint32_t x = 0; x < width; ++x)
+		{
+			const float fx = std::max(0.0f, (x + 0.5f) * scaleX - 0.5f);
+			const std::uint32_t x0 = std::min((std::uint32_t)fx, src.Width - 1);
+			const std::uint32_t x1 = std::min(x0 + 1, src.Width - 1);
+			const float tx = fx - x0;
+
+			const std::uint8_t* p00 = &src.Pixels[((std::size_t)y0 * src.Width + x0) * 4];
+			const std::uint8_t* p10 = &src.Pixels[((std::size_t)y0 * src.Width + x1) * 4];
+			const std::uint8_t* p01 = &src.Pixels[((std::size_t)y1 * src.Width + x0) * 4];
+			const std::uint8_t* p11 = &src.Pixels[((std::size_t)y1 * src.Width + x1) * 4];
+			std::uint8_t* out = &dst.Pixels[((std::size_t)y * width + x) * 4];
+
+			for(int c = 0; c < 4; ++c)
+			{
+				const float top = p00[c] + (p10[c] - p00[c]) * tx;
+				const float bottom = p01[c] + (p11[c] - p01[c]) * tx;
+				out[c] = (std::uint8_t)(top + (bottom - top) * ty + 0.5f);
+			}
+		}
+	}
+}
+
+void MipChain::Build(const TextureImage& image, std::uint32_t mipCount, std::vector<TextureImage>& mips,
+	const MipOptions& options)
+{
+	const TextureImage* slice = &image;
+	BuildChains(&slice, 1, mipCount, &mips, options);
+}
+
+void MipChain::BuildSlices(const std::vector<TextureImage>& slices, std::uint32_t mipCount,
+	std::vector<std::vector<TextureImage>>& mips, const MipOptions& options)
+{
+	std::vector<const TextureImage*> pointers;
+	for(const TextureImage& slice : slices)
+		pointers.push_back(&slice);
+
+	mips.resize(slices.size());
+	BuildChains(pointers.data(), (std::uint32_t)slices.size(), mipCount, mips.data(), options);
+}
+
+std::uint64_t MipChain::Checksum(const std::vector<TextureImage>& mips)
+{
+	std::uint64_t hash = 14695981039346656037ull;
+	auto add = [&hash](std::uint8_t byte)
+	{
+		hash ^= byte;
+		hash *= 1099511628211ull;
+	};
+
+	for(const TextureImage& mip : mips)
+	{
+		for(int i = 0; i < 4; ++i)
+			add((std::uint8_t)(mip.Width >> (i * 8)));
+		for(int i = 0; i < 4; ++i)
+			add((std::uint8_t)(mip.Height >> (i * 8)));
+		for(std::uint8_t byte : mip.Pixels)
+			add(byte);
+	}
+	return hash;
+}
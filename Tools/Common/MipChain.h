@@ -0,0 +1,66 @@
+//***************************************************************************************
+// MipChain.h
+//
+// Resampling for the texture cooking tools: resizing a source image and building the
+// mip chains below it.
+//
+// Mips are filtered in linear light.  Color texels are decoded from sRGB first unless
+// they are marked as linear data, such as normal maps, and alpha is always linear.  Each
+// level is filtered from the one above it, kept in floating point so rounding does not
+// build up down the chain, and is only quantized to 8 bits for output.  The filter is
+// separable, four channels to an SSE register, and the rows of every slice at a level
+// are shared between threads.
+//***************************************************************************************
+
+#ifndef MIPCHAIN_H
+#define MIPCHAIN_H
+
+#include "TextureImage.h"
+#include <cstdint>
+#include <vector>
+
+enum class MipFilter
+{
+	// Averages the texels under each output texel: 2x2 for even sides.
+	Box,
+
+	// Kaiser windowed sinc, three output texels wide.  Sharper than the box filter and
+	// free of its aliasing, at the cost of a little ringing at hard edges.
+	Kaiser
+};
+
+struct MipOptions
+{
+	MipFilter Filter = MipFilter::Kaiser;
+
+	// The color channels hold linear data rather than sRGB encoded colors.
+	bool LinearData = false;
+
+	// Threads to filter with, or one per core if 0.
+	unsigned Threads = 0;
+
+	// Filter with scalar code even where SSE is available, to check the two agree.
+	bool Scalar = false;
+};
+
+class MipChain
+{
+public:
+	// Bilinear resample to the given size.
+	static void Resize(const TextureImage& src, std::uint32_t width, std::uint32_t height, TextureImage& dst);
+
+	// The image followed by mipCount - 1 mips below it.  Each mip halves the sides of the
+	// one above, rounding down, to no less than 1.
+	static void Build(const TextureImage& image, std::uint32_t mipCount, std::vector<TextureImage>& mips,
+		const MipOptions& options = MipOptions());
+
+	// Build for every slice of an array, which must all be the same size.  mips[slice]
+	// receives the chain of that slice.
+	static void BuildSlices(const std::vector<TextureImage>& slices, std::uint32_t mipCount,
+		std::vector<std::vector<TextureImage>>& mips, const MipOptions& options = MipOptions());
+
+	// FNV-1a hash of the texels of a chain, for comparing the output of two builds.
+	static std::uint64_t Checksum(const std::vector<TextureImage>& mips);
+};
+
+#endif // MIPCHAIN_H
@@ -0,0 +1,956 @@
+//***************************************************************************************
+// TextureImage.cpp
+//***************************************************************************************
+
+#include "TextureImage.h"
+#include <cstdio>
+#include <cstring>
+
+namespace
+{
+	template<typename T>
+	T ReadLE(const std::uint8_t* p)
+	{
+		T value;
+		std::memcpy(&value, p, sizeof(T));
+		return value;
+	}
+
+	std::uint32_t ReadBE32(const std::uint8_t* p)
+	{
+		return ((std::uint32_t)p[0] << 24) | ((std::uint32_t)p[1] << 16) | ((std::uint32_t)p[2] << 8) | p[3];
+	}
+
+	//***********************************************************************************
+	// Inflate (RFC 1950/1951), enough to read PNG image data.
+	//***********************************************************************************
+
+	class BitReader
+	{
+	public:
+		BitReader(const std::uint8_t* data, std::size_t size) :
+			mData(data), mSize(size)
+		{
+		}
+
+		std::uint32_t Bits(int count)
+		{
+			std::uint32_t value = mBitBuffer;
+			while(mBitCount < count)
+			{
+				if(mPos == mSize)
+				{
+					mOverrun = true;
+					return 0;
+				}
+				value |= (std::uint32_t)mData[mPos++] << mBitCount;
+				mBitCount += 8;
+			}
+
+			mBitBuffer = value >> count;
+			mBitCount -= count;
+			return value & ((1u << count) - 1u);
+		}
+
+		// Drops the bits left in the current byte, before a stored block.
+		void AlignToByte()
+		{
+			mBitBuffer = 0;
+			mBitCount = 0;
+		}
+
+		bool ReadBytes(std::vector<std::uint8_t>& out, std::size_t count)
+		{
+			if(count > mSize - mPos)
+			{
+				mOverrun = true;
+				return false;
+			}
+			out.insert(out.end(), mData + mPos, mData + mPos + count);
+			mPos += count;
+			return true;
+		}
+
+		std::size_t Position() const { return mPos; }
+		bool Overrun() const { return mOverrun; }
+
+	private:
+		const std::uint8_t* mData;
+		std::size_t mSize;
+		std::size_t mPos = 0;
+		std::uint32_t mBitBuffer = 0;
+		int mBitCount = 0;
+		bool mOverrun = false;
+	};
+
+	const int MaxCodeBits = 15;
+
+	// A canonical Huffman code: how many codes there are of each length, and the symbols
+	// in code order.
+	struct Huffman
+	{
+		std::uint16_t Counts[MaxCodeBits + 1];
+		std::uint16_t Symbols[288];
+
+		bool Build(const std::uint8_t* lengths, int count)
+		{
+			std::memset(Counts, 0, sizeof(Counts));
+			for(int i = 0; i < count; ++i)
+				++Counts[lengths[i]];
+
+			if(Counts[0] == count)
+				return true;
+
+			// Reject over-subscribed codes; incomplete ones are allowed.
+			int left = 1;
+			for(int len = 1; len <= MaxCodeBits; ++len)
+			{
+				left = (left << 1) - Counts[len];
+				if(left < 0)
+					return false;
+			}
+
+			std::uint16_t offsets[MaxCodeBits + 1];
+			offsets[1] = 0;
+			for(int len = 1; len < MaxCodeBits; ++len)
+				offsets[len + 1] = offsets[len] + Counts[len];
+
+			for(int i = 0; i < count; ++i)
+			{
+				if(lengths[i] != 0)
+					Symbols[offsets[lengths[i]]++] = (std::uint16_t)i;
+			}
+
+			return true;
+		}
+
+		int Decode(BitReader& in) const
+		{
+			int code = 0;
+			int first = 0;
+			int index = 0;
+			for(int len = 1; len <= MaxCodeBits; ++len)
+			{
+				code |= (int)in.Bits(1);
+				const int count = Counts[len];
+				if(code - count < first)
+					return Symbols[index + (code - first)];
+
+				index += count;
+				first = (first + count) << 1;
+				code <<= 1;
+			}
+
+			return -1;
+		}
+	};
+
+	const std::uint16_t LengthBase[29] =
+	{
+		3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+		35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+	};
+	const std::uint8_t LengthExtra[29] =
+	{
+		0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+		3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+	};
+	const std::uint16_t DistanceBase[30] =
+	{
+		1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+		257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577
+	};
+	const std::uint8_t DistanceExtra[30] =
+	{
+		0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+		7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+	};
+
+	bool InflateCodes(BitReader& in, const Huffman& lengths, const Huffman& distances,
+		std::vector<std::uint8_t>& out, std::size_t maxSize)
+	{
+		for(;;)
+		{
+			int symbol = lengths.Decode(in);
+			if(symbol < 0 || in.Overrun())
+				return false;
+
+			if(symbol < 256)
+			{
+				if(out.size() == maxSize)
+					return false;
+				out.push_back((std::uint8_t)symbol);
+				continue;
+			}
+
+			if(symbol == 256)
+				return true;
+
+			symbol -= 257;
+			if(symbol >= 29)
+				return false;
+			const std::size_t length = LengthBase[symbol] + in.Bits(LengthExtra[symbol]);
+
+			symbol = distances.Decode(in);
+			if(symbol < 0 || symbol >= 30)
+				return false;
+			const std::size_t distance = DistanceBase[symbol] + in.Bits(DistanceExtra[symbol]);
+
+			if(in.Overrun() || distance > out.size() || length > maxSize - out.size())
+				return false;
+
+			// The copy may overlap what it writes, so go a byte at a time.
+			std::size_t from = out.size() - distance;
+			for(std::size_t i = 0; i < length; ++i)
+				out.push_back(out[from + i]);
+		}
+	}
+
+	bool InflateFixed(BitReader& in, std::vector<std::uint8_t>& out, std::size_t maxSize)
+	{
+		std::uint8_t lengths[288 + 30];
+		int symbol = 0;
+		for(; symbol < 144; ++symbol) lengths[symbol] = 8;
+		for(; symbol < 256; ++symbol) lengths[symbol] = 9;
+		for(; symbol < 280; ++symbol) lengths[symbol] = 7;
+		for(; symbol < 288; ++symbol) lengths[symbol] = 8;
+		for(; symbol < 288 + 30; ++symbol) lengths[symbol] = 5;
+
+		Huffman lengthCode, distanceCode;
+		lengthCode.Build(lengths, 288);
+		distanceCode.Build(lengths + 288, 30);
+		return InflateCodes(in, lengthCode, distanceCode, out, maxSize);
+	}
+
+	bool InflateDynamic(BitReader& in, std::vector<std::uint8_t>& out, std::size_t maxSize)
+	{
+		static const std::uint8_t order[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+		const int lengthCount = (int)in.Bits(5) + 257;
+		const int distanceCount = (int)in.Bits(5) + 1;
+		const int codeCount = (int)in.Bits(4) + 4;
+		if(lengthCount > 286 || distanceCount > 30)
+			return false;
+
+		std::uint8_t lengths[288 + 32];
+		std::memset(lengths, 0, sizeof(lengths));
+		for(int i = 0; i < codeCount; ++i)
+			lengths[order[i]] = (std::uint8_t)in.Bits(3);
+
+		Huffman codeLengthCode;
+		if(!codeLengthCode.Build(lengths, 19))
+			return false;
+
+		int index = 0;
+		while(index < lengthCount + distanceCount)
+		{
+			int symbol = codeLengthCode.Decode(in);
+			if(symbol < 0 || in.Overrun())
+				return false;
+
+			if(symbol < 16)
+			{
+				lengths[index++] = (std::uint8_t)symbol;
+				continue;
+			}
+
+			std::uint8_t value = 0;
+			int repeat;
+			if(symbol == 16)
+			{
+				if(index == 0)
+					return false;
+				value = lengths[index - 1];
+				repeat = 3 + (int)in.Bits(2);
+			}
+			else if(symbol == 17)
+				repeat = 3 + (int)in.Bits(3);
+			else
+				repeat = 11 + (int)in.Bits(7);
+
+			if(index + repeat > lengthCount + distanceCount)
+				return false;
+			while(repeat--)
+				lengths[index++] = value;
+		}
+
+		// Without an end of block code the block could never finish.
+		if(lengths[256] == 0)
+			return false;
+
+		Huffman lengthCode, distanceCode;
+		if(!lengthCode.Build(lengths, lengthCount) || !distanceCode.Build(lengths + lengthCount, distanceCount))
+			return false;
+
+		return InflateCodes(in, lengthCode, distanceCode, out, maxSize);
+	}
+
+	// Decompresses a zlib stream, failing if it would produce more than maxSize bytes.
+	bool Inflate(const std::uint8_t* data, std::size_t size, std::vector<std::uint8_t>& out, std::size_t maxSize)
+	{
+		if(size < 6)
+			return false;
+
+		const std::uint32_t cmf = data[0];
+		const std::uint32_t flg = data[1];
+		if((cmf & 0x0f) != 8 || ((cmf << 8) | flg) % 31 != 0 || (flg & 0x20) != 0)
+			return false;
+
+		BitReader in(data + 2, size - 2);
+		out.clear();
+
+		bool last = false;
+		while(!last)
+		{
+			last = in.Bits(1) != 0;
+			const std::uint32_t type = in.Bits(2);
+
+			bool ok;
+			if(type == 0)
+			{
+				in.AlignToByte();
+				std::vector<std::uint8_t> header;
+				if(!in.ReadBytes(header, 4))
+					return false;
+
+				const std::uint32_t length = header[0] | (header[1] << 8);
+				const std::uint32_t inverse = header[2] | (header[3] << 8);
+				ok = length == (~inverse & 0xffff) && length <= maxSize - out.size() && in.ReadBytes(out, length);
+			}
+			else if(type == 1)
+				ok = InflateFixed(in, out, maxSize);
+			else if(type == 2)
+				ok = InflateDynamic(in, out, maxSize);
+			else
+				ok = false;
+
+			if(!ok || in.Overrun())
+				return false;
+		}
+
+		// Check the Adler-32 of the output.
+		const std::size_t adlerPos = 2 + in.Position();
+		if(adlerPos + 4 > size)
+			return false;
+
+		std::uint32_t a = 1, b = 0;
+		for(std::size_t i = 0; i < out.size(); ++i)
+		{
+			a = (a + out[i]) % 65521;
+			b = (b + a) % 65521;
+		}
+
+		return ReadBE32(data + adlerPos) == ((b << 16) | a);
+	}
+
+	//***********************************************************************************
+	// PNG
+	//***********************************************************************************
+
+	std::uint32_t PngSample(const std::uint8_t* row, std::size_t index, int depth)
+	{
+		if(depth == 8)
+			return row[index];
+		if(depth == 16)
+			return ((std::uint32_t)row[index * 2] << 8) | row[index * 2 + 1];
+
+		const std::size_t bit = index * depth;
+		const int shift = 8 - depth - (int)(bit % 8);
+		return (row[bit / 8] >> shift) & ((1u << depth) - 1u);
+	}
+
+	std::uint8_t PngScale(std::uint32_t value, int depth)
+	{
+		if(depth == 16)
+			return (std::uint8_t)(value >> 8);
+		if(depth == 8)
+			return (std::uint8_t)value;
+		return (std::uint8_t)(value * 255 / ((1u << depth) - 1u));
+	}
+
+	std::uint8_t Paeth(int a, int b, int c)
+	{
+		const int p = a + b - c;
+		const int pa = p > a ? p - a : a - p;
+		const int pb = p > b ? p - b : b - p;
+		const int pc = p > c ? p - c : c - p;
+		if(pa <= pb && pa <= pc)
+			return (std::uint8_t)a;
+		return (std::uint8_t)(pb <= pc ? b : c);
+	}
+
+	bool LoadPng(const std::uint8_t* data, std::size_t size, TextureImage& image, std::string& error)
+	{
+		std::size_t pos = 8;
+		std::uint32_t width = 0, height = 0;
+		int depth = 0, colorType = 0;
+		bool haveHeader = false;
+		std::vector<std::uint8_t> palette;
+		std::vector<std::uint8_t> paletteAlpha;
+		std::uint32_t colorKey[3] = {};
+		bool hasColorKey = false;
+		std::vector<std::uint8_t> compressed;
+
+		for(;;)
+		{
+			if(size - pos < 12)
+			{
+				error = "truncated PNG chunk";
+				return false;
+			}
+
+			const std::uint32_t length = ReadBE32(data + pos);
+			const std::uint8_t* type = data + pos + 4;
+			const std::uint8_t* body = data + pos + 8;
+			if(length > size - pos - 12)
+			{
+				error = "truncated PNG chunk";
+				return false;
+			}
+			pos += 12 + (std::size_t)length;
+
+			if(std::memcmp(type, "IHDR", 4) == 0)
+			{
+				if(length < 13)
+				{
+					error = "invalid PNG header";
+					return false;
+				}
+				width = ReadBE32(body);
+				height = ReadBE32(body + 4);
+				depth = body[8];
+				colorType = body[9];
+				if(body[10] != 0 || body[11] != 0)
+				{
+					error = "invalid PNG compression or filter method";
+					return false;
+				}
+				if(body[12] != 0)
+				{
+					error = "interlaced PNG files are not supported";
+					return false;
+				}
+				haveHeader = true;
+			}
+			else if(std::memcmp(type, "PLTE", 4) == 0)
+				palette.assign(body, body + length);
+			else if(std::memcmp(type, "tRNS", 4) == 0)
+			{
+				if(colorType == 3)
+					paletteAlpha.assign(body, body + length);
+				else if(colorType == 0 && length >= 2)
+				{
+					colorKey[0] = (body[0] << 8) | body[1];
+					hasColorKey = true;
+				}
+				else if(colorType == 2 && length >= 6)
+				{
+					for(int c = 0; c < 3; ++c)
+						colorKey[c] = (body[c * 2] << 8) | body[c * 2 + 1];
+					hasColorKey = true;
+				}
+			}
+			else if(std::memcmp(type, "IDAT", 4) == 0)
+				compressed.insert(compressed.end(), body, body + length);
+			else if(std::memcmp(type, "IEND", 4) == 0)
+				break;
+		}
+
+		int channels;
+		switch(colorType)
+		{
+		case 0: channels = 1; break;
+		case 2: channels = 3; break;
+		case 3: channels = 1; break;
+		case 4: channels = 2; break;
+		case 6: channels = 4; break;
+		default: channels = 0; break;
+		}
+
+		const bool depthOk = depth == 8 || depth == 16 ||
+			((colorType == 0 || colorType == 3) && (depth == 1 || depth == 2 || depth == 4));
+		if(!haveHeader || channels == 0 || !depthOk || (colorType == 3 && depth == 16))
+		{
+			error = "unsupported PNG pixel format";
+			return false;
+		}
+		if(width == 0 || height == 0 || width > DDSFormat::MaxTexture2DSize || height > DDSFormat::MaxTexture2DSize)
+		{
+			error = "invalid PNG dimensions";
+			return false;
+		}
+		if(colorType == 3 && palette.empty())
+		{
+			error = "PNG palette is missing";
+			return false;
+		}
+
+		const std::size_t stride = ((std::size_t)width * channels * depth + 7) / 8;
+		const std::size_t pixelBytes = (std::size_t)(channels * depth + 7) / 8;
+		const std::size_t expected = (stride + 1) * height;
+
+		std::vector<std::uint8_t> raw;
+		if(!Inflate(compressed.data(), compressed.size(), raw, expected) || raw.size() != expected)
+		{
+			error = "corrupt PNG image data";
+			return false;
+		}
+
+		// Undo the per-row filters in place.  Each row starts with its filter type.
+		std::vector<std::uint8_t> zeroRow(stride, 0);
+		for(std::uint32_t y = 0; y < height; ++y)
+		{
+			std::uint8_t* row = raw.data() + y * (stride + 1) + 1;
+			const std::uint8_t* prior = y > 0 ? row - (stride + 1) : zeroRow.data();
+			const std::uint8_t filter = row[-1];
+
+			for(std::size_t i = 0; i < stride; ++i)
+			{
+				const int a = i >= pixelBytes ? row[i - pixelBytes] : 0;
+				const int b = prior[i];
+				const int c = i >= pixelBytes ? prior[i - pixelBytes] : 0;
+
+				switch(filter)
+				{
+				case 0: break;
+				case 1: row[i] = (std::uint8_t)(row[i] + a); break;
+				case 2: row[i] = (std::uint8_t)(row[i] + b); break;
+				case 3: row[i] = (std::uint8_t)(row[i] + ((a + b) >> 1)); break;
+				case 4: row[i] = (std::uint8_t)(row[i] + Paeth(a, b, c)); break;
+				default:
+					error = "invalid PNG filter type";
+					return false;
+				}
+			}
+		}
+
+		image.Width = width;
+		image.Height = height;
+		image.SRGB = false;
+		image.Pixels.resize((std::size_t)width * height * 4);
+
+		for(std::uint32_t y = 0; y < height; ++y)
+		{
+			const std::uint8_t* row = raw.data() + y * (stride + 1) + 1;
+			std::uint8_t* dst = image.Pixels.data() + (std::size_t)y * width * 4;
+
+			for(std::uint32_t x = 0; x < width; ++x, dst += 4)
+			{
+				const std::size_t s = (std::size_t)x * channels;
+				switch(colorType)
+				{
+				case 0:
+				{
+					const std::uint32_t v = PngSample(row, s, depth);
+					dst[0] = dst[1] = dst[2] = PngScale(v, depth);
+					dst[3] = hasColorKey && v == colorKey[0] ? 0 : 255;
+					break;
+				}
+				case 2:
+				{
+					const std::uint32_t r = PngSample(row, s, depth);
+					const std::uint32_t g = PngSample(row, s + 1, depth);
+					const std::uint32_t b = PngSample(row, s + 2, depth);
+					dst[0] = PngScale(r, depth);
+					dst[1] = PngScale(g, depth);
+					dst[2] = PngScale(b, depth);
+					dst[3] = hasColorKey && r == colorKey[0] && g == colorKey[1] && b == colorKey[2] ? 0 : 255;
+					break;
+				}
+				case 3:
+				{
+					const std::uint32_t index = PngSample(row, s, depth);
+					if(index * 3 + 2 >= palette.size())
+					{
+						error = "PNG palette index out of range";
+						return false;
+					}
+					dst[0] = palette[index * 3];
+					dst[1] = palette[index * 3 + 1];
+					dst[2] = palette[index * 3 + 2];
+					dst[3] = index < paletteAlpha.size() ? paletteAlpha[index] : 255;
+					break;
+				}
+				case 4:
+					dst[0] = dst[1] = dst[2] = PngScale(PngSample(row, s, depth), depth);
+					dst[3] = PngScale(PngSample(row, s + 1, depth), depth);
+					break;
+				default:
+					for(int c = 0; c < 4; ++c)
+						dst[c] = PngScale(PngSample(row, s + c, depth), depth);
+					break;
+				}
+			}
+		}
+
+		return true;
+	}
+
+	//***********************************************************************************
+	// BMP
+	//***********************************************************************************
+
+	int MaskShift(std::uint32_t mask)
+	{
+		int shift = 0;
+		while(mask && !(mask & 1))
+		{
+			mask >>= 1;
+			++shift;
+		}
+		return shift;
+	}
+
+	std::uint8_t MaskValue(std::uint32_t pixel, std::uint32_t mask)
+	{
+		if(mask == 0)
+			return 0;
+		const int shift = MaskShift(mask);
+		const std::uint32_t max = mask >> shift;
+		return (std::uint8_t)(((pixel & mask) >> shift) * 255 / max);
+	}
+
+	bool LoadBmp(const std::uint8_t* data, std::size_t size, TextureImage& image, std::string& error)
+	{
+		if(size < 54)
+		{
+			error = "truncated BMP header";
+			return false;
+		}
+
+		const std::uint32_t pixelOffset = ReadLE<std::uint32_t>(data + 10);
+		const std::uint32_t headerSize = ReadLE<std::uint32_t>(data + 14);
+		const std::int32_t width = ReadLE<std::int32_t>(data + 18);
+		const std::int32_t rawHeight = ReadLE<std::int32_t>(data + 22);
+		const std::uint16_t bitCount = ReadLE<std::uint16_t>(data + 28);
+		const std::uint32_t compression = ReadLE<std::uint32_t>(data + 30);
+		std::uint32_t paletteCount = ReadLE<std::uint32_t>(data + 46);
+
+		// Negative heights mean the rows are stored top to bottom.
+		const bool topDown = rawHeight < 0;
+		const std::int64_t height = topDown ? -(std::int64_t)rawHeight : rawHeight;
+
+		if(headerSize < 40 || headerSize > size - 14)
+		{
+			error = "invalid BMP header";
+			return false;
+		}
+		if(width <= 0 || height <= 0 || width > (std::int32_t)DDSFormat::MaxTexture2DSize || height > DDSFormat::MaxTexture2DSize)
+		{
+			error = "invalid BMP dimensions";
+			return false;
+		}
+
+		// BI_RGB, or BI_BITFIELDS with the masks after the header or inside a V4/V5 one.
+		std::uint32_t masks[4] = { 0x00ff0000, 0x0000ff00, 0x000000ff, 0 };
+		if(compression == 3)
+		{
+			const std::size_t maskPos = headerSize >= 52 ? 54 : 14 + headerSize;
+			const std::size_t maskCount = headerSize >= 56 ? 4 : 3;
+			if(maskPos + maskCount * 4 > size)
+			{
+				error = "truncated BMP header";
+				return false;
+			}
+			masks[3] = 0;
+			for(std::size_t i = 0; i < maskCount; ++i)
+				masks[i] = ReadLE<std::uint32_t>(data + maskPos + i * 4);
+		}
+		else if(compression != 0)
+		{
+			error = "compressed BMP files are not supported";
+			return false;
+		}
+
+		if(bitCount != 8 && bitCount != 24 && bitCount != 32)
+		{
+			error = "unsupported BMP bit count";
+			return false;
+		}
+		if(bitCount != 32 && compression != 0)
+		{
+			error = "unsupported BMP bit fields";
+			return false;
+		}
+
+		const std::size_t stride = (((std::size_t)width * bitCount + 31) / 32) * 4;
+		if(pixelOffset > size || stride * (std::size_t)height > size - pixelOffset)
+		{
+			error = "truncated BMP pixel data";
+			return false;
+		}
+
+		const std::uint8_t* palette = data + 14 + headerSize;
+		if(bitCount == 8)
+		{
+			if(paletteCount == 0)
+				paletteCount = 256;
+			if(paletteCount > 256 || 14 + headerSize + (std::size_t)paletteCount * 4 > pixelOffset)
+			{
+				error = "invalid BMP palette";
+				return false;
+			}
+		}
+
+		image.Width = (std::uint32_t)width;
+		image.Height = (std::uint32_t)height;
+		image.SRGB = false;
+		image.Pixels.resize((std::size_t)width * height * 4);
+
+		// A 32-bit BI_RGB file may or may not use the fourth byte for alpha.  Treat it as
+		// alpha unless it is zero everywhere.
+		bool anyAlpha = false;
+
+		for(std::int64_t y = 0; y < height; ++y)
+		{
+			const std::uint8_t* src = data + pixelOffset + stride * (std::size_t)(topDown ? y : height - 1 - y);
+			std::uint8_t* dst = image.Pixels.data() + (std::size_t)y * width * 4;
+
+			for(std::int32_t x = 0; x < width; ++x, dst += 4)
+			{
+				if(bitCount == 8)
+				{
+					const std::uint8_t index = src[x];
+					if(index >= paletteCount)
+					{
+						error = "BMP palette index out of range";
+						return false;
+					}
+					dst[0] = palette[index * 4 + 2];
+					dst[1] = palette[index * 4 + 1];
+					dst[2] = palette[index * 4];
+					dst[3] = 255;
+				}
+				else if(bitCount == 24)
+				{
+					dst[0] = src[x * 3 + 2];
+					dst[1] = src[x * 3 + 1];
+					dst[2] = src[x * 3];
+					dst[3] = 255;
+				}
+				else if(compression == 3)
+				{
+					const std::uint32_t pixel = ReadLE<std::uint32_t>(src + x * 4);
+					dst[0] = MaskValue(pixel, masks[0]);
+					dst[1] = MaskValue(pixel, masks[1]);
+					dst[2] = MaskValue(pixel, masks[2]);
+					dst[3] = masks[3] ? MaskValue(pixel, masks[3]) : 255;
+				}
+				else
+				{
+					dst[0] = src[x * 4 + 2];
+					dst[1] = src[x * 4 + 1];
+					dst[2] = src[x * 4];
+					dst[3] = src[x * 4 + 3];
+					anyAlpha = anyAlpha || dst[3] != 0;
+				}
+			}
+		}
+
+		if(bitCount == 32 && compression == 0 && !anyAlpha)
+		{
+			for(std::size_t i = 3; i < image.Pixels.size(); i += 4)
+				image.Pixels[i] = 255;
+		}
+
+		return true;
+	}
+
+	//***********************************************************************************
+	// DDS
+	//***********************************************************************************
+
+	bool LoadDds(const std::uint8_t* data, std::size_t size, TextureImage& image, std::string& error)
+	{
+		DDSInfo info;
+		const DDSStatus status = DDSFormat::Parse(data, size, info);
+		if(status != DDSStatus::Ok)
+		{
+			error = DDSFormat::StatusString(status);
+			return false;
+		}
+
+		if(info.Dimension != DDSDimension::Texture2D)
+		{
+			error = "only 2D DDS textures can be read";
+			return false;
+		}
+
+		bool bgr = false;
+		bool opaque = false;
+		bool srgb = false;
+		switch(info.Format)
+		{
+		case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB: srgb = true; break;
+		case DXGI_FORMAT_R8G8B8A8_UNORM: break;
+		case DXGI_FORMAT_B8G8R8A8_UNORM_SRGB: srgb = true; bgr = true; break;
+		case DXGI_FORMAT_B8G8R8A8_UNORM: bgr = true; break;
+		case DXGI_FORMAT_B8G8R8X8_UNORM_SRGB: srgb = true; bgr = true; opaque = true; break;
+		case DXGI_FORMAT_B8G8R8X8_UNORM: bgr = true; opaque = true; break;
+		default:
+			error = "DDS format " + std::to_string((int)info.Format) + " cannot be read, only 8-bit RGBA and BGRA can";
+			return false;
+		}
+
+		const DDSSubresource& top = info.Subresources[0];
+		image.Width = top.Width;
+		image.Height = top.Height;
+		image.SRGB = srgb;
+		image.Pixels.resize((std::size_t)top.Width * top.Height * 4);
+
+		for(std::uint32_t y = 0; y < top.Height; ++y)
+		{
+			const std::uint8_t* src = data + top.Offset + y * top.RowBytes;
+			std::uint8_t* dst = image.Pixels.data() + (std::size_t)y * top.Width * 4;
+
+			for(std::uint32_t x = 0; x < top.Width; ++x, src += 4, dst += 4)
+			{
+				dst[0] = bgr ? src[2] : src[0];
+				dst[1] = src[1];
+				dst[2] = bgr ? src[0] : src[2];
+				dst[3] = opaque ? 255 : src[3];
+			}
+		}
+
+		return true;
+	}
+}
+
+bool TextureImage::HasAlpha() const
+{
+	for(std::size_t i = 3; i < Pixels.size(); i += 4)
+	{
+		if(Pixels[i] != 255)
+			return true;
+	}
+	return false;
+}
+
+bool TextureImageIO::ReadFile(const std::string& path, std::vector<std::uint8_t>& bytes, std::string& error)
+{
+	FILE* file = std::fopen(path.c_str(), "rb");
+	if(!file)
+	{
+		error = "cannot open " + path;
+		return false;
+	}
+
+	bytes.clear();
+	std::uint8_t buffer[65536];
+	std::size_t count;
+	while((count = std::fread(buffer, 1, sizeof(buffer), file)) > 0)
+		bytes.insert(bytes.end(), buffer, buffer + count);
+
+	const bool ok = !std::ferror(file);
+	std::fclose(file);
+
+	if(!ok)
+		error = "cannot read " + path;
+	return ok;
+}
+
+bool TextureImageIO::Load(const std::string& path, TextureImage& image, std::string& error)
+{
+	std::vector<std::uint8_t> bytes;
+	if(!ReadFile(path, bytes, error))
+		return false;
+
+	if(!LoadFromMemory(bytes.data(), bytes.size(), image, error))
+	{
+		error = path + ": " + error;
+		return false;
+	}
+
+	return true;
+}
+
+bool TextureImageIO::LoadFromMemory(const std::uint8_t* data, std::size_t size, TextureImage& image, std::string& error)
+{
+	static const std::uint8_t pngSignature[8] = { 0x89, 'P', 'N', 'G', 0x0d, 0x0a, 0x1a, 0x0a };
+
+	if(size >= 8 && std::memcmp(data, pngSignature, 8) == 0)
+		return LoadPng(data, size, image, error);
+	if(size >= 2 && data[0] == 'B' && data[1] == 'M')
+		return LoadBmp(data, size, image, error);
+	if(size >= 4 && ReadLE<std::uint32_t>(data) == DDS_MAGIC)
+		return LoadDds(data, size, image, error);
+
+	error = "unknown image format";
+	return false;
+}
+
+bool TextureImageIO::SaveDDS(const std::string& path, DXGI_FORMAT format, std::uint32_t width, std::uint32_t height,
+	std::uint32_t mipCount, std::uint32_t arraySize, const std::vector<std::vector<std::uint8_t>>& subresources,
+	std::string& error)
+{
+	if(subresources.size() != (std::size_t)mipCount * arraySize || mipCount == 0 || arraySize == 0)
+	{
+		error = "wrong number of subresources";
+		return false;
+	}
+
+	// Check every surface has the size the loader will expect.
+	for(std::uint32_t item = 0; item < arraySize; ++item)
+	{
+		for(std::uint32_t mip = 0; mip < mipCount; ++mip)
+		{
+			const std::uint32_t w = width >> mip ? width >> mip : 1;
+			const std::uint32_t h = height >> mip ? height >> mip : 1;
+
+			std::uint64_t numBytes = 0;
+			if(!DDSFormat::GetSurfaceInfo(w, h, format, &numBytes, nullptr, nullptr) ||
+				subresources[item * mipCount + mip].size() != numBytes)
+			{
+				error = "subresource " + std::to_string(item * mipCount + mip) + " has the wrong size";
+				return false;
+			}
+		}
+	}
+
+	std::uint64_t topBytes = 0, topRowBytes = 0;
+	DDSFormat::GetSurfaceInfo(width, height, format, &topBytes, &topRowBytes, nullptr);
+	const bool compressed = topRowBytes * height != topBytes || DDSFormat::BitsPerPixel(format) < 8;
+
+	DDS_HEADER header = {};
+	header.size = sizeof(DDS_HEADER);
+	header.flags = DDS_HEADER_FLAGS_TEXTURE | (compressed ? DDS_HEADER_FLAGS_LINEARSIZE : DDS_HEADER_FLAGS_PITCH);
+	header.height = height;
+	header.width = width;
+	header.pitchOrLinearSize = (std::uint32_t)(compressed ? topBytes : topRowBytes);
+	header.depth = 1;
+	header.mipMapCount = mipCount;
+	header.ddspf.size = sizeof(DDS_PIXELFORMAT);
+	header.ddspf.flags = DDS_FOURCC;
+	header.ddspf.fourCC = MAKEFOURCC('D', 'X', '1', '0');
+	header.caps = DDS_SURFACE_FLAGS_TEXTURE;
+	if(mipCount > 1)
+	{
+		header.flags |= DDS_HEADER_FLAGS_MIPMAP;
+		header.caps |= DDS_SURFACE_FLAGS_MIPMAP;
+	}
+
+	DDS_HEADER_DXT10 dx10 = {};
+	dx10.dxgiFormat = format;
+	dx10.resourceDimension = DDS_DIMENSION_TEXTURE2D;
+	dx10.arraySize = arraySize;
+
+	FILE* file = std::fopen(path.c_str(), "wb");
+	if(!file)
+	{
+		error = "cannot create " + path;
+		return false;
+	}
+
+	const std::uint32_t magic = DDS_MAGIC;
+	bool ok = std::fwrite(&magic, sizeof(magic), 1, file) == 1 &&
+		std::fwrite(&header, sizeof(header), 1, file) == 1 &&
+		std::fwrite(&dx10, sizeof(dx10), 1, file) == 1;
+
+	for(std::size_t i = 0; ok && i < subresources.size(); ++i)
+		ok = std::fwrite(subresources[i].data(), 1, subresources[i].size(), file) == subresources[i].size();
+
+	ok = std::fclose(file) == 0 && ok;
+	if(!ok)
+		error = "cannot write " + path;
+	return ok;
+}
@@ -0,0 +1,56 @@
+//***************************************************************************************
+// TextureImage.h
+//
+// Reads source images for the texture cooking tools and writes the cooked DDS files.
+// Images are converted to 8-bit RGBA on load whatever their source format, so the tools
+// only have to handle one pixel layout.
+//
+// Supported inputs are PNG (non-interlaced), uncompressed BMP and DDS files stored in one
+// of the 8-bit RGBA or BGRA formats.  No platform imaging library is used, so the tools
+// build wherever DDSFormat does.
+//***************************************************************************************
+
+#ifndef TEXTUREIMAGE_H
+#define TEXTUREIMAGE_H
+
+#include "DDSFormat.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// An 8-bit RGBA image, rows from top to bottom with no padding.
+struct TextureImage
+{
+	std::uint32_t Width = 0;
+	std::uint32_t Height = 0;
+
+	// The texels are sRGB encoded.  Only DDS files say so; the tools decide for other
+	// sources.
+	bool SRGB = false;
+
+	std::vector<std::uint8_t> Pixels;
+
+	// True if any texel is not fully opaque.
+	bool HasAlpha() const;
+};
+
+class TextureImageIO
+{
+public:
+	// Loads the file, detecting its format from its contents rather than its name.  Only
+	// the top mip of the first array slice of a DDS file is read.
+	static bool Load(const std::string& path, TextureImage& image, std::string& error);
+	static bool LoadFromMemory(const std::uint8_t* data, std::size_t size, TextureImage& image, std::string& error);
+
+	// Writes a 2D texture or texture array with a DX10 header.  The subresources are in
+	// DDS order, the mips of the first slice then those of the next one, each tightly
+	// packed in the layout DDSFormat::GetSurfaceInfo gives.
+	static bool SaveDDS(const std::string& path, DXGI_FORMAT format, std::uint32_t width, std::uint32_t height,
+		std::uint32_t mipCount, std::uint32_t arraySize, const std::vector<std::vector<std::uint8_t>>& subresources,
+		std::string& error);
+
+	static bool ReadFile(const std::string& path, std::vector<std::uint8_t>& bytes, std::string& error);
+};
+
+#endif // TEXTUREIMAGE_H
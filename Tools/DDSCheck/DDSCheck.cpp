@@ -0,0 +1,418 @@
+//***************************************************************************************
+// DDSCheck.cpp
+//
+// Command line front end for the DDS parser in Common/DDSFormat.  Does not need
+// Direct3D, so it builds on any platform:
+//
+//   g++ -O2 -std=c++14 -I../../Common DDSCheck.cpp ../../Common/DDSFormat.cpp -o ddscheck
+//
+// Usage:
+//
+//   ddscheck file...                      Print the layout of each file.
+//   ddscheck -bench [iterations] file...  Parse the files repeatedly and report throughput.
+//   ddscheck -fuzz seed [iterations] [file...]
+//                                         Parse mutated copies of the files (or of a few
+//                                         built in textures) and check that every
+//                                         subresource the parser accepts lies inside the
+//                                         file.
+//
+// Built with -DDDSCHECK_LIBFUZZER (and -fsanitize=fuzzer, without main) the same checks
+// run as a libFuzzer target instead.
+//***************************************************************************************
+
+#include "DDSFormat.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+	bool ReadFile(const char* path, std::vector<std::uint8_t>& bytes)
+	{
+		FILE* file = std::fopen(path, "rb");
+		if(!file)
+			return false;
+
+		bytes.clear();
+		std::uint8_t buffer[65536];
+		std::size_t count;
+		while((count = std::fread(buffer, 1, sizeof(buffer), file)) > 0)
+			bytes.insert(bytes.end(), buffer, buffer + count);
+
+		const bool ok = !std::ferror(file);
+		std::fclose(file);
+		return ok;
+	}
+
+	const char* DimensionString(DDSDimension dimension)
+	{
+		switch(dimension)
+		{
+		case DDSDimension::Texture1D: return "1D";
+		case DDSDimension::Texture2D: return "2D";
+		case DDSDimension::Texture3D: return "3D";
+		default: return "unknown";
+		}
+	}
+
+	// The invariants a caller relies on when it reads subresources straight out of the
+	// file.  Returns a description of the first one broken, nullptr if they all hold.
+	const char* CheckInfo(const DDSInfo& info, std::size_t size)
+	{
+		if(info.Subresources.size() != (std::size_t)info.MipCount * info.ArraySize)
+			return "subresource count does not match mips and array size";
+		if(info.Format == DXGI_FORMAT_UNKNOWN || DDSFormat::BitsPerPixel(info.Format) == 0)
+			return "accepted a format of unknown size";
+
+		for(const DDSSubresource& sub : info.Subresources)
+		{
+			if(sub.Offset < info.DataOffset)
+				return "subresource overlaps the headers";
+			if(sub.Offset > size || sub.Size > size - sub.Offset)
+				return "subresource extends past the end of the file";
+			if(sub.Width == 0 || sub.Height == 0 || sub.Depth == 0)
+				return "subresource has a zero dimension";
+			if(sub.SliceBytes * sub.Depth != sub.Size)
+				return "subresource size does not match its slices";
+		}
+
+		return nullptr;
+	}
+
+	// Parses one input and checks the result.  Returns false if an invariant is broken.
+	bool FuzzOne(const std::uint8_t* data, std::size_t size, DDSInfo& info)
+	{
+		if(DDSFormat::Parse(data, size, info) != DDSStatus::Ok)
+			return true;
+
+		const char* problem = CheckInfo(info, size);
+		if(problem)
+		{
+			std::fprintf(stderr, "invariant broken: %s\n", problem);
+			return false;
+		}
+
+		return true;
+	}
+
+	template<typename T>
+	void WriteField(std::vector<std::uint8_t>& bytes, std::size_t offset, T value)
+	{
+		std::memcpy(bytes.data() + offset, &value, sizeof(T));
+	}
+
+	// A well formed file with a DX10 header and zeroed texels.
+	std::vector<std::uint8_t> MakeDDS(DXGI_FORMAT format, std::uint32_t dimension, std::uint32_t width,
+		std::uint32_t height, std::uint32_t depth, std::uint32_t mips, std::uint32_t arraySize, bool cube)
+	{
+		const std::size_t headerSize = sizeof(std::uint32_t) + sizeof(DDS_HEADER) + sizeof(DDS_HEADER_DXT10);
+		std::vector<std::uint8_t> bytes(headerSize, 0);
+
+		DDS_HEADER header = {};
+		header.size = sizeof(DDS_HEADER);
+		header.flags = DDS_HEADER_FLAGS_TEXTURE | DDS_HEADER_FLAGS_MIPMAP;
+		header.width = width;
+		header.height = height;
+		header.depth = depth;
+		header.mipMapCount = mips;
+		header.ddspf.size = sizeof(DDS_PIXELFORMAT);
+		header.ddspf.flags = DDS_FOURCC;
+		header.ddspf.fourCC = MAKEFOURCC('D', 'X', '1', '0');
+
+		DDS_HEADER_DXT10 dx10 = {};
+		dx10.dxgiFormat = format;
+		dx10.resourceDimension = dimension;
+		dx10.miscFlag = cube ? DDS_RESOURCE_MISC_TEXTURECUBE : 0;
+		dx10.arraySize = arraySize;
+
+		WriteField(bytes, 0, DDS_MAGIC);
+		WriteField(bytes, sizeof(std::uint32_t), header);
+		WriteField(bytes, sizeof(std::uint32_t) + sizeof(DDS_HEADER), dx10);
+
+		std::uint64_t dataSize = 0;
+		const std::uint32_t faces = arraySize * (cube ? 6 : 1);
+		for(std::uint32_t item = 0; item < faces; ++item)
+		{
+			std::uint32_t w = width, h = height, d = depth;
+			for(std::uint32_t mip = 0; mip < mips; ++mip)
+			{
+				std::uint64_t numBytes = 0;
+				DDSFormat::GetSurfaceInfo(w, h, format, &numBytes, nullptr, nullptr);
+				dataSize += numBytes * d;
+
+				w = w > 1 ? w / 2 : 1;
+				h = h > 1 ? h / 2 : 1;
+				d = d > 1 ? d / 2 : 1;
+			}
+		}
+
+		bytes.resize(headerSize + (std::size_t)dataSize, 0);
+		return bytes;
+	}
+
+	std::vector<std::vector<std::uint8_t>> MakeSeeds()
+	{
+		std::vector<std::vector<std::uint8_t>> seeds;
+		seeds.push_back(MakeDDS(DXGI_FORMAT_BC1_UNORM, DDS_DIMENSION_TEXTURE2D, 64, 64, 1, 7, 1, false));
+		seeds.push_back(MakeDDS(DXGI_FORMAT_BC7_UNORM_SRGB, DDS_DIMENSION_TEXTURE2D, 20, 12, 1, 5, 3, false));
+		seeds.push_back(MakeDDS(DXGI_FORMAT_R8G8B8A8_UNORM, DDS_DIMENSION_TEXTURE2D, 16, 16, 1, 5, 1, true));
+		seeds.push_back(MakeDDS(DXGI_FORMAT_R16G16B16A16_FLOAT, DDS_DIMENSION_TEXTURE3D, 8, 8, 8, 4, 1, false));
+		seeds.push_back(MakeDDS(DXGI_FORMAT_R32_FLOAT, DDS_DIMENSION_TEXTURE1D, 32, 1, 1, 6, 2, false));
+		seeds.push_back(MakeDDS(DXGI_FORMAT_YUY2, DDS_DIMENSION_TEXTURE2D, 8, 8, 1, 1, 1, false));
+		return seeds;
+	}
+
+	// Header fields worth randomizing: the main header's size, flags, height, width,
+	// depth, mip count, pixel format flags, fourCC and bit count, and the whole DX10
+	// header.
+	const std::size_t HeaderFieldOffsets[] =
+	{
+		4, 8, 12, 16, 24, 28, 80, 84, 88, 128, 132, 136, 140, 144
+	};
+
+	void Mutate(std::vector<std::uint8_t>& bytes, std::mt19937& rng)
+	{
+		const int mutations = 1 + (int)(rng() % 4);
+		for(int i = 0; i < mutations; ++i)
+		{
+			switch(rng() % 5)
+			{
+			case 0:
+				// Flip one bit anywhere, weighted towards the headers.
+				if(!bytes.empty())
+				{
+					std::size_t range = bytes.size();
+					if(rng() % 2 && range > 148)
+						range = 148;
+					bytes[rng() % range] ^= (std::uint8_t)(1u << (rng() % 8));
+				}
+				break;
+
+			case 1:
+				// Truncate.
+				if(!bytes.empty())
+					bytes.resize(rng() % bytes.size());
+				break;
+
+			case 2:
+			{
+				// Overwrite a header field with a random or boundary value.
+				const std::size_t offset = HeaderFieldOffsets[rng() % (sizeof(HeaderFieldOffsets) / sizeof(HeaderFieldOffsets[0]))];
+				if(offset + sizeof(std::uint32_t) <= bytes.size())
+				{
+					static const std::uint32_t boundaries[] =
+					{
+						0, 1, 2, 3, 4, 6, 15, 16, 17, 2048, 16384, 16385, 0x7fffffff, 0x80000000, 0xffffffff
+					};
+					const std::uint32_t value = rng() % 2 ? (std::uint32_t)rng() : boundaries[rng() % (sizeof(boundaries) / sizeof(boundaries[0]))];
+					WriteField(bytes, offset, value);
+				}
+				break;
+			}
+
+			case 3:
+				// Grow with garbage.
+				bytes.resize(bytes.size() + rng() % 256, (std::uint8_t)rng());
+				break;
+
+			default:
+				// A random DXGI format, which exercises the size tables.
+				if(bytes.size() >= 132)
+					WriteField(bytes, 128, (std::uint32_t)(rng() % 140));
+				break;
+			}
+		}
+	}
+
+	int PrintFiles(int argc, char** argv)
+	{
+		int failed = 0;
+		std::vector<std::uint8_t> bytes;
+		DDSInfo info;
+
+		for(int i = 0; i < argc; ++i)
+		{
+			if(!ReadFile(argv[i], bytes))
+			{
+				std::printf("%s: cannot read file\n", argv[i]);
+				++failed;
+				continue;
+			}
+
+			const DDSStatus status = DDSFormat::Parse(bytes.data(), bytes.size(), info);
+			if(status != DDSStatus::Ok)
+			{
+				std::printf("%s: %s\n", argv[i], DDSFormat::StatusString(status));
+				++failed;
+				continue;
+			}
+
+			std::printf("%s: %s %ux%ux%u, format %d, %u mips, array size %u%s, %zu bytes\n",
+				argv[i], DimensionString(info.Dimension), info.Width, info.Height, info.Depth,
+				(int)info.Format, info.MipCount, info.ArraySize, info.IsCubeMap ? " (cube)" : "",
+				bytes.size());
+
+			for(std::size_t s = 0; s < info.Subresources.size(); ++s)
+			{
+				const DDSSubresource& sub = info.Subresources[s];
+				std::printf("  [%zu] %ux%ux%u offset %llu size %llu row %llu\n", s,
+					sub.Width, sub.Height, sub.Depth, (unsigned long long)sub.Offset,
+					(unsigned long long)sub.Size, (unsigned long long)sub.RowBytes);
+			}
+		}
+
+		return failed ? 1 : 0;
+	}
+
+	int Bench(int argc, char** argv)
+	{
+		int iterations = 100000;
+		if(argc > 0 && std::atoi(argv[0]) > 0)
+		{
+			iterations = std::atoi(argv[0]);
+			++argv;
+			--argc;
+		}
+
+		std::vector<std::vector<std::uint8_t>> files;
+		for(int i = 0; i < argc; ++i)
+		{
+			std::vector<std::uint8_t> bytes;
+			if(!ReadFile(argv[i], bytes))
+			{
+				std::fprintf(stderr, "%s: cannot read file\n", argv[i]);
+				return 1;
+			}
+			files.push_back(bytes);
+		}
+		if(files.empty())
+			files = MakeSeeds();
+
+		// Only the headers are read, but report against the whole file size since that is
+		// what a loader hands the parser.
+		std::uint64_t bytesParsed = 0;
+		std::uint64_t accepted = 0;
+		DDSInfo info;
+
+		const auto start = std::chrono::steady_clock::now();
+		for(int i = 0; i < iterations; ++i)
+		{
+			for(const auto& bytes : files)
+			{
+				if(DDSFormat::Parse(bytes.data(), bytes.size(), info) == DDSStatus::Ok)
+					accepted += info.Subresources.size();
+				bytesParsed += bytes.size();
+			}
+		}
+		const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		const double parses = (double)iterations * files.size();
+		std::printf("%.0f parses in %.3f s: %.2f M files/s, %.1f ns/file, %.1f GB/s of file data (%llu subresources)\n",
+			parses, seconds, parses / seconds / 1e6, seconds * 1e9 / parses,
+			bytesParsed / seconds / 1e9, (unsigned long long)accepted);
+		return 0;
+	}
+
+	int Fuzz(int argc, char** argv)
+	{
+		if(argc < 1)
+		{
+			std::fprintf(stderr, "-fuzz needs a seed\n");
+			return 1;
+		}
+
+		const std::uint32_t seed = (std::uint32_t)std::strtoul(argv[0], nullptr, 10);
+		++argv;
+		--argc;
+
+		int iterations = 1000000;
+		if(argc > 0 && std::atoi(argv[0]) > 0)
+		{
+			iterations = std::atoi(argv[0]);
+			++argv;
+			--argc;
+		}
+
+		std::vector<std::vector<std::uint8_t>> corpus;
+		for(int i = 0; i < argc; ++i)
+		{
+			std::vector<std::uint8_t> bytes;
+			if(!ReadFile(argv[i], bytes))
+			{
+				std::fprintf(stderr, "%s: cannot read file\n", argv[i]);
+				return 1;
+			}
+			corpus.push_back(bytes);
+		}
+		if(corpus.empty())
+			corpus = MakeSeeds();
+
+		std::mt19937 rng(seed);
+		std::vector<std::uint8_t> input;
+		DDSInfo info;
+		int accepted = 0;
+
+		for(int i = 0; i < iterations; ++i)
+		{
+			input = corpus[rng() % corpus.size()];
+			Mutate(input, rng);
+
+			if(DDSFormat::Parse(input.data(), input.size(), info) == DDSStatus::Ok)
+				++accepted;
+
+			if(!FuzzOne(input.data(), input.size(), info))
+			{
+				const std::string path = "ddscheck-crash-" + std::to_string(seed) + "-" + std::to_string(i) + ".dds";
+				FILE* file = std::fopen(path.c_str(), "wb");
+				if(file)
+				{
+					std::fwrite(input.data(), 1, input.size(), file);
+					std::fclose(file);
+				}
+				std::fprintf(stderr, "iteration %d failed, input written to %s\n", i, path.c_str());
+				return 1;
+			}
+		}
+
+		std::printf("%d inputs, %d accepted, no invariant broken\n", iterations, accepted);
+		return 0;
+	}
+}
+
+#ifdef DDSCHECK_LIBFUZZER
+
+extern "C" int LLVMFuzzerTestOneInput(const std::uint8_t* data, std::size_t size)
+{
+	static DDSInfo info;
+	if(!FuzzOne(data, size, info))
+		std::abort();
+	return 0;
+}
+
+#else
+
+int main(int argc, char** argv)
+{
+	if(argc < 2)
+	{
+		std::fprintf(stderr,
+			"usage: ddscheck file...\n"
+			"       ddscheck -bench [iterations] file...\n"
+			"       ddscheck -fuzz seed [iterations] [file...]\n");
+		return 1;
+	}
+
+	if(std::strcmp(argv[1], "-bench") == 0)
+		return Bench(argc - 2, argv + 2);
+	if(std::strcmp(argv[1], "-fuzz") == 0)
+		return Fuzz(argc - 2, argv + 2);
+
+	return PrintFiles(argc - 1, argv + 1);
+}
+
+#endif
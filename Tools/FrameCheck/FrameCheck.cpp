@@ -0,0 +1,1215 @@
+//***************************************************************************************
+// FrameCheck.cpp
+//
+// Checks and microbenchmarks for the parts of the frame code that do not need
+// Direct3D, so they build and run on any platform:
+//
+//   g++ -O2 -std=c++14 -pthread -I"../../Assignment Folder/ProjectTest" FrameCheck.cpp
+//       "../../Assignment Folder/ProjectTest/DirtySet.cpp"
+//       "../../Assignment Folder/ProjectTest/RecordScheduler.cpp"
+//       "../../Assignment Folder/ProjectTest/SceneDiff.cpp"
+//       "../../Assignment Folder/ProjectTest/SceneFormat.cpp"
+//       ../../Common/DescriptorAllocator.cpp ../../Common/FileWatcher.cpp
+//       ../../Common/FramePacer.cpp ../../Common/GameTimer.cpp ../../Common/InputLog.cpp
+//       ../../Common/MappedFile.cpp ../../Common/Profiler.cpp -o framecheck
+//
+// Usage:
+//
+//   framecheck                   Run every check and report the failures.
+//   framecheck -bench [frames]   Time the frame bookkeeping over the given number of
+//                                frames, 1000 by default: dirty tracking and the
+//                                partitioning and recording of the draw list.  Then
+//                                time the profiler's scopes, and fail if a scope costs
+//                                more than its budget.
+//***************************************************************************************
+
+#include "../../Common/DescriptorAllocator.h"
+#include "../../Common/FileWatcher.h"
+#include "../../Common/FramePacer.h"
+#include "../../Common/GameTimer.h"
+#include "../../Common/InputLog.h"
+#include "../../Common/MappedFile.h"
+#include "../../Common/Profiler.h"
+#include "DirtySet.h"
+#include "NullCommandSink.h"
+#include "RecordingCommandSink.h"
+#include "RecordScheduler.h"
+#include "SceneDiff.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	// Frame resources in flight in the app.
+	const int gFrameResourceCount = 3;
+
+	int gFailures = 0;
+
+	void Expect(bool condition, const char* what)
+	{
+		if(!condition)
+		{
+			std::fprintf(stderr, "failed: %s\n", what);
+			++gFailures;
+		}
+	}
+
+	double SecondsSince(std::chrono::steady_clock::time_point start)
+	{
+		return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	// Spreads the changed items of a frame over the whole range, like edits to a scene
+	// would be, instead of touching one cache line.
+	std::uint32_t ScatterIndex(std::uint32_t frame, std::uint32_t k, std::uint32_t count)
+	{
+		return (std::uint32_t)(((std::uint64_t)frame * 7919u + (std::uint64_t)k * 104729u) % count);
+	}
+
+	//
+	// DirtySet
+	//
+
+	void CheckDirtySet()
+	{
+		DirtySet dirty(gFrameResourceCount);
+		dirty.Resize(10);
+
+		// New elements start dirty in every frame resource.
+		for(int f = 0; f < gFrameResourceCount; ++f)
+		{
+			Expect(dirty.Pending(f).size() == 10, "DirtySet: new elements are pending everywhere");
+			dirty.ClearPending(f);
+		}
+
+		dirty.MarkDirty(3);
+		dirty.MarkDirty(7);
+		dirty.MarkDirty(3);
+		for(int f = 0; f < gFrameResourceCount; ++f)
+		{
+			const auto& pending = dirty.Pending(f);
+			Expect(pending.size() == 2 && pending[0] == 3 && pending[1] == 7,
+				"DirtySet: marking twice queues once");
+		}
+
+		// A frame resource that uploaded can be queued again while the others still wait.
+		dirty.ClearPending(0);
+		dirty.MarkDirty(7);
+		Expect(dirty.Pending(0).size() == 1 && dirty.Pending(0)[0] == 7, "DirtySet: requeue after clear");
+		Expect(dirty.Pending(1).size() == 2, "DirtySet: no duplicate in a list not cleared");
+
+		// Shrinking drops pending indices past the end.
+		dirty.Resize(5);
+		Expect(dirty.Pending(1).size() == 1 && dirty.Pending(1)[0] == 3, "DirtySet: shrink drops removed elements");
+
+		// Many clears must not let a stale stamp match again.
+		dirty.ClearPending(1);
+		for(int i = 0; i < 100000; ++i)
+			dirty.ClearPending(1);
+		dirty.MarkDirty(4);
+		Expect(dirty.Pending(1).size() == 1, "DirtySet: generations stay distinct across clears");
+	}
+
+	//
+	// SceneDiff
+	//
+
+	// Two textures, an opaque and a transparent material, and three shapes, two of
+	// them in a group.
+	const char* gDiffScene =
+		"texture stoneTex stone.dds\n"
+		"texture waterTex water.dds\n"
+		"material stone stoneTex 1.0 1.0 1.0 1.0  0.02 0.02 0.02  0.25\n"
+		"material water waterTex 1.0 1.0 1.0 0.5  0.1 0.1 0.1  0.0  transparent\n"
+		"group castle\n"
+		"shape castle box stone  1.0 1.0 1.0  0.0 0.0 0.0\n"
+		"shape castle box stone  1.0 1.0 1.0  2.0 0.0 0.0\n"
+		"shape - pyramid stone  1.0 1.0 1.0  4.0 0.0 0.0\n";
+
+	// gDiffScene with the first occurrence of from replaced by to.
+	std::string EditScene(const std::string& from, const std::string& to)
+	{
+		std::string text = gDiffScene;
+		const std::size_t at = text.find(from);
+		if(at != std::string::npos)
+			text.replace(at, from.size(), to);
+		return text;
+	}
+
+	bool CookText(const std::string& text, CookedScene& scene)
+	{
+		std::string error;
+		SceneDesc desc;
+		std::vector<std::uint8_t> cooked;
+		return SceneFormat::ParseText(text, desc, error) &&
+			SceneFormat::Cook(desc, cooked, error) &&
+			scene.Load(std::move(cooked), error);
+	}
+
+	// Diffs gDiffScene against text, or returns a structural delta if either does not cook.
+	SceneDelta DiffScene(const std::string& text)
+	{
+		CookedScene oldScene;
+		CookedScene newScene;
+		if(!CookText(gDiffScene, oldScene) || !CookText(text, newScene))
+		{
+			SceneDelta failed;
+			failed.Structural = true;
+			failed.Reason = "does not cook";
+			return failed;
+		}
+		return SceneDiff::Diff(oldScene.View(), newScene.View());
+	}
+
+	bool Patches(const SceneDelta& delta, const std::vector<std::uint32_t>& materials,
+		const std::vector<std::uint32_t>& shapes)
+	{
+		return !delta.Structural && delta.ChangedMaterials == materials && delta.ChangedShapes == shapes;
+	}
+
+	// Rewrites a file until its write time moves, which takes a while on file systems
+	// with coarse times.
+	void TouchFile(const char* filename, const std::string& text)
+	{
+		std::uint64_t before = 0;
+		GetFileWriteTime(filename, before);
+		for(int attempt = 0; attempt < 300; ++attempt)
+		{
+			std::FILE* file = std::fopen(filename, "wb");
+			std::fwrite(text.data(), 1, text.size(), file);
+			std::fclose(file);
+
+			std::uint64_t after = 0;
+			if(GetFileWriteTime(filename, after) && after != before)
+				return;
+			std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		}
+	}
+
+	void CheckSceneDiff()
+	{
+		Expect(DiffScene(gDiffScene).Empty(), "SceneDiff: unchanged scene patches nothing");
+
+		Expect(Patches(DiffScene(EditScene("0.02 0.02 0.02  0.25", "0.02 0.02 0.02  0.5")), { 0 }, {}),
+			"SceneDiff: material constants patch the material only");
+		Expect(Patches(DiffScene(EditScene("stoneTex 1.0", "waterTex 1.0")), { 0 }, {}),
+			"SceneDiff: material texture patches the material only");
+		Expect(Patches(DiffScene(EditScene("0.25\n", "0.25  alphaTested\n")), { 0 }, {}),
+			"SceneDiff: material layer patches the material");
+
+		// Giving a shape the transparent material must move it out of the opaque layer,
+		// which the app does for every changed shape whose material has another layer.
+		{
+			const std::string text = EditScene("box stone  1.0 1.0 1.0  2.0", "box water  1.0 1.0 1.0  2.0");
+			Expect(Patches(DiffScene(text), {}, { 1 }), "SceneDiff: material swap patches the shape only");
+
+			CookedScene oldScene;
+			CookedScene newScene;
+			const bool cooked = CookText(gDiffScene, oldScene) && CookText(text, newScene);
+			Expect(cooked && oldScene.View().Materials[oldScene.View().ShapeMaterials[1]].Layer == (std::uint32_t)SceneLayer::Opaque &&
+				newScene.View().Materials[newScene.View().ShapeMaterials[1]].Layer == (std::uint32_t)SceneLayer::Transparent,
+				"SceneDiff: swapped material brings its layer");
+		}
+
+		Expect(Patches(DiffScene(EditScene("4.0 0.0 0.0", "4.0 1.0 0.0")), {}, { 2 }),
+			"SceneDiff: moved shape patches the shape only");
+		Expect(Patches(DiffScene(EditScene("4.0 0.0 0.0", "4.0 0.0 0.0  0.0 0.5 0.0")), {}, { 2 }),
+			"SceneDiff: rotated shape patches the shape only");
+		Expect(Patches(DiffScene(EditScene("shape - pyramid", "shape castle pyramid")), {}, { 2 }),
+			"SceneDiff: regrouped shape patches the shape only");
+		Expect(Patches(DiffScene(EditScene("- pyramid", "- box")), {}, { 2 }),
+			"SceneDiff: new mesh patches the shape only");
+
+		// Anything that changes the number of render items, materials or textures cannot
+		// be patched.
+		const SceneDelta added = DiffScene(std::string(gDiffScene) + "shape - box stone  1.0 1.0 1.0  6.0 0.0 0.0\n");
+		Expect(added.Structural && added.Reason == "shape count changed" &&
+			added.ChangedMaterials.empty() && added.ChangedShapes.empty(), "SceneDiff: added shape is structural");
+
+		const SceneDelta removed = DiffScene(EditScene("shape - pyramid stone  1.0 1.0 1.0  4.0 0.0 0.0\n", ""));
+		Expect(removed.Structural && removed.Reason == "shape count changed" &&
+			removed.ChangedMaterials.empty() && removed.ChangedShapes.empty(), "SceneDiff: removed shape is structural");
+
+		Expect(DiffScene(EditScene("group castle\n", "group castle\ngroup maze\n")).Structural,
+			"SceneDiff: added group is structural");
+		Expect(DiffScene(EditScene("water.dds", "sea.dds")).Structural, "SceneDiff: new texture file is structural");
+
+		// A shader edit is reported by the watcher on its own, and leaves the scene, which
+		// the app re-cooks only when its own file changes, with nothing to patch.
+		{
+			const char* sceneFilename = "framecheck.scene";
+			const char* shaderFilename = "framecheck.hlsl";
+			TouchFile(sceneFilename, gDiffScene);
+			TouchFile(shaderFilename, "float4 PS() : SV_Target { return 0.0f; }\n");
+
+			FileWatcher watcher;
+			watcher.Watch(sceneFilename);
+			watcher.Watch(shaderFilename);
+			TouchFile(shaderFilename, "float4 PS() : SV_Target { return 1.0f; }\n");
+
+			// A change is reported once its write time held for a poll.
+			const std::vector<std::string> unsettled = watcher.Poll();
+			const std::vector<std::string> settled = watcher.Poll();
+			Expect(unsettled.empty(), "SceneDiff: shader change waits a poll to settle");
+			Expect(settled.size() == 1 && settled[0] == shaderFilename, "SceneDiff: shader-only change reports the shader only");
+			Expect(watcher.Poll().empty(), "SceneDiff: a change is reported once");
+
+			std::string error;
+			SceneDesc desc;
+			std::vector<std::uint8_t> cooked;
+			CookedScene oldScene;
+			CookedScene newScene;
+			const bool loaded = CookText(gDiffScene, oldScene) &&
+				SceneFormat::LoadText(sceneFilename, desc, error) &&
+				SceneFormat::Cook(desc, cooked, error) &&
+				newScene.Load(std::move(cooked), error);
+			Expect(loaded && SceneDiff::Diff(oldScene.View(), newScene.View()).Empty(),
+				"SceneDiff: shader-only change leaves the scene unpatched");
+
+			std::remove(sceneFilename);
+			std::remove(shaderFilename);
+		}
+	}
+
+	//
+	// RecordScheduler
+	//
+
+	// A draw list shaped like the app's: runs of packets sharing a PSO, geometry and
+	// material, with the odd instanced batch.  StartIndex is the packet's position, so
+	// the draws a sink saw can be traced back to the packets.
+	std::vector<DrawPacket> MakePackets(std::uint32_t count)
+	{
+		std::vector<DrawPacket> packets(count);
+		for(std::uint32_t i = 0; i < count; ++i)
+		{
+			DrawPacket& p = packets[i];
+			p.Pso = i * 3 / count;
+			p.Geometry = (i / 40) % 7;
+			p.Topology = i * 3 / count == 2 ? 1 : 4;
+			p.MatCBIndex = (i / 5) % 11;
+			p.ObjCBIndex = i;
+			p.IndexCount = 36;
+			p.StartIndex = i;
+			p.BaseVertex = 0;
+			if(i % 97 == 0)
+			{
+				p.Instanced = true;
+				p.InstanceBase = i;
+				p.InstanceCount = 16;
+			}
+		}
+		return packets;
+	}
+
+	void CheckPartition()
+	{
+		RecordScheduler scheduler;
+
+		scheduler.Partition({}, 4, 0);
+		Expect(scheduler.GetChunks().empty(), "Partition: no packets gives no chunks");
+
+		const std::vector<DrawPacket> packets = MakePackets(1000);
+		const std::uint32_t count = (std::uint32_t)packets.size();
+
+		std::uint32_t totalCost = 0;
+		std::uint32_t maxPacketCost = 0;
+		for(std::uint32_t i = 0; i < count; ++i)
+		{
+			const std::uint32_t cost = RecordScheduler::EstimateCost(packets[i], i > 0 ? &packets[i - 1] : nullptr);
+			totalCost += cost;
+			maxPacketCost = std::max(maxPacketCost, cost);
+		}
+
+		for(std::uint32_t maxChunks : { 1u, 2u, 3u, 4u, 8u, 16u })
+		{
+			scheduler.Partition(packets, maxChunks, 0);
+			const auto& chunks = scheduler.GetChunks();
+			Expect(chunks.size() == maxChunks, "Partition: uses every chunk when there is no minimum");
+
+			// Chunks cover the list in order, each with at least one packet.
+			std::uint32_t next = 0;
+			std::uint32_t costSum = 0;
+			bool contiguous = true;
+			bool balanced = true;
+			for(const RecordChunk& chunk : chunks)
+			{
+				contiguous = contiguous && chunk.First == next && chunk.Count > 0;
+				next = chunk.First + chunk.Count;
+				costSum += chunk.Cost;
+
+				// A cut lands on the packet boundary closest to its target, so a chunk is
+				// off its share by less than a packet at each end.
+				const std::uint32_t share = totalCost / (std::uint32_t)chunks.size();
+				const std::uint32_t off = chunk.Cost > share ? chunk.Cost - share : share - chunk.Cost;
+				balanced = balanced && off <= 2 * maxPacketCost;
+			}
+			Expect(contiguous && next == count, "Partition: chunks cover the packets in order");
+			Expect(costSum == totalCost, "Partition: chunk costs add up to the list cost");
+			Expect(balanced, "Partition: chunk costs within two packets of an even share");
+		}
+
+		// A minimum cost per chunk caps the chunk count.
+		scheduler.Partition(packets, 16, totalCost / 3);
+		Expect(scheduler.GetChunks().size() == 3, "Partition: minimum chunk cost limits the chunk count");
+
+		scheduler.Partition(packets, 16, totalCost * 2);
+		Expect(scheduler.GetChunks().size() == 1, "Partition: short list stays on one command list");
+
+		// Never more chunks than packets.
+		const std::vector<DrawPacket> few = MakePackets(3);
+		scheduler.Partition(few, 8, 0);
+		Expect(scheduler.GetChunks().size() == 3, "Partition: at most one chunk per packet");
+	}
+
+	void CheckRecord()
+	{
+		// Bind counts on a list small enough to work out by hand.
+		std::vector<DrawPacket> packets(4);
+		for(std::uint32_t i = 0; i < 4; ++i)
+		{
+			packets[i].ObjCBIndex = i;
+			packets[i].StartIndex = i;
+		}
+		packets[2].MatCBIndex = 1;
+		packets[3].MatCBIndex = 1;
+		packets[3].Geometry = 1;
+		packets[3].Instanced = true;
+		packets[3].InstanceBase = 8;
+		packets[3].InstanceCount = 5;
+
+		RecordChunk all;
+		all.First = 0;
+		all.Count = 4;
+
+		RecordingCommandSink sink;
+		DrawStats stats;
+		RecordScheduler::Record(packets, all, sink, stats);
+
+		// The first packet binds everything; then packet 2 changes the material and
+		// packet 3 the geometry, and every packet sets its object or instance base.
+		Expect(sink.Count(RecordingCommandSink::Call::Pipeline) == 1, "Record: PSO bound once");
+		Expect(sink.Count(RecordingCommandSink::Call::Geometry) == 2, "Record: geometry bound on change only");
+		Expect(sink.Count(RecordingCommandSink::Call::Topology) == 1, "Record: topology bound once");
+		Expect(sink.Count(RecordingCommandSink::Call::Material) == 2, "Record: material bound on change only");
+		Expect(sink.Count(RecordingCommandSink::Call::Object) == 3, "Record: object set for each single draw");
+		Expect(sink.Count(RecordingCommandSink::Call::InstanceBase) == 1, "Record: instance base set for the batch");
+		Expect(sink.Count(RecordingCommandSink::Call::Draw) == 4, "Record: one draw per packet");
+
+		// Per packet, with geometry counting twice for the vertex and the index buffer.
+		Expect(stats.BindsIssued == 6 + 1 + 2 + 3, "Record: binds issued");
+		Expect(stats.BindsSkipped == 0 + 5 + 4 + 3, "Record: binds skipped");
+		Expect(stats.DrawCalls == 4 && stats.Instances == 3 + 5, "Record: draw and instance counts");
+
+		const RecordingCommandSink::Entry& last = sink.Calls.back();
+		Expect(last.Kind == RecordingCommandSink::Call::Draw && last.InstanceCount == 5 && last.StartIndex == 3,
+			"Record: instanced draw keeps its instance count");
+
+		// The cost estimate prices exactly what Record issues.
+		std::uint32_t cost = 0;
+		for(std::uint32_t i = 0; i < 4; ++i)
+			cost += RecordScheduler::EstimateCost(packets[i], i > 0 ? &packets[i - 1] : nullptr);
+		Expect(cost == stats.DrawCalls * RecordScheduler::DrawCost + stats.BindsIssued * RecordScheduler::BindCost,
+			"Record: EstimateCost matches the binds issued");
+	}
+
+	void CheckChunkedRecord()
+	{
+		const std::vector<DrawPacket> packets = MakePackets(1000);
+
+		RecordScheduler scheduler;
+		scheduler.Partition(packets, 8, 0);
+
+		// Each chunk goes to its own sink, as to its own command list; submitting the
+		// sinks in chunk order must replay the draws in packet order.
+		const auto& chunks = scheduler.GetChunks();
+		std::vector<RecordingCommandSink> sinks(chunks.size());
+		DrawStats total;
+		bool rebindsAtStart = true;
+		for(std::size_t c = 0; c < chunks.size(); ++c)
+		{
+			DrawStats stats;
+			RecordScheduler::Record(packets, chunks[c], sinks[c], stats);
+			total.Add(stats);
+
+			// A command list starts with no state, so each chunk binds it all again.
+			const auto& calls = sinks[c].Calls;
+			rebindsAtStart = rebindsAtStart && calls.size() >= 5 &&
+				calls[0].Kind == RecordingCommandSink::Call::Pipeline &&
+				calls[1].Kind == RecordingCommandSink::Call::Geometry &&
+				calls[2].Kind == RecordingCommandSink::Call::Topology &&
+				calls[3].Kind == RecordingCommandSink::Call::Material;
+		}
+		Expect(rebindsAtStart, "Record: every chunk binds its state from scratch");
+
+		std::uint32_t next = 0;
+		bool inOrder = true;
+		std::uint32_t binds = 0;
+		for(const RecordingCommandSink& sink : sinks)
+		{
+			for(const RecordingCommandSink::Entry& e : sink.Calls)
+			{
+				if(e.Kind == RecordingCommandSink::Call::Draw)
+					inOrder = inOrder && e.StartIndex == next++;
+				else
+					binds += e.Kind == RecordingCommandSink::Call::Geometry ? 2 : 1;
+			}
+		}
+		Expect(inOrder && next == packets.size(), "Record: chunks submitted in order replay the sorted draws");
+		Expect(binds == total.BindsIssued, "Record: BindsIssued counts the state calls made");
+		Expect(total.BindsIssued + total.BindsSkipped == 6 * total.DrawCalls, "Record: every bind issued or skipped");
+	}
+
+	//
+	// InputLog
+	//
+
+	void CheckInputLog()
+	{
+		const char* filename = "framecheck_input.log";
+
+		// Three frames of a recorded run: walking, then dragging the mouse.
+		InputRecorder recorder;
+		InputSample sample;
+		sample.Time = 0.0f;
+		sample.Keys = 1;
+		recorder.Add(sample);
+		sample.Time = 0.5f;
+		sample.Keys = 3;
+		sample.Buttons = InputSample::LeftButton;
+		sample.MouseX = -20;
+		sample.MouseY = 7;
+		recorder.Add(sample);
+		sample.Time = 1.0f;
+		sample.Keys = 0;
+		sample.Buttons = 0;
+		recorder.Add(sample);
+
+		std::string error;
+		Expect(recorder.Save(filename, error), "InputLog: save");
+
+		{
+			InputPlayback playback;
+			Expect(playback.Open(filename, error), "InputLog: open what was saved");
+			Expect(!playback.Finished(), "InputLog: not finished before the first sample");
+
+			// Each time gets the last sample at or before it, stamped with that time.
+			InputSample s = playback.Sample(0.25f);
+			Expect(s.Keys == 1 && s.Buttons == 0 && s.Time == 0.25f, "InputLog: holds a sample until the next");
+			s = playback.Sample(0.5f);
+			Expect(s.Keys == 3 && s.Buttons == InputSample::LeftButton && s.MouseX == -20 && s.MouseY == 7,
+				"InputLog: sample at its exact time, mouse included");
+			s = playback.Sample(0.75f);
+			Expect(s.Keys == 3 && !playback.Finished(), "InputLog: between samples");
+			s = playback.Sample(1.0f);
+			Expect(s.Keys == 0 && !playback.Finished(), "InputLog: last sample");
+			s = playback.Sample(1.1f);
+			Expect(s.Keys == 0 && playback.Finished(), "InputLog: finished past the last sample");
+		}
+
+		// A fixed step replay hands out the same states every run, up to and including
+		// the first frame past the last sample.
+		std::vector<std::uint16_t> runs[2];
+		for(auto& keys : runs)
+		{
+			InputPlayback playback;
+			playback.Open(filename, error);
+			for(int frame = 0; !playback.Finished(); ++frame)
+				keys.push_back(playback.Sample(frame * (1.0f / 60.0f)).Keys);
+		}
+		Expect(runs[0].size() == 62 && runs[0] == runs[1], "InputLog: replays are identical");
+
+		// A log cut short, or some other file, is refused.
+		{
+			std::FILE* file = std::fopen(filename, "r+b");
+			std::vector<char> bytes(sizeof(InputLogHeader) + sizeof(InputSample));
+			Expect(file != nullptr && std::fread(bytes.data(), 1, bytes.size(), file) == bytes.size(),
+				"InputLog: read back");
+			if(file != nullptr)
+				std::fclose(file);
+
+			file = std::fopen(filename, "wb");
+			std::fwrite(bytes.data(), 1, bytes.size(), file);
+			std::fclose(file);
+
+			InputPlayback playback;
+			Expect(!playback.Open(filename, error), "InputLog: truncated log refused");
+
+			bytes[0] = 'X';
+			file = std::fopen(filename, "wb");
+			std::fwrite(bytes.data(), 1, bytes.size(), file);
+			std::fclose(file);
+
+			InputPlayback other;
+			Expect(!other.Open(filename, error), "InputLog: wrong magic refused");
+		}
+
+		// An empty recording is finished from the start.
+		{
+			InputRecorder empty;
+			Expect(empty.Save(filename, error), "InputLog: save empty");
+
+			InputPlayback playback;
+			Expect(playback.Open(filename, error) && playback.Finished(), "InputLog: empty log is finished");
+			Expect(playback.Sample(0.0f).Keys == 0, "InputLog: empty log gives no input");
+		}
+
+		std::remove(filename);
+	}
+
+	// The camera moves of FrameScene::ApplyInput that a replay must reproduce, on a
+	// line: walking moves along x, and climbs as well while flying.
+	struct ReplayCamera
+	{
+		// FrameScene::KeyWalkForward and KeyToggleFly.
+		static const std::uint16_t WalkKey = 1 << 0;
+		static const std::uint16_t FlyKey = 1 << 4;
+
+		float X = 0.0f;
+		float Y = 0.0f;
+		bool CanFly = false;
+
+		// The camera after every simulation step.
+		std::vector<float> PathX;
+		std::vector<float> PathY;
+		std::vector<bool> PathFly;
+
+		void Apply(const GameTimer& gt, const InputSample& input, const InputSample& prev, bool toggleOnPress)
+		{
+			const std::uint16_t toggle = toggleOnPress ? input.PressedSince(prev) : input.Keys;
+			if(toggle & FlyKey)
+				CanFly = !CanFly;
+
+			const float dt = gt.SimStep();
+			for(int step = 0; step < gt.SimSteps(); ++step)
+			{
+				if(input.Keys & WalkKey)
+				{
+					X += 10.0f * dt;
+					if(CanFly)
+						Y += 5.0f * dt;
+				}
+				PathX.push_back(X);
+				PathY.push_back(Y);
+				PathFly.push_back(CanFly);
+			}
+		}
+	};
+
+	// Steps whose camera differs between two runs, over the steps both ran.
+	std::size_t PathDifferences(const ReplayCamera& a, const ReplayCamera& b)
+	{
+		std::size_t differences = 0;
+		const std::size_t steps = std::min(a.PathX.size(), b.PathX.size());
+		for(std::size_t i = 0; i < steps; ++i)
+		{
+			if(std::fabs(a.PathX[i] - b.PathX[i]) > 1e-4f || std::fabs(a.PathY[i] - b.PathY[i]) > 1e-4f ||
+				a.PathFly[i] != b.PathFly[i])
+				++differences;
+		}
+		return differences;
+	}
+
+	// Records two seconds of input at 144 Hz and replays the log at the app's fixed
+	// 60 Hz playback step: every simulation step must see the same camera.  The fly
+	// key is held for 12 recorded frames but only 5 replayed ones, so toggling every
+	// frame it is down would fly in one run and walk in the other.
+	void CheckInputReplay()
+	{
+		const char* filename = "framecheck_replay.log";
+		const double simStep = 1.0 / 60.0;
+		const int recordFrames = 288;
+
+		// Keys n 144ths of a second in.  They change half way between two simulation
+		// steps, where a 144 Hz frame and the 60 Hz sampling of the replay agree on them.
+		auto keysAt = [](int n)
+		{
+			std::uint16_t keys = n >= 6 && n < 246 ? ReplayCamera::WalkKey : 0;
+			if((n >= 30 && n < 42) || (n >= 126 && n < 138))
+				keys |= ReplayCamera::FlyKey;
+			return keys;
+		};
+
+		for(bool toggleOnPress : { true, false })
+		{
+			ReplayCamera recorded;
+			InputRecorder recorder;
+			{
+				GameTimer timer;
+				timer.SetFixedStep(1.0 / 144.0);
+				timer.SetSimStep(simStep, 4);
+				timer.Reset();
+
+				InputSample prev;
+				for(int frame = 0; frame < recordFrames; ++frame)
+				{
+					timer.Tick();
+
+					InputSample sample;
+					sample.Time = timer.TotalTime();
+					sample.Keys = keysAt(frame + 1);
+					recorder.Add(sample);
+
+					recorded.Apply(timer, sample, prev, toggleOnPress);
+					prev = sample;
+				}
+			}
+
+			std::string error;
+			Expect(recorder.Save(filename, error), "InputReplay: save");
+
+			ReplayCamera replayed;
+			{
+				InputPlayback playback;
+				Expect(playback.Open(filename, error), "InputReplay: open");
+
+				GameTimer timer;
+				timer.SetFixedStep(simStep);
+				timer.SetSimStep(simStep, 4);
+				timer.Reset();
+
+				InputSample prev;
+				while(!playback.Finished())
+				{
+					timer.Tick();
+					const InputSample sample = playback.Sample(timer.TotalTime());
+					replayed.Apply(timer, sample, prev, toggleOnPress);
+					prev = sample;
+				}
+			}
+
+			const bool bothRan = recorded.PathX.size() >= 119 && replayed.PathX.size() >= 119;
+			const std::size_t differences = PathDifferences(recorded, replayed);
+			if(toggleOnPress)
+			{
+				Expect(bothRan, "InputReplay: both runs cover the recording");
+				Expect(differences == 0, "InputReplay: a 60 Hz replay of a 144 Hz recording takes the same camera path");
+				Expect(recorded.PathY.back() > 0.0f && !recorded.CanFly, "InputReplay: the recording flew, then landed");
+			}
+			else
+			{
+				Expect(differences > 0, "InputReplay: toggling every frame the key is down depends on the frame rate");
+			}
+		}
+
+		std::remove(filename);
+	}
+
+	//
+	// GameTimer
+	//
+
+	// Ticks the timer frames times and returns the simulation steps taken.
+	int RunSimFrames(GameTimer& timer, int frames, int* maxPerFrame = nullptr)
+	{
+		int steps = 0;
+		int most = 0;
+		for(int frame = 0; frame < frames; ++frame)
+		{
+			timer.Tick();
+			steps += timer.SimSteps();
+			most = std::max(most, timer.SimSteps());
+		}
+		if(maxPerFrame != nullptr)
+			*maxPerFrame = most;
+		return steps;
+	}
+
+	void CheckSimClock()
+	{
+		const double step = 1.0 / 60.0;
+
+		GameTimer timer;
+		timer.SetFixedStep(step);
+		timer.SetSimStep(step, 4);
+		timer.Reset();
+
+		int most = 0;
+		Expect(RunSimFrames(timer, 60, &most) == 60 && most == 1, "SimClock: one step per frame at the step rate");
+
+		// Paused simulation: the frame clock runs on, the simulation does not.
+		timer.SetTimeScale(0.0);
+		const float pausedAt = timer.TotalTime();
+		Expect(RunSimFrames(timer, 60) == 0, "SimClock: time scale 0 takes no steps");
+		Expect(timer.TotalTime() > pausedAt, "SimClock: time scale 0 leaves the frame clock running");
+
+		timer.SetTimeScale(-1.0);
+		Expect(RunSimFrames(timer, 10) == 0 && timer.TimeScale() == 0.0f, "SimClock: a negative time scale is 0");
+
+		timer.SetTimeScale(2.0);
+		Expect(RunSimFrames(timer, 60, &most) == 120 && most == 2, "SimClock: time scale 2 takes twice the steps");
+
+		timer.SetTimeScale(0.5);
+		Expect(RunSimFrames(timer, 60) == 30, "SimClock: time scale 0.5 takes half the steps");
+
+		// Frames of 0.1 s are due six steps each; only four are taken and the rest of
+		// the backlog is dropped rather than carried into the next frame.
+		timer.SetTimeScale(1.0);
+		timer.SetFixedStep(0.1);
+		Expect(RunSimFrames(timer, 10, &most) == 40 && most == 4, "SimClock: steps per frame clamped at maxSteps");
+		Expect(timer.SimAlpha() >= 0.0f && timer.SimAlpha() < 1.0f, "SimClock: clamping keeps the blend in [0, 1)");
+
+		timer.SetTimeScale(2.0);
+		timer.SetFixedStep(step);
+		timer.SetSimStep(step, 1);
+		Expect(RunSimFrames(timer, 60, &most) == 60 && most == 1, "SimClock: time scale 2 clamped at one step");
+
+		// A stopped timer takes no steps.
+		timer.SetSimStep(step, 4);
+		timer.Stop();
+		Expect(RunSimFrames(timer, 10) == 0, "SimClock: no steps while stopped");
+	}
+
+	//
+	// FramePacer
+	//
+
+	// Runs frames that each take work seconds and returns the largest distance of a
+	// frame's length from the target period, skipping the first frame.
+	double RunPacedFrames(FramePacer& pacer, FramePacer::SimulatedClock& clock, int frames, double work)
+	{
+		const double period = pacer.GetTargetFps() > 0.0f ? 1.0 / pacer.GetTargetFps() : 0.0;
+
+		double maxError = 0.0;
+		double last = clock.Now();
+		for(int frame = 0; frame < frames; ++frame)
+		{
+			clock.Advance(work);
+			pacer.WaitForNextFrame();
+
+			const double now = clock.Now();
+			if(frame > 0)
+				maxError = std::max(maxError, std::fabs(now - last - period));
+			last = now;
+		}
+		return maxError;
+	}
+
+	void CheckFramePacer()
+	{
+		// Sleeps that wake up late are absorbed by spinning the last stretch.
+		{
+			FramePacer::SimulatedClock clock;
+			clock.Oversleep = 0.0015;
+			FramePacer pacer(&clock);
+			pacer.SetMaxFramesInFlight(3);
+			pacer.SetTargetFps(60.0f);
+
+			const double error = RunPacedFrames(pacer, clock, 120, 0.008);
+			Expect(error < 1e-4, "FramePacer: frames are a period apart despite oversleeping");
+			Expect(pacer.GetMissedFrames() == 0, "FramePacer: light frames make the target");
+			Expect(pacer.GetSpinThreshold() > clock.Oversleep, "FramePacer: spins for longer than a sleep overshoots");
+
+			// Two clean windows of 60 frames each drop a frame in flight.
+			Expect(pacer.GetFramesInFlight() == 1, "FramePacer: frames in flight drop while on target");
+		}
+
+		// Uncapped, the pacer never waits and allows every frame in flight.
+		{
+			FramePacer::SimulatedClock clock;
+			clock.SpinCost = 0.0;
+			FramePacer pacer(&clock);
+			pacer.SetMaxFramesInFlight(3);
+			pacer.SetTargetFps(0.0f);
+
+			RunPacedFrames(pacer, clock, 10, 0.005);
+			Expect(std::fabs(clock.Now() - 10 * 0.005) < 1e-9, "FramePacer: uncapped does not wait");
+			Expect(pacer.GetFramesInFlight() == 3, "FramePacer: uncapped keeps every frame in flight");
+		}
+
+		// Frames that miss start the next right away, and bring frames in flight back.
+		{
+			FramePacer::SimulatedClock clock;
+			FramePacer pacer(&clock);
+			pacer.SetMaxFramesInFlight(3);
+			pacer.SetTargetFps(60.0f);
+			RunPacedFrames(pacer, clock, 120, 0.008);
+			Expect(pacer.GetFramesInFlight() == 1, "FramePacer: settles at one frame in flight");
+
+			const double before = clock.Now();
+			RunPacedFrames(pacer, clock, 60, 0.020);
+			Expect(clock.Now() - before < 60 * 0.0201, "FramePacer: late frames do not wait");
+			Expect(pacer.GetMissedFrames() == 60, "FramePacer: late frames are counted");
+			Expect(pacer.GetFramesInFlight() == 2, "FramePacer: a window of misses adds a frame in flight");
+
+			// After a rise the count holds for a while before trying fewer again.
+			RunPacedFrames(pacer, clock, 8 * 60, 0.008);
+			Expect(pacer.GetFramesInFlight() == 2, "FramePacer: holds after a rise");
+			RunPacedFrames(pacer, clock, 60, 0.008);
+			Expect(pacer.GetFramesInFlight() == 1, "FramePacer: drops again after the hold");
+		}
+
+		// Latency starts at the first report and then moves a tenth of the way.
+		{
+			FramePacer::SimulatedClock clock;
+			FramePacer pacer(&clock);
+			pacer.AddLatency(10.0f);
+			Expect(pacer.GetLatencyMs() == 10.0f, "FramePacer: first latency is taken as is");
+			pacer.AddLatency(20.0f);
+			Expect(std::fabs(pacer.GetLatencyMs() - 11.0f) < 1e-4f, "FramePacer: latency is smoothed");
+		}
+	}
+
+	//
+	// DescriptorAllocator
+	//
+
+	void CheckDescriptorAllocator()
+	{
+		DescriptorAllocator alloc(8, 3, 4);
+		Expect(alloc.GetRegionSize() == 12 && alloc.GetHeapSize() == 36, "DescriptorAllocator: region and heap size");
+
+		// Slots come out lowest first and stay put.
+		for(std::uint32_t i = 0; i < 5; ++i)
+			Expect(alloc.Allocate() == i, "DescriptorAllocator: slots in order");
+		Expect(alloc.GetHighWater() == 5 && alloc.GetAllocatedCount() == 5, "DescriptorAllocator: high water follows allocation");
+
+		// Freed slots are reused lowest first, and the high water mark does not move.
+		alloc.Free(3);
+		alloc.Free(1);
+		Expect(!alloc.IsAllocated(1) && !alloc.IsAllocated(3) && alloc.IsAllocated(2), "DescriptorAllocator: free clears the slot only");
+		Expect(alloc.GetHighWater() == 5 && alloc.GetAllocatedCount() == 3, "DescriptorAllocator: high water stays after free");
+		Expect(alloc.Allocate() == 1, "DescriptorAllocator: lowest freed slot first");
+		Expect(alloc.Allocate() == 3, "DescriptorAllocator: next freed slot");
+		Expect(alloc.Allocate() == 5 && alloc.GetHighWater() == 6, "DescriptorAllocator: then past the high water");
+
+		// Full, until a slot is freed.
+		Expect(alloc.Allocate() == 6 && alloc.Allocate() == 7, "DescriptorAllocator: fills to capacity");
+		Expect(alloc.Allocate() == DescriptorAllocator::Invalid, "DescriptorAllocator: Invalid when full");
+		alloc.Free(4);
+		Expect(alloc.Allocate() == 4, "DescriptorAllocator: a freed slot makes room again");
+		Expect(!alloc.IsAllocated(8) && !alloc.IsAllocated(DescriptorAllocator::Invalid), "DescriptorAllocator: slots past the end");
+
+		// Each frame resource owns a region, with the transient slots after the copied
+		// persistent ones.
+		for(std::uint32_t frame = 0; frame < 3; ++frame)
+		{
+			Expect(alloc.BeginFrame(frame) == frame * 12 && alloc.GetFrameStart() == frame * 12,
+				"DescriptorAllocator: frame region start");
+			Expect(alloc.AllocateTransient() == frame * 12 + 8, "DescriptorAllocator: transient after the persistent slots");
+			Expect(alloc.AllocateTransient(2) == frame * 12 + 9, "DescriptorAllocator: contiguous transient slots");
+			Expect(alloc.AllocateTransient(2) == DescriptorAllocator::Invalid, "DescriptorAllocator: transient overflow");
+			Expect(alloc.AllocateTransient() == frame * 12 + 11 && alloc.GetTransientCount() == 4,
+				"DescriptorAllocator: overflow takes nothing");
+			Expect(alloc.AllocateTransient() == DescriptorAllocator::Invalid, "DescriptorAllocator: region full");
+		}
+
+		// Beginning a region again drops its transient views.
+		alloc.BeginFrame(1);
+		Expect(alloc.GetTransientCount() == 0 && alloc.AllocateTransient(4) == 20, "DescriptorAllocator: begin frame resets transients");
+
+		alloc.Reset(4, 2, 0);
+		Expect(alloc.GetAllocatedCount() == 0 && alloc.GetHighWater() == 0 && alloc.Allocate() == 0,
+			"DescriptorAllocator: reset frees everything");
+		alloc.BeginFrame(1);
+		Expect(alloc.AllocateTransient() == DescriptorAllocator::Invalid, "DescriptorAllocator: no transient slots");
+	}
+
+	// What UpdateObjectCBs scanned before the dirty set: a counter on every render
+	// item, each behind its own allocation, next to the item's matrices.
+	struct ScannedItem
+	{
+		float World[16];
+		float TexTransform[16];
+		int NumFramesDirty = 0;
+	};
+
+	// Per frame cost of finding the items to upload among 100K mostly static ones, by
+	// scanning every item's counter as the app used to and with a DirtySet.  The upload
+	// itself is left out, since it is the same for both.
+	void BenchDirtySet(int frames)
+	{
+		const std::uint32_t itemCount = 100000;
+
+		std::vector<std::unique_ptr<ScannedItem>> items;
+		for(std::uint32_t i = 0; i < itemCount; ++i)
+			items.push_back(std::make_unique<ScannedItem>());
+
+		std::printf("%u items, %d frames\n", itemCount, frames);
+		for(std::uint32_t changed : { 0u, 10u, 100u, 1000u, 10000u })
+		{
+			std::uint64_t scanUploads = 0;
+			const auto scanStart = std::chrono::steady_clock::now();
+			for(int frame = 0; frame < frames; ++frame)
+			{
+				for(std::uint32_t k = 0; k < changed; ++k)
+					items[ScatterIndex(frame, k, itemCount)]->NumFramesDirty = gFrameResourceCount;
+
+				for(auto& item : items)
+				{
+					if(item->NumFramesDirty > 0)
+					{
+						++scanUploads;
+						item->NumFramesDirty--;
+					}
+				}
+			}
+			const double scanSeconds = SecondsSince(scanStart);
+
+			// Start from the state after the first upload of every item.
+			DirtySet dirty(gFrameResourceCount);
+			dirty.Resize(itemCount);
+			for(int f = 0; f < gFrameResourceCount; ++f)
+				dirty.ClearPending(f);
+
+			std::uint64_t dirtyUploads = 0;
+			const auto dirtyStart = std::chrono::steady_clock::now();
+			for(int frame = 0; frame < frames; ++frame)
+			{
+				const int frameIndex = frame % gFrameResourceCount;
+				for(std::uint32_t k = 0; k < changed; ++k)
+					dirty.MarkDirty(ScatterIndex(frame, k, itemCount));
+
+				dirtyUploads += dirty.Pending(frameIndex).size();
+				dirty.ClearPending(frameIndex);
+			}
+			const double dirtySeconds = SecondsSince(dirtyStart);
+
+			for(auto& item : items)
+				item->NumFramesDirty = 0;
+
+			std::printf("  %5u changed: scan %8.2f us/frame, dirty set %8.2f us/frame (%llu and %llu uploads)\n",
+				changed, scanSeconds * 1e6 / frames, dirtySeconds * 1e6 / frames,
+				(unsigned long long)scanUploads, (unsigned long long)dirtyUploads);
+		}
+	}
+
+	// Per frame cost of splitting a sorted draw list over the record workers, and how
+	// evenly the chunks share the work, for lists of 1K to 100K visible packets.  Each
+	// chunk is recorded on the calling thread and timed on its own, so the time
+	// imbalance is what the slowest worker would add to the frame.  The list is
+	// recorded into a NullCommandSink, and once more into a RecordingCommandSink, whose
+	// logging is closer to the cost of a real command list.
+	void BenchRecordScheduler(int frames)
+	{
+		std::printf("%d frames of 10K packets, as many packets in all for the other lists\n", frames);
+		std::printf("  packets  workers  partition us  null us  logged us  cost imbalance  time imbalance\n");
+
+		for(std::uint32_t packetCount : { 1000u, 10000u, 100000u })
+		{
+			// Sorted like the app's draw keys: pipeline, then geometry, then material.
+			std::vector<DrawPacket> packets = MakePackets(packetCount);
+			std::stable_sort(packets.begin(), packets.end(), [](const DrawPacket& a, const DrawPacket& b)
+			{
+				if(a.Pso != b.Pso)
+					return a.Pso < b.Pso;
+				if(a.Geometry != b.Geometry)
+					return a.Geometry < b.Geometry;
+				return a.MatCBIndex < b.MatCBIndex;
+			});
+
+			const int iterations = std::max(1, (int)(frames * (10000.0 / packetCount)));
+
+			for(std::uint32_t workers : { 1u, 2u, 4u, 8u, 16u })
+			{
+				RecordScheduler scheduler;
+				const auto partitionStart = std::chrono::steady_clock::now();
+				for(int i = 0; i < iterations; ++i)
+					scheduler.Partition(packets, workers, 0);
+				const double partitionSeconds = SecondsSince(partitionStart);
+
+				const auto& chunks = scheduler.GetChunks();
+				std::vector<double> chunkSeconds(chunks.size(), 0.0);
+				std::vector<RecordingCommandSink> logs(chunks.size());
+				double nullSeconds = 0.0;
+				double loggedSeconds = 0.0;
+				for(int i = 0; i < iterations; ++i)
+				{
+					for(std::size_t c = 0; c < chunks.size(); ++c)
+					{
+						NullCommandSink sink;
+						DrawStats stats;
+						const auto start = std::chrono::steady_clock::now();
+						RecordScheduler::Record(packets, chunks[c], sink, stats);
+						const double seconds = SecondsSince(start);
+						chunkSeconds[c] += seconds;
+						nullSeconds += seconds;
+					}
+
+					for(std::size_t c = 0; c < chunks.size(); ++c)
+					{
+						logs[c].Calls.clear();
+						DrawStats stats;
+						const auto start = std::chrono::steady_clock::now();
+						RecordScheduler::Record(packets, chunks[c], logs[c], stats);
+						loggedSeconds += SecondsSince(start);
+					}
+				}
+
+				// Largest chunk over the mean chunk, by estimated cost and by time.
+				std::uint32_t maxCost = 0;
+				std::uint32_t totalCost = 0;
+				for(const RecordChunk& chunk : chunks)
+				{
+					maxCost = std::max(maxCost, chunk.Cost);
+					totalCost += chunk.Cost;
+				}
+				const double costImbalance = (double)maxCost * chunks.size() / totalCost;
+				const double timeImbalance = *std::max_element(chunkSeconds.begin(), chunkSeconds.end()) *
+					chunks.size() / nullSeconds;
+
+				std::printf("  %7u  %7u  %12.2f  %7.1f  %9.1f  %14.3f  %14.3f\n",
+					packetCount, workers, partitionSeconds * 1e6 / iterations, nullSeconds * 1e6 / iterations,
+					loggedSeconds * 1e6 / iterations, costImbalance, timeImbalance);
+			}
+		}
+	}
+
+	const std::uint32_t gScopesPerThread = 4000000;
+
+	void RecordEmptyScopes()
+	{
+		for(std::uint32_t i = 0; i < gScopesPerThread; ++i)
+		{
+			PROFILE_SCOPE("empty");
+		}
+	}
+
+	// Keeps the clock reads below from being optimised away.
+	volatile std::int64_t gClockSink = 0;
+
+	// The two time stamps of a scope without recording it.
+	void ReadScopeClocks()
+	{
+		for(std::uint32_t i = 0; i < gScopesPerThread; ++i)
+		{
+			gClockSink = Profiler::Now();
+			gClockSink = Profiler::Now();
+		}
+	}
+
+	// Nanoseconds per iteration of body run gScopesPerThread times on each of
+	// threadCount threads at once, the best of a few runs.  With more threads than
+	// cores the threads take turns, so the time is shared out over the cores.
+	double TimeThreads(unsigned threadCount, void (*body)())
+	{
+		const unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+		const unsigned busyCores = std::min(threadCount, cores);
+
+		double best = 0.0;
+		for(int run = 0; run < 5; ++run)
+		{
+			std::atomic<unsigned> ready(0);
+			std::atomic<bool> go(false);
+			std::vector<std::thread> threads;
+			for(unsigned t = 0; t < threadCount; ++t)
+			{
+				threads.emplace_back([&ready, &go, body]()
+				{
+					// The first scope on a thread creates its ring.
+					{
+						PROFILE_SCOPE("warmup");
+					}
+					++ready;
+					while(!go.load())
+						std::this_thread::yield();
+					body();
+				});
+			}
+			while(ready.load() < threadCount)
+				std::this_thread::yield();
+
+			const auto start = std::chrono::steady_clock::now();
+			go.store(true);
+			for(std::thread& thread : threads)
+				thread.join();
+
+			const double ns = SecondsSince(start) * 1e9 * busyCores / ((double)gScopesPerThread * threadCount);
+			best = run == 0 ? ns : std::min(best, ns);
+		}
+		return best;
+	}
+
+	// Cost of an empty PROFILE_SCOPE on one thread and on several at once, each
+	// recording many times its ring's capacity, so the cost includes wrapping around
+	// and publishing Head.  The time stamps are timed on their own, since reading the
+	// clock is most of a scope and varies a lot between machines.  Returns false if a
+	// scope costs more than the budget the profiler is built to.
+	bool BenchProfiler()
+	{
+		const double budgetNs = 50.0;
+		const unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+
+		Profiler::SetEnabled(true);
+		std::printf("%u scopes per thread, %u event ring, %u cores\n", gScopesPerThread, Profiler::RingCapacity, cores);
+
+		bool withinBudget = true;
+		for(unsigned threadCount : { 1u, std::max(2u, std::min(8u, cores)) })
+		{
+			const double clockNs = TimeThreads(threadCount, ReadScopeClocks);
+			const double scopeNs = TimeThreads(threadCount, RecordEmptyScopes);
+			std::printf("  %u threads: %6.2f ns/scope, %6.2f ns of it reading the clock, %6.2f ns recording\n",
+				threadCount, scopeNs, clockNs, std::max(0.0, scopeNs - clockNs));
+			withinBudget = withinBudget && scopeNs < budgetNs;
+		}
+
+		// Disabled, a scope is one relaxed load.
+		Profiler::SetEnabled(false);
+		std::printf("  disabled:  %6.2f ns/scope\n", TimeThreads(1, RecordEmptyScopes));
+		Profiler::SetEnabled(true);
+
+		if(!withinBudget)
+			std::printf("failed: a profile scope costs more than %.0f ns\n", budgetNs);
+		return withinBudget;
+	}
+
+	int Bench(int argc, char** argv)
+	{
+		int frames = 1000;
+		if(argc > 0 && std::atoi(argv[0]) > 0)
+			frames = std::atoi(argv[0]);
+
+		BenchDirtySet(frames);
+		BenchRecordScheduler(frames);
+		return BenchProfiler() ? 0 : 1;
+	}
+
+	int Check()
+	{
+		CheckDirtySet();
+		CheckSceneDiff();
+		CheckPartition();
+		CheckRecord();
+		CheckChunkedRecord();
+		CheckInputLog();
+		CheckInputReplay();
+		CheckSimClock();
+		CheckFramePacer();
+		CheckDescriptorAllocator();
+
+		if(gFailures > 0)
+		{
+			std::printf("%d checks failed\n", gFailures);
+			return 1;
+		}
+
+		std::printf("all checks passed\n");
+		return 0;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	if(argc > 1 && std::strcmp(argv[1], "-bench") == 0)
+		return Bench(argc - 2, argv + 2);
+
+	if(argc > 1)
+	{
+		std::fprintf(stderr,
+			"usage: framecheck\n"
+			"       framecheck -bench [frames]\n");
+		return 1;
+	}
+
+	return Check();
+}
@@ -0,0 +1,480 @@
+//***************************************************************************************
+// TextureAssemble.cpp
+//
+// Packs several images into one texture, either as the slices of a texture array or as
+// the regions of an atlas, and writes a remap table saying where each image went.
+// Replaces the Windows only texassemble.exe.  Builds on any platform:
+//
+//   g++ -O2 -msse2 -pthread -std=c++14 -I../../Common -I../Common TextureAssemble.cpp
+//       ../Common/BCEncoder.cpp ../Common/MipChain.cpp ../Common/TextureImage.cpp
+//       ../../Common/DDSFormat.cpp -o texassemble
+//
+// Usage:
+//
+//   texassemble -array|-atlas [options] -o output.dds input...
+//
+//   -array                 One slice per input.  The inputs must be the same size unless
+//                          -fit is given, which resamples them to the size of the first.
+//   -atlas                 Pack the inputs side by side into one 2D texture.
+//   -f auto|rgba|bc1|bc3|bc7
+//                          Output format.  auto (the default) picks BC1 if every input is
+//                          opaque and BC3 otherwise.  rgba writes R8G8B8A8.
+//   -q fast|normal|best    Block compression quality preset, normal by default.
+//   -gutter texels         Atlas padding around each image, 8 by default.
+//   -srgb                  Mark the output as sRGB.
+//   -nomips                Only write the top mip.
+//   -mipfilter box|kaiser  Array mip filter, kaiser by default.  See MipChain.h.
+//   -linear                The color channels are linear data and are filtered without
+//                          decoding them from sRGB.
+//   -t count               Encoder threads, one per core by default.
+//
+// The remap table is written next to the output with a .remap extension.  Each line
+// names an input and gives its array slice and the scale and offset that map its UVs
+// into the texture: uv' = uv * scale + offset.
+//
+// Atlas gutters repeat the edge texels of their image, so filtering at the edge of a
+// region only ever sees that image.  Each region is also aligned so no mip averages
+// texels of two regions.  That holds for as many mips as the gutter can be halved and
+// still be a texel wide, so the atlas gets no more mips than that: an 8 texel gutter
+// gives 4.  The guarantee needs each mip to average exactly the 2x2 texels above it, so
+// atlas mips always use the box filter; a wider filter would need a wider gutter.
+// Wrap addressing cannot work inside an atlas; textures that tile belong in an array.
+//***************************************************************************************
+
+#include "BCEncoder.h"
+#include "MipChain.h"
+#include "TextureImage.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+namespace
+{
+	enum class OutputFormat
+	{
+		Auto,
+		RGBA,
+		BC1,
+		BC3,
+		BC7
+	};
+
+	struct AssembleOptions
+	{
+		bool Atlas = false;
+		bool Fit = false;
+		OutputFormat Format = OutputFormat::Auto;
+		BCQuality Quality = BCQuality::Normal;
+		std::uint32_t Gutter = 8;
+		bool SRGB = false;
+		bool Mips = true;
+		MipOptions MipFilter;
+		unsigned Threads = 0;
+		std::string Output;
+	};
+
+	// Where one input went, in texels of the top mip.
+	struct RemapEntry
+	{
+		std::string Name;
+		std::uint32_t Slice = 0;
+		std::uint32_t X = 0;
+		std::uint32_t Y = 0;
+		std::uint32_t Width = 0;
+		std::uint32_t Height = 0;
+	};
+
+	std::string BaseName(const std::string& path)
+	{
+		std::string name = path;
+		const std::size_t slash = name.find_last_of("/\\");
+		if(slash != std::string::npos)
+			name = name.substr(slash + 1);
+
+		const std::size_t dot = name.find_last_of('.');
+		if(dot != std::string::npos)
+			name = name.substr(0, dot);
+		return name;
+	}
+
+	std::string RemapPath(const std::string& output)
+	{
+		const std::size_t dot = output.find_last_of('.');
+		const std::size_t slash = output.find_last_of("/\\");
+		if(dot != std::string::npos && (slash == std::string::npos || dot > slash))
+			return output.substr(0, dot) + ".remap";
+		return output + ".remap";
+	}
+
+	std::uint32_t AlignUp(std::uint32_t value, std::uint32_t alignment)
+	{
+		return (value + alignment - 1) / alignment * alignment;
+	}
+
+	BCFormat ToBCFormat(OutputFormat format)
+	{
+		switch(format)
+		{
+		case OutputFormat::BC1: return BCFormat::BC1;
+		case OutputFormat::BC3: return BCFormat::BC3;
+		default: return BCFormat::BC7;
+		}
+	}
+
+	DXGI_FORMAT ToDXGIFormat(OutputFormat format, bool srgb)
+	{
+		if(format == OutputFormat::RGBA)
+			return srgb ? DXGI_FORMAT_R8G8B8A8_UNORM_SRGB : DXGI_FORMAT_R8G8B8A8_UNORM;
+		return BCEncoder::GetDXGIFormat(ToBCFormat(format), srgb);
+	}
+
+	// Builds the mips of every slice and appends them to subresources, slice by slice.
+	void AddSlices(const std::vector<TextureImage>& slices, std::uint32_t mipCount, OutputFormat format,
+		const AssembleOptions& options, const MipOptions& mipOptions, std::vector<std::vector<std::uint8_t>>& subresources)
+	{
+		std::vector<std::vector<TextureImage>> mips;
+		MipChain::BuildSlices(slices, mipCount, mips, mipOptions);
+
+		for(const auto& chain : mips)
+		{
+			for(const TextureImage& mip : chain)
+			{
+				subresources.emplace_back();
+				if(format == OutputFormat::RGBA)
+					subresources.back() = mip.Pixels;
+				else
+				{
+					BCEncoder::Compress(ToBCFormat(format), options.Quality, mip.Pixels.data(), mip.Width, mip.Height,
+						subresources.back(), options.Threads);
+				}
+			}
+		}
+	}
+
+	bool BuildArray(std::vector<TextureImage>& images, const std::vector<std::string>& inputs,
+		const AssembleOptions& options, TextureImage& size, std::vector<RemapEntry>& remap)
+	{
+		std::uint32_t width = images[0].Width;
+		std::uint32_t height = images[0].Height;
+
+		for(std::size_t i = 1; i < images.size(); ++i)
+		{
+			if(images[i].Width != width || images[i].Height != height)
+			{
+				if(!options.Fit)
+				{
+					std::fprintf(stderr, "%s is %ux%u but %s is %ux%u; use -fit to resample\n", inputs[i].c_str(),
+						images[i].Width, images[i].Height, inputs[0].c_str(), width, height);
+					return false;
+				}
+
+				TextureImage resized;
+				MipChain::Resize(images[i], width, height, resized);
+				images[i] = std::move(resized);
+			}
+		}
+
+		// Block compressed textures need a top mip whose sides are multiples of 4.
+		if(options.Format != OutputFormat::RGBA && (width % 4 != 0 || height % 4 != 0))
+		{
+			const std::uint32_t alignedWidth = AlignUp(width, 4);
+			const std::uint32_t alignedHeight = AlignUp(height, 4);
+			std::printf("resampling %ux%u to %ux%u\n", width, height, alignedWidth, alignedHeight);
+
+			for(TextureImage& image : images)
+			{
+				TextureImage resized;
+				MipChain::Resize(image, alignedWidth, alignedHeight, resized);
+				image = std::move(resized);
+			}
+			width = alignedWidth;
+			height = alignedHeight;
+		}
+
+		size.Width = width;
+		size.Height = height;
+
+		for(std::size_t i = 0; i < images.size(); ++i)
+		{
+			RemapEntry entry;
+			entry.Name = BaseName(inputs[i]);
+			entry.Slice = (std::uint32_t)i;
+			entry.Width = width;
+			entry.Height = height;
+			remap.push_back(entry);
+		}
+
+		return true;
+	}
+
+	// Shelf packs the images, tallest first, into an atlas about as wide as it is high.
+	void BuildAtlas(const std::vector<TextureImage>& images, const std::vector<std::string>& inputs,
+		std::uint32_t gutter, std::uint32_t alignment, TextureImage& atlas, std::vector<RemapEntry>& remap)
+	{
+		std::vector<std::size_t> order(images.size());
+		std::vector<std::uint32_t> cellWidths(images.size()), cellHeights(images.size());
+		std::uint64_t area = 0;
+		std::uint32_t widest = 0;
+
+		for(std::size_t i = 0; i < images.size(); ++i)
+		{
+			order[i] = i;
+			cellWidths[i] = AlignUp(images[i].Width + gutter * 2, alignment);
+			cellHeights[i] = AlignUp(images[i].Height + gutter * 2, alignment);
+			area += (std::uint64_t)cellWidths[i] * cellHeights[i];
+			widest = std::max(widest, cellWidths[i]);
+		}
+
+		std::stable_sort(order.begin(), order.end(),
+			[&](std::size_t a, std::size_t b) { return cellHeights[a] > cellHeights[b]; });
+
+		std::uint32_t atlasWidth = 1;
+		while((std::uint64_t)atlasWidth * atlasWidth < area)
+			atlasWidth *= 2;
+		atlasWidth = AlignUp(std::max(atlasWidth, widest), alignment);
+
+		remap.resize(images.size());
+		std::uint32_t x = 0, y = 0, shelfHeight = 0;
+		for(std::size_t i : order)
+		{
+			if(x + cellWidths[i] > atlasWidth)
+			{
+				y += shelfHeight;
+				x = 0;
+				shelfHeight = 0;
+			}
+
+			RemapEntry& entry = remap[i];
+			entry.Name = BaseName(inputs[i]);
+			entry.X = x + gutter;
+			entry.Y = y + gutter;
+			entry.Width = images[i].Width;
+			entry.Height = images[i].Height;
+
+			x += cellWidths[i];
+			shelfHeight = std::max(shelfHeight, cellHeights[i]);
+		}
+
+		atlas.Width = atlasWidth;
+		atlas.Height = y + shelfHeight;
+		atlas.Pixels.assign((std::size_t)atlas.Width * atlas.Height * 4, 0);
+
+		// Fill each cell, gutter included, clamping to the edges of its image.
+		for(std::size_t i = 0; i < images.size(); ++i)
+		{
+			const TextureImage& image = images[i];
+			const RemapEntry& entry = remap[i];
+			const std::uint32_t cellX = entry.X - gutter;
+			const std::uint32_t cellY = entry.Y - gutter;
+
+			for(std::uint32_t cy = 0; cy < cellHeights[i]; ++cy)
+			{
+				const std::uint32_t sy = (std::uint32_t)std::min<std::int64_t>(
+					std::max<std::int64_t>((std::int64_t)cy - gutter, 0), image.Height - 1);
+
+				for(std::uint32_t cx = 0; cx < cellWidths[i]; ++cx)
+				{
+					const std::uint32_t sx = (std::uint32_t)std::min<std::int64_t>(
+						std::max<std::int64_t>((std::int64_t)cx - gutter, 0), image.Width - 1);
+
+					const std::uint8_t* src = &image.Pixels[((std::size_t)sy * image.Width + sx) * 4];
+					std::uint8_t* dst = &atlas.Pixels[((std::size_t)(cellY + cy) * atlas.Width + cellX + cx) * 4];
+					std::copy(src, src + 4, dst);
+				}
+			}
+		}
+	}
+
+	bool WriteRemap(const std::string& path, const std::vector<RemapEntry>& remap, std::uint32_t width, std::uint32_t height)
+	{
+		FILE* file = std::fopen(path.c_str(), "w");
+		if(!file)
+			return false;
+
+		std::fprintf(file, "# name slice scaleU scaleV offsetU offsetV\n");
+		for(const RemapEntry& entry : remap)
+		{
+			std::fprintf(file, "%s %u %.8g %.8g %.8g %.8g\n", entry.Name.c_str(), entry.Slice,
+				(double)entry.Width / width, (double)entry.Height / height,
+				(double)entry.X / width, (double)entry.Y / height);
+		}
+
+		return std::fclose(file) == 0;
+	}
+
+	int Usage()
+	{
+		std::fprintf(stderr,
+			"usage: texassemble -array|-atlas [-f auto|rgba|bc1|bc3|bc7] [-q fast|normal|best] [-gutter texels]\n"
+			"                   [-fit] [-srgb] [-nomips] [-mipfilter box|kaiser] [-linear] [-t threads] -o output.dds input...\n");
+		return 1;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	AssembleOptions options;
+	std::vector<std::string> inputs;
+	bool modeGiven = false;
+
+	for(int i = 1; i < argc; ++i)
+	{
+		const std::string arg = argv[i];
+		const bool hasValue = i + 1 < argc;
+
+		if(arg == "-array" || arg == "-atlas")
+		{
+			options.Atlas = arg == "-atlas";
+			modeGiven = true;
+		}
+		else if(arg == "-f" && hasValue)
+		{
+			const std::string value = argv[++i];
+			if(value == "auto")
+				options.Format = OutputFormat::Auto;
+			else if(value == "rgba")
+				options.Format = OutputFormat::RGBA;
+			else if(value == "bc1")
+				options.Format = OutputFormat::BC1;
+			else if(value == "bc3")
+				options.Format = OutputFormat::BC3;
+			else if(value == "bc7")
+				options.Format = OutputFormat::BC7;
+			else
+				return Usage();
+		}
+		else if(arg == "-q" && hasValue)
+		{
+			const std::string value = argv[++i];
+			if(value == "fast")
+				options.Quality = BCQuality::Fast;
+			else if(value == "normal")
+				options.Quality = BCQuality::Normal;
+			else if(value == "best")
+				options.Quality = BCQuality::Best;
+			else
+				return Usage();
+		}
+		else if(arg == "-gutter" && hasValue)
+			options.Gutter = (std::uint32_t)std::atoi(argv[++i]);
+		else if(arg == "-fit")
+			options.Fit = true;
+		else if(arg == "-srgb")
+			options.SRGB = true;
+		else if(arg == "-nomips")
+			options.Mips = false;
+		else if(arg == "-mipfilter" && hasValue)
+		{
+			const std::string value = argv[++i];
+			if(value == "box")
+				options.MipFilter.Filter = MipFilter::Box;
+			else if(value == "kaiser")
+				options.MipFilter.Filter = MipFilter::Kaiser;
+			else
+				return Usage();
+		}
+		else if(arg == "-linear")
+			options.MipFilter.LinearData = true;
+		else if(arg == "-t" && hasValue)
+			options.Threads = (unsigned)std::atoi(argv[++i]);
+		else if(arg == "-o" && hasValue)
+			options.Output = argv[++i];
+		else if(!arg.empty() && arg[0] == '-')
+			return Usage();
+		else
+			inputs.push_back(arg);
+	}
+
+	if(!modeGiven || inputs.empty() || options.Output.empty() || (options.Atlas && options.Gutter == 0))
+		return Usage();
+
+	std::vector<TextureImage> images(inputs.size());
+	bool hasAlpha = false;
+	bool srgb = options.SRGB;
+	for(std::size_t i = 0; i < inputs.size(); ++i)
+	{
+		std::string error;
+		if(!TextureImageIO::Load(inputs[i], images[i], error))
+		{
+			std::fprintf(stderr, "%s\n", error.c_str());
+			return 1;
+		}
+		hasAlpha = hasAlpha || images[i].HasAlpha();
+		srgb = srgb || images[i].SRGB;
+	}
+
+	OutputFormat format = options.Format;
+	if(format == OutputFormat::Auto)
+		format = hasAlpha ? OutputFormat::BC3 : OutputFormat::BC1;
+	options.Format = format;
+
+	std::vector<RemapEntry> remap;
+	std::vector<std::vector<std::uint8_t>> subresources;
+	std::uint32_t width, height, mipCount, arraySize;
+	MipOptions mipOptions = options.MipFilter;
+	mipOptions.Threads = options.Threads;
+
+	if(options.Atlas)
+	{
+		// The number of mips the gutter keeps apart, and the alignment that keeps each
+		// region on a whole block at every one of them.
+		std::uint32_t safeMips = 1;
+		while(options.Mips && (options.Gutter >> safeMips) > 0)
+			++safeMips;
+		const std::uint32_t alignment = 4u << (safeMips - 1);
+
+		TextureImage atlas;
+		BuildAtlas(images, inputs, options.Gutter, alignment, atlas, remap);
+
+		width = atlas.Width;
+		height = atlas.Height;
+		mipCount = std::min(safeMips, DDSFormat::CountMips(width, height, 1));
+		arraySize = 1;
+		mipOptions.Filter = MipFilter::Box;
+		AddSlices(std::vector<TextureImage>(1, atlas), mipCount, format, options, mipOptions, subresources);
+	}
+	else
+	{
+		TextureImage size;
+		if(!BuildArray(images, inputs, options, size, remap))
+			return 1;
+
+		width = size.Width;
+		height = size.Height;
+		mipCount = options.Mips ? DDSFormat::CountMips(width, height, 1) : 1;
+		arraySize = (std::uint32_t)images.size();
+		AddSlices(images, mipCount, format, options, mipOptions, subresources);
+	}
+
+	if(width > DDSFormat::MaxTexture2DSize || height > DDSFormat::MaxTexture2DSize || arraySize > DDSFormat::MaxArraySize)
+	{
+		std::fprintf(stderr, "%ux%u with %u slices is larger than Direct3D 12 allows\n", width, height, arraySize);
+		return 1;
+	}
+
+	std::string error;
+	if(!TextureImageIO::SaveDDS(options.Output, ToDXGIFormat(format, srgb), width, height, mipCount, arraySize,
+		subresources, error))
+	{
+		std::fprintf(stderr, "%s\n", error.c_str());
+		return 1;
+	}
+
+	const std::string remapPath = RemapPath(options.Output);
+	if(!WriteRemap(remapPath, remap, width, height))
+	{
+		std::fprintf(stderr, "cannot write %s\n", remapPath.c_str());
+		return 1;
+	}
+
+	std::uint64_t bytes = 0;
+	for(const auto& subresource : subresources)
+		bytes += subresource.size();
+
+	std::printf("%s: %s %ux%u, %u slices, %u mips, %.1f KB; remap table in %s\n", options.Output.c_str(),
+		options.Atlas ? "atlas" : "array", width, height, arraySize, mipCount, bytes / 1024.0, remapPath.c_str());
+	return 0;
+}
@@ -0,0 +1,468 @@
+//***************************************************************************************
+// TextureCook.cpp
+//
+// Cooks source images into block compressed DDS files with full mip chains, ready for
+// DDSTextureLoader.  Builds on any platform:
+//
+//   g++ -O2 -msse2 -pthread -std=c++14 -I../../Common -I../Common TextureCook.cpp ../Common/BCEncoder.cpp
+//       ../Common/MipChain.cpp ../Common/TextureImage.cpp ../../Common/DDSFormat.cpp -o texcook
+//
+// Usage:
+//
+//   texcook [options] input...
+//   texcook -bench [input...]
+//
+//   -f auto|bc1|bc3|bc7    Output format.  auto (the default) picks BC1 for opaque images
+//                          and BC3 for the rest.
+//   -q fast|normal|best    Encoder quality preset, normal by default.
+//   -srgb                  Mark the output as sRGB.  DDS inputs keep their own setting.
+//   -nomips                Only write the top mip.
+//   -mipfilter box|kaiser  Mip filter, kaiser by default.  See MipChain.h.
+//   -linear                The color channels are linear data, such as a normal map,
+//                          and are filtered without decoding them from sRGB.
+//   -t count               Encoder threads, one per core by default.
+//   -o directory           Where to write the output, named after the input with a .dds
+//                          extension.  The current directory by default.
+//
+// Block compressed textures need a top mip whose sides are multiples of 4, so other
+// sizes are resampled up to the next multiple first.  The peak signal to noise ratio of
+// every cooked texture is printed, measured on the top mip against the source.
+//
+// -bench times the mip generator on the inputs, or on a generated 2048x2048 image if
+// there are none, with each filter and with and without SSE.  It fails if the two
+// disagree, by checksum, if a single color image does not keep its color down the
+// chain, or if the chains of a set of generated images no longer match their stored
+// checksums.  Those hold for the build line above; contracting the filter arithmetic
+// into fused multiply-adds, as -ffp-contract=fast does, changes them.
+//***************************************************************************************
+
+#include "BCEncoder.h"
+#include "MipChain.h"
+#include "TextureImage.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace
+{
+	struct CookOptions
+	{
+		bool AutoFormat = true;
+		BCFormat Format = BCFormat::BC1;
+		BCQuality Quality = BCQuality::Normal;
+		bool SRGB = false;
+		bool Mips = true;
+		MipOptions MipFilter;
+		unsigned Threads = 0;
+		std::string OutputDir = ".";
+	};
+
+	const char* FormatName(BCFormat format)
+	{
+		switch(format)
+		{
+		case BCFormat::BC1: return "BC1";
+		case BCFormat::BC3: return "BC3";
+		default: return "BC7";
+		}
+	}
+
+	std::string OutputPath(const std::string& input, const std::string& outputDir)
+	{
+		std::string name = input;
+		const std::size_t slash = name.find_last_of("/\\");
+		if(slash != std::string::npos)
+			name = name.substr(slash + 1);
+
+		const std::size_t dot = name.find_last_of('.');
+		if(dot != std::string::npos)
+			name = name.substr(0, dot);
+
+		return outputDir + "/" + name + ".dds";
+	}
+
+	struct CookResult
+	{
+		std::uint64_t SourceBytes = 0;
+		std::uint64_t CookedBytes = 0;
+	};
+
+	bool Cook(const std::string& input, const CookOptions& options, CookResult& result)
+	{
+		std::string error;
+		TextureImage image;
+		if(!TextureImageIO::Load(input, image, error))
+		{
+			std::fprintf(stderr, "%s\n", error.c_str());
+			return false;
+		}
+
+		const BCFormat format = options.AutoFormat ? (image.HasAlpha() ? BCFormat::BC3 : BCFormat::BC1) : options.Format;
+		const bool srgb = image.SRGB || options.SRGB;
+
+		const std::uint32_t width = (image.Width + 3) & ~3u;
+		const std::uint32_t height = (image.Height + 3) & ~3u;
+		if(width != image.Width || height != image.Height)
+		{
+			TextureImage resized;
+			MipChain::Resize(image, width, height, resized);
+			std::printf("%s: resampled %ux%u to %ux%u\n", input.c_str(), image.Width, image.Height, width, height);
+			image = std::move(resized);
+		}
+
+		const std::uint32_t mipCount = options.Mips ? DDSFormat::CountMips(width, height, 1) : 1;
+
+		std::vector<std::vector<std::uint8_t>> subresources(mipCount);
+		std::uint64_t texelCount = 0;
+		std::uint64_t uncompressedBytes = 0;
+		double seconds = 0.0;
+		double rgbPsnr = 0.0, alphaPsnr = 0.0;
+
+		std::vector<TextureImage> mips;
+		MipOptions mipOptions = options.MipFilter;
+		mipOptions.Threads = options.Threads;
+		MipChain::Build(image, mipCount, mips, mipOptions);
+
+		for(std::uint32_t level = 0; level < mipCount; ++level)
+		{
+			const TextureImage& mip = mips[level];
+			const auto start = std::chrono::steady_clock::now();
+			BCEncoder::Compress(format, options.Quality, mip.Pixels.data(), mip.Width, mip.Height,
+				subresources[level], options.Threads);
+			seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+			texelCount += (std::uint64_t)mip.Width * mip.Height;
+			uncompressedBytes += mip.Pixels.size();
+
+			if(level == 0)
+			{
+				std::vector<std::uint8_t> decoded;
+				BCEncoder::Decompress(format, subresources[0].data(), mip.Width, mip.Height, decoded);
+				rgbPsnr = BCEncoder::PSNR(mip.Pixels.data(), decoded.data(), texelCount, 0, 3);
+				alphaPsnr = BCEncoder::PSNR(mip.Pixels.data(), decoded.data(), texelCount, 3, 1);
+			}
+		}
+
+		const std::string output = OutputPath(input, options.OutputDir);
+		if(!TextureImageIO::SaveDDS(output, BCEncoder::GetDXGIFormat(format, srgb), width, height,
+			mipCount, 1, subresources, error))
+		{
+			std::fprintf(stderr, "%s\n", error.c_str());
+			return false;
+		}
+
+		std::uint64_t cookedBytes = 0;
+		for(const auto& subresource : subresources)
+			cookedBytes += subresource.size();
+
+		std::printf("%s -> %s: %s%s %ux%u, %u mips, %.1f KB (%.1f KB as RGBA8, %.1fx smaller), "
+			"PSNR RGB %.2f dB alpha %.2f dB, %.1f MPix/s\n",
+			input.c_str(), output.c_str(), FormatName(format), srgb ? " sRGB" : "", width, height, mipCount,
+			cookedBytes / 1024.0, uncompressedBytes / 1024.0, (double)uncompressedBytes / cookedBytes,
+			rgbPsnr, alphaPsnr, texelCount / seconds / 1e6);
+
+		result.SourceBytes += uncompressedBytes;
+		result.CookedBytes += cookedBytes;
+		return true;
+	}
+
+	// The largest difference between a channel of any texel in the chain and color.
+	double MaxDifference(const std::vector<TextureImage>& mips, const std::uint8_t color[4])
+	{
+		double worst = 0.0;
+		for(const TextureImage& mip : mips)
+		{
+			for(std::size_t i = 0; i < mip.Pixels.size(); ++i)
+				worst = std::max(worst, std::abs((double)mip.Pixels[i] - color[i % 4]));
+		}
+		return worst;
+	}
+
+	// Gradients, a checker in alpha and an xor pattern, shifted by seed so the slices of
+	// an array differ.
+	TextureImage MakePattern(std::uint32_t width, std::uint32_t height, std::uint32_t seed)
+	{
+		TextureImage image;
+		image.Width = width;
+		image.Height = height;
+		image.Pixels.resize((std::size_t)width * height * 4);
+		for(std::uint32_t y = 0; y < height; ++y)
+		{
+			for(std::uint32_t x = 0; x < width; ++x)
+			{
+				std::uint8_t* texel = &image.Pixels[((std::size_t)y * width + x) * 4];
+				texel[0] = (std::uint8_t)(x + seed * 37);
+				texel[1] = (std::uint8_t)(y + seed * 59);
+				texel[2] = (std::uint8_t)((x ^ y) * 7 + seed);
+				texel[3] = (std::uint8_t)(((x / 16 + y / 16) & 1) ? 255 : (x + y) / 16);
+			}
+		}
+		return image;
+	}
+
+	// Checksums of the mip chains of patterns, as the filters built them when they were
+	// last changed on purpose.  Sides that are not powers of two, odd ones included, and
+	// arrays exercise the rounding and the slice split; a deliberate change to the output
+	// must update the table.
+	struct GoldenChain
+	{
+		std::uint32_t Width;
+		std::uint32_t Height;
+		std::uint32_t Slices;
+		MipFilter Filter;
+		bool LinearData;
+		std::uint64_t Checksum;
+	};
+
+	const GoldenChain GoldenChains[] =
+	{
+		{ 61, 37, 1, MipFilter::Box, false, 0x9728e0956da2781cull },
+		{ 61, 37, 1, MipFilter::Box, true, 0x58b5fb3acf16a841ull },
+		{ 61, 37, 1, MipFilter::Kaiser, false, 0x59a812e6e5e8deb9ull },
+		{ 61, 37, 1, MipFilter::Kaiser, true, 0xf34a3c36fb88442eull },
+		{ 100, 24, 1, MipFilter::Kaiser, false, 0x33c4852bb11de476ull },
+		{ 64, 64, 1, MipFilter::Box, false, 0x95e0ac8ba794bd60ull },
+		{ 64, 64, 1, MipFilter::Kaiser, true, 0x90c16e9f1a0b9cc6ull },
+		{ 1, 9, 1, MipFilter::Kaiser, false, 0x8795b97bd36de963ull },
+		{ 45, 29, 3, MipFilter::Box, false, 0x8ee57afb934820afull },
+		{ 45, 29, 3, MipFilter::Kaiser, true, 0xc83124e59de239ecull },
+	};
+
+	// Builds every golden chain with SSE and with scalar code and returns how many did
+	// not come out as stored.
+	int CheckGoldenChains(unsigned threads)
+	{
+		int failed = 0;
+		for(const GoldenChain& golden : GoldenChains)
+		{
+			std::vector<TextureImage> slices;
+			for(std::uint32_t slice = 0; slice < golden.Slices; ++slice)
+				slices.push_back(MakePattern(golden.Width, golden.Height, slice));
+
+			MipOptions options;
+			options.Filter = golden.Filter;
+			options.LinearData = golden.LinearData;
+			options.Threads = threads;
+
+			std::uint64_t checksums[2];
+			for(int scalar = 0; scalar < 2; ++scalar)
+			{
+				options.Scalar = scalar != 0;
+
+				std::vector<std::vector<TextureImage>> mips;
+				MipChain::BuildSlices(slices, DDSFormat::CountMips(golden.Width, golden.Height, 1), mips, options);
+
+				std::vector<TextureImage> all;
+				for(const std::vector<TextureImage>& chain : mips)
+					all.insert(all.end(), chain.begin(), chain.end());
+				checksums[scalar] = MipChain::Checksum(all);
+			}
+
+			const bool match = checksums[0] == golden.Checksum && checksums[1] == golden.Checksum;
+			std::printf("golden %ux%u x%u %s %s: checksum %016llx, scalar %016llx%s\n", golden.Width,
+				golden.Height, golden.Slices, golden.Filter == MipFilter::Box ? "box" : "kaiser",
+				golden.LinearData ? "linear" : "sRGB", (unsigned long long)checksums[0],
+				(unsigned long long)checksums[1], match ? "" : " MISMATCH");
+			if(!match)
+				++failed;
+		}
+		return failed;
+	}
+
+	int Bench(const std::vector<std::string>& inputs, unsigned threads)
+	{
+		std::vector<TextureImage> images;
+		for(const std::string& input : inputs)
+		{
+			std::string error;
+			images.emplace_back();
+			if(!TextureImageIO::Load(input, images.back(), error))
+			{
+				std::fprintf(stderr, "%s\n", error.c_str());
+				return 1;
+			}
+		}
+
+		if(images.empty())
+			images.push_back(MakePattern(2048, 2048, 0));
+
+		const MipFilter filters[] = { MipFilter::Box, MipFilter::Kaiser };
+		int failed = 0;
+
+		for(const MipFilter filter : filters)
+		{
+			const char* filterName = filter == MipFilter::Box ? "box" : "kaiser";
+
+			for(std::size_t i = 0; i < images.size(); ++i)
+			{
+				const TextureImage& image = images[i];
+				const std::uint32_t mipCount = DDSFormat::CountMips(image.Width, image.Height, 1);
+				const char* name = inputs.empty() ? "generated" : inputs[i].c_str();
+
+				MipOptions options;
+				options.Filter = filter;
+				options.Threads = threads;
+
+				std::uint64_t checksums[2];
+				double rates[2];
+				for(int scalar = 0; scalar < 2; ++scalar)
+				{
+					options.Scalar = scalar != 0;
+
+					// Repeat small images until the timing means something.
+					std::vector<TextureImage> mips;
+					std::uint64_t texels = 0;
+					const auto start = std::chrono::steady_clock::now();
+					double seconds = 0.0;
+					do
+					{
+						MipChain::Build(image, mipCount, mips, options);
+						texels += (std::uint64_t)image.Width * image.Height;
+						seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+					} while(seconds < 0.25);
+
+					checksums[scalar] = MipChain::Checksum(mips);
+					rates[scalar] = texels / seconds / 1e6;
+				}
+
+				const bool match = checksums[0] == checksums[1];
+				std::printf("%s %s %ux%u, %u mips: %.1f MPix/s, %.1f MPix/s scalar, checksum %016llx%s\n",
+					name, filterName, image.Width, image.Height, mipCount, rates[0], rates[1],
+					(unsigned long long)checksums[0], match ? "" : " MISMATCH");
+				if(!match)
+					++failed;
+			}
+
+			// Every level of a single color image should be that color, whatever the filter
+			// weights and however the sides round.
+			const std::uint8_t color[4] = { 200, 90, 17, 128 };
+			TextureImage flat;
+			flat.Width = 45;
+			flat.Height = 13;
+			for(std::uint32_t t = 0; t < flat.Width * flat.Height; ++t)
+				flat.Pixels.insert(flat.Pixels.end(), color, color + 4);
+
+			for(int linear = 0; linear < 2; ++linear)
+			{
+				MipOptions options;
+				options.Filter = filter;
+				options.LinearData = linear != 0;
+
+				std::vector<TextureImage> mips;
+				MipChain::Build(flat, DDSFormat::CountMips(flat.Width, flat.Height, 1), mips, options);
+				if(MaxDifference(mips, color) > 0.0)
+				{
+					std::printf("%s %s: a single color image changes color down the chain\n", filterName,
+						linear ? "linear" : "sRGB");
+					++failed;
+				}
+			}
+		}
+
+		failed += CheckGoldenChains(threads);
+
+		std::printf(failed ? "%d checks failed\n" : "all checks passed\n", failed);
+		return failed ? 1 : 0;
+	}
+
+	int Usage()
+	{
+		std::fprintf(stderr,
+			"usage: texcook [-f auto|bc1|bc3|bc7] [-q fast|normal|best] [-srgb] [-nomips]\n"
+			"               [-mipfilter box|kaiser] [-linear] [-t threads] [-o directory] input...\n"
+			"       texcook -bench [-t threads] [input...]\n");
+		return 1;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	CookOptions options;
+	std::vector<std::string> inputs;
+	bool bench = false;
+
+	for(int i = 1; i < argc; ++i)
+	{
+		const std::string arg = argv[i];
+		const bool hasValue = i + 1 < argc;
+
+		if(arg == "-f" && hasValue)
+		{
+			const std::string value = argv[++i];
+			options.AutoFormat = value == "auto";
+			if(value == "bc1")
+				options.Format = BCFormat::BC1;
+			else if(value == "bc3")
+				options.Format = BCFormat::BC3;
+			else if(value == "bc7")
+				options.Format = BCFormat::BC7;
+			else if(!options.AutoFormat)
+				return Usage();
+		}
+		else if(arg == "-q" && hasValue)
+		{
+			const std::string value = argv[++i];
+			if(value == "fast")
+				options.Quality = BCQuality::Fast;
+			else if(value == "normal")
+				options.Quality = BCQuality::Normal;
+			else if(value == "best")
+				options.Quality = BCQuality::Best;
+			else
+				return Usage();
+		}
+		else if(arg == "-srgb")
+			options.SRGB = true;
+		else if(arg == "-nomips")
+			options.Mips = false;
+		else if(arg == "-mipfilter" && hasValue)
+		{
+			const std::string value = argv[++i];
+			if(value == "box")
+				options.MipFilter.Filter = MipFilter::Box;
+			else if(value == "kaiser")
+				options.MipFilter.Filter = MipFilter::Kaiser;
+			else
+				return Usage();
+		}
+		else if(arg == "-linear")
+			options.MipFilter.LinearData = true;
+		else if(arg == "-bench")
+			bench = true;
+		else if(arg == "-t" && hasValue)
+			options.Threads = (unsigned)std::atoi(argv[++i]);
+		else if(arg == "-o" && hasValue)
+			options.OutputDir = argv[++i];
+		else if(!arg.empty() && arg[0] == '-')
+			return Usage();
+		else
+			inputs.push_back(arg);
+	}
+
+	if(bench)
+		return Bench(inputs, options.Threads);
+	if(inputs.empty())
+		return Usage();
+
+	CookResult total;
+	int failed = 0;
+	for(const std::string& input : inputs)
+	{
+		if(!Cook(input, options, total))
+			++failed;
+	}
+
+	if(total.CookedBytes > 0)
+	{
+		std::printf("total: %.1f KB cooked, %.1f KB as RGBA8, %.1fx smaller\n", total.CookedBytes / 1024.0,
+			total.SourceBytes / 1024.0, (double)total.SourceBytes / total.CookedBytes);
+	}
+
+	return failed ? 1 : 0;
+}